@@ -0,0 +1,214 @@
+//--------------------------------------------------------------------------------------
+// File: Animation.h
+//
+// Keyframe animation clips for skinned and rigid-body models
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <DirectXMath.h>
+
+#ifndef DIRECTX_TOOLKIT_API
+#ifdef DIRECTX_TOOLKIT_EXPORT
+#ifdef __GNUC__
+#define DIRECTX_TOOLKIT_API __attribute__ ((dllexport))
+#else
+#define DIRECTX_TOOLKIT_API __declspec(dllexport)
+#endif
+#elif defined(DIRECTX_TOOLKIT_IMPORT)
+#ifdef __GNUC__
+#define DIRECTX_TOOLKIT_API __attribute__ ((dllimport))
+#else
+#define DIRECTX_TOOLKIT_API __declspec(dllimport)
+#endif
+#else
+#define DIRECTX_TOOLKIT_API
+#endif
+#endif
+
+
+namespace DirectX
+{
+    inline namespace DX11
+    {
+        class Model;
+
+        //------------------------------------------------------------------------------
+        // A relative bone transform kept as scale, rotation and translation so poses can be blended
+        struct AnimationBonePose
+        {
+            XMVECTOR    scale;
+            XMVECTOR    rotation;       // Unit quaternion
+            XMVECTOR    translation;
+        };
+
+        //------------------------------------------------------------------------------
+        // A set of translation/rotation/scale keyframe tracks, one per animated bone
+        class AnimationClip
+        {
+        public:
+            DIRECTX_TOOLKIT_API AnimationClip(AnimationClip&&) noexcept;
+            DIRECTX_TOOLKIT_API AnimationClip& operator= (AnimationClip&&) noexcept;
+
+            AnimationClip(AnimationClip const&) = delete;
+            AnimationClip& operator= (AnimationClip const&) = delete;
+
+            DIRECTX_TOOLKIT_API virtual ~AnimationClip();
+
+            // Properties
+            DIRECTX_TOOLKIT_API const wchar_t* __cdecl GetName() const noexcept;
+            DIRECTX_TOOLKIT_API float __cdecl GetDuration() const noexcept;
+            DIRECTX_TOOLKIT_API size_t __cdecl GetTrackCount() const noexcept;
+
+            // Matches tracks to model bones by name, returning the number of bones animated
+            DIRECTX_TOOLKIT_API size_t __cdecl Bind(const Model& model);
+
+            // Samples relative bone transforms at the given time, which wraps around the clip duration.
+            // Bones without a track keep the model's boneMatrices.
+            DIRECTX_TOOLKIT_API void __cdecl Evaluate(
+                const Model& model,
+                float time,
+                size_t nbones,
+                _Out_writes_(nbones) XMMATRIX* localTransforms) const;
+
+            // Samples bones in decomposed form for blending. Only bones with a track are written,
+            // so the pose should start out as the rest pose.
+            DIRECTX_TOOLKIT_API void __cdecl Evaluate(
+                const Model& model,
+                float time,
+                size_t nbones,
+                _Inout_updates_(nbones) AnimationBonePose* pose) const;
+
+            // Computes the skinning transforms for DrawSkinned at the given time
+            DIRECTX_TOOLKIT_API void __cdecl Apply(
+                const Model& model,
+                float time,
+                size_t nbones,
+                _Out_writes_(nbones) XMMATRIX* boneTransforms) const;
+
+            // Loads an animation from a DirectX SDK .SDKMESH_ANIM file
+            DIRECTX_TOOLKIT_API static std::unique_ptr<AnimationClip> __cdecl CreateFromSDKMESH(
+                _In_reads_bytes_(dataSize) const uint8_t* animData, size_t dataSize);
+            DIRECTX_TOOLKIT_API static std::unique_ptr<AnimationClip> __cdecl CreateFromSDKMESH(
+                _In_z_ const wchar_t* szFileName);
+
+            // Loads an animation clip from a Visual Studio Starter Kit .CMO file using the animsOffset
+            // reported by Model::CreateFromCMO. The first clip is used if no name is given.
+            DIRECTX_TOOLKIT_API static std::unique_ptr<AnimationClip> __cdecl CreateFromCMO(
+                _In_reads_bytes_(dataSize) const uint8_t* meshData, size_t dataSize,
+                size_t animsOffset,
+                _In_opt_z_ const wchar_t* clipName = nullptr);
+            DIRECTX_TOOLKIT_API static std::unique_ptr<AnimationClip> __cdecl CreateFromCMO(
+                _In_z_ const wchar_t* szFileName,
+                size_t animsOffset,
+                _In_opt_z_ const wchar_t* clipName = nullptr);
+
+        #ifdef __cpp_lib_byte
+            static std::unique_ptr<AnimationClip> __cdecl CreateFromSDKMESH(
+                _In_reads_bytes_(dataSize) const std::byte* animData, size_t dataSize)
+            {
+                return CreateFromSDKMESH(reinterpret_cast<const uint8_t*>(animData), dataSize);
+            }
+
+            static std::unique_ptr<AnimationClip> __cdecl CreateFromCMO(
+                _In_reads_bytes_(dataSize) const std::byte* meshData, size_t dataSize,
+                size_t animsOffset,
+                _In_opt_z_ const wchar_t* clipName = nullptr)
+            {
+                return CreateFromCMO(reinterpret_cast<const uint8_t*>(meshData), dataSize, animsOffset, clipName);
+            }
+        #endif // __cpp_lib_byte
+
+        #if defined(_MSC_VER) && !defined(_NATIVE_WCHAR_T_DEFINED)
+            DIRECTX_TOOLKIT_API static std::unique_ptr<AnimationClip> __cdecl CreateFromSDKMESH(
+                _In_z_ const __wchar_t* szFileName);
+
+            DIRECTX_TOOLKIT_API static std::unique_ptr<AnimationClip> __cdecl CreateFromCMO(
+                _In_z_ const __wchar_t* szFileName,
+                size_t animsOffset,
+                _In_opt_z_ const __wchar_t* clipName = nullptr);
+        #endif // !_NATIVE_WCHAR_T_DEFINED
+
+        private:
+            AnimationClip();
+
+            class Impl;
+
+            std::unique_ptr<Impl> pImpl;
+        };
+
+
+        //------------------------------------------------------------------------------
+        // Layered blending of animation clips for many instances of a model
+        enum AnimationBlendMode : uint32_t
+        {
+            AnimationBlend_Override = 0,    // Weighted blend with the other override layers
+            AnimationBlend_Additive,        // Adds the clip's difference from the rest pose
+        };
+
+        struct AnimationLayer
+        {
+            const AnimationClip*    clip;       // Layers without a clip or weight are skipped
+            float                   time;
+            float                   weight;
+            AnimationBlendMode      mode;
+            const float*            boneMask;   // Optional weight per model bone, or nullptr for all bones
+        };
+
+        // Override layers are combined by normalized weight, with rotations blended by quaternion
+        // nlerp, and topped up with the rest pose where their weights sum to less than one. Additive
+        // layers are then applied in order. Crossfading is two override layers whose weights sum
+        // to one. The rest pose is the model's boneMatrices when the blender is created; the
+        // model must outlive the blender and the clips must be bound to it.
+        class AnimationBlender
+        {
+        public:
+            DIRECTX_TOOLKIT_API explicit AnimationBlender(const Model& model);
+
+            DIRECTX_TOOLKIT_API AnimationBlender(AnimationBlender&&) noexcept;
+            DIRECTX_TOOLKIT_API AnimationBlender& operator= (AnimationBlender&&) noexcept;
+
+            AnimationBlender(AnimationBlender const&) = delete;
+            AnimationBlender& operator= (AnimationBlender const&) = delete;
+
+            DIRECTX_TOOLKIT_API virtual ~AnimationBlender();
+
+            // Blends layerCount layers per instance, with the layers of instance i starting at
+            // layers[i * layerCount], into relative bone transforms stored nbones per instance.
+            // Work is split across up to threadCount threads of the shared worker pool.
+            DIRECTX_TOOLKIT_API void __cdecl Blend(
+                size_t instanceCount,
+                size_t layerCount,
+                _In_reads_(instanceCount * layerCount) const AnimationLayer* layers,
+                size_t nbones,
+                _Out_writes_(instanceCount * nbones) XMMATRIX* localTransforms,
+                unsigned int threadCount = 1) const;
+
+            // Blends and then computes the skinning transforms for DrawSkinned, as AnimationClip::Apply does
+            DIRECTX_TOOLKIT_API void __cdecl Apply(
+                size_t instanceCount,
+                size_t layerCount,
+                _In_reads_(instanceCount * layerCount) const AnimationLayer* layers,
+                size_t nbones,
+                _Out_writes_(instanceCount * nbones) XMMATRIX* boneTransforms,
+                unsigned int threadCount = 1) const;
+
+            DIRECTX_TOOLKIT_API const AnimationBonePose* __cdecl GetRestPose() const noexcept;
+
+        private:
+            class Impl;
+
+            std::unique_ptr<Impl> pImpl;
+        };
+    }
+}
@@ -159,6 +159,11 @@ namespace DirectX
             virtual void __cdecl SetBoneTransforms(_In_reads_(count) XMMATRIX const* value, size_t count) = 0;
             virtual void __cdecl ResetBoneTransforms() = 0;
 
+            // Sets bone i to value[indices[i]], as used for mesh bone influences
+            virtual void __cdecl GatherBoneTransforms(
+                _In_reads_(count) const uint32_t* indices, size_t count,
+                _In_reads_(nbones) XMMATRIX const* value, size_t nbones);
+
             static constexpr int MaxBones = 72;
 
         protected:
@@ -493,6 +498,7 @@ namespace DirectX
             // Animation settings.
             DIRECTX_TOOLKIT_API void __cdecl SetWeightsPerVertex(int value) override;
             DIRECTX_TOOLKIT_API void __cdecl SetBoneTransforms(_In_reads_(count) XMMATRIX const* value, size_t count) override;
+            DIRECTX_TOOLKIT_API void __cdecl GatherBoneTransforms(_In_reads_(count) const uint32_t* indices, size_t count, _In_reads_(nbones) XMMATRIX const* value, size_t nbones) override;
             DIRECTX_TOOLKIT_API void __cdecl ResetBoneTransforms() override;
 
             // Normal compression settings.
@@ -608,6 +614,7 @@ namespace DirectX
             // Animation settings.
             void __cdecl SetWeightsPerVertex(int value) override;
             void __cdecl SetBoneTransforms(_In_reads_(count) XMMATRIX const* value, size_t count) override;
+            void __cdecl GatherBoneTransforms(_In_reads_(count) const uint32_t* indices, size_t count, _In_reads_(nbones) XMMATRIX const* value, size_t nbones) override;
             void __cdecl ResetBoneTransforms() override;
         };
 
@@ -712,6 +719,7 @@ namespace DirectX
             // Animation settings.
             void __cdecl SetWeightsPerVertex(int value) override;
             void __cdecl SetBoneTransforms(_In_reads_(count) XMMATRIX const* value, size_t count) override;
+            void __cdecl GatherBoneTransforms(_In_reads_(count) const uint32_t* indices, size_t count, _In_reads_(nbones) XMMATRIX const* value, size_t nbones) override;
             void __cdecl ResetBoneTransforms() override;
         };
 
@@ -821,6 +829,7 @@ namespace DirectX
             // Animation settings.
             void __cdecl SetWeightsPerVertex(int value) override;
             void __cdecl SetBoneTransforms(_In_reads_(count) XMMATRIX const* value, size_t count) override;
+            void __cdecl GatherBoneTransforms(_In_reads_(count) const uint32_t* indices, size_t count, _In_reads_(nbones) XMMATRIX const* value, size_t nbones) override;
             void __cdecl ResetBoneTransforms() override;
         };
 
@@ -1001,6 +1010,7 @@ namespace DirectX
             // Animation settings.
             void __cdecl SetWeightsPerVertex(int value) override;
             void __cdecl SetBoneTransforms(_In_reads_(count) XMMATRIX const* value, size_t count) override;
+            void __cdecl GatherBoneTransforms(_In_reads_(count) const uint32_t* indices, size_t count, _In_reads_(nbones) XMMATRIX const* value, size_t nbones) override;
             void __cdecl ResetBoneTransforms() override;
         };
 
@@ -1062,6 +1072,16 @@ namespace DirectX
                 _In_opt_ ID3D11DeviceContext* deviceContext,
                 _Outptr_ ID3D11ShaderResourceView** textureView) = 0;
 
+            // Returns a view the factory has already loaded and cached for 'name' without
+            // loading anything. Factories without a texture cache return false.
+            virtual bool __cdecl GetCachedTexture(
+                _In_z_ const wchar_t* /*name*/,
+                _Outptr_result_maybenull_ ID3D11ShaderResourceView** textureView)
+            {
+                *textureView = nullptr;
+                return false;
+            }
+
         protected:
             IEffectFactory() = default;
             IEffectFactory(IEffectFactory&&) = default;
@@ -1091,6 +1111,9 @@ namespace DirectX
                 _In_z_ const wchar_t* name,
                 _In_opt_ ID3D11DeviceContext* deviceContext,
                 _Outptr_ ID3D11ShaderResourceView** textureView) override;
+            DIRECTX_TOOLKIT_API bool __cdecl GetCachedTexture(
+                _In_z_ const wchar_t* name,
+                _Outptr_result_maybenull_ ID3D11ShaderResourceView** textureView) override;
 
             // Settings.
             DIRECTX_TOOLKIT_API void __cdecl ReleaseCache();
@@ -1135,6 +1158,9 @@ namespace DirectX
                 _In_z_ const wchar_t* name,
                 _In_opt_ ID3D11DeviceContext* deviceContext,
                 _Outptr_ ID3D11ShaderResourceView** textureView) override;
+            DIRECTX_TOOLKIT_API bool __cdecl GetCachedTexture(
+                _In_z_ const wchar_t* name,
+                _Outptr_result_maybenull_ ID3D11ShaderResourceView** textureView) override;
 
             // Settings.
             DIRECTX_TOOLKIT_API void __cdecl ReleaseCache();
@@ -1178,6 +1204,9 @@ namespace DirectX
                 _In_z_ const wchar_t* name,
                 _In_opt_ ID3D11DeviceContext* deviceContext,
                 _Outptr_ ID3D11ShaderResourceView** textureView) override;
+            DIRECTX_TOOLKIT_API bool __cdecl GetCachedTexture(
+                _In_z_ const wchar_t* name,
+                _Outptr_result_maybenull_ ID3D11ShaderResourceView** textureView) override;
 
             // Settings.
             DIRECTX_TOOLKIT_API void __cdecl ReleaseCache();
@@ -1227,6 +1256,9 @@ namespace DirectX
                 _In_z_ const wchar_t* name,
                 _In_opt_ ID3D11DeviceContext* deviceContext,
                 _Outptr_ ID3D11ShaderResourceView** textureView) override;
+            DIRECTX_TOOLKIT_API bool __cdecl GetCachedTexture(
+                _In_z_ const wchar_t* name,
+                _Outptr_result_maybenull_ ID3D11ShaderResourceView** textureView) override;
 
             // DGSL methods.
             struct DIRECTX_TOOLKIT_API DGSLEffectInfo : public EffectInfo
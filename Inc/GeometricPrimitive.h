@@ -57,6 +57,12 @@ namespace DirectX
             using VertexCollection = std::vector<VertexType>;
             using IndexCollection = std::vector<uint16_t>;
 
+            using PackedVertexType = VertexPositionNormalTexturePacked;
+            using PackedVertexCollection = std::vector<PackedVertexType>;
+
+            using TangentVertexType = VertexPositionNormalTangentColorTexture;
+            using TangentVertexCollection = std::vector<TangentVertexType>;
+
             DIRECTX_TOOLKIT_API virtual ~GeometricPrimitive();
 
             // Factory methods.
@@ -173,6 +179,36 @@ namespace DirectX
                 float size = 1, size_t tessellation = 8,
                 bool rhcoords = true);
 
+            // Vertex/Index methods with tangent frames (analytic for sphere, cylinder, and torus).
+            DIRECTX_TOOLKIT_API static void __cdecl CreateSphere(
+                TangentVertexCollection& vertices,
+                IndexCollection& indices,
+                float diameter = 1, size_t tessellation = 16,
+                bool rhcoords = true, bool invertn = false);
+            DIRECTX_TOOLKIT_API static void __cdecl CreateCylinder(
+                TangentVertexCollection& vertices,
+                IndexCollection& indices,
+                float height = 1, float diameter = 1, size_t tessellation = 32,
+                bool rhcoords = true);
+            DIRECTX_TOOLKIT_API static void __cdecl CreateTorus(
+                TangentVertexCollection& vertices,
+                IndexCollection& indices,
+                float diameter = 1, float thickness = 0.333f, size_t tessellation = 32,
+                bool rhcoords = true);
+
+            // Computes tangent frames for any of the generated shapes (or custom geometry) from
+            // the texture mapping, with corner-angle weighting.
+            DIRECTX_TOOLKIT_API static void __cdecl ComputeTangents(
+                const VertexCollection& vertices,
+                const IndexCollection& indices,
+                TangentVertexCollection& result);
+
+            // Quantizes generated vertices to the 16-byte packed format (half-float position,
+            // biased R10G10B10A2 normal, UNORM16 texture coordinates).
+            DIRECTX_TOOLKIT_API static void __cdecl PackVertices(
+                const VertexCollection& vertices,
+                PackedVertexCollection& packed);
+
             // Draw the primitive.
             DIRECTX_TOOLKIT_API void XM_CALLCONV Draw(
                 FXMMATRIX world, CXMMATRIX view, CXMMATRIX projection,
@@ -206,6 +242,11 @@ namespace DirectX
                 s_reversez = reverseZ;
             }
 
+            // The factory methods share a process-wide cache of generated vertex/index data,
+            // so recreating a primitive is just an upload. A limit of 0 disables the cache.
+            DIRECTX_TOOLKIT_API static void __cdecl SetGeometryCacheLimit(size_t bytes);
+            DIRECTX_TOOLKIT_API static void __cdecl PurgeGeometryCache();
+
         private:
             DIRECTX_TOOLKIT_API static bool s_reversez;
 
@@ -0,0 +1,132 @@
+//--------------------------------------------------------------------------------------
+// File: Meshlets.h
+//
+// Splits indexed triangle lists into bounded clusters for fine-grained CPU culling
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#if defined(_XBOX_ONE) && defined(_TITLE)
+#include <d3d11_x.h>
+#else
+#include <d3d11_1.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#ifndef DIRECTX_TOOLKIT_API
+#ifdef DIRECTX_TOOLKIT_EXPORT
+#ifdef __GNUC__
+#define DIRECTX_TOOLKIT_API __attribute__ ((dllexport))
+#else
+#define DIRECTX_TOOLKIT_API __declspec(dllexport)
+#endif
+#elif defined(DIRECTX_TOOLKIT_IMPORT)
+#ifdef __GNUC__
+#define DIRECTX_TOOLKIT_API __attribute__ ((dllimport))
+#else
+#define DIRECTX_TOOLKIT_API __declspec(dllimport)
+#endif
+#else
+#define DIRECTX_TOOLKIT_API
+#endif
+#endif
+
+
+namespace DirectX
+{
+    inline namespace DX11
+    {
+        class IEffect;
+        class ModelMesh;
+        class ModelMeshPart;
+
+        constexpr size_t MESHLET_DEFAULT_MAX_VERTS = 64;
+        constexpr size_t MESHLET_DEFAULT_MAX_PRIMS = 124;
+
+        //------------------------------------------------------------------------------
+        // A cluster of triangles occupying a contiguous range of a reordered index buffer
+        struct Meshlet
+        {
+            uint32_t        startIndex;
+            uint32_t        indexCount;
+            uint32_t        vertexCount;    // Unique vertices referenced by the cluster
+            BoundingSphere  boundingSphere;
+
+            // Normal cone: the whole cluster faces away from a viewer at 'eye' when
+            // dot(normalize(coneApex - eye), coneAxis) >= coneCutoff. A cutoff of 1 or more
+            // means the triangles face too many directions for the test to be useful.
+            XMFLOAT3        coneApex;
+            XMFLOAT3        coneAxis;
+            float           coneCutoff;
+        };
+
+        struct MeshletRange
+        {
+            uint32_t startIndex;
+            uint32_t indexCount;
+        };
+
+        // Builds clusters from an indexed triangle list. 'positions' points to the float3
+        // position of the first vertex, with successive vertices 'vertexStride' bytes apart.
+        // The triangles are rewritten into 'reorderedIndices' so each meshlet is a single range.
+        // rhcoords follows the GeometricPrimitive winding convention when orienting the cones.
+        DIRECTX_TOOLKIT_API void __cdecl ComputeMeshlets(
+            _In_reads_(nFaces * 3) const uint16_t* indices, size_t nFaces,
+            _In_reads_bytes_(nVerts * vertexStride) const void* positions, size_t vertexStride, size_t nVerts,
+            std::vector<Meshlet>& meshlets,
+            std::vector<uint16_t>& reorderedIndices,
+            bool rhcoords = true,
+            size_t maxVerts = MESHLET_DEFAULT_MAX_VERTS,
+            size_t maxPrims = MESHLET_DEFAULT_MAX_PRIMS);
+
+        DIRECTX_TOOLKIT_API void __cdecl ComputeMeshlets(
+            _In_reads_(nFaces * 3) const uint32_t* indices, size_t nFaces,
+            _In_reads_bytes_(nVerts * vertexStride) const void* positions, size_t vertexStride, size_t nVerts,
+            std::vector<Meshlet>& meshlets,
+            std::vector<uint32_t>& reorderedIndices,
+            bool rhcoords = true,
+            size_t maxVerts = MESHLET_DEFAULT_MAX_VERTS,
+            size_t maxPrims = MESHLET_DEFAULT_MAX_PRIMS);
+
+        // Builds clusters for a loaded model mesh part. The part's index data is read back from
+        // the GPU, and the part is given a new index buffer in meshlet order (startIndex 0).
+        DIRECTX_TOOLKIT_API void __cdecl ComputeMeshlets(
+            _In_ ID3D11DeviceContext* deviceContext,
+            const ModelMesh& mesh,
+            ModelMeshPart& part,
+            std::vector<Meshlet>& meshlets,
+            bool rhcoords = true,
+            size_t maxVerts = MESHLET_DEFAULT_MAX_VERTS,
+            size_t maxPrims = MESHLET_DEFAULT_MAX_PRIMS);
+
+        // Appends the index ranges of clusters that intersect the frustum and are not entirely
+        // back-facing. The frustum and eye position are in world space. Adjacent ranges are merged.
+        DIRECTX_TOOLKIT_API void XM_CALLCONV CullMeshlets(
+            _In_reads_(nMeshlets) const Meshlet* meshlets, size_t nMeshlets,
+            const BoundingFrustum& frustum,
+            FXMMATRIX world,
+            CXMVECTOR eyePosition,
+            std::vector<MeshletRange>& visible);
+
+        // Draws only the given index ranges of a mesh part.
+        DIRECTX_TOOLKIT_API void __cdecl DrawMeshletRanges(
+            _In_ ID3D11DeviceContext* deviceContext,
+            const ModelMeshPart& part,
+            _In_ IEffect* ieffect,
+            _In_ ID3D11InputLayout* iinputLayout,
+            const std::vector<MeshletRange>& ranges,
+            _In_ std::function<void __cdecl()> setCustomState = nullptr);
+    }
+}
@@ -19,6 +19,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <future>
 #include <memory>
 #include <new>
 #include <set>
@@ -62,8 +63,14 @@ namespace DirectX
     {
         class IEffect;
         class IEffectFactory;
+        class IEffectMatrices;
+        class IEffectSkinning;
         class CommonStates;
         class ModelMesh;
+        class ModelMeshGeometry;
+        class ModelBoneTransformPool;
+        class ModelInstanceBuffer;
+        class WorkerThreads;
 
         //------------------------------------------------------------------------------
         // Model loading options
@@ -76,6 +83,11 @@ namespace DirectX
             ModelLoader_AllowLargeModels = 0x8,
             ModelLoader_IncludeBones = 0x10,
             ModelLoader_DisableSkinning = 0x20,
+            ModelLoader_MemoryMappedFile = 0x40,
+            ModelLoader_ConsolidateBuffers = 0x80,
+            ModelLoader_RetainGeometry = 0x100,
+            ModelLoader_CompactVertices = 0x200,
+            ModelLoader_MergeParts = 0x400,
         };
 
         //------------------------------------------------------------------------------
@@ -103,17 +115,18 @@ namespace DirectX
 
             static constexpr uint32_t c_Invalid = uint32_t(-1);
 
-            struct aligned_deleter { void operator()(void* p) noexcept { _aligned_free(p); } };
+            // Arrays from MakeArray or a ModelBoneTransformPool carry a tagged header that records
+            // the pool they came from, if any, so the deleter needs no state. Arrays allocated
+            // with _aligned_malloc may still be owned by a TransformArray and are freed with
+            // _aligned_free.
+            struct aligned_deleter
+            {
+                DIRECTX_TOOLKIT_API void __cdecl operator()(void* p) noexcept;
+            };
 
             using TransformArray = std::unique_ptr<XMMATRIX[], aligned_deleter>;
 
-            static TransformArray MakeArray(size_t count)
-            {
-                void* temp = _aligned_malloc(sizeof(XMMATRIX) * count, 16);
-                if (!temp)
-                    throw std::bad_alloc();
-                return TransformArray(static_cast<XMMATRIX*>(temp));
-            }
+            static TransformArray __cdecl MakeArray(size_t count);
         };
 
 
@@ -148,6 +161,9 @@ namespace DirectX
             std::shared_ptr<InputLayoutCollection>                  vbDecl;
             bool                                                    isAlpha;
 
+            // Vertices from vertexOffset the indices may refer to, or 0 if the loader did not know
+            uint32_t                                                vertexCount;
+
             // Draw mesh part with custom effect
             void __cdecl Draw(
                 _In_ ID3D11DeviceContext* deviceContext,
@@ -168,6 +184,19 @@ namespace DirectX
 
             // Change effect used by part and regenerate input layout (be sure to call Model::Modified as well)
             void __cdecl ModifyEffect(_In_ ID3D11Device* device, _In_ const std::shared_ptr<IEffect>& ieffect, bool isalpha = false);
+
+            // Effect interfaces used when drawing, or nullptr if the effect does not support them
+            IEffectMatrices* __cdecl GetEffectMatrices() const;
+            IEffectSkinning* __cdecl GetEffectSkinning() const;
+
+            // Resolves the effect interfaces once rather than on every draw (done by the loaders,
+            // ModifyEffect, and Model::UpdateEffects; call it after assigning effect directly)
+            void __cdecl UpdateEffectInterfaces() noexcept;
+
+        private:
+            std::weak_ptr<IEffect>  mEffectTag;
+            IEffectMatrices*        mEffectMatrices;
+            IEffectSkinning*        mEffectSkinning;
         };
 
 
@@ -195,6 +224,13 @@ namespace DirectX
             bool                        ccw;
             bool                        pmalpha;
 
+            // CPU copy of the triangles for picking (see ModelPicking.h), or nullptr
+            std::shared_ptr<ModelMeshGeometry> geometry;
+
+            // Decodes positions stored as SNORM16 by ModelLoader_CompactVertices into mesh space
+            float                       positionScale;
+            XMFLOAT3                    positionBias;
+
             using Collection = std::vector<std::shared_ptr<ModelMesh>>;
 
             // Setup states for drawing mesh
@@ -227,6 +263,9 @@ namespace DirectX
                 bool alpha = false,
                 _In_ std::function<void __cdecl()> setCustomState = nullptr) const;
 
+            // World matrix to give the mesh part effects, with the position decode folded in
+            XMMATRIX XM_CALLCONV GetVertexTransform(FXMMATRIX world) const noexcept;
+
             static void SetDepthBufferMode(bool reverseZ)
             {
                 s_reversez = reverseZ;
@@ -250,6 +289,9 @@ namespace DirectX
             Model(Model const& other);
             Model& operator= (Model const& rhs);
 
+            // Copies a model with its bone matrices allocated from a pool
+            Model(Model const& other, ModelBoneTransformPool& pool);
+
             virtual ~Model();
 
             ModelMesh::Collection       meshes;
@@ -258,6 +300,9 @@ namespace DirectX
             ModelBone::TransformArray   invBindPoseMatrices;
             std::wstring                name;
 
+            // Textures the loader requested from the effect factory for the materials
+            std::vector<std::wstring>   textureNames;
+
             // Draw all the meshes in the model
             void XM_CALLCONV Draw(
                 _In_ ID3D11DeviceContext* deviceContext,
@@ -284,7 +329,24 @@ namespace DirectX
                 bool wireframe = false,
                 _In_ std::function<void __cdecl()> setCustomState = nullptr) const;
 
-            // Compute bone positions based on heirarchy and transform matrices
+            // Draw all the meshes once per instance using hardware instancing. The mesh part effects
+            // must support instancing and have it enabled (see NormalMapEffect::SetInstancingEnabled).
+            // Optional per-instance colors are bound to COLOR for parts that lack vertex colors.
+            // The instance data is written to the caller's instance buffer, which must not be
+            // shared between device contexts.
+            void XM_CALLCONV DrawInstanced(
+                _In_ ID3D11DeviceContext* deviceContext,
+                const CommonStates& states,
+                ModelInstanceBuffer& instanceBuffer,
+                size_t instanceCount, _In_reads_(instanceCount) const XMMATRIX* instanceTransforms,
+                FXMMATRIX view, CXMMATRIX projection,
+                _In_reads_opt_(instanceCount) const XMFLOAT4* instanceColors = nullptr,
+                bool wireframe = false,
+                _In_ std::function<void __cdecl()> setCustomState = nullptr) const;
+
+            // Compute bone positions based on heirarchy and transform matrices. The flattened hierarchy
+            // is cached by the loaders and Modified; after editing childIndex or siblingIndex call
+            // Modified, as only debug builds detect the stale order and flatten the hierarchy again.
             void __cdecl CopyAbsoluteBoneTransformsTo(
                 size_t nbones,
                 _Out_writes_(nbones) XMMATRIX* boneTransforms) const;
@@ -294,6 +356,13 @@ namespace DirectX
                 _In_reads_(nbones) const XMMATRIX* inBoneTransforms,
                 _Out_writes_(nbones) XMMATRIX* outBoneTransforms) const;
 
+            // Compute bone positions for many instances at once, each using nbones consecutive transforms
+            void __cdecl CopyAbsoluteBoneTransforms(
+                size_t instanceCount,
+                size_t nbones,
+                _In_reads_(instanceCount * nbones) const XMMATRIX* inBoneTransforms,
+                _Out_writes_(instanceCount * nbones) XMMATRIX* outBoneTransforms) const;
+
             // Set bone matrices to a set of relative tansforms
             void __cdecl CopyBoneTransformsFrom(
                 size_t nbones,
@@ -304,8 +373,8 @@ namespace DirectX
                 size_t nbones,
                 _Out_writes_(nbones) XMMATRIX* boneTransforms) const;
 
-            // Notify model that effects, parts list, or mesh list has changed
-            void __cdecl Modified() noexcept { mEffectCache.clear(); }
+            // Notify model that effects, parts list, mesh list, or bone hierarchy has changed
+            void __cdecl Modified() noexcept;
 
             // Update all effects used by the model
             void __cdecl UpdateEffects(_In_ std::function<void __cdecl(IEffect*)> setEffect);
@@ -348,6 +417,18 @@ namespace DirectX
                 _In_ std::shared_ptr<IEffect> ieffect = nullptr,
                 ModelLoaderFlags flags = ModelLoader_Clockwise);
 
+            // Loads a model from a baked model file written by ModelDescription::WriteBaked
+            static std::unique_ptr<Model> __cdecl CreateFromBaked(
+                _In_ ID3D11Device* device,
+                _In_reads_bytes_(dataSize) const uint8_t* meshData, _In_ size_t dataSize,
+                _In_ IEffectFactory& fxFactory,
+                ModelLoaderFlags flags = ModelLoader_Clockwise);
+            static std::unique_ptr<Model> __cdecl CreateFromBaked(
+                _In_ ID3D11Device* device,
+                _In_z_ const wchar_t* szFileName,
+                _In_ IEffectFactory& fxFactory,
+                ModelLoaderFlags flags = ModelLoader_Clockwise);
+
         #ifdef __cpp_lib_byte
             static std::unique_ptr<Model> __cdecl CreateFromCMO(
                 _In_ ID3D11Device* device,
@@ -376,6 +457,15 @@ namespace DirectX
             {
                 return CreateFromVBO(device, reinterpret_cast<const uint8_t*>(meshData), dataSize, ieffect, flags);
             }
+
+            static std::unique_ptr<Model> __cdecl CreateFromBaked(
+                _In_ ID3D11Device* device,
+                _In_reads_bytes_(dataSize) const std::byte* meshData, _In_ size_t dataSize,
+                _In_ IEffectFactory& fxFactory,
+                ModelLoaderFlags flags = ModelLoader_Clockwise)
+            {
+                return CreateFromBaked(device, reinterpret_cast<const uint8_t*>(meshData), dataSize, fxFactory, flags);
+            }
         #endif // __cpp_lib_byte
 
         #if defined(_MSC_VER) && !defined(_NATIVE_WCHAR_T_DEFINED)
@@ -397,16 +487,576 @@ namespace DirectX
                 _In_z_ const __wchar_t* szFileName,
                 _In_ std::shared_ptr<IEffect> ieffect = nullptr,
                 ModelLoaderFlags flags = ModelLoader_Clockwise);
+
+            static std::unique_ptr<Model> __cdecl CreateFromBaked(
+                _In_ ID3D11Device* device,
+                _In_z_ const __wchar_t* szFileName,
+                _In_ IEffectFactory& fxFactory,
+                ModelLoaderFlags flags = ModelLoader_Clockwise);
         #endif // !_NATIVE_WCHAR_T_DEFINED
 
         private:
             std::set<IEffect*>  mEffectCache;
 
-            void __cdecl ComputeAbsolute(uint32_t index,
-                CXMMATRIX local, size_t nbones,
-                _In_reads_(nbones) const XMMATRIX* inBoneTransforms,
-                _Inout_updates_(nbones) XMMATRIX* outBoneTransforms,
-                size_t& visited) const;
+            // Bone hierarchy flattened into parent-before-child order, with the child and
+            // sibling links it was built from so debug builds can detect stale orders
+            std::vector<uint32_t>   mBoneOrder;
+            std::vector<uint32_t>   mBoneParents;
+            std::vector<uint32_t>   mBoneLinks;
+
+            Model(Model const& other, _In_opt_ ModelBoneTransformPool* pool);
+
+            void __cdecl UpdateBoneOrder() noexcept;
+            bool __cdecl IsBoneOrderCurrent() const noexcept;
+
+            void __cdecl ComputeBoneOrder(
+                std::vector<uint32_t>& order,
+                std::vector<uint32_t>& parents) const;
+
+            static void __cdecl ComputeAbsolute(
+                size_t count,
+                _In_reads_(count) const uint32_t* order,
+                _In_reads_(count) const uint32_t* parents,
+                _In_ const XMMATRIX* inBoneTransforms,
+                _Inout_ XMMATRIX* outBoneTransforms) noexcept;
+        };
+
+
+        //------------------------------------------------------------------------------
+        // Per-instance vertex data and instancing input layouts for Model::DrawInstanced. The
+        // buffer is a ring written without synchronization, so each device context needs its
+        // own. Input layouts are cached per vertex declaration and effect, and entries whose
+        // declaration or effect has been released are dropped when new layouts are created.
+        class ModelInstanceBuffer
+        {
+        public:
+            DIRECTX_TOOLKIT_API ModelInstanceBuffer() noexcept(false);
+
+            DIRECTX_TOOLKIT_API ModelInstanceBuffer(ModelInstanceBuffer&&) noexcept;
+            DIRECTX_TOOLKIT_API ModelInstanceBuffer& operator= (ModelInstanceBuffer&&) noexcept;
+
+            ModelInstanceBuffer(ModelInstanceBuffer const&) = delete;
+            ModelInstanceBuffer& operator= (ModelInstanceBuffer const&) = delete;
+
+            DIRECTX_TOOLKIT_API virtual ~ModelInstanceBuffer();
+
+            // Releases the instance buffer and the cached input layouts
+            DIRECTX_TOOLKIT_API void __cdecl Reset() noexcept;
+
+        private:
+            friend class Model;
+
+            class Impl;
+
+            std::unique_ptr<Impl> pImpl;
+        };
+
+
+        //------------------------------------------------------------------------------
+        // Recycles bone transform arrays for many model instances. Requests are rounded up to
+        // power-of-two size classes carved from large slabs, and released arrays go on a free
+        // list for their class rather than back to the heap. Safe to use from several threads.
+        // The pool must outlive the arrays it hands out.
+        class ModelBoneTransformPool
+        {
+        public:
+            DIRECTX_TOOLKIT_API explicit ModelBoneTransformPool(size_t slabSize = 256 * 1024);
+
+            ModelBoneTransformPool(ModelBoneTransformPool&&) = delete;
+            ModelBoneTransformPool& operator= (ModelBoneTransformPool&&) = delete;
+
+            ModelBoneTransformPool(ModelBoneTransformPool const&) = delete;
+            ModelBoneTransformPool& operator= (ModelBoneTransformPool const&) = delete;
+
+            DIRECTX_TOOLKIT_API virtual ~ModelBoneTransformPool();
+
+            // Drop-in for ModelBone::MakeArray; the contents are uninitialized
+            DIRECTX_TOOLKIT_API ModelBone::TransformArray __cdecl Allocate(size_t count);
+
+            // Bytes held in slabs and in arrays too large for a size class
+            DIRECTX_TOOLKIT_API size_t __cdecl GetReservedBytes() const noexcept;
+
+            // Arrays handed out and not yet released
+            DIRECTX_TOOLKIT_API size_t __cdecl GetArrayCount() const noexcept;
+
+        private:
+            friend struct ModelBone::aligned_deleter;
+
+            void __cdecl Release(_In_ void* p) noexcept;
+
+            class Impl;
+
+            std::unique_ptr<Impl> pImpl;
+        };
+
+        // Bone transforms for many instances of one skeleton stored back to back, nbones per
+        // instance, in the layout the batched Model::CopyAbsoluteBoneTransforms expects, so
+        // hierarchy evaluation and skinning stream through memory. Adding instances may move
+        // the storage; removing one moves the last instance into its slot.
+        class DIRECTX_TOOLKIT_API ModelBoneTransformBatch
+        {
+        public:
+            explicit ModelBoneTransformBatch(size_t nbones, _In_opt_ ModelBoneTransformPool* pool = nullptr);
+
+            ModelBoneTransformBatch(ModelBoneTransformBatch&&) = default;
+            ModelBoneTransformBatch& operator= (ModelBoneTransformBatch&&) = default;
+
+            ModelBoneTransformBatch(ModelBoneTransformBatch const&) = delete;
+            ModelBoneTransformBatch& operator= (ModelBoneTransformBatch const&) = delete;
+
+            virtual ~ModelBoneTransformBatch() = default;
+
+            // Returns the index of the new instance, set to 'transforms' or to identity
+            size_t __cdecl AddInstance(_In_reads_opt_(nbones) const XMMATRIX* transforms = nullptr);
+
+            void __cdecl RemoveInstance(size_t index);
+
+            void __cdecl Reserve(size_t instanceCount);
+
+            void __cdecl Clear() noexcept { mInstanceCount = 0; }
+
+            XMMATRIX* __cdecl GetInstance(size_t index) noexcept;
+            const XMMATRIX* __cdecl GetInstance(size_t index) const noexcept;
+
+            XMMATRIX* __cdecl GetData() noexcept { return mData.get(); }
+            const XMMATRIX* __cdecl GetData() const noexcept { return mData.get(); }
+
+            size_t __cdecl GetBoneCount() const noexcept { return mBoneCount; }
+            size_t __cdecl GetInstanceCount() const noexcept { return mInstanceCount; }
+            size_t __cdecl GetCapacity() const noexcept { return mCapacity; }
+
+        private:
+            ModelBone::TransformArray   mData;
+            ModelBoneTransformPool*     mPool;
+            size_t                      mBoneCount;
+            size_t                      mInstanceCount;
+            size_t                      mCapacity;
+        };
+
+
+        //------------------------------------------------------------------------------
+        // Frustum culling of model meshes for many model instances at once
+        struct ModelMeshVisibility
+        {
+            uint32_t    instanceIndex;
+            uint32_t    meshIndex;
+        };
+
+        class DIRECTX_TOOLKIT_API ModelCuller
+        {
+        public:
+            ModelCuller() = default;
+
+            ModelCuller(ModelCuller&&) = default;
+            ModelCuller& operator= (ModelCuller&&) = default;
+
+            ModelCuller(ModelCuller const&) = delete;
+            ModelCuller& operator= (ModelCuller const&) = delete;
+
+            virtual ~ModelCuller() = default;
+
+            // Tests the world-space bounding sphere of every mesh of each (model, world) instance
+            // against a world-space frustum, replacing 'visible' with the meshes that may be
+            // visible in instance order. Work is split across up to threadCount threads, which
+            // are shared with other cullers and kept between calls.
+            void __cdecl Cull(
+                const BoundingFrustum& frustum,
+                size_t instanceCount,
+                _In_reads_(instanceCount) const Model* const* models,
+                _In_reads_(instanceCount) const XMMATRIX* worlds,
+                std::vector<ModelMeshVisibility>& visible,
+                unsigned int threadCount = 1);
+
+        private:
+            std::vector<std::vector<ModelMeshVisibility>> mThreadResults;
+            std::shared_ptr<WorkerThreads> mWorkers;
+        };
+
+
+        //------------------------------------------------------------------------------
+        // Shared vertex and index buffers for many models. Adding a model copies its buffers
+        // on the GPU into large arena buffers, grouped by vertex stride or index format, and
+        // rewrites the mesh part base vertex and start index to match. Space is not reclaimed
+        // when models are released; Reset drops the arena's references to its buffers.
+        class DIRECTX_TOOLKIT_API ModelBufferArena
+        {
+        public:
+            explicit ModelBufferArena(size_t blockSize = 16 * 1024 * 1024);
+
+            ModelBufferArena(ModelBufferArena&&) = default;
+            ModelBufferArena& operator= (ModelBufferArena&&) = default;
+
+            ModelBufferArena(ModelBufferArena const&) = delete;
+            ModelBufferArena& operator= (ModelBufferArena const&) = delete;
+
+            virtual ~ModelBufferArena() = default;
+
+            // Moves the model's vertex and index buffers into the arena. Buffers larger than the
+            // block size, or used with more than one stride or index format, are left in place.
+            void __cdecl Add(_In_ ID3D11DeviceContext* deviceContext, Model& model);
+
+            void __cdecl Reset() noexcept;
+
+            size_t __cdecl GetBufferCount() const noexcept { return mBlocks.size(); }
+            size_t __cdecl GetUsedBytes() const noexcept;
+
+        private:
+            struct Block
+            {
+                Microsoft::WRL::ComPtr<ID3D11Buffer>    buffer;
+                UINT                                    bindFlags;
+                UINT                                    elementSize;
+                UINT                                    used;
+            };
+
+            std::vector<Block>  mBlocks;
+            size_t              mBlockSize;
+        };
+
+
+        //------------------------------------------------------------------------------
+        // Largest differences between the vertices of a model loaded with and without
+        // ModelLoader_CompactVertices, for deciding whether the compact encodings are
+        // acceptable for an asset.
+        struct ModelCompactionError
+        {
+            float       position;       // Distance in mesh space
+            float       normal;         // Angle in radians
+            float       tangent;        // Angle in radians
+            float       texcoord;       // Per component
+            size_t      vertexCount;
+        };
+
+        // Both models must come from the same file. The vertices used by their triangle list
+        // parts are read back from the GPU and decoded.
+        DIRECTX_TOOLKIT_API ModelCompactionError __cdecl MeasureVertexCompaction(
+            _In_ ID3D11DeviceContext* deviceContext,
+            const Model& original,
+            const Model& compacted);
+
+
+        //------------------------------------------------------------------------------
+        // Geometry counts and memory use of one or more models, for budgets and for finding
+        // the heaviest meshes. Buffers shared between mesh parts or models, such as those from
+        // ModelLoader_ConsolidateBuffers or a ModelBufferArena, and meshes shared by copies of
+        // a model are counted once.
+        class DIRECTX_TOOLKIT_API ModelStatistics
+        {
+        public:
+            struct MeshStatistics
+            {
+                std::wstring    modelName;
+                std::wstring    meshName;
+                size_t          partCount;
+                size_t          vertexCount;
+                size_t          indexCount;
+                size_t          triangleCount;  // Triangle lists and strips
+                size_t          vertexBytes;    // Vertex data referenced by the parts
+                size_t          indexBytes;     // Index data drawn by the parts
+            };
+
+            struct Totals
+            {
+                size_t  modelCount;
+                size_t  meshCount;
+                size_t  partCount;
+                size_t  vertexCount;
+                size_t  indexCount;
+                size_t  triangleCount;
+                size_t  vertexBufferCount;
+                size_t  vertexBufferBytes;
+                size_t  indexBufferCount;
+                size_t  indexBufferBytes;
+                size_t  textureCount;
+                size_t  textureBytes;
+                size_t  textureMisses;          // Names with no view in the factory cache
+            };
+
+            ModelStatistics() noexcept;
+
+            ModelStatistics(ModelStatistics&&) = default;
+            ModelStatistics& operator= (ModelStatistics&&) = default;
+
+            ModelStatistics(ModelStatistics const&) = delete;
+            ModelStatistics& operator= (ModelStatistics const&) = delete;
+
+            virtual ~ModelStatistics() = default;
+
+            // Adds the meshes of a model. With a factory, the textures in Model::textureNames that
+            // are in its texture cache are counted; nothing is loaded, so textures the factory has
+            // not loaded with sharing enabled are counted as misses.
+            void __cdecl Add(const Model& model, _In_opt_ IEffectFactory* fxFactory = nullptr);
+
+            void __cdecl Reset() noexcept;
+
+            const Totals& __cdecl GetTotals() const noexcept { return mTotals; }
+            const std::vector<MeshStatistics>& __cdecl GetMeshes() const noexcept { return mMeshes; }
+
+            // Text summary of the totals and the meshes with the most vertex and index data
+            std::wstring __cdecl GetReport(size_t maxMeshes = 10) const;
+
+        private:
+            Totals                                              mTotals;
+            std::vector<MeshStatistics>                         mMeshes;
+            std::set<std::shared_ptr<ModelMesh>>                mMeshRefs;
+            std::set<Microsoft::WRL::ComPtr<ID3D11Resource>>    mResources;
+            std::set<std::pair<ID3D11Buffer*, int32_t>>         mVertexRanges;
+        };
+
+
+        //------------------------------------------------------------------------------
+        // Software skinning of vertex positions, normals and tangents on the CPU, for skeletons
+        // with more than IEffectSkinning::MaxBones bones or when vertex shading is the bottleneck.
+        // Skinned vertices keep their original layout and are drawn with non-skinning effects.
+        class ModelSkinner
+        {
+        public:
+            DIRECTX_TOOLKIT_API ModelSkinner();
+
+            DIRECTX_TOOLKIT_API ModelSkinner(ModelSkinner&&) noexcept;
+            DIRECTX_TOOLKIT_API ModelSkinner& operator= (ModelSkinner&&) noexcept;
+
+            ModelSkinner(ModelSkinner const&) = delete;
+            ModelSkinner& operator= (ModelSkinner const&) = delete;
+
+            DIRECTX_TOOLKIT_API virtual ~ModelSkinner();
+
+            // Reads back the vertices of every mesh part with BLENDINDICES and BLENDWEIGHT inputs.
+            // The vertices a mesh draws from one vertex buffer are skinned once for all its parts.
+            DIRECTX_TOOLKIT_API void __cdecl AddModel(
+                _In_ ID3D11DeviceContext* deviceContext,
+                const Model& model);
+
+            // Adds CPU-side vertices in the layout described by vbDecl, returning the stream index.
+            // Blend indices are mapped through boneInfluences when provided. These streams are not drawn.
+            DIRECTX_TOOLKIT_API size_t __cdecl AddVertices(
+                const ModelMeshPart::InputLayoutCollection& vbDecl,
+                uint32_t vertexStride,
+                size_t vertexCount,
+                _In_reads_bytes_(vertexCount * vertexStride) const void* vertices,
+                size_t nInfluences = 0,
+                _In_reads_opt_(nInfluences) const uint32_t* boneInfluences = nullptr);
+
+            // Skins every stream with the given model bone transforms, as passed to Model::DrawSkinned.
+            // Streams are split across up to threadCount threads of the shared worker pool.
+            // No device is required.
+            DIRECTX_TOOLKIT_API void __cdecl Skin(
+                size_t nbones,
+                _In_reads_(nbones) const XMMATRIX* boneTransforms,
+                unsigned int threadCount = 1);
+
+            // Copies the skinned vertices into dynamic vertex buffers
+            DIRECTX_TOOLKIT_API void __cdecl Update(_In_ ID3D11DeviceContext* deviceContext);
+
+            // Sets the non-skinning effect used to draw the skinned mesh parts
+            DIRECTX_TOOLKIT_API void __cdecl SetEffect(
+                _In_ ID3D11Device* device,
+                const std::shared_ptr<IEffect>& ieffect);
+
+            DIRECTX_TOOLKIT_API void __cdecl SetEffect(
+                _In_ ID3D11Device* device,
+                const ModelMeshPart& part,
+                const std::shared_ptr<IEffect>& ieffect);
+
+            // Draws the skinned mesh parts of the added models, opaque parts first
+            DIRECTX_TOOLKIT_API void XM_CALLCONV Draw(
+                _In_ ID3D11DeviceContext* deviceContext,
+                const CommonStates& states,
+                FXMMATRIX world,
+                CXMMATRIX view,
+                CXMMATRIX projection,
+                bool wireframe = false,
+                _In_ std::function<void __cdecl()> setCustomState = nullptr) const;
+
+            // Properties
+            DIRECTX_TOOLKIT_API size_t __cdecl GetStreamCount() const noexcept;
+            DIRECTX_TOOLKIT_API size_t __cdecl GetVertexCount(size_t stream) const;
+            DIRECTX_TOOLKIT_API const void* __cdecl GetSkinnedVertices(size_t stream) const;
+
+        private:
+            class Impl;
+
+            std::unique_ptr<Impl> pImpl;
+        };
+
+
+        //------------------------------------------------------------------------------
+        // A list of mesh parts from one or more models sorted to minimize state changes.
+        // Opaque parts are ordered by effect, input layout and buffers; alpha parts keep the
+        // order they were added in. The models must outlive the list.
+        class DIRECTX_TOOLKIT_API ModelDrawList
+        {
+        public:
+            struct Statistics
+            {
+                size_t  drawCalls;
+                size_t  effectApplies;
+                size_t  effectAppliesSkipped;   // Redundant IEffect::Apply calls avoided
+                size_t  stateChanges;           // IASet* and RSSetState calls issued
+                size_t  stateChangesSkipped;    // Redundant IASet* and RSSetState calls avoided
+            };
+
+            ModelDrawList() noexcept;
+
+            ModelDrawList(ModelDrawList&&) = default;
+            ModelDrawList& operator= (ModelDrawList&&) = default;
+
+            ModelDrawList(ModelDrawList const&) = delete;
+            ModelDrawList& operator= (ModelDrawList const&) = delete;
+
+            virtual ~ModelDrawList();
+
+            // Adds all the meshes in a model
+            void XM_CALLCONV Add(const Model& model, FXMMATRIX world);
+
+            // Adds all the meshes in a model using model bones
+            void XM_CALLCONV Add(
+                const Model& model,
+                size_t nbones, _In_reads_(nbones) const XMMATRIX* boneTransforms,
+                FXMMATRIX world);
+
+            void __cdecl Clear() noexcept;
+
+            // Sorts the opaque parts (done automatically by Draw when needed)
+            void __cdecl Compile();
+
+            // Draws all the opaque parts followed by all the alpha parts. A setCustomState hook is
+            // invoked for every part, so no state is reused across parts when one is provided.
+            void XM_CALLCONV Draw(
+                _In_ ID3D11DeviceContext* deviceContext,
+                const CommonStates& states,
+                FXMMATRIX view, CXMMATRIX projection,
+                bool wireframe = false,
+                _In_ std::function<void __cdecl()> setCustomState = nullptr);
+
+            // Counters from the most recent Draw
+            const Statistics& __cdecl GetStatistics() const noexcept { return mStats; }
+
+            size_t __cdecl GetPartCount() const noexcept { return mOpaque.size() + mAlpha.size(); }
+
+        private:
+            struct Entry
+            {
+                const ModelMeshPart*    part;
+                const ModelMesh*        mesh;
+                uint32_t                worldIndex;
+            };
+
+            std::vector<Entry>          mOpaque;
+            std::vector<Entry>          mAlpha;
+            std::vector<XMFLOAT4X4>     mWorlds;
+            Statistics                  mStats;
+            bool                        mSorted;
+
+            void XM_CALLCONV AddMesh(const ModelMesh& mesh, FXMMATRIX world);
+
+            void XM_CALLCONV DrawEntries(
+                _In_ ID3D11DeviceContext* deviceContext,
+                const CommonStates& states,
+                const std::vector<Entry>& entries,
+                bool alpha,
+                FXMMATRIX view, CXMMATRIX projection,
+                bool wireframe,
+                const std::function<void __cdecl()>& setCustomState);
+        };
+
+        //------------------------------------------------------------------------------
+        // Two-phase model loading: a model file is read and validated on the CPU without a
+        // device, and the device objects are created from it afterwards on any thread.
+        enum ModelFileFormat : uint32_t
+        {
+            ModelFile_SDKMESH = 0,
+            ModelFile_CMO,
+            ModelFile_VBO,
+            ModelFile_Baked,
+        };
+
+        class ModelDescription
+        {
+        public:
+            DIRECTX_TOOLKIT_API ModelDescription(ModelDescription&&) noexcept;
+            DIRECTX_TOOLKIT_API ModelDescription& operator= (ModelDescription&&) noexcept;
+
+            ModelDescription(ModelDescription const&) = delete;
+            ModelDescription& operator= (ModelDescription const&) = delete;
+
+            DIRECTX_TOOLKIT_API virtual ~ModelDescription();
+
+            // Phase one: reads and validates a model file into its meshes, parts, vertex formats,
+            // materials, bones, and buffer contents. Does not require a device. CMO materials are
+            // described for IEffectFactory, with their UV transforms applied to the texture
+            // coordinates; use Model::CreateFromCMO with a DGSLEffectFactory for DGSL shaders.
+            DIRECTX_TOOLKIT_API static std::unique_ptr<ModelDescription> __cdecl CreateFromMemory(
+                ModelFileFormat format,
+                _In_reads_bytes_(dataSize) const uint8_t* meshData, size_t dataSize,
+                ModelLoaderFlags flags = ModelLoader_Clockwise);
+            DIRECTX_TOOLKIT_API static std::unique_ptr<ModelDescription> __cdecl CreateFromFile(
+                ModelFileFormat format,
+                _In_z_ const wchar_t* szFileName,
+                ModelLoaderFlags flags = ModelLoader_Clockwise);
+
+            // Loads every texture referenced by the materials through the factory on the shared
+            // worker threads. With factory sharing enabled, phase two then finds them cached.
+            DIRECTX_TOOLKIT_API void __cdecl RequestTextures(IEffectFactory& fxFactory) const;
+
+            // Phase two: creates the buffers, effects, and input layouts of a new model from the
+            // description. For VBO files a default effect is used.
+            DIRECTX_TOOLKIT_API std::unique_ptr<Model> __cdecl CreateModel(
+                _In_ ID3D11Device* device,
+                IEffectFactory& fxFactory) const;
+
+            // Writes the description out as a baked model file for Model::CreateFromBaked.
+            // Does not require a device.
+            DIRECTX_TOOLKIT_API void __cdecl WriteBaked(_In_z_ const wchar_t* szFileName) const;
+
+            // Runs phase two on a worker thread. The factory must outlive the returned future.
+            DIRECTX_TOOLKIT_API static std::future<std::unique_ptr<Model>> __cdecl CreateModelAsync(
+                _In_ ID3D11Device* device,
+                IEffectFactory& fxFactory,
+                std::shared_ptr<const ModelDescription> description);
+
+            // Runs both phases for a file on a worker thread, requesting textures concurrently
+            DIRECTX_TOOLKIT_API static std::future<std::unique_ptr<Model>> __cdecl CreateModelAsync(
+                _In_ ID3D11Device* device,
+                IEffectFactory& fxFactory,
+                ModelFileFormat format,
+                _In_z_ const wchar_t* szFileName,
+                ModelLoaderFlags flags = ModelLoader_Clockwise);
+
+            // Properties
+            DIRECTX_TOOLKIT_API ModelFileFormat __cdecl GetFormat() const noexcept;
+            DIRECTX_TOOLKIT_API ModelLoaderFlags __cdecl GetFlags() const noexcept;
+            DIRECTX_TOOLKIT_API const std::wstring& __cdecl GetName() const noexcept;
+            DIRECTX_TOOLKIT_API const uint8_t* __cdecl GetData() const noexcept;
+            DIRECTX_TOOLKIT_API size_t __cdecl GetDataSize() const noexcept;
+            DIRECTX_TOOLKIT_API size_t __cdecl GetMeshCount() const noexcept;
+            DIRECTX_TOOLKIT_API const std::vector<std::wstring>& __cdecl GetTextureNames() const noexcept;
+
+            // Offset of the animation clips in a CMO file for AnimationClip::CreateFromCMO, or 0 if none
+            DIRECTX_TOOLKIT_API size_t __cdecl GetAnimationsOffset() const noexcept;
+
+        #if defined(_MSC_VER) && !defined(_NATIVE_WCHAR_T_DEFINED)
+            DIRECTX_TOOLKIT_API void __cdecl WriteBaked(_In_z_ const __wchar_t* szFileName) const;
+
+            DIRECTX_TOOLKIT_API static std::unique_ptr<ModelDescription> __cdecl CreateFromFile(
+                ModelFileFormat format,
+                _In_z_ const __wchar_t* szFileName,
+                ModelLoaderFlags flags = ModelLoader_Clockwise);
+
+            DIRECTX_TOOLKIT_API static std::future<std::unique_ptr<Model>> __cdecl CreateModelAsync(
+                _In_ ID3D11Device* device,
+                IEffectFactory& fxFactory,
+                ModelFileFormat format,
+                _In_z_ const __wchar_t* szFileName,
+                ModelLoaderFlags flags = ModelLoader_Clockwise);
+        #endif // !_NATIVE_WCHAR_T_DEFINED
+
+        private:
+            class Impl;
+
+            explicit ModelDescription(std::unique_ptr<Impl>&& impl) noexcept;
+
+            std::unique_ptr<Impl> pImpl;
         };
 
     #ifdef __clang__
@@ -0,0 +1,135 @@
+//--------------------------------------------------------------------------------------
+// File: ModelLOD.h
+//
+// Quadric edge-collapse simplification of indexed triangle lists, and level-of-detail
+// selection for models by projected size
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#if defined(_XBOX_ONE) && defined(_TITLE)
+#include <d3d11_x.h>
+#else
+#include <d3d11_1.h>
+#endif
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <DirectXMath.h>
+
+#ifndef DIRECTX_TOOLKIT_API
+#ifdef DIRECTX_TOOLKIT_EXPORT
+#ifdef __GNUC__
+#define DIRECTX_TOOLKIT_API __attribute__ ((dllexport))
+#else
+#define DIRECTX_TOOLKIT_API __declspec(dllexport)
+#endif
+#elif defined(DIRECTX_TOOLKIT_IMPORT)
+#ifdef __GNUC__
+#define DIRECTX_TOOLKIT_API __attribute__ ((dllimport))
+#else
+#define DIRECTX_TOOLKIT_API __declspec(dllimport)
+#endif
+#else
+#define DIRECTX_TOOLKIT_API
+#endif
+#endif
+
+
+namespace DirectX
+{
+    class CommonStates;
+
+    inline namespace DX11
+    {
+        class Model;
+        class ModelMesh;
+        class ModelMeshPart;
+
+        // Reduces an indexed triangle list by collapsing edges in order of quadric error, keeping
+        // the original vertices so only the indices change. 'positions' points to the float3
+        // position of the first vertex, with successive vertices 'vertexStride' bytes apart.
+        // Vertices on open borders, and vertices that share a position with another vertex
+        // (attribute seams), are never moved so the result has no cracks. Simplification stops
+        // at 'targetFaces' triangles or before a collapse would exceed 'maxError', a distance in
+        // the units of the positions. Returns the largest error of the collapses applied.
+        DIRECTX_TOOLKIT_API float __cdecl SimplifyMesh(
+            _In_reads_(nFaces * 3) const uint16_t* indices, size_t nFaces,
+            _In_reads_bytes_(nVerts * vertexStride) const void* positions, size_t vertexStride, size_t nVerts,
+            size_t targetFaces,
+            float maxError,
+            std::vector<uint16_t>& simplifiedIndices);
+
+        DIRECTX_TOOLKIT_API float __cdecl SimplifyMesh(
+            _In_reads_(nFaces * 3) const uint32_t* indices, size_t nFaces,
+            _In_reads_bytes_(nVerts * vertexStride) const void* positions, size_t vertexStride, size_t nVerts,
+            size_t targetFaces,
+            float maxError,
+            std::vector<uint32_t>& simplifiedIndices);
+
+        //------------------------------------------------------------------------------
+        // Reduced index buffers for every triangle list mesh part of a model, and drawing
+        // each mesh at the level chosen from the projected size of its bounding sphere.
+        class ModelLOD
+        {
+        public:
+            // Builds 'levelCount' levels after the full detail level 0, each aiming for
+            // 'reduction' times the triangles of the level before it. The part data is read
+            // back from the GPU.
+            DIRECTX_TOOLKIT_API ModelLOD(
+                _In_ ID3D11DeviceContext* deviceContext,
+                const Model& model,
+                size_t levelCount = 3,
+                float reduction = 0.5f,
+                float maxError = FLT_MAX);
+
+            DIRECTX_TOOLKIT_API ModelLOD(ModelLOD&&) noexcept;
+            DIRECTX_TOOLKIT_API ModelLOD& operator= (ModelLOD&&) noexcept;
+
+            ModelLOD(ModelLOD const&) = delete;
+            ModelLOD& operator= (ModelLOD const&) = delete;
+
+            DIRECTX_TOOLKIT_API virtual ~ModelLOD();
+
+            // Number of levels including the full detail level 0
+            DIRECTX_TOOLKIT_API size_t __cdecl GetLevelCount() const noexcept;
+
+            // Level 'level' is used once the projected bounding sphere diameter falls below
+            // 'size' as a fraction of the viewport height. Defaults halve for every level from 0.5.
+            DIRECTX_TOOLKIT_API void __cdecl SetScreenSizeThreshold(size_t level, float size);
+
+            DIRECTX_TOOLKIT_API size_t XM_CALLCONV SelectLevel(
+                const ModelMesh& mesh,
+                FXMMATRIX world,
+                CXMMATRIX view,
+                CXMMATRIX projection) const;
+
+            DIRECTX_TOOLKIT_API uint32_t __cdecl GetIndexCount(const ModelMeshPart& part, size_t level) const;
+
+            // Draws all meshes in the model, each at its selected level
+            DIRECTX_TOOLKIT_API void XM_CALLCONV Draw(
+                _In_ ID3D11DeviceContext* deviceContext,
+                const CommonStates& states,
+                FXMMATRIX world,
+                CXMMATRIX view,
+                CXMMATRIX projection,
+                bool wireframe = false,
+                _In_ std::function<void __cdecl()> setCustomState = nullptr) const;
+
+        private:
+            class Impl;
+
+            std::unique_ptr<Impl> pImpl;
+        };
+    }
+}
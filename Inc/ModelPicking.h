@@ -0,0 +1,154 @@
+//--------------------------------------------------------------------------------------
+// File: ModelPicking.h
+//
+// Ray picking against model geometry using a bounding volume hierarchy per mesh
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Model.h"
+#include "SimpleMath.h"
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+namespace DirectX
+{
+    inline namespace DX11
+    {
+        //------------------------------------------------------------------------------
+        // Triangles of a mesh in mesh space, kept on the CPU for picking. The loaders fill
+        // ModelMesh::geometry when given ModelLoader_RetainGeometry.
+        class ModelMeshGeometry
+        {
+        public:
+            DIRECTX_TOOLKIT_API ModelMeshGeometry();
+
+            DIRECTX_TOOLKIT_API ModelMeshGeometry(ModelMeshGeometry&&) noexcept;
+            DIRECTX_TOOLKIT_API ModelMeshGeometry& operator= (ModelMeshGeometry&&) noexcept;
+
+            ModelMeshGeometry(ModelMeshGeometry const&) = delete;
+            ModelMeshGeometry& operator= (ModelMeshGeometry const&) = delete;
+
+            DIRECTX_TOOLKIT_API virtual ~ModelMeshGeometry();
+
+            // Adds a triangle list for the given mesh part. 'positions' points to the float3
+            // position of the vertex the indices are relative to, with successive vertices
+            // 'vertexStride' bytes apart.
+            DIRECTX_TOOLKIT_API void __cdecl AddTriangles(
+                uint32_t partIndex,
+                _In_reads_(nFaces * 3) const uint16_t* indices, size_t nFaces,
+                _In_reads_bytes_(nVerts * vertexStride) const void* positions, size_t vertexStride, size_t nVerts);
+
+            DIRECTX_TOOLKIT_API void __cdecl AddTriangles(
+                uint32_t partIndex,
+                _In_reads_(nFaces * 3) const uint32_t* indices, size_t nFaces,
+                _In_reads_bytes_(nVerts * vertexStride) const void* positions, size_t vertexStride, size_t nVerts);
+
+            // Builds the hierarchy with the surface area heuristic; required after adding triangles
+            DIRECTX_TOOLKIT_API void __cdecl Build();
+
+            DIRECTX_TOOLKIT_API size_t __cdecl GetTriangleCount() const noexcept;
+
+            // Finds the closest triangle hit by origin + t * direction for t in [0, maxDistance],
+            // from either side. The direction does not need to be unit length. Safe to call from
+            // several threads at once.
+            DIRECTX_TOOLKIT_API bool XM_CALLCONV Intersects(
+                FXMVECTOR origin,
+                FXMVECTOR direction,
+                float maxDistance,
+                float& distance,
+                uint32_t& partIndex,
+                uint32_t& triangleIndex) const;
+
+            // Reads back the triangle list parts of a mesh that was loaded without retaining its geometry
+            DIRECTX_TOOLKIT_API static std::shared_ptr<ModelMeshGeometry> __cdecl CreateFromMesh(
+                _In_ ID3D11DeviceContext* deviceContext,
+                const ModelMesh& mesh);
+
+        private:
+            class Impl;
+
+            std::unique_ptr<Impl> pImpl;
+        };
+
+
+        //------------------------------------------------------------------------------
+        // Closest hit of a picking query
+        struct ModelPickResult
+        {
+            float       distance;       // In units of the ray direction length
+            uint32_t    instanceIndex;
+            uint32_t    meshIndex;
+            uint32_t    partIndex;
+            uint32_t    triangleIndex;  // Within the mesh part
+        };
+
+        // Picks the closest triangle among the meshes of many (model, world) instances. Meshes
+        // without geometry are skipped. When 'boneTransforms' is given, each instance supplies
+        // an array of model->bones.size() matrices (or nullptr) and meshes attached to a bone
+        // are placed as in Model::Draw with bones; skinned meshes are tested in their bind pose.
+        // Work is split across up to threadCount threads, which are shared with the other
+        // pickers and cullers and kept between calls.
+        class DIRECTX_TOOLKIT_API ModelPicker
+        {
+        public:
+            ModelPicker() = default;
+
+            ModelPicker(ModelPicker&&) = default;
+            ModelPicker& operator= (ModelPicker&&) = default;
+
+            ModelPicker(ModelPicker const&) = delete;
+            ModelPicker& operator= (ModelPicker const&) = delete;
+
+            virtual ~ModelPicker() = default;
+
+            bool __cdecl Pick(
+                const SimpleMath::Ray& ray,
+                float maxDistance,
+                size_t instanceCount,
+                _In_reads_(instanceCount) const Model* const* models,
+                _In_reads_(instanceCount) const XMMATRIX* worlds,
+                ModelPickResult& result,
+                unsigned int threadCount = 1,
+                _In_reads_opt_(instanceCount) const XMMATRIX* const* boneTransforms = nullptr);
+
+            // The distance of the result is measured from 'start' in world units
+            bool __cdecl PickSegment(
+                const SimpleMath::Vector3& start,
+                const SimpleMath::Vector3& end,
+                size_t instanceCount,
+                _In_reads_(instanceCount) const Model* const* models,
+                _In_reads_(instanceCount) const XMMATRIX* worlds,
+                ModelPickResult& result,
+                unsigned int threadCount = 1,
+                _In_reads_opt_(instanceCount) const XMMATRIX* const* boneTransforms = nullptr);
+
+            bool __cdecl Pick(
+                const SimpleMath::Ray& ray,
+                float maxDistance,
+                const Model& model,
+                const XMMATRIX& world,
+                ModelPickResult& result,
+                _In_opt_ const XMMATRIX* boneTransforms = nullptr)
+            {
+                const Model* models[1] = { &model };
+                const XMMATRIX* bones[1] = { boneTransforms };
+                return Pick(ray, maxDistance, 1, models, &world, result, 1, bones);
+            }
+
+        private:
+            std::vector<size_t>             mMeshOffsets;
+            std::shared_ptr<WorkerThreads>  mWorkers;
+        };
+    }
+}
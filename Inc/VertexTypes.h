@@ -302,6 +302,56 @@ namespace DirectX
         };
 
 
+        // Vertex struct holding quantized position, normal vector, and texture mapping information.
+        // Position is half-float (w = 1), normal is R10G10B10A2 biased into [0,1], and texture
+        // coordinates are UNORM16 in [0,1]. Requires effects with biased vertex normals enabled.
+        struct DIRECTX_TOOLKIT_API VertexPositionNormalTexturePacked
+        {
+            VertexPositionNormalTexturePacked() = default;
+
+            VertexPositionNormalTexturePacked(const VertexPositionNormalTexturePacked&) = default;
+            VertexPositionNormalTexturePacked& operator=(const VertexPositionNormalTexturePacked&) = default;
+
+            VertexPositionNormalTexturePacked(VertexPositionNormalTexturePacked&&) = default;
+            VertexPositionNormalTexturePacked& operator=(VertexPositionNormalTexturePacked&&) = default;
+
+            uint64_t position;
+            uint32_t normal;
+            uint32_t textureCoordinate;
+
+            VertexPositionNormalTexturePacked(XMFLOAT3 const& iposition, XMFLOAT3 const& inormal, XMFLOAT2 const& itextureCoordinate) noexcept
+                : position{},
+                normal{},
+                textureCoordinate{}
+            {
+                SetPosition(XMLoadFloat3(&iposition));
+                SetNormal(XMLoadFloat3(&inormal));
+                SetTextureCoordinate(XMLoadFloat2(&itextureCoordinate));
+            }
+
+            VertexPositionNormalTexturePacked(FXMVECTOR iposition, FXMVECTOR inormal, FXMVECTOR itextureCoordinate) noexcept
+                : position{},
+                normal{},
+                textureCoordinate{}
+            {
+                SetPosition(iposition);
+                SetNormal(inormal);
+                SetTextureCoordinate(itextureCoordinate);
+            }
+
+            explicit VertexPositionNormalTexturePacked(VertexPositionNormalTexture const& vertex) noexcept
+                : VertexPositionNormalTexturePacked(vertex.position, vertex.normal, vertex.textureCoordinate)
+            {}
+
+            void XM_CALLCONV SetPosition(FXMVECTOR iposition) noexcept;
+            void XM_CALLCONV SetNormal(FXMVECTOR inormal) noexcept;
+            void XM_CALLCONV SetTextureCoordinate(FXMVECTOR itextureCoordinate) noexcept;
+
+            static constexpr unsigned int InputElementCount = 3;
+            static const D3D11_INPUT_ELEMENT_DESC InputElements[InputElementCount];
+        };
+
+
         // Vertex struct holding position, normal vector, color, and texture mapping information.
         struct DIRECTX_TOOLKIT_API VertexPositionNormalColorTexture
         {
@@ -0,0 +1,1129 @@
+//--------------------------------------------------------------------------------------
+// File: Animation.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "Animation.h"
+#include "Model.h"
+#include "BinaryReader.h"
+#include "CMO.h"
+#include "PlatformHelpers.h"
+#include "SDKMesh.h"
+#include "WorkerThreads.h"
+
+#include <exception>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+    // Sanitizes a source rotation so sampling never has to special-case it.
+    inline XMVECTOR XM_CALLCONV SanitizeRotation(FXMVECTOR quat) noexcept
+    {
+        if (XMVector4Equal(quat, g_XMZero))
+            return XMQuaternionIdentity();
+
+        return XMQuaternionNormalize(quat);
+    }
+
+    // Reciprocal of a quantization range, or zero for an empty range.
+    inline XMVECTOR XM_CALLCONV InverseExtent(FXMVECTOR extent) noexcept
+    {
+        return XMVectorSelect(g_XMZero, XMVectorReciprocal(extent), XMVectorGreater(extent, g_XMZero));
+    }
+
+    // Builds the scale * rotation * translation transform of a decomposed pose.
+    inline XMMATRIX XM_CALLCONV ComposeTransform(const AnimationBonePose& pose) noexcept
+    {
+        XMMATRIX m = XMMatrixMultiply(XMMatrixScalingFromVector(pose.scale), XMMatrixRotationQuaternion(pose.rotation));
+        m.r[3] = XMVectorSelect(g_XMIdentityR3, pose.translation, g_XMSelect1110);
+        return m;
+    }
+
+    // Below this many instances per thread the cost of handing out the work outweighs it
+    constexpr size_t c_MinInstancesPerThread = 16;
+
+    // Full precision key used while building a track
+    struct SourceKey
+    {
+        XMFLOAT4 rotation;
+        XMFLOAT3 translation;
+        XMFLOAT3 scale;
+    };
+}
+
+
+//--------------------------------------------------------------------------------------
+// Internal AnimationClip implementation class.
+//
+// Keys are quantized to 16 bits per component: rotations as signed normalized
+// quaternions, translations and scales relative to the range of their track. Scale
+// keys are only stored when the scale of a track actually changes. Key times are kept
+// in a separate array so the per-bone search only touches the times.
+//--------------------------------------------------------------------------------------
+
+class AnimationClip::Impl
+{
+public:
+    struct PackedKey
+    {
+        XMSHORTN4   rotation;
+        XMUSHORTN4  translation;
+    };
+
+    struct Track
+    {
+        uint32_t    boneIndex;      // Bound by name when c_Invalid
+        uint32_t    firstKey;
+        uint32_t    keyCount;
+        uint32_t    firstTime;      // Tracks with identical key times share them
+        uint32_t    firstScale;     // c_Invalid when the scale is constant
+        XMFLOAT3    translationMin;
+        XMFLOAT3    translationExtent;
+        XMFLOAT3    scaleMin;
+        XMFLOAT3    scaleExtent;
+    };
+
+    Impl() noexcept :
+        duration(0.f)
+    {}
+
+    std::wstring                name;
+    float                       duration;
+    std::vector<Track>          tracks;
+    std::vector<std::wstring>   trackNames;
+    std::vector<float>          keyTimes;
+    std::vector<PackedKey>      keys;
+    std::vector<XMUSHORTN4>     scales;
+    std::vector<uint32_t>       boneToTrack;
+
+    void AddTrack(
+        std::wstring&& trackName,
+        uint32_t boneIndex,
+        uint32_t firstTime,
+        _In_reads_(count) const SourceKey* source, size_t count);
+
+    size_t Bind(const Model& model);
+
+    void Evaluate(const Model& model, float time, size_t nbones, _Out_writes_(nbones) XMMATRIX* localTransforms) const;
+
+    void Evaluate(const Model& model, float time, size_t nbones, _Inout_updates_(nbones) AnimationBonePose* pose) const;
+
+    void XM_CALLCONV Sample(const Track& track, uint32_t k0, uint32_t k1, FXMVECTOR weight, AnimationBonePose& pose) const noexcept;
+
+private:
+    void Validate(const Model& model, size_t nbones, _In_opt_ const void* transforms) const;
+
+    template<typename TFunc>
+    void ForEachBone(size_t modelBones, float time, TFunc&& fn) const;
+};
+
+
+_Use_decl_annotations_
+void AnimationClip::Impl::AddTrack(
+    std::wstring&& trackName,
+    uint32_t boneIndex,
+    uint32_t firstTime,
+    const SourceKey* source, size_t count)
+{
+    assert(source != nullptr && count > 0);
+
+    if (count > UINT32_MAX - keys.size())
+        throw std::runtime_error("Too many animation keys");
+
+    XMVECTOR tmin = XMLoadFloat3(&source[0].translation);
+    XMVECTOR tmax = tmin;
+    XMVECTOR smin = XMLoadFloat3(&source[0].scale);
+    XMVECTOR smax = smin;
+    for (size_t k = 1; k < count; ++k)
+    {
+        const XMVECTOR t = XMLoadFloat3(&source[k].translation);
+        tmin = XMVectorMin(tmin, t);
+        tmax = XMVectorMax(tmax, t);
+
+        const XMVECTOR s = XMLoadFloat3(&source[k].scale);
+        smin = XMVectorMin(smin, s);
+        smax = XMVectorMax(smax, s);
+    }
+
+    const bool constantScale = XMVector3Equal(smin, smax);
+
+    Track track = {};
+    track.boneIndex = boneIndex;
+    track.firstKey = static_cast<uint32_t>(keys.size());
+    track.keyCount = static_cast<uint32_t>(count);
+    track.firstTime = firstTime;
+    track.firstScale = constantScale ? ModelBone::c_Invalid : static_cast<uint32_t>(scales.size());
+    XMStoreFloat3(&track.translationMin, tmin);
+    XMStoreFloat3(&track.translationExtent, XMVectorSubtract(tmax, tmin));
+    XMStoreFloat3(&track.scaleMin, smin);
+    XMStoreFloat3(&track.scaleExtent, XMVectorSubtract(smax, smin));
+
+    const XMVECTOR tscale = InverseExtent(XMVectorSubtract(tmax, tmin));
+    const XMVECTOR sscale = InverseExtent(XMVectorSubtract(smax, smin));
+
+    keys.reserve(keys.size() + count);
+    if (!constantScale)
+    {
+        scales.reserve(scales.size() + count);
+    }
+
+    XMVECTOR prev = XMQuaternionIdentity();
+    for (size_t k = 0; k < count; ++k)
+    {
+        XMVECTOR q = XMLoadFloat4(&source[k].rotation);
+
+        // Keep neighboring rotations in the same hemisphere so sampling can blend them directly
+        if (k > 0 && XMVectorGetX(XMVector4Dot(q, prev)) < 0.f)
+        {
+            q = XMVectorNegate(q);
+        }
+        prev = q;
+
+        PackedKey key = {};
+        XMStoreShortN4(&key.rotation, q);
+        XMStoreUShortN4(&key.translation,
+            XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&source[k].translation), tmin), tscale));
+        keys.emplace_back(key);
+
+        if (!constantScale)
+        {
+            XMUSHORTN4 scale;
+            XMStoreUShortN4(&scale,
+                XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&source[k].scale), smin), sscale));
+            scales.emplace_back(scale);
+        }
+    }
+
+    tracks.emplace_back(track);
+    trackNames.emplace_back(std::move(trackName));
+}
+
+
+size_t AnimationClip::Impl::Bind(const Model& model)
+{
+    std::map<std::wstring, uint32_t> bonesByName;
+    for (size_t j = 0; j < model.bones.size(); ++j)
+    {
+        // The first bone with a given name wins
+        bonesByName.emplace(model.bones[j].name, static_cast<uint32_t>(j));
+    }
+
+    boneToTrack.assign(model.bones.size(), ModelBone::c_Invalid);
+
+    size_t count = 0;
+    for (size_t j = 0; j < tracks.size(); ++j)
+    {
+        uint32_t bone = tracks[j].boneIndex;
+        if (bone == ModelBone::c_Invalid)
+        {
+            auto it = bonesByName.find(trackNames[j]);
+            if (it == bonesByName.cend())
+            {
+                DebugTrace("WARNING: AnimationClip track '%ls' has no matching bone in the model\n", trackNames[j].c_str());
+                continue;
+            }
+
+            bone = it->second;
+        }
+        else if (bone >= model.bones.size())
+        {
+            DebugTrace("WARNING: AnimationClip track for bone %u is out of range for the model\n", bone);
+            continue;
+        }
+
+        if (boneToTrack[bone] == ModelBone::c_Invalid)
+        {
+            boneToTrack[bone] = static_cast<uint32_t>(j);
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+
+_Use_decl_annotations_
+void AnimationClip::Impl::Validate(const Model& model, size_t nbones, const void* transforms) const
+{
+    if (!nbones || !transforms)
+    {
+        throw std::invalid_argument("Bone transforms array required");
+    }
+
+    const size_t modelBones = model.bones.size();
+    if (nbones < modelBones)
+    {
+        throw std::invalid_argument("Bone transforms array is too small");
+    }
+
+    if (!modelBones || boneToTrack.size() != modelBones)
+    {
+        throw std::runtime_error("AnimationClip must be bound to the model");
+    }
+}
+
+
+// Calls fn(bone, track, k0, k1, weight) for every model bone, with a null track for the
+// bones the clip does not animate. The bracketing keys are searched once per bone, and
+// reused when the next track shares the same key times.
+template<typename TFunc>
+void AnimationClip::Impl::ForEachBone(size_t modelBones, float time, TFunc&& fn) const
+{
+    float t = 0.f;
+    if (duration > 0.f)
+    {
+        t = fmodf(time, duration);
+        if (t < 0.f)
+            t += duration;
+    }
+
+    uint32_t searchedTimes = ModelBone::c_Invalid;
+    uint32_t searchedCount = 0;
+    uint32_t k0 = 0;
+    uint32_t k1 = 0;
+    XMVECTOR weight = g_XMZero;
+
+    for (size_t j = 0; j < modelBones; ++j)
+    {
+        const uint32_t index = boneToTrack[j];
+        if (index == ModelBone::c_Invalid)
+        {
+            fn(j, nullptr, 0u, 0u, g_XMZero);
+            continue;
+        }
+
+        const Track& track = tracks[index];
+        if (track.firstTime != searchedTimes || track.keyCount != searchedCount)
+        {
+            searchedTimes = track.firstTime;
+            searchedCount = track.keyCount;
+
+            const float* times = &keyTimes[track.firstTime];
+            const auto next = static_cast<uint32_t>(std::upper_bound(times, times + track.keyCount, t) - times);
+            k0 = next ? (next - 1) : 0;
+            k1 = std::min(next, track.keyCount - 1);
+
+            const float span = times[k1] - times[k0];
+            weight = XMVectorReplicate((span > 0.f) ? ((t - times[k0]) / span) : 0.f);
+        }
+
+        fn(j, &track, k0, k1, weight);
+    }
+}
+
+
+_Use_decl_annotations_
+void AnimationClip::Impl::Evaluate(const Model& model, float time, size_t nbones, XMMATRIX* localTransforms) const
+{
+    Validate(model, nbones, localTransforms);
+
+    const size_t modelBones = model.bones.size();
+
+    ForEachBone(modelBones, time,
+        [&](size_t j, const Track* track, uint32_t k0, uint32_t k1, const XMVECTOR& weight)
+        {
+            if (!track)
+            {
+                localTransforms[j] = (model.boneMatrices) ? model.boneMatrices[j] : XMMatrixIdentity();
+                return;
+            }
+
+            AnimationBonePose pose;
+            Sample(*track, k0, k1, weight, pose);
+            localTransforms[j] = ComposeTransform(pose);
+        });
+
+    for (size_t j = modelBones; j < nbones; ++j)
+    {
+        localTransforms[j] = XMMatrixIdentity();
+    }
+}
+
+
+_Use_decl_annotations_
+void AnimationClip::Impl::Evaluate(const Model& model, float time, size_t nbones, AnimationBonePose* pose) const
+{
+    Validate(model, nbones, pose);
+
+    ForEachBone(model.bones.size(), time,
+        [&](size_t j, const Track* track, uint32_t k0, uint32_t k1, const XMVECTOR& weight)
+        {
+            if (track)
+            {
+                Sample(*track, k0, k1, weight, pose[j]);
+            }
+        });
+}
+
+
+// Blends two keys of a track.
+void XM_CALLCONV AnimationClip::Impl::Sample(const Track& track, uint32_t k0, uint32_t k1, FXMVECTOR weight, AnimationBonePose& pose) const noexcept
+{
+    const PackedKey& a = keys[size_t(track.firstKey) + k0];
+    const PackedKey& b = keys[size_t(track.firstKey) + k1];
+
+    pose.rotation = XMQuaternionNormalize(
+        XMVectorLerpV(XMLoadShortN4(&a.rotation), XMLoadShortN4(&b.rotation), weight));
+
+    pose.translation = XMVectorMultiplyAdd(
+        XMVectorLerpV(XMLoadUShortN4(&a.translation), XMLoadUShortN4(&b.translation), weight),
+        XMLoadFloat3(&track.translationExtent),
+        XMLoadFloat3(&track.translationMin));
+
+    XMVECTOR scale = XMLoadFloat3(&track.scaleMin);
+    if (track.firstScale != ModelBone::c_Invalid)
+    {
+        const XMUSHORTN4* s = &scales[track.firstScale];
+        scale = XMVectorMultiplyAdd(
+            XMVectorLerpV(XMLoadUShortN4(&s[k0]), XMLoadUShortN4(&s[k1]), weight),
+            XMLoadFloat3(&track.scaleExtent),
+            scale);
+    }
+    pose.scale = scale;
+}
+
+
+//--------------------------------------------------------------------------------------
+// AnimationClip
+//--------------------------------------------------------------------------------------
+
+AnimationClip::AnimationClip() :
+    pImpl(std::make_unique<Impl>())
+{}
+
+AnimationClip::AnimationClip(AnimationClip&&) noexcept = default;
+AnimationClip& AnimationClip::operator= (AnimationClip&&) noexcept = default;
+AnimationClip::~AnimationClip() = default;
+
+
+const wchar_t* AnimationClip::GetName() const noexcept
+{
+    return pImpl->name.c_str();
+}
+
+
+float AnimationClip::GetDuration() const noexcept
+{
+    return pImpl->duration;
+}
+
+
+size_t AnimationClip::GetTrackCount() const noexcept
+{
+    return pImpl->tracks.size();
+}
+
+
+size_t AnimationClip::Bind(const Model& model)
+{
+    return pImpl->Bind(model);
+}
+
+
+_Use_decl_annotations_
+void AnimationClip::Evaluate(const Model& model, float time, size_t nbones, XMMATRIX* localTransforms) const
+{
+    pImpl->Evaluate(model, time, nbones, localTransforms);
+}
+
+
+_Use_decl_annotations_
+void AnimationClip::Evaluate(const Model& model, float time, size_t nbones, AnimationBonePose* pose) const
+{
+    pImpl->Evaluate(model, time, nbones, pose);
+}
+
+
+_Use_decl_annotations_
+void AnimationClip::Apply(const Model& model, float time, size_t nbones, XMMATRIX* boneTransforms) const
+{
+    if (!nbones || !boneTransforms)
+    {
+        throw std::invalid_argument("Bone transforms array required");
+    }
+
+    auto local = ModelBone::MakeArray(nbones);
+    pImpl->Evaluate(model, time, nbones, local.get());
+
+    model.CopyAbsoluteBoneTransforms(nbones, local.get(), boneTransforms);
+
+    if (model.invBindPoseMatrices)
+    {
+        // Adjust for the model's bind pose
+        for (size_t j = 0; j < model.bones.size(); ++j)
+        {
+            boneTransforms[j] = XMMatrixMultiply(model.invBindPoseMatrices[j], boneTransforms[j]);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// AnimationBlender
+//--------------------------------------------------------------------------------------
+
+class AnimationBlender::Impl
+{
+public:
+    explicit Impl(const Model& model);
+
+    const Model*                    model;
+    std::vector<AnimationBonePose>  restPose;
+
+    // Taken when the blender is created, since Blend and Apply are const
+    std::shared_ptr<WorkerThreads>  workers;
+
+    void Run(
+        size_t instanceCount,
+        size_t layerCount,
+        _In_reads_(instanceCount * layerCount) const AnimationLayer* layers,
+        size_t nbones,
+        _Out_writes_(instanceCount * nbones) XMMATRIX* transforms,
+        unsigned int threadCount,
+        bool skinning) const;
+
+private:
+    // Working poses for one thread
+    struct Scratch
+    {
+        std::vector<AnimationBonePose>  sample;
+        std::vector<AnimationBonePose>  blend;
+        std::vector<float>              weights;
+        std::vector<XMMATRIX>           local;
+    };
+
+    void BlendInstance(
+        _In_reads_(layerCount) const AnimationLayer* layers,
+        size_t layerCount,
+        size_t nbones,
+        _Out_writes_(nbones) XMMATRIX* localTransforms,
+        Scratch& scratch) const;
+
+    void ProcessRange(
+        size_t first,
+        size_t last,
+        size_t layerCount,
+        _In_ const AnimationLayer* layers,
+        size_t nbones,
+        _Out_ XMMATRIX* transforms,
+        bool skinning) const;
+};
+
+
+AnimationBlender::Impl::Impl(const Model& m) :
+    model(&m),
+    workers(WorkerThreads::Get())
+{
+    const size_t nbones = m.bones.size();
+    if (!nbones)
+    {
+        throw std::runtime_error("Model is missing bones");
+    }
+
+    restPose.resize(nbones);
+    for (size_t j = 0; j < nbones; ++j)
+    {
+        auto& pose = restPose[j];
+        if (m.boneMatrices && XMMatrixDecompose(&pose.scale, &pose.rotation, &pose.translation, m.boneMatrices[j]))
+            continue;
+
+        // Degenerate bone matrices keep only their offset
+        pose.scale = g_XMOne;
+        pose.rotation = XMQuaternionIdentity();
+        pose.translation = (m.boneMatrices) ? m.boneMatrices[j].r[3] : g_XMZero;
+    }
+}
+
+
+_Use_decl_annotations_
+void AnimationBlender::Impl::BlendInstance(
+    const AnimationLayer* layers,
+    size_t layerCount,
+    size_t nbones,
+    XMMATRIX* localTransforms,
+    Scratch& scratch) const
+{
+    const size_t modelBones = restPose.size();
+
+    auto sample = scratch.sample.data();
+    auto blend = scratch.blend.data();
+    auto weights = scratch.weights.data();
+
+    for (size_t j = 0; j < modelBones; ++j)
+    {
+        blend[j].scale = blend[j].rotation = blend[j].translation = g_XMZero;
+        weights[j] = 0.f;
+    }
+
+    // Weighted sums of the override layers
+    bool additive = false;
+    for (size_t k = 0; k < layerCount; ++k)
+    {
+        const auto& layer = layers[k];
+        if (!layer.clip || !(layer.weight > 0.f))
+            continue;
+
+        if (layer.mode == AnimationBlend_Additive)
+        {
+            additive = true;
+            continue;
+        }
+
+        std::copy_n(restPose.data(), modelBones, sample);
+        layer.clip->Evaluate(*model, layer.time, modelBones, sample);
+
+        for (size_t j = 0; j < modelBones; ++j)
+        {
+            const float w = (layer.boneMask) ? layer.weight * layer.boneMask[j] : layer.weight;
+            if (!(w > 0.f))
+                continue;
+
+            const XMVECTOR vw = XMVectorReplicate(w);
+
+            // Rotations are kept in the rest pose's hemisphere so the sum does not cancel out
+            XMVECTOR q = sample[j].rotation;
+            q = XMVectorSelect(q, XMVectorNegate(q), XMVectorLess(XMVector4Dot(q, restPose[j].rotation), g_XMZero));
+
+            blend[j].scale = XMVectorMultiplyAdd(sample[j].scale, vw, blend[j].scale);
+            blend[j].rotation = XMVectorMultiplyAdd(q, vw, blend[j].rotation);
+            blend[j].translation = XMVectorMultiplyAdd(sample[j].translation, vw, blend[j].translation);
+            weights[j] += w;
+        }
+    }
+
+    for (size_t j = 0; j < modelBones; ++j)
+    {
+        auto& pose = blend[j];
+        const float total = weights[j];
+
+        if (total < 1.f)
+        {
+            // The rest pose makes up the missing weight
+            const auto& rest = restPose[j];
+            const XMVECTOR vw = XMVectorReplicate(1.f - total);
+            pose.scale = XMVectorMultiplyAdd(rest.scale, vw, pose.scale);
+            pose.rotation = XMVectorMultiplyAdd(rest.rotation, vw, pose.rotation);
+            pose.translation = XMVectorMultiplyAdd(rest.translation, vw, pose.translation);
+        }
+        else if (total > 1.f)
+        {
+            const XMVECTOR inv = XMVectorReplicate(1.f / total);
+            pose.scale = XMVectorMultiply(pose.scale, inv);
+            pose.translation = XMVectorMultiply(pose.translation, inv);
+        }
+
+        pose.rotation = XMQuaternionNormalize(pose.rotation);
+    }
+
+    // Additive layers apply their difference from the rest pose on top, in order
+    for (size_t k = 0; additive && k < layerCount; ++k)
+    {
+        const auto& layer = layers[k];
+        if (!layer.clip || !(layer.weight > 0.f) || layer.mode != AnimationBlend_Additive)
+            continue;
+
+        std::copy_n(restPose.data(), modelBones, sample);
+        layer.clip->Evaluate(*model, layer.time, modelBones, sample);
+
+        for (size_t j = 0; j < modelBones; ++j)
+        {
+            const float w = (layer.boneMask) ? layer.weight * layer.boneMask[j] : layer.weight;
+            if (!(w > 0.f))
+                continue;
+
+            const auto& rest = restPose[j];
+            auto& pose = blend[j];
+
+            XMVECTOR delta = XMQuaternionMultiply(sample[j].rotation, XMQuaternionConjugate(rest.rotation));
+            delta = XMVectorSelect(delta, XMVectorNegate(delta), XMVectorLess(XMVectorSplatW(delta), g_XMZero));
+            delta = XMQuaternionNormalize(XMVectorLerp(XMQuaternionIdentity(), delta, w));
+
+            const XMVECTOR ratio = XMVectorSelect(g_XMOne,
+                XMVectorDivide(sample[j].scale, rest.scale),
+                XMVectorNotEqual(rest.scale, g_XMZero));
+
+            pose.rotation = XMQuaternionMultiply(delta, pose.rotation);
+            pose.translation = XMVectorMultiplyAdd(XMVectorSubtract(sample[j].translation, rest.translation),
+                XMVectorReplicate(w), pose.translation);
+            pose.scale = XMVectorMultiply(pose.scale, XMVectorLerp(g_XMOne, ratio, w));
+        }
+    }
+
+    for (size_t j = 0; j < modelBones; ++j)
+    {
+        localTransforms[j] = ComposeTransform(blend[j]);
+    }
+
+    for (size_t j = modelBones; j < nbones; ++j)
+    {
+        localTransforms[j] = XMMatrixIdentity();
+    }
+}
+
+
+_Use_decl_annotations_
+void AnimationBlender::Impl::ProcessRange(
+    size_t first,
+    size_t last,
+    size_t layerCount,
+    const AnimationLayer* layers,
+    size_t nbones,
+    XMMATRIX* transforms,
+    bool skinning) const
+{
+    const size_t modelBones = restPose.size();
+
+    Scratch scratch;
+    scratch.sample.resize(modelBones);
+    scratch.blend.resize(modelBones);
+    scratch.weights.resize(modelBones);
+    if (skinning)
+    {
+        scratch.local.resize(nbones);
+    }
+
+    for (size_t i = first; i < last; ++i)
+    {
+        const AnimationLayer* instanceLayers = layers + i * layerCount;
+        XMMATRIX* dest = transforms + i * nbones;
+
+        if (!skinning)
+        {
+            BlendInstance(instanceLayers, layerCount, nbones, dest, scratch);
+            continue;
+        }
+
+        BlendInstance(instanceLayers, layerCount, nbones, scratch.local.data(), scratch);
+
+        model->CopyAbsoluteBoneTransforms(nbones, scratch.local.data(), dest);
+
+        if (model->invBindPoseMatrices)
+        {
+            // Adjust for the model's bind pose
+            for (size_t j = 0; j < modelBones; ++j)
+            {
+                dest[j] = XMMatrixMultiply(model->invBindPoseMatrices[j], dest[j]);
+            }
+        }
+    }
+}
+
+
+_Use_decl_annotations_
+void AnimationBlender::Impl::Run(
+    size_t instanceCount,
+    size_t layerCount,
+    const AnimationLayer* layers,
+    size_t nbones,
+    XMMATRIX* transforms,
+    unsigned int threadCount,
+    bool skinning) const
+{
+    if (!instanceCount)
+        return;
+
+    if (!nbones || !transforms)
+    {
+        throw std::invalid_argument("Bone transforms array required");
+    }
+
+    if (nbones < restPose.size())
+    {
+        throw std::invalid_argument("Bone transforms array is too small");
+    }
+
+    if (instanceCount > (SIZE_MAX / sizeof(XMMATRIX)) / nbones)
+    {
+        throw std::overflow_error("Too many bone transforms");
+    }
+
+    if (layerCount > 0)
+    {
+        if (!layers)
+        {
+            throw std::invalid_argument("Animation layers array required");
+        }
+
+        if (instanceCount > SIZE_MAX / layerCount)
+        {
+            throw std::overflow_error("Too many animation layers");
+        }
+
+        for (size_t k = 0; k < instanceCount * layerCount; ++k)
+        {
+            if (layers[k].mode != AnimationBlend_Override && layers[k].mode != AnimationBlend_Additive)
+            {
+                throw std::invalid_argument("Invalid animation blend mode");
+            }
+        }
+    }
+
+    size_t nthreads = std::max(1u, threadCount);
+    nthreads = std::min(nthreads, std::max<size_t>(1, instanceCount / c_MinInstancesPerThread));
+
+    if (nthreads == 1)
+    {
+        ProcessRange(0, instanceCount, layerCount, layers, nbones, transforms, skinning);
+        return;
+    }
+
+    // Each task blends a contiguous range of instances on the shared worker threads
+    const size_t perThread = (instanceCount + nthreads - 1) / nthreads;
+
+    std::vector<std::exception_ptr> errors(nthreads);
+
+    workers->ParallelFor(nthreads, [&](size_t t) noexcept
+        {
+            const size_t first = std::min(instanceCount, t * perThread);
+            const size_t last = std::min(instanceCount, first + perThread);
+
+            try
+            {
+                ProcessRange(first, last, layerCount, layers, nbones, transforms, skinning);
+            }
+            catch (...)
+            {
+                errors[t] = std::current_exception();
+            }
+        });
+
+    // Errors are rethrown in range order, so the exception does not depend on thread timing
+    for (const auto& it : errors)
+    {
+        if (it)
+        {
+            std::rethrow_exception(it);
+        }
+    }
+}
+
+
+AnimationBlender::AnimationBlender(const Model& model) :
+    pImpl(std::make_unique<Impl>(model))
+{}
+
+AnimationBlender::AnimationBlender(AnimationBlender&&) noexcept = default;
+AnimationBlender& AnimationBlender::operator= (AnimationBlender&&) noexcept = default;
+AnimationBlender::~AnimationBlender() = default;
+
+
+_Use_decl_annotations_
+void AnimationBlender::Blend(
+    size_t instanceCount,
+    size_t layerCount,
+    const AnimationLayer* layers,
+    size_t nbones,
+    XMMATRIX* localTransforms,
+    unsigned int threadCount) const
+{
+    pImpl->Run(instanceCount, layerCount, layers, nbones, localTransforms, threadCount, false);
+}
+
+
+_Use_decl_annotations_
+void AnimationBlender::Apply(
+    size_t instanceCount,
+    size_t layerCount,
+    const AnimationLayer* layers,
+    size_t nbones,
+    XMMATRIX* boneTransforms,
+    unsigned int threadCount) const
+{
+    pImpl->Run(instanceCount, layerCount, layers, nbones, boneTransforms, threadCount, true);
+}
+
+
+const AnimationBonePose* AnimationBlender::GetRestPose() const noexcept
+{
+    return pImpl->restPose.data();
+}
+
+
+//--------------------------------------------------------------------------------------
+// SDKMESH_ANIM loader
+//--------------------------------------------------------------------------------------
+
+_Use_decl_annotations_
+std::unique_ptr<AnimationClip> AnimationClip::CreateFromSDKMESH(const uint8_t* animData, size_t dataSize)
+{
+    if (!animData)
+        throw std::invalid_argument("Animation data must be non-null");
+
+    if (dataSize < sizeof(DXUT::SDKANIMATION_FILE_HEADER))
+        throw std::runtime_error("End of file");
+
+    auto header = reinterpret_cast<const DXUT::SDKANIMATION_FILE_HEADER*>(animData);
+
+    if (header->IsBigEndian)
+        throw std::runtime_error("Big-endian SDKMESH_ANIM files are not supported");
+
+    if (!header->NumFrames || !header->NumAnimationKeys || !header->AnimationFPS)
+        throw std::runtime_error("No animation data found");
+
+    if (header->NumAnimationKeys == UINT32_MAX)
+        throw std::runtime_error("Too many animation keys");
+
+    if (header->AnimationDataSize > dataSize - sizeof(DXUT::SDKANIMATION_FILE_HEADER))
+        throw std::runtime_error("End of file");
+
+    if (header->AnimationDataOffset > dataSize
+        || (dataSize - header->AnimationDataOffset) / sizeof(DXUT::SDKANIMATION_FRAME_DATA) < header->NumFrames)
+        throw std::runtime_error("End of file");
+
+    auto frameData = reinterpret_cast<const DXUT::SDKANIMATION_FRAME_DATA*>(animData + header->AnimationDataOffset);
+
+    std::unique_ptr<AnimationClip> clip(new AnimationClip());
+    auto impl = clip->pImpl.get();
+
+    // Keys are evenly spaced and shared by every track. The first key is repeated at the
+    // end so the clip loops smoothly.
+    const uint32_t nkeys = header->NumAnimationKeys;
+    const auto fps = static_cast<float>(header->AnimationFPS);
+
+    impl->duration = float(nkeys) / fps;
+    impl->keyTimes.resize(size_t(nkeys) + 1);
+    for (uint32_t k = 0; k <= nkeys; ++k)
+    {
+        impl->keyTimes[k] = float(k) / fps;
+    }
+
+    impl->tracks.reserve(header->NumFrames);
+    impl->trackNames.reserve(header->NumFrames);
+
+    std::vector<SourceKey> source(size_t(nkeys) + 1);
+    for (uint32_t j = 0; j < header->NumFrames; ++j)
+    {
+        // Key offsets are relative to the end of the file header
+        const uint64_t offset = uint64_t(sizeof(DXUT::SDKANIMATION_FILE_HEADER)) + frameData[j].DataOffset;
+        if (offset > dataSize
+            || (dataSize - offset) / sizeof(DXUT::SDKANIMATION_DATA) < nkeys)
+            throw std::runtime_error("End of file");
+
+        char frameName[DXUT::MAX_FRAME_NAME] = {};
+        memcpy(frameName, frameData[j].FrameName, sizeof(frameName) - 1);
+
+        wchar_t trackName[DXUT::MAX_FRAME_NAME] = {};
+        ASCIIToWChar(trackName, frameName);
+
+        auto src = reinterpret_cast<const DXUT::SDKANIMATION_DATA*>(animData + offset);
+        for (uint32_t k = 0; k < nkeys; ++k)
+        {
+            XMStoreFloat4(&source[k].rotation, SanitizeRotation(XMLoadFloat4(&src[k].Orientation)));
+            source[k].translation = src[k].Translation;
+            source[k].scale = src[k].Scaling;
+        }
+        source[nkeys] = source[0];
+
+        impl->AddTrack(trackName, ModelBone::c_Invalid, 0, source.data(), source.size());
+    }
+
+    return clip;
+}
+
+
+_Use_decl_annotations_
+std::unique_ptr<AnimationClip> AnimationClip::CreateFromSDKMESH(const wchar_t* szFileName)
+{
+    size_t dataSize = 0;
+    std::unique_ptr<uint8_t[]> data;
+    HRESULT hr = BinaryReader::ReadEntireFile(szFileName, data, &dataSize);
+    if (FAILED(hr))
+    {
+        DebugTrace("ERROR: CreateFromSDKMESH failed (%08X) loading '%ls'\n",
+            static_cast<unsigned int>(hr), szFileName);
+        throw std::runtime_error("AnimationClip::CreateFromSDKMESH");
+    }
+
+    auto clip = CreateFromSDKMESH(data.get(), dataSize);
+
+    clip->pImpl->name = szFileName;
+
+    return clip;
+}
+
+
+//--------------------------------------------------------------------------------------
+// CMO animation clip loader
+//--------------------------------------------------------------------------------------
+
+_Use_decl_annotations_
+std::unique_ptr<AnimationClip> AnimationClip::CreateFromCMO(
+    const uint8_t* meshData, size_t dataSize,
+    size_t animsOffset,
+    const wchar_t* clipName)
+{
+    if (!meshData)
+        throw std::invalid_argument("meshData cannot be null");
+
+    if (!animsOffset)
+        throw std::invalid_argument("CMO file has no animation clips");
+
+    size_t usedSize = animsOffset;
+
+    auto nClips = reinterpret_cast<const uint32_t*>(meshData + usedSize);
+    usedSize += sizeof(uint32_t);
+    if (dataSize < usedSize)
+        throw std::runtime_error("End of file");
+
+    for (size_t clipIndex = 0; clipIndex < *nClips; ++clipIndex)
+    {
+        // Clip name
+        auto nName = reinterpret_cast<const uint32_t*>(meshData + usedSize);
+        usedSize += sizeof(uint32_t);
+        if (dataSize < usedSize)
+            throw std::runtime_error("End of file");
+
+        auto name = reinterpret_cast<const wchar_t*>(static_cast<const void*>(meshData + usedSize)); // CodeQL [SM02986] The cast here is intentional to interpret the string in the buffer.
+
+        if (*nName > (dataSize - usedSize) / sizeof(wchar_t))
+            throw std::runtime_error("End of file");
+        usedSize += sizeof(wchar_t)*(*nName);
+
+        auto clipHeader = reinterpret_cast<const VSD3DStarter::Clip*>(meshData + usedSize);
+        usedSize += sizeof(VSD3DStarter::Clip);
+        if (dataSize < usedSize)
+            throw std::runtime_error("End of file");
+
+        if (clipHeader->keys > (dataSize - usedSize) / sizeof(VSD3DStarter::Keyframe))
+            throw std::runtime_error("End of file");
+
+        auto keyframes = reinterpret_cast<const VSD3DStarter::Keyframe*>(meshData + usedSize);
+        usedSize += sizeof(VSD3DStarter::Keyframe) * clipHeader->keys;
+
+        std::wstring clipNameStr(name, *nName);
+        if (clipName && clipNameStr.compare(clipName) != 0)
+            continue;
+
+        if (!clipHeader->keys)
+            throw std::runtime_error("Animation clip has no keyframes");
+
+        std::unique_ptr<AnimationClip> clip(new AnimationClip());
+        auto impl = clip->pImpl.get();
+        impl->name = std::move(clipNameStr);
+
+        // Group the keyframes by bone in time order
+        std::vector<uint32_t> order(clipHeader->keys);
+        for (uint32_t k = 0; k < clipHeader->keys; ++k)
+        {
+            order[k] = k;
+        }
+
+        std::stable_sort(order.begin(), order.end(), [keyframes](uint32_t a, uint32_t b) noexcept
+            {
+                if (keyframes[a].BoneIndex != keyframes[b].BoneIndex)
+                    return keyframes[a].BoneIndex < keyframes[b].BoneIndex;
+
+                return keyframes[a].Time < keyframes[b].Time;
+            });
+
+        impl->keyTimes.reserve(clipHeader->keys);
+
+        float lastTime = 0.f;
+        std::vector<SourceKey> source;
+        for (size_t first = 0; first < order.size();)
+        {
+            const uint32_t boneIndex = keyframes[order[first]].BoneIndex;
+
+            size_t last = first;
+            while (last < order.size() && keyframes[order[last]].BoneIndex == boneIndex)
+                ++last;
+
+            const auto firstTime = static_cast<uint32_t>(impl->keyTimes.size());
+
+            source.resize(last - first);
+            for (size_t k = first; k < last; ++k)
+            {
+                const auto& key = keyframes[order[k]];
+
+                const float keyTime = std::max(key.Time - clipHeader->StartTime, 0.f);
+                impl->keyTimes.push_back(keyTime);
+                lastTime = std::max(lastTime, keyTime);
+
+                XMVECTOR scale, rotation, translation;
+                const XMMATRIX m = XMLoadFloat4x4(&key.Transform);
+                if (!XMMatrixDecompose(&scale, &rotation, &translation, m))
+                {
+                    DebugTrace("WARNING: CMO keyframe for bone %u could not be decomposed\n", boneIndex);
+                    scale = g_XMOne;
+                    rotation = XMQuaternionIdentity();
+                    translation = m.r[3];
+                }
+
+                auto& dest = source[k - first];
+                XMStoreFloat4(&dest.rotation, SanitizeRotation(rotation));
+                XMStoreFloat3(&dest.translation, translation);
+                XMStoreFloat3(&dest.scale, scale);
+            }
+
+            impl->AddTrack(std::wstring(), boneIndex, firstTime, source.data(), source.size());
+
+            first = last;
+        }
+
+        impl->duration = clipHeader->EndTime - clipHeader->StartTime;
+        if (!(impl->duration > 0.f))
+        {
+            impl->duration = lastTime;
+        }
+
+        return clip;
+    }
+
+    if (clipName)
+    {
+        DebugTrace("ERROR: CreateFromCMO could not find animation clip '%ls'\n", clipName);
+    }
+
+    throw std::runtime_error("Animation clip not found");
+}
+
+
+_Use_decl_annotations_
+std::unique_ptr<AnimationClip> AnimationClip::CreateFromCMO(
+    const wchar_t* szFileName,
+    size_t animsOffset,
+    const wchar_t* clipName)
+{
+    size_t dataSize = 0;
+    std::unique_ptr<uint8_t[]> data;
+    HRESULT hr = BinaryReader::ReadEntireFile(szFileName, data, &dataSize);
+    if (FAILED(hr))
+    {
+        DebugTrace("ERROR: CreateFromCMO failed (%08X) loading '%ls'\n",
+            static_cast<unsigned int>(hr), szFileName);
+        throw std::runtime_error("AnimationClip::CreateFromCMO");
+    }
+
+    return CreateFromCMO(data.get(), dataSize, animsOffset, clipName);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Adapters for /Zc:wchar_t- clients
+
+#if defined(_MSC_VER) && !defined(_NATIVE_WCHAR_T_DEFINED)
+
+_Use_decl_annotations_
+std::unique_ptr<AnimationClip> AnimationClip::CreateFromSDKMESH(const __wchar_t* szFileName)
+{
+    return CreateFromSDKMESH(reinterpret_cast<const unsigned short*>(szFileName));
+}
+
+_Use_decl_annotations_
+std::unique_ptr<AnimationClip> AnimationClip::CreateFromCMO(
+    const __wchar_t* szFileName,
+    size_t animsOffset,
+    const __wchar_t* clipName)
+{
+    return CreateFromCMO(reinterpret_cast<const unsigned short*>(szFileName), animsOffset,
+        reinterpret_cast<const unsigned short*>(clipName));
+}
+
+#endif
@@ -93,3 +93,61 @@ HRESULT BinaryReader::ReadEntireFile(
 
     return S_OK;
 }
+
+
+// Maps a file from the filesystem into memory.
+HRESULT BinaryReader::MapEntireFile(
+    _In_z_ wchar_t const* fileName,
+    _Inout_ ScopedFileView& view,
+    _Out_ size_t* dataSize)
+{
+    if (!fileName || !dataSize)
+        return E_INVALIDARG;
+
+    *dataSize = 0;
+    view.reset();
+
+    // Open the file.
+    ScopedHandle hFile(safe_handle(CreateFile2(
+        fileName,
+        GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING,
+        nullptr)));
+    if (!hFile)
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    // Get the file size.
+    FILE_STANDARD_INFO fileInfo;
+    if (!GetFileInformationByHandleEx(hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    // File is too big for 32-bit allocation, so reject read.
+    if (fileInfo.EndOfFile.HighPart > 0)
+        return E_FAIL;
+
+    // Empty files cannot be mapped.
+    if (!fileInfo.EndOfFile.LowPart)
+        return E_FAIL;
+
+    // The view keeps the mapping alive, so both handles can be closed once it exists.
+#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP)
+    ScopedHandle hMapping(CreateFileMappingFromApp(hFile.get(), nullptr, PAGE_READONLY, 0, nullptr));
+#else
+    ScopedHandle hMapping(CreateFileMappingW(hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+#endif
+    if (!hMapping)
+        return HRESULT_FROM_WIN32(GetLastError());
+
+#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP)
+    view.reset(MapViewOfFileFromApp(hMapping.get(), FILE_MAP_READ, 0, 0));
+#else
+    view.reset(MapViewOfFile(hMapping.get(), FILE_MAP_READ, 0, 0, 0));
+#endif
+    if (!view)
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    *dataSize = fileInfo.EndOfFile.LowPart;
+
+    return S_OK;
+}
@@ -69,6 +69,9 @@ namespace DirectX
         // Lower level helper reads directly from the filesystem into memory.
         static HRESULT ReadEntireFile(_In_z_ wchar_t const* fileName, _Inout_ std::unique_ptr<uint8_t[]>& data, _Out_ size_t* dataSize);
 
+        // Maps a file read-only into memory instead of copying it. The file stays open until the view is released.
+        static HRESULT MapEntireFile(_In_z_ wchar_t const* fileName, _Inout_ ScopedFileView& view, _Out_ size_t* dataSize);
+
 
     private:
         // The data currently being read.
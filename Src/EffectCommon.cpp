@@ -24,6 +24,76 @@ void XM_CALLCONV IEffectMatrices::SetMatrices(FXMMATRIX world, CXMMATRIX view, C
 }
 
 
+// IEffectSkinning default method, for effects that only take a contiguous bone array
+_Use_decl_annotations_
+void IEffectSkinning::GatherBoneTransforms(const uint32_t* indices, size_t count, XMMATRIX const* value, size_t nbones)
+{
+    if (count > MaxBones)
+        throw std::invalid_argument("count parameter exceeds MaxBones");
+
+    XMMATRIX temp[MaxBones];
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (indices[i] >= nbones)
+            throw std::runtime_error("Invalid bone influence index");
+
+        temp[i] = value[indices[i]];
+    }
+
+    SetBoneTransforms(temp, count);
+}
+
+
+// Shared by the skinned effects for SetBoneTransforms and GatherBoneTransforms
+_Use_decl_annotations_
+void DirectX::StoreBoneTransforms(
+    XMVECTOR (*boneConstant)[3],
+    const uint32_t* indices,
+    size_t count,
+    XMMATRIX const* value,
+    size_t nbones)
+{
+    if (count > IEffectSkinning::MaxBones)
+        throw std::invalid_argument("count parameter exceeds MaxBones");
+
+    if (!count)
+        return;
+
+    if (!value)
+        throw std::invalid_argument("Bone transforms array required");
+
+    if (indices)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (indices[i] >= nbones)
+                throw std::runtime_error("Invalid bone influence index");
+        }
+    }
+    else if (count > nbones)
+    {
+        throw std::invalid_argument("count parameter exceeds the bone transforms array");
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const XMMATRIX& bone = value[indices ? indices[i] : i];
+
+    #if DIRECTX_MATH_VERSION >= 313
+        XMStoreFloat3x4A(reinterpret_cast<XMFLOAT3X4A*>(&boneConstant[i]), bone);
+    #else
+        // Xbox One XDK has an older version of DirectXMath
+        const XMMATRIX boneMatrix = XMMatrixTranspose(bone);
+
+        boneConstant[i][0] = boneMatrix.r[0];
+        boneConstant[i][1] = boneMatrix.r[1];
+        boneConstant[i][2] = boneMatrix.r[2];
+    #endif
+    }
+}
+
+
 // Constructor initializes default matrix values.
 EffectMatrices::EffectMatrices() noexcept
 {
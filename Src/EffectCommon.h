@@ -143,6 +143,17 @@ namespace DirectX
     };
 
 
+    // Helper stores bone matrices as the three transposed rows per bone read by the skinning
+    // shaders. Bone i is value[indices[i]] when indices are given, otherwise value[i]. Every
+    // argument is validated before any constant is written.
+    void StoreBoneTransforms(
+        _Out_writes_(count) XMVECTOR (*boneConstant)[3],
+        _In_reads_opt_(count) const uint32_t* indices,
+        size_t count,
+        _In_reads_(nbones) XMMATRIX const* value,
+        size_t nbones);
+
+
     // Points to a precompiled vertex or pixel shader program.
     struct ShaderBytecode
     {
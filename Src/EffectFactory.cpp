@@ -10,6 +10,7 @@
 #include "pch.h"
 #include "Effects.h"
 #include "DemandCreate.h"
+#include "EffectTextureCache.h"
 #include "SharedResourcePool.h"
 
 #include "DDSTextureLoader.h"
@@ -80,6 +81,10 @@ public:
 
     std::shared_ptr<IEffect> CreateEffect(_In_ IEffectFactory* factory, _In_ const IEffectFactory::EffectInfo& info, _In_opt_ ID3D11DeviceContext* deviceContext);
     void CreateTexture(_In_z_ const wchar_t* texture, _In_opt_ ID3D11DeviceContext* deviceContext, _Outptr_ ID3D11ShaderResourceView** textureView);
+    bool GetCachedTexture(_In_z_ const wchar_t* texture, _Outptr_result_maybenull_ ID3D11ShaderResourceView** textureView)
+    {
+        return mTextureCache.Find(texture, textureView);
+    }
 
     void ReleaseCache();
 
@@ -95,14 +100,13 @@ public:
 
 private:
     using EffectCache = std::map< std::wstring, std::shared_ptr<IEffect> >;
-    using TextureCache = std::map< std::wstring, ComPtr<ID3D11ShaderResourceView> >;
 
     EffectCache  mEffectCache;
     EffectCache  mEffectCacheSkinning;
     EffectCache  mEffectCacheDualTexture;
     EffectCache  mEffectNormalMap;
     EffectCache  mEffectNormalMapSkinned;
-    TextureCache mTextureCache;
+    EffectTextureCache mTextureCache;
 
     std::mutex mutex;
 };
@@ -377,86 +381,71 @@ void EffectFactory::Impl::CreateTexture(const wchar_t* name, ID3D11DeviceContext
     UNREFERENCED_PARAMETER(deviceContext);
 #endif
 
-    auto it = mTextureCache.find(name);
-
-    if (mSharing && it != mTextureCache.end())
-    {
-        ID3D11ShaderResourceView* srv = it->second.Get();
-        srv->AddRef();
-        *textureView = srv;
-    }
-    else
-    {
-        wchar_t fullName[MAX_PATH] = {};
-        wcscpy_s(fullName, mPath);
-        wcscat_s(fullName, name);
-
-        WIN32_FILE_ATTRIBUTE_DATA fileAttr = {};
-        if (!GetFileAttributesExW(fullName, GetFileExInfoStandard, &fileAttr))
+    mTextureCache.Get(name, mSharing, textureView, [&](ID3D11ShaderResourceView** view)
         {
-            // Try Current Working Directory (CWD)
-            wcscpy_s(fullName, name);
+            wchar_t fullName[MAX_PATH] = {};
+            wcscpy_s(fullName, mPath);
+            wcscat_s(fullName, name);
+
+            WIN32_FILE_ATTRIBUTE_DATA fileAttr = {};
             if (!GetFileAttributesExW(fullName, GetFileExInfoStandard, &fileAttr))
             {
-                DebugTrace("ERROR: EffectFactory could not find texture file '%ls'\n", name);
-                throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "EffectFactory::CreateTexture");
+                // Try Current Working Directory (CWD)
+                wcscpy_s(fullName, name);
+                if (!GetFileAttributesExW(fullName, GetFileExInfoStandard, &fileAttr))
+                {
+                    DebugTrace("ERROR: EffectFactory could not find texture file '%ls'\n", name);
+                    throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "EffectFactory::CreateTexture");
+                }
             }
-        }
 
-        wchar_t ext[_MAX_EXT] = {};
-        _wsplitpath_s(name, nullptr, 0, nullptr, 0, nullptr, 0, ext, _MAX_EXT);
-        const bool isdds = _wcsicmp(ext, L".dds") == 0;
+            wchar_t ext[_MAX_EXT] = {};
+            _wsplitpath_s(name, nullptr, 0, nullptr, 0, nullptr, 0, ext, _MAX_EXT);
+            const bool isdds = _wcsicmp(ext, L".dds") == 0;
 
-        if (isdds)
-        {
-            HRESULT hr = CreateDDSTextureFromFileEx(
-                mDevice.Get(), fullName, 0,
-                D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
-                mForceSRGB ? DDS_LOADER_FORCE_SRGB : DDS_LOADER_DEFAULT, nullptr, textureView);
-            if (FAILED(hr))
+            if (isdds)
             {
-                DebugTrace("ERROR: CreateDDSTextureFromFile failed (%08X) for '%ls'\n",
-                    static_cast<unsigned int>(hr), fullName);
-                throw std::runtime_error("EffectFactory::CreateDDSTextureFromFile");
+                HRESULT hr = CreateDDSTextureFromFileEx(
+                    mDevice.Get(), fullName, 0,
+                    D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
+                    mForceSRGB ? DDS_LOADER_FORCE_SRGB : DDS_LOADER_DEFAULT, nullptr, view);
+                if (FAILED(hr))
+                {
+                    DebugTrace("ERROR: CreateDDSTextureFromFile failed (%08X) for '%ls'\n",
+                        static_cast<unsigned int>(hr), fullName);
+                    throw std::runtime_error("EffectFactory::CreateDDSTextureFromFile");
+                }
             }
-        }
-    #if !defined(_XBOX_ONE) || !defined(_TITLE)
-        else if (deviceContext)
-        {
-            std::lock_guard<std::mutex> lock(mutex);
-            HRESULT hr = CreateWICTextureFromFileEx(
-                mDevice.Get(), deviceContext, fullName, 0,
-                D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
-                mForceSRGB ? WIC_LOADER_FORCE_SRGB : WIC_LOADER_DEFAULT, nullptr, textureView);
-            if (FAILED(hr))
+        #if !defined(_XBOX_ONE) || !defined(_TITLE)
+            else if (deviceContext)
             {
-                DebugTrace("ERROR: CreateWICTextureFromFile failed (%08X) for '%ls'\n",
-                    static_cast<unsigned int>(hr), fullName);
-                throw std::runtime_error("EffectFactory::CreateWICTextureFromFile");
+                std::lock_guard<std::mutex> lock(mutex);
+                HRESULT hr = CreateWICTextureFromFileEx(
+                    mDevice.Get(), deviceContext, fullName, 0,
+                    D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
+                    mForceSRGB ? WIC_LOADER_FORCE_SRGB : WIC_LOADER_DEFAULT, nullptr, view);
+                if (FAILED(hr))
+                {
+                    DebugTrace("ERROR: CreateWICTextureFromFile failed (%08X) for '%ls'\n",
+                        static_cast<unsigned int>(hr), fullName);
+                    throw std::runtime_error("EffectFactory::CreateWICTextureFromFile");
+                }
             }
-        }
-    #endif
-        else
-        {
-            HRESULT hr = CreateWICTextureFromFileEx(
-                mDevice.Get(), fullName, 0,
-                D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
-                mForceSRGB ? WIC_LOADER_FORCE_SRGB : WIC_LOADER_DEFAULT, nullptr, textureView);
-            if (FAILED(hr))
+        #endif
+            else
             {
-                DebugTrace("ERROR: CreateWICTextureFromFile failed (%08X) for '%ls'\n",
-                    static_cast<unsigned int>(hr), fullName);
-                throw std::runtime_error("EffectFactory::CreateWICTextureFromFile");
+                HRESULT hr = CreateWICTextureFromFileEx(
+                    mDevice.Get(), fullName, 0,
+                    D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
+                    mForceSRGB ? WIC_LOADER_FORCE_SRGB : WIC_LOADER_DEFAULT, nullptr, view);
+                if (FAILED(hr))
+                {
+                    DebugTrace("ERROR: CreateWICTextureFromFile failed (%08X) for '%ls'\n",
+                        static_cast<unsigned int>(hr), fullName);
+                    throw std::runtime_error("EffectFactory::CreateWICTextureFromFile");
+                }
             }
-        }
-
-        if (mSharing && *name && it == mTextureCache.end())
-        {
-            std::lock_guard<std::mutex> lock(mutex);
-            TextureCache::value_type v(name, *textureView);
-            mTextureCache.insert(v);
-        }
-    }
+        });
 }
 
 void EffectFactory::Impl::ReleaseCache()
@@ -467,7 +456,7 @@ void EffectFactory::Impl::ReleaseCache()
     mEffectCacheDualTexture.clear();
     mEffectNormalMap.clear();
     mEffectNormalMapSkinned.clear();
-    mTextureCache.clear();
+    mTextureCache.Clear();
 }
 
 
@@ -498,6 +487,15 @@ void EffectFactory::CreateTexture(const wchar_t* name, ID3D11DeviceContext* devi
     return pImpl->CreateTexture(name, deviceContext, textureView);
 }
 
+_Use_decl_annotations_
+bool EffectFactory::GetCachedTexture(const wchar_t* name, ID3D11ShaderResourceView** textureView)
+{
+    if (!name || !textureView)
+        throw std::invalid_argument("name and textureView parameters can't be null");
+
+    return pImpl->GetCachedTexture(name, textureView);
+}
+
 void EffectFactory::ReleaseCache()
 {
     pImpl->ReleaseCache();
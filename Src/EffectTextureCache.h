@@ -0,0 +1,134 @@
+//--------------------------------------------------------------------------------------
+// File: EffectTextureCache.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include <wrl/client.h>
+
+
+namespace DirectX
+{
+    // Texture cache shared by the effect factories. The first request for a name marks it as
+    // loading; concurrent requests for the same name wait for that load rather than loading
+    // the texture again, and pick up the view it caches.
+    class EffectTextureCache
+    {
+    public:
+        EffectTextureCache() = default;
+
+        EffectTextureCache(EffectTextureCache const&) = delete;
+        EffectTextureCache& operator= (EffectTextureCache const&) = delete;
+
+        // Returns the cached view for 'name' or calls load(textureView), caching the result
+        // when sharing is enabled. The load runs without the cache lock held.
+        template<typename TLoad>
+        void Get(_In_z_ const wchar_t* name, bool sharing, _Outptr_ ID3D11ShaderResourceView** textureView, TLoad&& load)
+        {
+            if (!sharing || !*name)
+            {
+                load(textureView);
+                return;
+            }
+
+            std::unique_lock<std::mutex> lock(mMutex);
+
+            std::set<std::wstring>::iterator loading;
+            for (;;)
+            {
+                auto it = mCache.find(name);
+                if (it != mCache.end())
+                {
+                    ID3D11ShaderResourceView* srv = it->second.Get();
+                    srv->AddRef();
+                    *textureView = srv;
+                    return;
+                }
+
+                auto inserted = mLoading.insert(name);
+                if (inserted.second)
+                {
+                    loading = inserted.first;
+                    break;
+                }
+
+                mLoaded.wait(lock);
+            }
+
+            // However this request ends, the name stops loading and waiting requests wake up,
+            // either to find the cached view or to retry the load themselves
+            LoadingGuard guard(*this, lock, loading);
+
+            lock.unlock();
+
+            load(textureView);
+
+            lock.lock();
+            mCache.emplace(name, *textureView);
+        }
+
+        // Returns the cached view for 'name' without loading it, or false if there is none
+        bool Find(_In_z_ const wchar_t* name, _Outptr_result_maybenull_ ID3D11ShaderResourceView** textureView)
+        {
+            *textureView = nullptr;
+
+            const std::lock_guard<std::mutex> lock(mMutex);
+
+            auto it = mCache.find(name);
+            if (it == mCache.end())
+                return false;
+
+            ID3D11ShaderResourceView* srv = it->second.Get();
+            srv->AddRef();
+            *textureView = srv;
+            return true;
+        }
+
+        void Clear()
+        {
+            const std::lock_guard<std::mutex> lock(mMutex);
+            mCache.clear();
+        }
+
+    private:
+        struct LoadingGuard
+        {
+            LoadingGuard(EffectTextureCache& cache, std::unique_lock<std::mutex>& lock, std::set<std::wstring>::iterator it) noexcept :
+                mCache(cache), mLock(lock), mIt(it)
+            {
+            }
+
+            LoadingGuard(LoadingGuard const&) = delete;
+            LoadingGuard& operator= (LoadingGuard const&) = delete;
+
+            ~LoadingGuard()
+            {
+                if (!mLock.owns_lock())
+                    mLock.lock();
+
+                mCache.mLoading.erase(mIt);
+                mCache.mLoaded.notify_all();
+            }
+
+            EffectTextureCache&                 mCache;
+            std::unique_lock<std::mutex>&       mLock;
+            std::set<std::wstring>::iterator    mIt;
+        };
+
+        std::mutex                                                                  mMutex;
+        std::condition_variable                                                     mLoaded;
+        std::map<std::wstring, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>    mCache;
+        std::set<std::wstring>                                                      mLoading;
+    };
+}
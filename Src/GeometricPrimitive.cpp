@@ -19,6 +19,162 @@
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
 
+namespace
+{
+    enum class GeometryShape : uint32_t
+    {
+        Box,
+        Sphere,
+        GeoSphere,
+        Cylinder,
+        Cone,
+        Torus,
+        Tetrahedron,
+        Octahedron,
+        Dodecahedron,
+        Icosahedron,
+        Teapot,
+    };
+
+    struct GeometryKey
+    {
+        GeometryShape shape;
+        float params[3];
+        size_t tessellation;
+        bool rhcoords;
+        bool invertn;
+
+        bool operator < (const GeometryKey& other) const noexcept
+        {
+            return std::tie(shape, params[0], params[1], params[2], tessellation, rhcoords, invertn)
+                < std::tie(other.shape, other.params[0], other.params[1], other.params[2], other.tessellation, other.rhcoords, other.invertn);
+        }
+    };
+
+    // Immutable CPU-side copy of generated vertex and index data.
+    struct GeometryData
+    {
+        VertexCollection vertices;
+        IndexCollection indices;
+
+        size_t SizeInBytes() const noexcept
+        {
+            return vertices.size() * sizeof(VertexCollection::value_type)
+                + indices.size() * sizeof(IndexCollection::value_type);
+        }
+    };
+
+    // Process-wide cache of generated geometry, so that recreating a primitive (for example
+    // after a device-lost or a level reload) only has to upload the data again. Entries are
+    // evicted least-recently-used first once the total size exceeds the memory limit.
+    class GeometryCache
+    {
+    public:
+        static constexpr size_t DefaultLimit = 4 * 1024 * 1024;
+
+        GeometryCache() noexcept(false) : mLimit(DefaultLimit), mSize(0) {}
+
+        GeometryCache(GeometryCache const&) = delete;
+        GeometryCache& operator= (GeometryCache const&) = delete;
+
+        template<typename TCompute>
+        std::shared_ptr<const GeometryData> DemandCreate(const GeometryKey& key, TCompute compute)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+
+                auto pos = mEntries.find(key);
+                if (pos != mEntries.end())
+                {
+                    // Move to the front of the recently-used list.
+                    mLRU.splice(mLRU.begin(), mLRU, pos->second);
+                    return pos->second->data;
+                }
+            }
+
+            // Generate outside of the lock, as this can be slow for high tessellation factors.
+            auto data = std::make_shared<GeometryData>();
+            compute(data->vertices, data->indices);
+
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            auto pos = mEntries.find(key);
+            if (pos != mEntries.end())
+            {
+                // Another thread generated the same geometry first.
+                mLRU.splice(mLRU.begin(), mLRU, pos->second);
+                return pos->second->data;
+            }
+
+            const size_t bytes = data->SizeInBytes();
+            if (bytes <= mLimit)
+            {
+                mLRU.push_front(Entry{ key, data, bytes });
+                mEntries[key] = mLRU.begin();
+                mSize += bytes;
+
+                Trim(mLimit);
+            }
+
+            return data;
+        }
+
+        void SetLimit(size_t bytes)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            mLimit = bytes;
+            Trim(bytes);
+        }
+
+        void Purge()
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            Trim(0);
+        }
+
+    private:
+        struct Entry
+        {
+            GeometryKey key;
+            std::shared_ptr<const GeometryData> data;
+            size_t bytes;
+        };
+
+        void Trim(size_t limit) noexcept
+        {
+            while (mSize > limit && !mLRU.empty())
+            {
+                const Entry& last = mLRU.back();
+                mSize -= last.bytes;
+                mEntries.erase(last.key);
+                mLRU.pop_back();
+            }
+        }
+
+        std::mutex mMutex;
+        size_t mLimit;
+        size_t mSize;
+        std::list<Entry> mLRU;
+        std::map<GeometryKey, std::list<Entry>::iterator> mEntries;
+    };
+
+    GeometryCache s_geometryCache;
+
+    template<typename TCompute>
+    inline std::shared_ptr<const GeometryData> GetGeometry(
+        GeometryShape shape,
+        float p0, float p1, float p2,
+        size_t tessellation,
+        bool rhcoords, bool invertn,
+        TCompute compute)
+    {
+        const GeometryKey key = { shape, { p0, p1, p2 }, tessellation, rhcoords, invertn };
+        return s_geometryCache.DemandCreate(key, compute);
+    }
+}
+
 
 // Internal GeometricPrimitive implementation class.
 class GeometricPrimitive::Impl
@@ -352,6 +508,16 @@ void GeometricPrimitive::Impl::CreateInputLayout(IEffect* effect, ID3D11InputLay
 
 bool GeometricPrimitive::s_reversez = false;
 
+void GeometricPrimitive::SetGeometryCacheLimit(size_t bytes)
+{
+    s_geometryCache.SetLimit(bytes);
+}
+
+void GeometricPrimitive::PurgeGeometryCache()
+{
+    s_geometryCache.Purge();
+}
+
 // Constructor.
 GeometricPrimitive::GeometricPrimitive() noexcept(false)
     : pImpl(std::make_unique<Impl>())
@@ -421,14 +587,16 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateCube(
     float size,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeBox(vertices, indices, XMFLOAT3(size, size, size), rhcoords, false);
+    auto geometry = GetGeometry(GeometryShape::Box, size, size, size, 0, rhcoords, false,
+        [&](VertexCollection& vertices, IndexCollection& indices)
+        {
+            ComputeBox(vertices, indices, XMFLOAT3(size, size, size), rhcoords, false);
+        });
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -451,14 +619,16 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateBox(
     bool rhcoords,
     bool invertn)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeBox(vertices, indices, size, rhcoords, invertn);
+    auto geometry = GetGeometry(GeometryShape::Box, size.x, size.y, size.z, 0, rhcoords, invertn,
+        [&](VertexCollection& vertices, IndexCollection& indices)
+        {
+            ComputeBox(vertices, indices, size, rhcoords, invertn);
+        });
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -486,14 +656,16 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateSphere(
     bool rhcoords,
     bool invertn)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeSphere(vertices, indices, diameter, tessellation, rhcoords, invertn);
+    auto geometry = GetGeometry(GeometryShape::Sphere, diameter, 0, 0, tessellation, rhcoords, invertn,
+        [&](VertexCollection& vertices, IndexCollection& indices)
+        {
+            ComputeSphere(vertices, indices, diameter, tessellation, rhcoords, invertn);
+        });
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -521,14 +693,16 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateGeoSphere(
     size_t tessellation,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeGeoSphere(vertices, indices, diameter, tessellation, rhcoords);
+    auto geometry = GetGeometry(GeometryShape::GeoSphere, diameter, 0, 0, tessellation, rhcoords, false,
+        [&](VertexCollection& vertices, IndexCollection& indices)
+        {
+            ComputeGeoSphere(vertices, indices, diameter, tessellation, rhcoords);
+        });
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -556,14 +730,16 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateCylinder(
     size_t tessellation,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeCylinder(vertices, indices, height, diameter, tessellation, rhcoords);
+    auto geometry = GetGeometry(GeometryShape::Cylinder, height, diameter, 0, tessellation, rhcoords, false,
+        [&](VertexCollection& vertices, IndexCollection& indices)
+        {
+            ComputeCylinder(vertices, indices, height, diameter, tessellation, rhcoords);
+        });
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -589,14 +765,16 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateCone(
     size_t tessellation,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeCone(vertices, indices, diameter, height, tessellation, rhcoords);
+    auto geometry = GetGeometry(GeometryShape::Cone, diameter, height, 0, tessellation, rhcoords, false,
+        [&](VertexCollection& vertices, IndexCollection& indices)
+        {
+            ComputeCone(vertices, indices, diameter, height, tessellation, rhcoords);
+        });
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -625,14 +803,16 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateTorus(
     size_t tessellation,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeTorus(vertices, indices, diameter, thickness, tessellation, rhcoords);
+    auto geometry = GetGeometry(GeometryShape::Torus, diameter, thickness, 0, tessellation, rhcoords, false,
+        [&](VertexCollection& vertices, IndexCollection& indices)
+        {
+            ComputeTorus(vertices, indices, diameter, thickness, tessellation, rhcoords);
+        });
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -659,14 +839,16 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateTetrahedron(
     float size,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeTetrahedron(vertices, indices, size, rhcoords);
+    auto geometry = GetGeometry(GeometryShape::Tetrahedron, size, 0, 0, 0, rhcoords, false,
+        [&](VertexCollection& vertices, IndexCollection& indices)
+        {
+            ComputeTetrahedron(vertices, indices, size, rhcoords);
+        });
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -691,14 +873,16 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateOctahedron(
     float size,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeOctahedron(vertices, indices, size, rhcoords);
+    auto geometry = GetGeometry(GeometryShape::Octahedron, size, 0, 0, 0, rhcoords, false,
+        [&](VertexCollection& vertices, IndexCollection& indices)
+        {
+            ComputeOctahedron(vertices, indices, size, rhcoords);
+        });
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -723,14 +907,16 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateDodecahedron(
     float size,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeDodecahedron(vertices, indices, size, rhcoords);
+    auto geometry = GetGeometry(GeometryShape::Dodecahedron, size, 0, 0, 0, rhcoords, false,
+        [&](VertexCollection& vertices, IndexCollection& indices)
+        {
+            ComputeDodecahedron(vertices, indices, size, rhcoords);
+        });
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -755,14 +941,16 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateIcosahedron(
     float size,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeIcosahedron(vertices, indices, size, rhcoords);
+    auto geometry = GetGeometry(GeometryShape::Icosahedron, size, 0, 0, 0, rhcoords, false,
+        [&](VertexCollection& vertices, IndexCollection& indices)
+        {
+            ComputeIcosahedron(vertices, indices, size, rhcoords);
+        });
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -788,14 +976,16 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateTeapot(
     size_t tessellation,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeTeapot(vertices, indices, size, tessellation, rhcoords);
+    auto geometry = GetGeometry(GeometryShape::Teapot, size, 0, 0, tessellation, rhcoords, false,
+        [&](VertexCollection& vertices, IndexCollection& indices)
+        {
+            ComputeTeapot(vertices, indices, size, tessellation, rhcoords);
+        });
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -811,6 +1001,76 @@ void GeometricPrimitive::CreateTeapot(
 }
 
 
+//--------------------------------------------------------------------------------------
+// Tangent frames
+//--------------------------------------------------------------------------------------
+
+void GeometricPrimitive::CreateSphere(
+    TangentVertexCollection& vertices,
+    IndexCollection& indices,
+    float diameter,
+    size_t tessellation,
+    bool rhcoords,
+    bool invertn)
+{
+    VertexCollection source;
+    ComputeSphere(source, indices, diameter, tessellation, rhcoords, invertn);
+    ComputeSphereTangents(source, tessellation, rhcoords, vertices);
+}
+
+void GeometricPrimitive::CreateCylinder(
+    TangentVertexCollection& vertices,
+    IndexCollection& indices,
+    float height,
+    float diameter,
+    size_t tessellation,
+    bool rhcoords)
+{
+    VertexCollection source;
+    ComputeCylinder(source, indices, height, diameter, tessellation, rhcoords);
+    ComputeCylinderTangents(source, tessellation, rhcoords, vertices);
+}
+
+void GeometricPrimitive::CreateTorus(
+    TangentVertexCollection& vertices,
+    IndexCollection& indices,
+    float diameter,
+    float thickness,
+    size_t tessellation,
+    bool rhcoords)
+{
+    VertexCollection source;
+    ComputeTorus(source, indices, diameter, thickness, tessellation, rhcoords);
+    ComputeTorusTangents(source, tessellation, rhcoords, vertices);
+}
+
+void GeometricPrimitive::ComputeTangents(
+    const VertexCollection& vertices,
+    const IndexCollection& indices,
+    TangentVertexCollection& result)
+{
+    ComputeTangentFrames(vertices, indices, result);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Packed vertex output
+//--------------------------------------------------------------------------------------
+
+void GeometricPrimitive::PackVertices(
+    const VertexCollection& vertices,
+    PackedVertexCollection& packed)
+{
+    packed.clear();
+    packed.reserve(vertices.size());
+
+    for (const auto& it : vertices)
+    {
+        packed.emplace_back(it);
+    }
+}
+
+
 //--------------------------------------------------------------------------------------
 // Custom
 //--------------------------------------------------------------------------------------
@@ -52,6 +52,21 @@ namespace
     }
 
 
+    // Tabulates the sine (x) and cosine (y) of float(i) * range / float(segments) + offset
+    // for i in [0, segments], so each angle is only evaluated once per primitive.
+    void ComputeSinCosTable(std::vector<XMFLOAT2>& table, size_t segments, float range, float offset)
+    {
+        table.resize(segments + 1);
+
+        for (size_t i = 0; i <= segments; i++)
+        {
+            const float angle = float(i) * range / float(segments) + offset;
+
+            XMScalarSinCos(&table[i].x, &table[i].y, angle);
+        }
+    }
+
+
     // Helper for inverting normals of geometric primitives for 'inside' vs. 'outside' viewing
     inline void InvertNormals(VertexCollection& vertices)
     {
@@ -157,55 +172,29 @@ void DirectX::ComputeSphere(VertexCollection& vertices, IndexCollection& indices
 
     const float radius = diameter / 2;
 
-    // Create rings of vertices at progressively higher latitudes.
-    for (size_t i = 0; i <= verticalSegments; i++)
-    {
-        const float v = 1 - float(i) / float(verticalSegments);
-
-        const float latitude = (float(i) * XM_PI / float(verticalSegments)) - XM_PIDIV2;
-        float dy, dxz;
-
-        XMScalarSinCos(&dy, &dxz, latitude);
+    // Rings of vertices at progressively higher latitudes, joined by triangles.
+    std::vector<XMFLOAT2> latitudes;
+    std::vector<XMFLOAT2> longitudes;
+    ComputeSinCosTable(latitudes, verticalSegments, XM_PI, -XM_PIDIV2);
+    ComputeSinCosTable(longitudes, horizontalSegments, XM_2PI, 0.f);
 
-        // Create a single ring of vertices at this latitude.
-        for (size_t j = 0; j <= horizontalSegments; j++)
+    ComputeParametricSurface(vertices, indices, verticalSegments, horizontalSegments, false, true, false,
+        [&](size_t i, size_t j) noexcept
         {
+            const float v = 1 - float(i) / float(verticalSegments);
             const float u = float(j) / float(horizontalSegments);
 
-            const float longitude = float(j) * XM_2PI / float(horizontalSegments);
-            float dx, dz;
-
-            XMScalarSinCos(&dx, &dz, longitude);
+            const float dy = latitudes[i].x;
+            const float dxz = latitudes[i].y;
 
-            dx *= dxz;
-            dz *= dxz;
+            const float dx = longitudes[j].x * dxz;
+            const float dz = longitudes[j].y * dxz;
 
             const XMVECTOR normal = XMVectorSet(dx, dy, dz, 0);
             const XMVECTOR textureCoordinate = XMVectorSet(u, v, 0, 0);
 
-            vertices.push_back(VertexPositionNormalTexture(XMVectorScale(normal, radius), normal, textureCoordinate));
-        }
-    }
-
-    // Fill the index buffer with triangles joining each pair of latitude rings.
-    const size_t stride = horizontalSegments + 1;
-
-    for (size_t i = 0; i < verticalSegments; i++)
-    {
-        for (size_t j = 0; j <= horizontalSegments; j++)
-        {
-            const size_t nextI = i + 1;
-            const size_t nextJ = (j + 1) % stride;
-
-            index_push_back(indices, i * stride + j);
-            index_push_back(indices, nextI * stride + j);
-            index_push_back(indices, i * stride + nextJ);
-
-            index_push_back(indices, i * stride + nextJ);
-            index_push_back(indices, nextI * stride + j);
-            index_push_back(indices, nextI * stride + nextJ);
-        }
-    }
+            return VertexPositionNormalTexture(XMVectorScale(normal, radius), normal, textureCoordinate);
+        });
 
     // Build RH above
     if (!rhcoords)
@@ -622,30 +611,26 @@ void DirectX::ComputeCylinder(VertexCollection& vertices, IndexCollection& indic
     const XMVECTOR topOffset = XMVectorScale(g_XMIdentityR1, height);
 
     const float radius = diameter / 2;
-    const size_t stride = tessellation + 1;
-
-    // Create a ring of triangles around the outside of the cylinder.
-    for (size_t i = 0; i <= tessellation; i++)
-    {
-        const XMVECTOR normal = GetCircleVector(i, tessellation);
 
-        const XMVECTOR sideOffset = XMVectorScale(normal, radius);
+    // Create a ring of triangles around the outside of the cylinder, as pairs of top and bottom vertices.
+    std::vector<XMFLOAT2> angles;
+    ComputeSinCosTable(angles, tessellation, XM_2PI, 0.f);
 
-        const float u = float(i) / float(tessellation);
+    ComputeParametricSurface(vertices, indices, tessellation, 1, true, false, false,
+        [&](size_t i, size_t j) noexcept
+        {
+            const XMVECTOR normal = XMVectorSet(angles[i].x, 0, angles[i].y, 0);
 
-        const XMVECTOR textureCoordinate = XMLoadFloat(&u);
+            const XMVECTOR sideOffset = XMVectorScale(normal, radius);
 
-        vertices.push_back(VertexPositionNormalTexture(XMVectorAdd(sideOffset, topOffset), normal, textureCoordinate));
-        vertices.push_back(VertexPositionNormalTexture(XMVectorSubtract(sideOffset, topOffset), normal, XMVectorAdd(textureCoordinate, g_XMIdentityR1)));
+            const float u = float(i) / float(tessellation);
 
-        index_push_back(indices, i * 2);
-        index_push_back(indices, (i * 2 + 2) % (stride * 2));
-        index_push_back(indices, i * 2 + 1);
+            const XMVECTOR textureCoordinate = XMLoadFloat(&u);
 
-        index_push_back(indices, i * 2 + 1);
-        index_push_back(indices, (i * 2 + 2) % (stride * 2));
-        index_push_back(indices, (i * 2 + 3) % (stride * 2));
-    }
+            return (j == 0)
+                ? VertexPositionNormalTexture(XMVectorAdd(sideOffset, topOffset), normal, textureCoordinate)
+                : VertexPositionNormalTexture(XMVectorSubtract(sideOffset, topOffset), normal, XMVectorAdd(textureCoordinate, g_XMIdentityR1));
+        });
 
     // Create flat triangle fan caps to seal the top and bottom.
     CreateCylinderCap(vertices, indices, tessellation, height, radius, true);
@@ -720,28 +705,30 @@ void DirectX::ComputeTorus(VertexCollection& vertices, IndexCollection& indices,
     if (tessellation < 3)
         throw std::invalid_argument("tesselation parameter must be at least 3");
 
-    const size_t stride = tessellation + 1;
-
-    // First we loop around the main ring of the torus.
+    // Create a transform matrix for each step around the main ring that will align
+    // geometry to slice perpendicularly though the current ring position.
+    std::vector<XMFLOAT4X4> transforms(tessellation + 1);
     for (size_t i = 0; i <= tessellation; i++)
     {
-        const float u = float(i) / float(tessellation);
-
         const float outerAngle = float(i) * XM_2PI / float(tessellation) - XM_PIDIV2;
 
-        // Create a transform matrix that will align geometry to
-        // slice perpendicularly though the current ring position.
-        const XMMATRIX transform = XMMatrixTranslation(diameter / 2, 0, 0) * XMMatrixRotationY(outerAngle);
+        XMStoreFloat4x4(&transforms[i], XMMatrixTranslation(diameter / 2, 0, 0) * XMMatrixRotationY(outerAngle));
+    }
 
-        // Now we loop along the other axis, around the side of the tube.
-        for (size_t j = 0; j <= tessellation; j++)
+    // The other axis loops around the side of the tube.
+    std::vector<XMFLOAT2> innerAngles;
+    ComputeSinCosTable(innerAngles, tessellation, XM_2PI, XM_PI);
+
+    ComputeParametricSurface(vertices, indices, tessellation, tessellation, true, true, true,
+        [&](size_t i, size_t j) noexcept
         {
+            const float u = float(i) / float(tessellation);
             const float v = 1 - float(j) / float(tessellation);
 
-            const float innerAngle = float(j) * XM_2PI / float(tessellation) + XM_PI;
-            float dx, dy;
+            const float dy = innerAngles[j].x;
+            const float dx = innerAngles[j].y;
 
-            XMScalarSinCos(&dy, &dx, innerAngle);
+            const XMMATRIX transform = XMLoadFloat4x4(&transforms[i]);
 
             // Create a vertex.
             XMVECTOR normal = XMVectorSet(dx, dy, 0, 0);
@@ -751,21 +738,8 @@ void DirectX::ComputeTorus(VertexCollection& vertices, IndexCollection& indices,
             position = XMVector3Transform(position, transform);
             normal = XMVector3TransformNormal(normal, transform);
 
-            vertices.push_back(VertexPositionNormalTexture(position, normal, textureCoordinate));
-
-            // And create indices for two triangles.
-            const size_t nextI = (i + 1) % stride;
-            const size_t nextJ = (j + 1) % stride;
-
-            index_push_back(indices, i * stride + j);
-            index_push_back(indices, i * stride + nextJ);
-            index_push_back(indices, nextI * stride + j);
-
-            index_push_back(indices, i * stride + nextJ);
-            index_push_back(indices, nextI * stride + nextJ);
-            index_push_back(indices, nextI * stride + j);
-        }
-    }
+            return VertexPositionNormalTexture(position, normal, textureCoordinate);
+        });
 
     // Build RH above
     if (!rhcoords)
@@ -1191,3 +1165,247 @@ void DirectX::ComputeTeapot(VertexCollection& vertices, IndexCollection& indices
     if (!rhcoords)
         ReverseWinding(indices, vertices);
 }
+
+
+//--------------------------------------------------------------------------------------
+// Tangent frames
+//--------------------------------------------------------------------------------------
+namespace
+{
+    // Orthogonalizes the texture-space derivatives against the vertex normal and emits a vertex
+    // with the tangent in xyz and the bitangent handedness in w.
+    inline void XM_CALLCONV PushTangentVertex(
+        TangentVertexCollection& result,
+        const VertexPositionNormalTexture& vertex,
+        FXMVECTOR dpdu,
+        FXMVECTOR dpdv)
+    {
+        const XMVECTOR normal = XMLoadFloat3(&vertex.normal);
+
+        XMVECTOR tangent = XMVectorSubtract(dpdu, XMVectorMultiply(normal, XMVector3Dot(normal, dpdu)));
+
+        if (XMVector3Less(XMVector3LengthSq(tangent), g_XMEpsilon))
+        {
+            // Degenerate texture mapping, so pick any vector perpendicular to the normal.
+            const XMVECTOR axis = (fabsf(vertex.normal.y) < 0.99f) ? g_XMIdentityR1 : g_XMIdentityR0;
+            tangent = XMVector3Cross(axis, normal);
+        }
+
+        tangent = XMVector3Normalize(tangent);
+
+        const XMVECTOR handedness = XMVector3Less(XMVector3Dot(XMVector3Cross(normal, tangent), dpdv), g_XMZero)
+            ? g_XMNegativeOne : g_XMOne;
+
+        tangent = XMVectorSelect(handedness, tangent, g_XMSelect1110);
+
+        result.emplace_back(
+            XMLoadFloat3(&vertex.position),
+            normal,
+            tangent,
+            0xFFFFFFFF,
+            XMLoadFloat2(&vertex.textureCoordinate));
+    }
+}
+
+
+// Generic tangent frames from the texture mapping of each triangle, weighted by the corner angle.
+void DirectX::ComputeTangentFrames(const VertexCollection& vertices, const IndexCollection& indices, TangentVertexCollection& result)
+{
+    result.clear();
+
+    if (indices.size() % 3)
+        throw std::invalid_argument("Expected triangular faces");
+
+    const size_t nVerts = vertices.size();
+
+    std::vector<XMFLOAT3> tangents(nVerts, XMFLOAT3(0, 0, 0));
+    std::vector<XMFLOAT3> bitangents(nVerts, XMFLOAT3(0, 0, 0));
+
+    for (size_t j = 0; j < indices.size(); j += 3)
+    {
+        const size_t i0 = indices[j];
+        const size_t i1 = indices[j + 1];
+        const size_t i2 = indices[j + 2];
+
+        if (i0 >= nVerts || i1 >= nVerts || i2 >= nVerts)
+            throw std::out_of_range("Index not in vertices list");
+
+        const XMVECTOR p0 = XMLoadFloat3(&vertices[i0].position);
+        const XMVECTOR p1 = XMLoadFloat3(&vertices[i1].position);
+        const XMVECTOR p2 = XMLoadFloat3(&vertices[i2].position);
+
+        const XMVECTOR t0 = XMLoadFloat2(&vertices[i0].textureCoordinate);
+        const XMVECTOR t1 = XMLoadFloat2(&vertices[i1].textureCoordinate);
+        const XMVECTOR t2 = XMLoadFloat2(&vertices[i2].textureCoordinate);
+
+        const XMVECTOR e1 = XMVectorSubtract(p1, p0);
+        const XMVECTOR e2 = XMVectorSubtract(p2, p0);
+
+        // (du1, dv1, du2, dv2)
+        const XMVECTOR st = XMVectorPermute<0, 1, 4, 5>(XMVectorSubtract(t1, t0), XMVectorSubtract(t2, t0));
+
+        const float det = XMVectorGetX(st) * XMVectorGetW(st) - XMVectorGetZ(st) * XMVectorGetY(st);
+        if (fabsf(det) < 1e-12f)
+            continue;
+
+        const XMVECTOR invDet = XMVectorReplicate(1.f / det);
+
+        // dp/du = (e1 * dv2 - e2 * dv1) / det, dp/dv = (e2 * du1 - e1 * du2) / det
+        const XMVECTOR dpdu = XMVectorMultiply(XMVectorSubtract(
+            XMVectorMultiply(e1, XMVectorSplatW(st)),
+            XMVectorMultiply(e2, XMVectorSplatY(st))), invDet);
+        const XMVECTOR dpdv = XMVectorMultiply(XMVectorSubtract(
+            XMVectorMultiply(e2, XMVectorSplatX(st)),
+            XMVectorMultiply(e1, XMVectorSplatZ(st))), invDet);
+
+        // Weight each corner by its angle, so the result does not depend on how faces are split.
+        const XMVECTOR n1 = XMVector3Normalize(e1);
+        const XMVECTOR n2 = XMVector3Normalize(e2);
+        const XMVECTOR n3 = XMVector3Normalize(XMVectorSubtract(p2, p1));
+
+        const XMVECTOR w0 = XMVector3AngleBetweenNormals(n1, n2);
+        const XMVECTOR w1 = XMVector3AngleBetweenNormals(XMVectorNegate(n1), n3);
+        const XMVECTOR w2 = XMVectorSubtract(g_XMPi, XMVectorAdd(w0, w1));
+
+        const size_t corners[3] = { i0, i1, i2 };
+        const XMVECTOR weights[3] = { w0, w1, w2 };
+
+        for (size_t k = 0; k < 3; ++k)
+        {
+            auto& t = tangents[corners[k]];
+            XMStoreFloat3(&t, XMVectorMultiplyAdd(dpdu, weights[k], XMLoadFloat3(&t)));
+
+            auto& b = bitangents[corners[k]];
+            XMStoreFloat3(&b, XMVectorMultiplyAdd(dpdv, weights[k], XMLoadFloat3(&b)));
+        }
+    }
+
+    result.reserve(nVerts);
+
+    for (size_t i = 0; i < nVerts; i++)
+    {
+        PushTangentVertex(result, vertices[i], XMLoadFloat3(&tangents[i]), XMLoadFloat3(&bitangents[i]));
+    }
+}
+
+
+// Analytic tangent frames for ComputeSphere output.
+void DirectX::ComputeSphereTangents(const VertexCollection& vertices, size_t tessellation, bool rhcoords, TangentVertexCollection& result)
+{
+    result.clear();
+
+    const size_t verticalSegments = tessellation;
+    const size_t horizontalSegments = tessellation * 2;
+
+    if (tessellation < 3 || vertices.size() != (verticalSegments + 1) * (horizontalSegments + 1))
+        throw std::invalid_argument("Vertices do not match sphere tessellation");
+
+    result.reserve(vertices.size());
+
+    // ReverseWinding mirrors u for left-handed coordinates.
+    const XMVECTOR uscale = rhcoords ? g_XMOne : g_XMNegativeOne;
+
+    size_t index = 0;
+    for (size_t i = 0; i <= verticalSegments; i++)
+    {
+        const float latitude = (float(i) * XM_PI / float(verticalSegments)) - XM_PIDIV2;
+        float dy, dxz;
+
+        XMScalarSinCos(&dy, &dxz, latitude);
+
+        for (size_t j = 0; j <= horizontalSegments; j++)
+        {
+            const float longitude = float(j) * XM_2PI / float(horizontalSegments);
+            float dx, dz;
+
+            XMScalarSinCos(&dx, &dz, longitude);
+
+            // u increases with longitude, v decreases with latitude.
+            const XMVECTOR dpdu = XMVectorMultiply(XMVectorSet(dz, 0, -dx, 0), uscale);
+            const XMVECTOR dpdv = XMVectorSet(dy * dx, -dxz, dy * dz, 0);
+
+            PushTangentVertex(result, vertices[index++], dpdu, dpdv);
+        }
+    }
+}
+
+
+// Analytic tangent frames for ComputeCylinder output.
+void DirectX::ComputeCylinderTangents(const VertexCollection& vertices, size_t tessellation, bool rhcoords, TangentVertexCollection& result)
+{
+    result.clear();
+
+    const size_t sideCount = (tessellation + 1) * 2;
+
+    if (tessellation < 3 || vertices.size() != sideCount + tessellation * 2)
+        throw std::invalid_argument("Vertices do not match cylinder tessellation");
+
+    result.reserve(vertices.size());
+
+    const XMVECTOR uscale = rhcoords ? g_XMOne : g_XMNegativeOne;
+
+    // Sides: u follows the circle, v runs from top to bottom.
+    for (size_t i = 0; i < sideCount; i++)
+    {
+        const auto& vertex = vertices[i];
+
+        const XMVECTOR dpdu = XMVectorMultiply(XMVectorSet(vertex.normal.z, 0, -vertex.normal.x, 0), uscale);
+
+        PushTangentVertex(result, vertex, dpdu, g_XMNegIdentityR1);
+    }
+
+    // Caps: planar mapping of x/z, with u mirrored on the top cap.
+    const XMVECTOR topdpdu = XMVectorMultiply(g_XMNegIdentityR0, uscale);
+    const XMVECTOR bottomdpdu = XMVectorMultiply(g_XMIdentityR0, uscale);
+
+    for (size_t i = 0; i < tessellation; i++)
+    {
+        PushTangentVertex(result, vertices[sideCount + i], topdpdu, g_XMNegIdentityR2);
+    }
+
+    for (size_t i = 0; i < tessellation; i++)
+    {
+        PushTangentVertex(result, vertices[sideCount + tessellation + i], bottomdpdu, g_XMNegIdentityR2);
+    }
+}
+
+
+// Analytic tangent frames for ComputeTorus output.
+void DirectX::ComputeTorusTangents(const VertexCollection& vertices, size_t tessellation, bool rhcoords, TangentVertexCollection& result)
+{
+    result.clear();
+
+    const size_t stride = tessellation + 1;
+
+    if (tessellation < 3 || vertices.size() != stride * stride)
+        throw std::invalid_argument("Vertices do not match torus tessellation");
+
+    result.reserve(vertices.size());
+
+    const XMVECTOR uscale = rhcoords ? g_XMOne : g_XMNegativeOne;
+
+    size_t index = 0;
+    for (size_t i = 0; i <= tessellation; i++)
+    {
+        const float outerAngle = float(i) * XM_2PI / float(tessellation) - XM_PIDIV2;
+        float so, co;
+
+        XMScalarSinCos(&so, &co, outerAngle);
+
+        // u follows the main ring.
+        const XMVECTOR dpdu = XMVectorMultiply(XMVectorSet(-so, 0, -co, 0), uscale);
+
+        for (size_t j = 0; j <= tessellation; j++)
+        {
+            const float innerAngle = float(j) * XM_2PI / float(tessellation) + XM_PI;
+            float si, ci;
+
+            XMScalarSinCos(&si, &ci, innerAngle);
+
+            // v decreases around the side of the tube.
+            const XMVECTOR dpdv = XMVectorSet(si * co, -ci, -si * so, 0);
+
+            PushTangentVertex(result, vertices[index++], dpdu, dpdv);
+        }
+    }
+}
@@ -8,12 +8,20 @@
 // https://go.microsoft.com/fwlink/?LinkID=615561
 //--------------------------------------------------------------------------------------
 
+#pragma once
+
 #include "VertexTypes.h"
 
+#include <climits>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
 namespace DirectX
 {
     using VertexCollection = std::vector<DirectX::VertexPositionNormalTexture>;
     using IndexCollection = std::vector<uint16_t>;
+    using TangentVertexCollection = std::vector<DirectX::VertexPositionNormalTangentColorTexture>;
 
     void ComputeBox(VertexCollection& vertices, IndexCollection& indices, const XMFLOAT3& size, bool rhcoords, bool invertn);
     void ComputeSphere(VertexCollection& vertices, IndexCollection& indices, float diameter, size_t tessellation, bool rhcoords, bool invertn);
@@ -26,4 +34,69 @@ namespace DirectX
     void ComputeDodecahedron(VertexCollection& vertices, IndexCollection& indices, float size, bool rhcoords);
     void ComputeIcosahedron(VertexCollection& vertices, IndexCollection& indices, float size, bool rhcoords);
     void ComputeTeapot(VertexCollection& vertices, IndexCollection& indices, float size, size_t tessellation, bool rhcoords);
+
+    // Generates a regular grid of (outerSegments + 1) x (innerSegments + 1) vertices, appended to
+    // 'vertices' in row-major order, where evaluate(i, j) returns the vertex for outer step i and
+    // inner step j. Each grid cell becomes two triangles. A wrapped dimension also joins its last
+    // step back to the first, so seams can share or duplicate vertices as the shape requires.
+    template<typename TEvaluate>
+    void ComputeParametricSurface(
+        VertexCollection& vertices, IndexCollection& indices,
+        size_t outerSegments, size_t innerSegments,
+        bool wrapOuter, bool wrapInner,
+        bool flipWinding,
+        TEvaluate&& evaluate)
+    {
+        const size_t vbase = vertices.size();
+        const size_t outerStride = outerSegments + 1;
+        const size_t innerStride = innerSegments + 1;
+
+        // Use >=, not > comparison, because some D3D level 9_x hardware does not support 0xFFFF index values.
+        if (vbase + outerStride * innerStride - 1 >= USHRT_MAX)
+            throw std::out_of_range("Index value out of range: cannot tesselate primitive so finely");
+
+        vertices.reserve(vbase + outerStride * innerStride);
+
+        for (size_t i = 0; i <= outerSegments; i++)
+        {
+            for (size_t j = 0; j <= innerSegments; j++)
+            {
+                vertices.push_back(evaluate(i, j));
+            }
+        }
+
+        const size_t outerCount = wrapOuter ? outerStride : outerSegments;
+        const size_t innerCount = wrapInner ? innerStride : innerSegments;
+
+        indices.reserve(indices.size() + outerCount * innerCount * 6);
+
+        for (size_t i = 0; i < outerCount; i++)
+        {
+            const size_t nextI = (i + 1) % outerStride;
+
+            for (size_t j = 0; j < innerCount; j++)
+            {
+                const size_t nextJ = (j + 1) % innerStride;
+
+                const auto i0 = static_cast<uint16_t>(vbase + i * innerStride + j);
+                const auto i1 = static_cast<uint16_t>(vbase + nextI * innerStride + j);
+                const auto i2 = static_cast<uint16_t>(vbase + i * innerStride + nextJ);
+                const auto i3 = static_cast<uint16_t>(vbase + nextI * innerStride + nextJ);
+
+                if (flipWinding)
+                {
+                    indices.insert(indices.end(), { i0, i2, i1, i2, i3, i1 });
+                }
+                else
+                {
+                    indices.insert(indices.end(), { i0, i1, i2, i2, i1, i3 });
+                }
+            }
+        }
+    }
+
+    void ComputeTangentFrames(const VertexCollection& vertices, const IndexCollection& indices, TangentVertexCollection& result);
+    void ComputeSphereTangents(const VertexCollection& vertices, size_t tessellation, bool rhcoords, TangentVertexCollection& result);
+    void ComputeCylinderTangents(const VertexCollection& vertices, size_t tessellation, bool rhcoords, TangentVertexCollection& result);
+    void ComputeTorusTangents(const VertexCollection& vertices, size_t tessellation, bool rhcoords, TangentVertexCollection& result);
 }
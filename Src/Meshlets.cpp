@@ -0,0 +1,480 @@
+//--------------------------------------------------------------------------------------
+// File: Meshlets.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "Meshlets.h"
+
+#include "BufferHelpers.h"
+#include "DirectXHelpers.h"
+#include "Effects.h"
+#include "Model.h"
+#include "ModelHelpers.h"
+#include "PlatformHelpers.h"
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    //--------------------------------------------------------------------------------------
+    // Computes the bounding sphere and normal cone of a finished cluster.
+    void ComputeMeshletBounds(
+        Meshlet& meshlet,
+        const std::vector<XMFLOAT3>& positions,
+        const std::vector<uint32_t>& clusterVerts,
+        const std::vector<uint32_t>& clusterTris,
+        const uint32_t* faceIndices,
+        float facing)
+    {
+        std::vector<XMFLOAT3> points;
+        points.reserve(clusterVerts.size());
+        for (const auto it : clusterVerts)
+        {
+            points.push_back(positions[it]);
+        }
+
+        BoundingSphere::CreateFromPoints(meshlet.boundingSphere, points.size(), points.data(), sizeof(XMFLOAT3));
+
+        const XMVECTOR center = XMLoadFloat3(&meshlet.boundingSphere.Center);
+
+        // Triangle normals, oriented towards the front face.
+        std::vector<XMFLOAT3> normals;
+        normals.reserve(clusterTris.size());
+
+        XMVECTOR axis = g_XMZero;
+        for (const auto face : clusterTris)
+        {
+            const XMVECTOR p0 = XMLoadFloat3(&positions[faceIndices[face * 3]]);
+            const XMVECTOR p1 = XMLoadFloat3(&positions[faceIndices[face * 3 + 1]]);
+            const XMVECTOR p2 = XMLoadFloat3(&positions[faceIndices[face * 3 + 2]]);
+
+            const XMVECTOR n = XMVectorScale(XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0)), facing);
+            if (XMVector3Less(XMVector3LengthSq(n), g_XMEpsilon))
+                continue;
+
+            const XMVECTOR nn = XMVector3Normalize(n);
+
+            XMFLOAT3 tmp;
+            XMStoreFloat3(&tmp, nn);
+            normals.push_back(tmp);
+
+            axis = XMVectorAdd(axis, nn);
+        }
+
+        meshlet.coneApex = meshlet.boundingSphere.Center;
+        meshlet.coneAxis = XMFLOAT3(0, 0, 0);
+        meshlet.coneCutoff = 1.f;
+
+        if (normals.empty() || XMVector3Less(XMVector3LengthSq(axis), g_XMEpsilon))
+            return;
+
+        axis = XMVector3Normalize(axis);
+        XMStoreFloat3(&meshlet.coneAxis, axis);
+
+        float mindp = 1.f;
+        for (const auto& it : normals)
+        {
+            mindp = std::min(mindp, XMVectorGetX(XMVector3Dot(XMLoadFloat3(&it), axis)));
+        }
+
+        // Triangles spread over more than a hemisphere (less a margin) can't be usefully rejected.
+        if (mindp <= 0.1f)
+            return;
+
+        // Place the apex behind every triangle plane.
+        float maxt = 0.f;
+        size_t j = 0;
+        for (const auto face : clusterTris)
+        {
+            const XMVECTOR p0 = XMLoadFloat3(&positions[faceIndices[face * 3]]);
+            const XMVECTOR p1 = XMLoadFloat3(&positions[faceIndices[face * 3 + 1]]);
+            const XMVECTOR p2 = XMLoadFloat3(&positions[faceIndices[face * 3 + 2]]);
+
+            const XMVECTOR n = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+            if (XMVector3Less(XMVector3LengthSq(n), g_XMEpsilon))
+                continue;
+
+            const XMVECTOR nn = XMLoadFloat3(&normals[j++]);
+
+            const float dc = XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, p0), nn));
+            const float dn = XMVectorGetX(XMVector3Dot(axis, nn));
+
+            assert(dn > 0.f);
+            maxt = std::max(maxt, dc / dn);
+        }
+
+        XMStoreFloat3(&meshlet.coneApex, XMVectorSubtract(center, XMVectorScale(axis, maxt)));
+        meshlet.coneCutoff = sqrtf(1.f - mindp * mindp);
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Greedy clustering: grow each meshlet from a seed triangle by repeatedly adding the
+    // adjacent triangle that introduces the fewest new vertices.
+    template<typename index_t>
+    void BuildMeshlets(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        _In_reads_bytes_(nVerts * vertexStride) const void* positions, size_t vertexStride, size_t nVerts,
+        std::vector<Meshlet>& meshlets,
+        std::vector<index_t>& reorderedIndices,
+        bool rhcoords,
+        size_t maxVerts,
+        size_t maxPrims)
+    {
+        if (!indices || !nFaces || !positions || !nVerts)
+            throw std::invalid_argument("Requires both vertices and indices");
+
+        if (vertexStride < sizeof(XMFLOAT3))
+            throw std::invalid_argument("Invalid vertex stride");
+
+        if (maxVerts < 3 || maxPrims < 1)
+            throw std::invalid_argument("Meshlet limits must allow at least one triangle");
+
+        if (nFaces * 3 > UINT32_MAX || nVerts >= UINT32_MAX)
+            throw std::out_of_range("Too many faces or vertices");
+
+        std::vector<XMFLOAT3> pos(nVerts);
+        {
+            auto ptr = static_cast<const uint8_t*>(positions);
+            for (size_t j = 0; j < nVerts; ++j, ptr += vertexStride)
+            {
+                memcpy(&pos[j], ptr, sizeof(XMFLOAT3));
+            }
+        }
+
+        std::vector<uint32_t> faceIndices(nFaces * 3);
+        for (size_t j = 0; j < nFaces * 3; ++j)
+        {
+            if (indices[j] >= nVerts)
+                throw std::out_of_range("Index not in vertices list");
+
+            faceIndices[j] = static_cast<uint32_t>(indices[j]);
+        }
+
+        // Vertex to triangle adjacency.
+        std::vector<uint32_t> adjOffsets(nVerts + 1, 0);
+        for (const auto it : faceIndices)
+        {
+            ++adjOffsets[it + 1];
+        }
+
+        for (size_t j = 0; j < nVerts; ++j)
+        {
+            adjOffsets[j + 1] += adjOffsets[j];
+        }
+
+        std::vector<uint32_t> adjFaces(nFaces * 3);
+        {
+            std::vector<uint32_t> fill(adjOffsets.cbegin(), adjOffsets.cend() - 1);
+            for (size_t j = 0; j < nFaces * 3; ++j)
+            {
+                adjFaces[fill[faceIndices[j]]++] = static_cast<uint32_t>(j / 3);
+            }
+        }
+
+        const float facing = rhcoords ? -1.f : 1.f;
+
+        meshlets.clear();
+        reorderedIndices.clear();
+        reorderedIndices.reserve(nFaces * 3);
+
+        std::vector<uint8_t> emitted(nFaces, 0);
+        std::vector<uint32_t> vertexTag(nVerts, UINT32_MAX);
+
+        std::vector<uint32_t> clusterVerts;
+        std::vector<uint32_t> clusterTris;
+        std::vector<uint32_t> candidates;
+
+        clusterVerts.reserve(maxVerts);
+        clusterTris.reserve(maxPrims);
+
+        size_t seed = 0;
+        for (;;)
+        {
+            while (seed < nFaces && emitted[seed])
+                ++seed;
+
+            if (seed >= nFaces)
+                break;
+
+            const auto id = static_cast<uint32_t>(meshlets.size());
+
+            clusterVerts.clear();
+            clusterTris.clear();
+            candidates.clear();
+
+            auto newVertexCount = [&](size_t face) noexcept -> size_t
+                {
+                    const uint32_t a = faceIndices[face * 3];
+                    const uint32_t b = faceIndices[face * 3 + 1];
+                    const uint32_t c = faceIndices[face * 3 + 2];
+
+                    size_t count = (vertexTag[a] != id) ? 1u : 0u;
+                    if (vertexTag[b] != id && b != a)
+                        ++count;
+                    if (vertexTag[c] != id && c != a && c != b)
+                        ++count;
+                    return count;
+                };
+
+            auto addFace = [&](size_t face)
+                {
+                    emitted[face] = 1;
+                    clusterTris.push_back(static_cast<uint32_t>(face));
+
+                    for (size_t k = 0; k < 3; ++k)
+                    {
+                        const uint32_t v = faceIndices[face * 3 + k];
+                        if (vertexTag[v] == id)
+                            continue;
+
+                        vertexTag[v] = id;
+                        clusterVerts.push_back(v);
+
+                        for (uint32_t a = adjOffsets[v]; a < adjOffsets[v + 1]; ++a)
+                        {
+                            if (!emitted[adjFaces[a]])
+                                candidates.push_back(adjFaces[a]);
+                        }
+                    }
+                };
+
+            addFace(seed);
+
+            while (clusterTris.size() < maxPrims)
+            {
+                size_t best = SIZE_MAX;
+                size_t bestNew = 4;
+
+                for (const auto face : candidates)
+                {
+                    if (emitted[face])
+                        continue;
+
+                    const size_t count = newVertexCount(face);
+                    if (count < bestNew && clusterVerts.size() + count <= maxVerts)
+                    {
+                        best = face;
+                        bestNew = count;
+                        if (!count)
+                            break;
+                    }
+                }
+
+                if (best == SIZE_MAX)
+                    break;
+
+                addFace(best);
+            }
+
+            Meshlet meshlet = {};
+            meshlet.startIndex = static_cast<uint32_t>(reorderedIndices.size());
+            meshlet.indexCount = static_cast<uint32_t>(clusterTris.size() * 3);
+            meshlet.vertexCount = static_cast<uint32_t>(clusterVerts.size());
+
+            for (const auto face : clusterTris)
+            {
+                reorderedIndices.push_back(indices[face * 3]);
+                reorderedIndices.push_back(indices[face * 3 + 1]);
+                reorderedIndices.push_back(indices[face * 3 + 2]);
+            }
+
+            ComputeMeshletBounds(meshlet, pos, clusterVerts, clusterTris, faceIndices.data(), facing);
+
+            meshlets.push_back(meshlet);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Meshlet construction
+//--------------------------------------------------------------------------------------
+
+_Use_decl_annotations_
+void DirectX::ComputeMeshlets(
+    const uint16_t* indices, size_t nFaces,
+    const void* positions, size_t vertexStride, size_t nVerts,
+    std::vector<Meshlet>& meshlets,
+    std::vector<uint16_t>& reorderedIndices,
+    bool rhcoords,
+    size_t maxVerts,
+    size_t maxPrims)
+{
+    BuildMeshlets(indices, nFaces, positions, vertexStride, nVerts, meshlets, reorderedIndices, rhcoords, maxVerts, maxPrims);
+}
+
+_Use_decl_annotations_
+void DirectX::ComputeMeshlets(
+    const uint32_t* indices, size_t nFaces,
+    const void* positions, size_t vertexStride, size_t nVerts,
+    std::vector<Meshlet>& meshlets,
+    std::vector<uint32_t>& reorderedIndices,
+    bool rhcoords,
+    size_t maxVerts,
+    size_t maxPrims)
+{
+    BuildMeshlets(indices, nFaces, positions, vertexStride, nVerts, meshlets, reorderedIndices, rhcoords, maxVerts, maxPrims);
+}
+
+_Use_decl_annotations_
+void DirectX::ComputeMeshlets(
+    ID3D11DeviceContext* deviceContext,
+    const ModelMesh& mesh,
+    ModelMeshPart& part,
+    std::vector<Meshlet>& meshlets,
+    bool rhcoords,
+    size_t maxVerts,
+    size_t maxPrims)
+{
+    if (!deviceContext)
+        throw std::invalid_argument("Direct3D device context is null");
+
+    std::vector<uint32_t> indices;
+    ModelHelpers::ReadPartIndices(deviceContext, part, indices);
+
+    if (indices.size() % 3)
+        throw std::invalid_argument("Expected triangular faces");
+
+    std::vector<XMFLOAT3> positions;
+    ModelHelpers::ReadPartPositions(deviceContext, part, positions);
+
+    // Meshes that cull counter-clockwise faces have clockwise front faces, the same winding as
+    // GeometricPrimitive; the others flip the cone orientation.
+    const bool orient = (rhcoords == mesh.ccw);
+
+    std::vector<uint32_t> reordered;
+    BuildMeshlets(indices.data(), indices.size() / 3,
+        positions.data(), sizeof(XMFLOAT3), positions.size(),
+        meshlets, reordered, orient, maxVerts, maxPrims);
+
+    // Store in the part's original index format, relative to its base vertex.
+    ComPtr<ID3D11Device> device;
+    deviceContext->GetDevice(&device);
+
+    ComPtr<ID3D11Buffer> ib;
+    if (part.indexFormat == DXGI_FORMAT_R32_UINT)
+    {
+        for (auto& it : reordered)
+        {
+            it = static_cast<uint32_t>(int64_t(it) - part.vertexOffset);
+        }
+
+        ThrowIfFailed(CreateStaticBuffer(device.Get(), reordered, D3D11_BIND_INDEX_BUFFER, ib.GetAddressOf()));
+    }
+    else
+    {
+        std::vector<uint16_t> reordered16(reordered.size());
+        for (size_t j = 0; j < reordered.size(); ++j)
+        {
+            reordered16[j] = static_cast<uint16_t>(int64_t(reordered[j]) - part.vertexOffset);
+        }
+
+        ThrowIfFailed(CreateStaticBuffer(device.Get(), reordered16, D3D11_BIND_INDEX_BUFFER, ib.GetAddressOf()));
+    }
+
+    SetDebugObjectName(ib.Get(), "ModelMeshlets");
+
+    part.indexBuffer = ib;
+    part.startIndex = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Meshlet culling
+//--------------------------------------------------------------------------------------
+
+_Use_decl_annotations_
+void XM_CALLCONV DirectX::CullMeshlets(
+    const Meshlet* meshlets, size_t nMeshlets,
+    const BoundingFrustum& frustum,
+    FXMMATRIX world,
+    CXMVECTOR eyePosition,
+    std::vector<MeshletRange>& visible)
+{
+    if (!meshlets && nMeshlets > 0)
+        throw std::invalid_argument("Invalid meshlets");
+
+    // Facing is invariant under affine transforms, so test the cones in object space. A mirroring
+    // transform reverses which side is rendered, so cone rejection is skipped in that case.
+    XMVECTOR det;
+    const XMMATRIX invWorld = XMMatrixInverse(&det, world);
+    const bool coneTest = XMVectorGetX(det) > 0.f;
+
+    const XMVECTOR eye = XMVector3Transform(eyePosition, invWorld);
+
+    for (size_t j = 0; j < nMeshlets; ++j)
+    {
+        const Meshlet& meshlet = meshlets[j];
+
+        if (coneTest && meshlet.coneCutoff < 1.f)
+        {
+            const XMVECTOR view = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&meshlet.coneApex), eye));
+            if (XMVectorGetX(XMVector3Dot(view, XMLoadFloat3(&meshlet.coneAxis))) >= meshlet.coneCutoff)
+                continue;
+        }
+
+        BoundingSphere sphere;
+        meshlet.boundingSphere.Transform(sphere, world);
+
+        if (!frustum.Intersects(sphere))
+            continue;
+
+        if (!visible.empty())
+        {
+            auto& last = visible.back();
+            if (last.startIndex + last.indexCount == meshlet.startIndex)
+            {
+                last.indexCount += meshlet.indexCount;
+                continue;
+            }
+        }
+
+        visible.push_back(MeshletRange{ meshlet.startIndex, meshlet.indexCount });
+    }
+}
+
+
+_Use_decl_annotations_
+void DirectX::DrawMeshletRanges(
+    ID3D11DeviceContext* deviceContext,
+    const ModelMeshPart& part,
+    IEffect* ieffect,
+    ID3D11InputLayout* iinputLayout,
+    const std::vector<MeshletRange>& ranges,
+    std::function<void()> setCustomState)
+{
+    if (ranges.empty())
+        return;
+
+    deviceContext->IASetInputLayout(iinputLayout);
+
+    auto vb = part.vertexBuffer.Get();
+    const UINT vbStride = part.vertexStride;
+    constexpr UINT vbOffset = 0;
+    deviceContext->IASetVertexBuffers(0, 1, &vb, &vbStride, &vbOffset);
+
+    deviceContext->IASetIndexBuffer(part.indexBuffer.Get(), part.indexFormat, 0);
+
+    assert(ieffect != nullptr);
+    ieffect->Apply(deviceContext);
+
+    // Hook lets the caller replace our shaders or state settings with whatever else they see fit.
+    if (setCustomState)
+    {
+        setCustomState();
+    }
+
+    deviceContext->IASetPrimitiveTopology(part.primitiveType);
+
+    for (const auto& it : ranges)
+    {
+        deviceContext->DrawIndexed(it.indexCount, it.startIndex, part.vertexOffset);
+    }
+}
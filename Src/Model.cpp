@@ -31,7 +31,10 @@ ModelMeshPart::ModelMeshPart() noexcept :
     vertexStride(0),
     primitiveType(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST),
     indexFormat(DXGI_FORMAT_R16_UINT),
-    isAlpha(false)
+    isAlpha(false),
+    vertexCount(0),
+    mEffectMatrices(nullptr),
+    mEffectSkinning(nullptr)
 {}
 
 
@@ -154,6 +157,39 @@ void ModelMeshPart::ModifyEffect(ID3D11Device* d3dDevice, const std::shared_ptr<
     ThrowIfFailed(
         CreateInputLayoutFromEffect(d3dDevice, effect.get(), vbDecl->data(), vbDecl->size(), inputLayout.ReleaseAndGetAddressOf())
     );
+
+    UpdateEffectInterfaces();
+}
+
+
+// Returns the matrices interface of the effect, using the cached pointer when it is still current.
+IEffectMatrices* ModelMeshPart::GetEffectMatrices() const
+{
+    if (!mEffectTag.owner_before(effect) && !effect.owner_before(mEffectTag))
+        return mEffectMatrices;
+
+    // The effect was assigned directly without updating the cache
+    return dynamic_cast<IEffectMatrices*>(effect.get());
+}
+
+
+// Returns the skinning interface of the effect, using the cached pointer when it is still current.
+IEffectSkinning* ModelMeshPart::GetEffectSkinning() const
+{
+    if (!mEffectTag.owner_before(effect) && !effect.owner_before(mEffectTag))
+        return mEffectSkinning;
+
+    return dynamic_cast<IEffectSkinning*>(effect.get());
+}
+
+
+void ModelMeshPart::UpdateEffectInterfaces() noexcept
+{
+    // Tagging with the owner rather than the raw pointer means a new effect allocated at the
+    // address of a released one is never mistaken for it.
+    mEffectTag = effect;
+    mEffectMatrices = dynamic_cast<IEffectMatrices*>(effect.get());
+    mEffectSkinning = dynamic_cast<IEffectSkinning*>(effect.get());
 }
 
 
@@ -166,7 +202,9 @@ bool ModelMesh::s_reversez = false;
 ModelMesh::ModelMesh() noexcept :
     boneIndex(ModelBone::c_Invalid),
     ccw(true),
-    pmalpha(true)
+    pmalpha(true),
+    positionScale(1.f),
+    positionBias(0.f, 0.f, 0.f)
 {}
 
 
@@ -174,6 +212,17 @@ ModelMesh::~ModelMesh()
 {}
 
 
+XMMATRIX XM_CALLCONV ModelMesh::GetVertexTransform(FXMMATRIX world) const noexcept
+{
+    if (positionScale == 1.f && positionBias.x == 0.f && positionBias.y == 0.f && positionBias.z == 0.f)
+        return world;
+
+    XMMATRIX decode = XMMatrixScaling(positionScale, positionScale, positionScale);
+    decode.r[3] = XMVectorSelect(g_XMIdentityR3, XMLoadFloat3(&positionBias), g_XMSelect1110);
+    return XMMatrixMultiply(decode, world);
+}
+
+
 // Set render state for mesh part rendering.
 _Use_decl_annotations_
 void ModelMesh::PrepareForRendering(
@@ -238,6 +287,8 @@ void XM_CALLCONV ModelMesh::Draw(
 {
     assert(deviceContext != nullptr);
 
+    const XMMATRIX local = GetVertexTransform(world);
+
     for (const auto& it : meshParts)
     {
         auto part = it.get();
@@ -249,10 +300,10 @@ void XM_CALLCONV ModelMesh::Draw(
             continue;
         }
 
-        auto imatrices = dynamic_cast<IEffectMatrices*>(part->effect.get());
+        auto imatrices = part->GetEffectMatrices();
         if (imatrices)
         {
-            imatrices->SetMatrices(world, view, projection);
+            imatrices->SetMatrices(local, view, projection);
         }
 
         part->Draw(deviceContext, part->effect.get(), part->inputLayout.Get(), setCustomState);
@@ -281,11 +332,11 @@ void XM_CALLCONV ModelMesh::Draw(
     XMMATRIX local;
     if (boneIndex != ModelBone::c_Invalid && boneIndex < nbones)
     {
-        local = XMMatrixMultiply(boneTransforms[boneIndex], world);
+        local = GetVertexTransform(XMMatrixMultiply(boneTransforms[boneIndex], world));
     }
     else
     {
-        local = world;
+        local = GetVertexTransform(world);
     }
 
     for (const auto& it : meshParts)
@@ -299,7 +350,7 @@ void XM_CALLCONV ModelMesh::Draw(
             continue;
         }
 
-        auto imatrices = dynamic_cast<IEffectMatrices*>(part->effect.get());
+        auto imatrices = part->GetEffectMatrices();
         if (imatrices)
         {
             imatrices->SetMatrices(local, view, projection);
@@ -329,8 +380,6 @@ void XM_CALLCONV ModelMesh::DrawSkinned(
         throw std::invalid_argument("Bone transforms array required");
     }
 
-    ModelBone::TransformArray temp;
-
     for (const auto& mit : meshParts)
     {
         auto part = mit.get();
@@ -342,15 +391,22 @@ void XM_CALLCONV ModelMesh::DrawSkinned(
             continue;
         }
 
-        auto imatrices = dynamic_cast<IEffectMatrices*>(part->effect.get());
+        auto imatrices = part->GetEffectMatrices();
         if (imatrices)
         {
             imatrices->SetMatrices(world, view, projection);
         }
 
-        auto iskinning = dynamic_cast<IEffectSkinning*>(part->effect.get());
+        auto iskinning = part->GetEffectSkinning();
         if (iskinning)
         {
+            // Only effects that skin on the GPU are limited in bones; the fallback below is not
+            const size_t count = boneInfluences.empty() ? nbones : boneInfluences.size();
+            if (count > IEffectSkinning::MaxBones)
+            {
+                throw std::runtime_error("Too many bones for skinning");
+            }
+
             if (boneInfluences.empty())
             {
                 // Direct-mapping of vertex bone indices to our master bone array
@@ -358,32 +414,8 @@ void XM_CALLCONV ModelMesh::DrawSkinned(
             }
             else
             {
-                if (!temp)
-                {
-                    // Create the influence mapped bones on-demand.
-                    temp = ModelBone::MakeArray(IEffectSkinning::MaxBones);
-
-                    size_t count = 0;
-                    for (auto it : boneInfluences)
-                    {
-                        ++count;
-                        if (count > IEffectSkinning::MaxBones)
-                        {
-                            throw std::runtime_error("Too many bones for skinning");
-                        }
-
-                        if (it >= nbones)
-                        {
-                            throw std::runtime_error("Invalid bone influence index");
-                        }
-
-                        temp[count - 1] = boneTransforms[it];
-                    }
-
-                    assert(count == boneInfluences.size());
-                }
-
-                iskinning->SetBoneTransforms(temp.get(), boneInfluences.size());
+                // Influence mapped bones are gathered directly into the effect
+                iskinning->GatherBoneTransforms(boneInfluences.data(), boneInfluences.size(), boneTransforms, nbones);
             }
         }
         else if (imatrices)
@@ -392,7 +424,7 @@ void XM_CALLCONV ModelMesh::DrawSkinned(
             const XMMATRIX bm = (boneIndex != ModelBone::c_Invalid && boneIndex < nbones)
                 ? boneTransforms[boneIndex] : XMMatrixIdentity();
 
-            imatrices->SetWorld(XMMatrixMultiply(bm, world));
+            imatrices->SetWorld(GetVertexTransform(XMMatrixMultiply(bm, world)));
         }
 
         part->Draw(deviceContext, part->effect.get(), part->inputLayout.Get(), setCustomState);
@@ -408,22 +440,37 @@ Model::~Model()
 {}
 
 Model::Model(Model const& other) :
+    Model(other, nullptr)
+{
+}
+
+Model::Model(Model const& other, ModelBoneTransformPool& pool) :
+    Model(other, &pool)
+{
+}
+
+_Use_decl_annotations_
+Model::Model(Model const& other, ModelBoneTransformPool* pool) :
     meshes(other.meshes),
     bones(other.bones),
     name(other.name),
-    mEffectCache(other.mEffectCache)
+    textureNames(other.textureNames),
+    mEffectCache(other.mEffectCache),
+    mBoneOrder(other.mBoneOrder),
+    mBoneParents(other.mBoneParents),
+    mBoneLinks(other.mBoneLinks)
 {
     const size_t nbones = other.bones.size();
     if (nbones > 0)
     {
         if (other.boneMatrices)
         {
-            boneMatrices = ModelBone::MakeArray(nbones);
+            boneMatrices = pool ? pool->Allocate(nbones) : ModelBone::MakeArray(nbones);
             memcpy(boneMatrices.get(), other.boneMatrices.get(), sizeof(XMMATRIX) * nbones);
         }
         if (other.invBindPoseMatrices)
         {
-            invBindPoseMatrices = ModelBone::MakeArray(nbones);
+            invBindPoseMatrices = pool ? pool->Allocate(nbones) : ModelBone::MakeArray(nbones);
             memcpy(invBindPoseMatrices.get(), other.invBindPoseMatrices.get(), sizeof(XMMATRIX) * nbones);
         }
     }
@@ -439,7 +486,11 @@ Model& Model::operator= (Model const& rhs)
         std::swap(boneMatrices, tmp.boneMatrices);
         std::swap(invBindPoseMatrices, tmp.invBindPoseMatrices);
         std::swap(name, tmp.name);
+        std::swap(textureNames, tmp.textureNames);
         std::swap(mEffectCache, tmp.mEffectCache);
+        std::swap(mBoneOrder, tmp.mBoneOrder);
+        std::swap(mBoneParents, tmp.mBoneParents);
+        std::swap(mBoneLinks, tmp.mBoneLinks);
     }
     return *this;
 }
@@ -583,9 +634,17 @@ void Model::CopyAbsoluteBoneTransformsTo(
 
     memset(boneTransforms, 0, sizeof(XMMATRIX) * nbones);
 
-    const XMMATRIX id = XMMatrixIdentity();
-    size_t visited = 0;
-    ComputeAbsolute(0, id, bones.size(), boneMatrices.get(), boneTransforms, visited);
+    if (IsBoneOrderCurrent())
+    {
+        ComputeAbsolute(mBoneOrder.size(), mBoneOrder.data(), mBoneParents.data(), boneMatrices.get(), boneTransforms);
+    }
+    else
+    {
+        std::vector<uint32_t> order;
+        std::vector<uint32_t> parents;
+        ComputeBoneOrder(order, parents);
+        ComputeAbsolute(order.size(), order.data(), parents.data(), boneMatrices.get(), boneTransforms);
+    }
 }
 
 
@@ -596,7 +655,19 @@ void Model::CopyAbsoluteBoneTransforms(
     const XMMATRIX* inBoneTransforms,
     XMMATRIX* outBoneTransforms) const
 {
-    if (!nbones || !inBoneTransforms || !outBoneTransforms)
+    CopyAbsoluteBoneTransforms(1, nbones, inBoneTransforms, outBoneTransforms);
+}
+
+
+// Compute using bone hierarchy for a batch of instances stored consecutively.
+_Use_decl_annotations_
+void Model::CopyAbsoluteBoneTransforms(
+    size_t instanceCount,
+    size_t nbones,
+    const XMMATRIX* inBoneTransforms,
+    XMMATRIX* outBoneTransforms) const
+{
+    if (!instanceCount || !nbones || !inBoneTransforms || !outBoneTransforms)
     {
         throw std::invalid_argument("Bone transforms arrays required");
     }
@@ -611,51 +682,156 @@ void Model::CopyAbsoluteBoneTransforms(
         throw std::runtime_error("Model is missing bones");
     }
 
-    memset(outBoneTransforms, 0, sizeof(XMMATRIX) * nbones);
+    if (instanceCount > (SIZE_MAX / sizeof(XMMATRIX)) / nbones)
+    {
+        throw std::overflow_error("Too many bone transforms");
+    }
+
+    memset(outBoneTransforms, 0, sizeof(XMMATRIX) * nbones * instanceCount);
 
-    const XMMATRIX id = XMMatrixIdentity();
-    size_t visited = 0;
-    ComputeAbsolute(0, id, bones.size(), inBoneTransforms, outBoneTransforms, visited);
+    const uint32_t* order = mBoneOrder.data();
+    const uint32_t* parents = mBoneParents.data();
+    size_t count = mBoneOrder.size();
+
+    std::vector<uint32_t> tmpOrder;
+    std::vector<uint32_t> tmpParents;
+    if (!IsBoneOrderCurrent())
+    {
+        ComputeBoneOrder(tmpOrder, tmpParents);
+        order = tmpOrder.data();
+        parents = tmpParents.data();
+        count = tmpOrder.size();
+    }
+
+    for (size_t j = 0; j < instanceCount; ++j)
+    {
+        ComputeAbsolute(count, order, parents, inBoneTransforms, outBoneTransforms);
+        inBoneTransforms += nbones;
+        outBoneTransforms += nbones;
+    }
+}
+
+
+// Private helper for flattening the bone hierarchy so that every parent precedes its children.
+_Use_decl_annotations_
+void Model::ComputeBoneOrder(
+    std::vector<uint32_t>& order,
+    std::vector<uint32_t>& parents) const
+{
+    order.clear();
+    parents.clear();
+
+    const size_t nbones = bones.size();
+    order.reserve(nbones);
+    parents.reserve(nbones);
+
+    // Pairs of bone index and the parent whose absolute transform it is relative to
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+    stack.emplace_back(0u, ModelBone::c_Invalid);
+
+    while (!stack.empty())
+    {
+        const uint32_t index = stack.back().first;
+        const uint32_t parent = stack.back().second;
+        stack.pop_back();
+
+        if (index == ModelBone::c_Invalid || index >= nbones)
+            continue;
+
+        if (order.size() >= nbones) // Cycle detection safety!
+        {
+            DebugTrace("ERROR: Model::CopyAbsoluteBoneTransformsTo encountered a cycle in the bones!\n");
+            throw std::runtime_error("Model bones form an invalid graph");
+        }
+
+        order.push_back(index);
+        parents.push_back(parent);
+
+        stack.emplace_back(bones[index].childIndex, index);
+        stack.emplace_back(bones[index].siblingIndex, parent);
+    }
 }
 
 
-// Private helper for computing hierarchical transforms using bones via recursion.
+// Private helper for computing hierarchical transforms using the flattened bone order.
 _Use_decl_annotations_
 void Model::ComputeAbsolute(
-    uint32_t index,
-    CXMMATRIX parent,
-    size_t nbones,
+    size_t count,
+    const uint32_t* order,
+    const uint32_t* parents,
     const XMMATRIX* inBoneTransforms,
-    XMMATRIX* outBoneTransforms,
-    size_t& visited) const
+    XMMATRIX* outBoneTransforms) noexcept
 {
-    if (index == ModelBone::c_Invalid || index >= nbones)
-        return;
-
     assert(inBoneTransforms != nullptr && outBoneTransforms != nullptr);
 
-    ++visited; // Cycle detection safety!
-    if (visited > bones.size())
+    for (size_t j = 0; j < count; ++j)
     {
-        DebugTrace("ERROR: Model::CopyAbsoluteBoneTransformsTo encountered a cycle in the bones!\n");
-        throw std::runtime_error("Model bones form an invalid graph");
+        const uint32_t index = order[j];
+        const uint32_t parent = parents[j];
+
+        outBoneTransforms[index] = (parent == ModelBone::c_Invalid)
+            ? inBoneTransforms[index]
+            : XMMatrixMultiply(inBoneTransforms[index], outBoneTransforms[parent]);
     }
+}
+
+
+// Private helper for rebuilding the cached bone order after the hierarchy changes.
+void Model::UpdateBoneOrder() noexcept
+{
+    mBoneLinks.clear();
 
-    XMMATRIX local = inBoneTransforms[index];
-    local = XMMatrixMultiply(local, parent);
-    outBoneTransforms[index] = local;
+    try
+    {
+        ComputeBoneOrder(mBoneOrder, mBoneParents);
 
-    if (bones[index].siblingIndex != ModelBone::c_Invalid)
+        mBoneLinks.reserve(bones.size() * 2);
+        for (const auto& bone : bones)
+        {
+            mBoneLinks.push_back(bone.childIndex);
+            mBoneLinks.push_back(bone.siblingIndex);
+        }
+    }
+    catch (...)
     {
-        ComputeAbsolute(bones[index].siblingIndex, parent, nbones,
-            inBoneTransforms, outBoneTransforms, visited);
+        // Invalid hierarchies are reported when the transforms are computed
+        mBoneOrder.clear();
+        mBoneParents.clear();
+        mBoneLinks.clear();
     }
+}
 
-    if (bones[index].childIndex != ModelBone::c_Invalid)
+
+// Private helper for checking the cached bone order is usable. The order is valid once
+// Modified has built it for the current bone count; debug builds also compare every link
+// to catch hierarchies edited without calling Modified.
+bool Model::IsBoneOrderCurrent() const noexcept
+{
+    if (bones.empty() || mBoneLinks.size() != bones.size() * 2)
+        return false;
+
+#ifdef _DEBUG
+    const uint32_t* links = mBoneLinks.data();
+    for (const auto& bone : bones)
     {
-        ComputeAbsolute(bones[index].childIndex, local, nbones,
-            inBoneTransforms, outBoneTransforms, visited);
+        if (links[0] != bone.childIndex || links[1] != bone.siblingIndex)
+        {
+            DebugTrace("WARNING: Model bone hierarchy changed without calling Modified\n");
+            return false;
+        }
+        links += 2;
     }
+#endif
+
+    return true;
+}
+
+
+// Notify model that effects, parts list, mesh list, or bone hierarchy has changed.
+void Model::Modified() noexcept
+{
+    mEffectCache.clear();
+    UpdateBoneOrder();
 }
 
 
@@ -723,6 +899,8 @@ void Model::UpdateEffects(_In_ std::function<void(IEffect*)> setEffect)
 
             for (const auto& it : mesh->meshParts)
             {
+                it->UpdateEffectInterfaces();
+
                 if (it->effect)
                     mEffectCache.insert(it->effect.get());
             }
@@ -0,0 +1,191 @@
+//--------------------------------------------------------------------------------------
+// File: ModelBaked.h
+//
+// The baked model format is written by ModelDescription::WriteBaked from a model
+// description. It holds the vertex and index buffer data ready for upload, resolved
+// input layouts, material parameters, and the bone hierarchy, so loading it only
+// requires mapping the file and creating the device objects.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+
+namespace BakedModel
+{
+    // File layout
+    //
+    // Header
+    // Tables, each 4-byte aligned and located by the header
+    // Buffer data, each 16-byte aligned and located by the Buffer table
+    // String data, null-terminated UTF-16 strings addressed by byte offset (offset 0 is the empty string)
+
+    constexpr uint32_t MAGIC = 0x4D4B5444; // "DTKM"
+    constexpr uint32_t VERSION = 2;
+    constexpr uint32_t BUFFER_ALIGNMENT = 16;
+
+    enum HEADER_FLAGS : uint32_t
+    {
+        HEADER_INV_BIND_POSE = 0x1,     // Matrices table holds the bone matrices followed by the inverse bind pose
+    };
+
+    enum MATERIAL_FLAGS : uint32_t
+    {
+        MATERIAL_PER_VERTEX_COLOR = 0x1,
+        MATERIAL_SKINNING = 0x2,
+        MATERIAL_DUAL_TEXTURE = 0x4,
+        MATERIAL_NORMAL_MAPS = 0x8,
+        MATERIAL_BIASED_VERTEX_NORMALS = 0x10,
+    };
+
+    enum MESH_FLAGS : uint32_t
+    {
+        MESH_CCW = 0x1,
+        MESH_PMALPHA = 0x2,
+    };
+
+    enum PART_FLAGS : uint32_t
+    {
+        PART_ALPHA = 0x1,
+    };
+
+    // Input element semantic names are stored as an index into this table
+    constexpr const char* SEMANTIC_NAMES[] =
+    {
+        "SV_Position",
+        "POSITION",
+        "NORMAL",
+        "COLOR",
+        "TANGENT",
+        "BINORMAL",
+        "TEXCOORD",
+        "BLENDINDICES",
+        "BLENDWEIGHT",
+        "PSIZE",
+        "FOG",
+    };
+
+#pragma pack(push,4)
+
+    struct Table
+    {
+        uint32_t Offset;
+        uint32_t Count;
+    };
+
+    struct Header
+    {
+        uint32_t Magic;
+        uint32_t Version;
+        uint32_t HeaderSize;
+        uint32_t Flags;
+        Table    Buffers;        // Buffer
+        Table    ElementSets;    // ElementSet
+        Table    Elements;       // Element
+        Table    Materials;      // Material
+        Table    Meshes;         // Mesh
+        Table    Parts;          // Part
+        Table    Influences;     // uint32_t bone indices
+        Table    Bones;          // Bone
+        Table    Matrices;       // DirectX::XMFLOAT4X4
+        Table    Strings;        // Count is in bytes
+    };
+
+    struct Buffer
+    {
+        uint32_t DataOffset;
+        uint32_t SizeBytes;
+        uint32_t BindFlags;      // D3D11_BIND_VERTEX_BUFFER or D3D11_BIND_INDEX_BUFFER
+        uint32_t Reserved;
+    };
+
+    struct ElementSet
+    {
+        uint32_t FirstElement;
+        uint32_t ElementCount;
+    };
+
+    struct Element
+    {
+        uint32_t Semantic;       // Index into SEMANTIC_NAMES
+        uint32_t SemanticIndex;
+        uint32_t Format;         // DXGI_FORMAT
+        uint32_t InputSlot;
+        uint32_t AlignedByteOffset;
+        uint32_t InputSlotClass; // D3D11_INPUT_CLASSIFICATION
+        uint32_t InstanceDataStepRate;
+    };
+
+    struct Material
+    {
+        uint32_t            Name;
+        uint32_t            DiffuseTexture;
+        uint32_t            SpecularTexture;
+        uint32_t            NormalTexture;
+        uint32_t            EmissiveTexture;
+        uint32_t            Flags;
+        float               SpecularPower;
+        float               Alpha;
+        DirectX::XMFLOAT3   AmbientColor;
+        DirectX::XMFLOAT3   DiffuseColor;
+        DirectX::XMFLOAT3   SpecularColor;
+        DirectX::XMFLOAT3   EmissiveColor;
+    };
+
+    struct Mesh
+    {
+        uint32_t            Name;
+        uint32_t            FirstPart;
+        uint32_t            PartCount;
+        uint32_t            BoneIndex;
+        uint32_t            FirstInfluence;
+        uint32_t            InfluenceCount;
+        uint32_t            Flags;
+        DirectX::XMFLOAT3   SphereCenter;
+        float               SphereRadius;
+        DirectX::XMFLOAT3   BoxCenter;
+        DirectX::XMFLOAT3   BoxExtents;
+        float               PositionScale;  // Position decode of compacted vertices (1 and 0 when not compacted)
+        DirectX::XMFLOAT3   PositionBias;
+    };
+
+    struct Part
+    {
+        uint32_t Material;
+        uint32_t VertexBuffer;
+        uint32_t IndexBuffer;
+        uint32_t ElementSet;
+        uint32_t IndexCount;
+        uint32_t StartIndex;
+        int32_t  VertexOffset;
+        uint32_t VertexStride;
+        uint32_t PrimitiveType;  // D3D_PRIMITIVE_TOPOLOGY
+        uint32_t IndexFormat;    // DXGI_FORMAT
+        uint32_t Flags;
+        uint32_t VertexCount;    // 0 if unknown
+    };
+
+    struct Bone
+    {
+        uint32_t Name;
+        uint32_t ParentIndex;
+        uint32_t ChildIndex;
+        uint32_t SiblingIndex;
+    };
+
+#pragma pack(pop)
+
+} // namespace
+
+static_assert(sizeof(BakedModel::Header) == 96, "Baked model header size mismatch");
+static_assert(sizeof(BakedModel::Buffer) == 16, "Baked model buffer size mismatch");
+static_assert(sizeof(BakedModel::Element) == 28, "Baked model element size mismatch");
+static_assert(sizeof(BakedModel::Material) == 80, "Baked model material size mismatch");
+static_assert(sizeof(BakedModel::Mesh) == 84, "Baked model mesh size mismatch");
+static_assert(sizeof(BakedModel::Part) == 48, "Baked model part size mismatch");
+static_assert(sizeof(BakedModel::Bone) == 16, "Baked model bone size mismatch");
@@ -0,0 +1,412 @@
+//--------------------------------------------------------------------------------------
+// File: ModelBoneTransformPool.cpp
+//
+// Pooled bone transform arrays and contiguous per-instance bone palettes
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "Model.h"
+
+#include "PlatformHelpers.h"
+
+using namespace DirectX;
+
+namespace
+{
+    // Size class k holds 2^k transforms; larger arrays are allocated individually
+    constexpr uint32_t c_SizeClasses = 13;
+    constexpr uint32_t c_LargeArray = uint32_t(-1);
+
+    // Precedes every array from MakeArray or a pool, so the deleter can find the pool and the
+    // pool the size class
+    struct ArrayHeader
+    {
+        ModelBoneTransformPool* pool;   // nullptr for ModelBone::MakeArray
+        uint32_t                sizeClass;
+        uint64_t                bytes;
+    };
+
+    // The header block ends with a tag word directly in front of the transforms. Arrays the
+    // application allocated with _aligned_malloc have the CRT's pointer to the underlying block
+    // in that word instead, which can never hold a value in the top 64K of the address space.
+    constexpr size_t c_HeaderSize = 32;
+    constexpr size_t c_ArrayAlignment = 16;
+    constexpr uintptr_t c_ArrayTag = ~uintptr_t(0x5444);
+
+    static_assert(sizeof(ArrayHeader) + sizeof(uintptr_t) <= c_HeaderSize, "Header overlaps the tag");
+    static_assert(c_HeaderSize % alignof(XMMATRIX) == 0, "Header must keep the transforms aligned");
+
+    // Writes the header and tag at the start of a block and returns the transforms that follow
+    void* InitArray(void* block, uint32_t sizeClass, uint64_t bytes) noexcept
+    {
+        auto header = static_cast<ArrayHeader*>(block);
+        header->pool = nullptr;
+        header->sizeClass = sizeClass;
+        header->bytes = bytes;
+
+        void* p = static_cast<uint8_t*>(block) + c_HeaderSize;
+        static_cast<uintptr_t*>(p)[-1] = c_ArrayTag;
+        return p;
+    }
+
+    ArrayHeader* GetHeader(void* p) noexcept
+    {
+        return reinterpret_cast<ArrayHeader*>(static_cast<uint8_t*>(p) - c_HeaderSize);
+    }
+
+    // Released arrays are linked through their own storage
+    struct FreeArray
+    {
+        FreeArray* next;
+    };
+
+    uint32_t GetSizeClass(size_t count) noexcept
+    {
+        uint32_t sizeClass = 0;
+        while (sizeClass < c_SizeClasses && (size_t(1) << sizeClass) < count)
+        {
+            ++sizeClass;
+        }
+        return (sizeClass < c_SizeClasses) ? sizeClass : c_LargeArray;
+    }
+
+    constexpr size_t GetArrayBytes(uint32_t sizeClass) noexcept
+    {
+        return c_HeaderSize + (size_t(1) << sizeClass) * sizeof(XMMATRIX);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// ModelBone
+//--------------------------------------------------------------------------------------
+
+ModelBone::TransformArray ModelBone::MakeArray(size_t count)
+{
+    if (count > (SIZE_MAX - c_HeaderSize) / sizeof(XMMATRIX))
+        throw std::overflow_error("Bone transform array too large");
+
+    const size_t bytes = c_HeaderSize + count * sizeof(XMMATRIX);
+
+    void* temp = _aligned_malloc(bytes, c_ArrayAlignment);
+    if (!temp)
+        throw std::bad_alloc();
+
+    return TransformArray(static_cast<XMMATRIX*>(InitArray(temp, c_LargeArray, bytes)));
+}
+
+
+_Use_decl_annotations_
+void ModelBone::aligned_deleter::operator()(void* p) noexcept
+{
+    if (!p)
+        return;
+
+    // Arrays allocated directly with _aligned_malloc are still accepted
+    if (static_cast<const uintptr_t*>(p)[-1] != c_ArrayTag)
+    {
+        _aligned_free(p);
+        return;
+    }
+
+    auto header = GetHeader(p);
+    if (header->pool)
+    {
+        header->pool->Release(p);
+    }
+    else
+    {
+        _aligned_free(header);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// ModelBoneTransformPool
+//--------------------------------------------------------------------------------------
+
+class ModelBoneTransformPool::Impl
+{
+public:
+    explicit Impl(size_t slabSize) noexcept :
+        mSlabSize(slabSize),
+        mCursor(nullptr),
+        mRemaining(0),
+        mFreeLists{},
+        mReservedBytes(0),
+        mArrayCount(0)
+    {
+    }
+
+    Impl(Impl&&) = delete;
+    Impl& operator= (Impl&&) = delete;
+
+    Impl(Impl const&) = delete;
+    Impl& operator= (Impl const&) = delete;
+
+    ~Impl()
+    {
+        if (mArrayCount > 0)
+        {
+            DebugTrace("WARNING: ModelBoneTransformPool destroyed with %zu arrays still in use\n", mArrayCount);
+        }
+
+        for (auto slab : mSlabs)
+        {
+            _aligned_free(slab);
+        }
+    }
+
+    void* Allocate(size_t count)
+    {
+        if (count > (SIZE_MAX - c_HeaderSize) / sizeof(XMMATRIX))
+            throw std::overflow_error("Bone transform array too large");
+
+        const uint32_t sizeClass = GetSizeClass(count);
+
+        if (sizeClass == c_LargeArray)
+        {
+            const size_t bytes = c_HeaderSize + count * sizeof(XMMATRIX);
+
+            void* temp = _aligned_malloc(bytes, c_ArrayAlignment);
+            if (!temp)
+                throw std::bad_alloc();
+
+            const std::lock_guard<std::mutex> lock(mMutex);
+            mReservedBytes += bytes;
+            ++mArrayCount;
+
+            return InitArray(temp, c_LargeArray, bytes);
+        }
+
+        const size_t bytes = GetArrayBytes(sizeClass);
+
+        const std::lock_guard<std::mutex> lock(mMutex);
+
+        void* block = nullptr;
+        if (mFreeLists[sizeClass])
+        {
+            auto entry = mFreeLists[sizeClass];
+            mFreeLists[sizeClass] = entry->next;
+            block = entry;
+        }
+        else
+        {
+            if (mRemaining < bytes)
+            {
+                // The rest of the current slab is abandoned
+                const size_t slabBytes = std::max(mSlabSize, bytes);
+
+                void* slab = _aligned_malloc(slabBytes, c_ArrayAlignment);
+                if (!slab)
+                    throw std::bad_alloc();
+
+                try
+                {
+                    mSlabs.push_back(slab);
+                }
+                catch (...)
+                {
+                    _aligned_free(slab);
+                    throw;
+                }
+
+                mCursor = static_cast<uint8_t*>(slab);
+                mRemaining = slabBytes;
+                mReservedBytes += slabBytes;
+            }
+
+            block = mCursor;
+            mCursor += bytes;
+            mRemaining -= bytes;
+        }
+
+        ++mArrayCount;
+
+        return InitArray(block, sizeClass, bytes);
+    }
+
+    void Release(void* p) noexcept
+    {
+        if (!p)
+            return;
+
+        auto header = GetHeader(p);
+        const uint32_t sizeClass = header->sizeClass;
+
+        const std::lock_guard<std::mutex> lock(mMutex);
+
+        assert(mArrayCount > 0);
+        --mArrayCount;
+
+        if (sizeClass == c_LargeArray)
+        {
+            mReservedBytes -= static_cast<size_t>(header->bytes);
+            _aligned_free(header);
+            return;
+        }
+
+        assert(sizeClass < c_SizeClasses);
+
+        auto block = reinterpret_cast<FreeArray*>(header);
+        block->next = mFreeLists[sizeClass];
+        mFreeLists[sizeClass] = block;
+    }
+
+    size_t GetReservedBytes() const noexcept
+    {
+        const std::lock_guard<std::mutex> lock(mMutex);
+        return mReservedBytes;
+    }
+
+    size_t GetArrayCount() const noexcept
+    {
+        const std::lock_guard<std::mutex> lock(mMutex);
+        return mArrayCount;
+    }
+
+private:
+    mutable std::mutex  mMutex;
+    size_t              mSlabSize;
+    std::vector<void*>  mSlabs;
+    uint8_t*            mCursor;
+    size_t              mRemaining;
+    FreeArray*          mFreeLists[c_SizeClasses];
+    size_t              mReservedBytes;
+    size_t              mArrayCount;
+};
+
+
+ModelBoneTransformPool::ModelBoneTransformPool(size_t slabSize) :
+    pImpl(std::make_unique<Impl>(slabSize))
+{
+}
+
+
+ModelBoneTransformPool::~ModelBoneTransformPool() = default;
+
+
+ModelBone::TransformArray ModelBoneTransformPool::Allocate(size_t count)
+{
+    void* ptr = pImpl->Allocate(count);
+
+    GetHeader(ptr)->pool = this;
+
+    return ModelBone::TransformArray(static_cast<XMMATRIX*>(ptr));
+}
+
+
+_Use_decl_annotations_
+void ModelBoneTransformPool::Release(void* p) noexcept
+{
+    pImpl->Release(p);
+}
+
+
+size_t ModelBoneTransformPool::GetReservedBytes() const noexcept
+{
+    return pImpl->GetReservedBytes();
+}
+
+
+size_t ModelBoneTransformPool::GetArrayCount() const noexcept
+{
+    return pImpl->GetArrayCount();
+}
+
+
+//--------------------------------------------------------------------------------------
+// ModelBoneTransformBatch
+//--------------------------------------------------------------------------------------
+
+_Use_decl_annotations_
+ModelBoneTransformBatch::ModelBoneTransformBatch(size_t nbones, ModelBoneTransformPool* pool) :
+    mPool(pool),
+    mBoneCount(nbones),
+    mInstanceCount(0),
+    mCapacity(0)
+{
+    if (!nbones)
+        throw std::invalid_argument("Bone count must be non-zero");
+}
+
+
+XMMATRIX* ModelBoneTransformBatch::GetInstance(size_t index) noexcept
+{
+    assert(index < mInstanceCount);
+    return mData.get() + index * mBoneCount;
+}
+
+
+const XMMATRIX* ModelBoneTransformBatch::GetInstance(size_t index) const noexcept
+{
+    assert(index < mInstanceCount);
+    return mData.get() + index * mBoneCount;
+}
+
+
+void ModelBoneTransformBatch::Reserve(size_t instanceCount)
+{
+    if (instanceCount <= mCapacity)
+        return;
+
+    // Grow geometrically so adding instances one at a time stays cheap
+    const size_t capacity = std::max(instanceCount, mCapacity * 2);
+
+    if (capacity > SIZE_MAX / sizeof(XMMATRIX) / mBoneCount)
+        throw std::overflow_error("Too many bone transform instances");
+
+    auto data = mPool ? mPool->Allocate(capacity * mBoneCount) : ModelBone::MakeArray(capacity * mBoneCount);
+
+    if (mInstanceCount > 0)
+    {
+        memcpy(data.get(), mData.get(), sizeof(XMMATRIX) * mBoneCount * mInstanceCount);
+    }
+
+    mData = std::move(data);
+    mCapacity = capacity;
+}
+
+
+_Use_decl_annotations_
+size_t ModelBoneTransformBatch::AddInstance(const XMMATRIX* transforms)
+{
+    Reserve(mInstanceCount + 1);
+
+    XMMATRIX* dest = mData.get() + mInstanceCount * mBoneCount;
+    if (transforms)
+    {
+        memcpy(dest, transforms, sizeof(XMMATRIX) * mBoneCount);
+    }
+    else
+    {
+        const XMMATRIX id = XMMatrixIdentity();
+        for (size_t j = 0; j < mBoneCount; ++j)
+        {
+            dest[j] = id;
+        }
+    }
+
+    return mInstanceCount++;
+}
+
+
+void ModelBoneTransformBatch::RemoveInstance(size_t index)
+{
+    if (index >= mInstanceCount)
+        throw std::out_of_range("Invalid bone transform instance");
+
+    --mInstanceCount;
+
+    if (index != mInstanceCount)
+    {
+        memcpy(mData.get() + index * mBoneCount,
+            mData.get() + mInstanceCount * mBoneCount,
+            sizeof(XMMATRIX) * mBoneCount);
+    }
+}
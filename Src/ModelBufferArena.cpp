@@ -0,0 +1,221 @@
+//--------------------------------------------------------------------------------------
+// File: ModelBufferArena.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "Model.h"
+#include "DirectXHelpers.h"
+#include "PlatformHelpers.h"
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    struct SourceBuffer
+    {
+        UINT            elementSize;
+        bool            valid;
+        ID3D11Buffer*   target;
+        UINT            offset;     // In elements
+    };
+
+    inline UINT AlignUp(UINT value, UINT alignment) noexcept
+    {
+        return ((value + alignment - 1) / alignment) * alignment;
+    }
+
+    inline UINT GetIndexSize(DXGI_FORMAT format) noexcept
+    {
+        return (format == DXGI_FORMAT_R32_UINT) ? 4u : 2u;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// ModelBufferArena
+//--------------------------------------------------------------------------------------
+
+ModelBufferArena::ModelBufferArena(size_t blockSize) :
+    mBlockSize(blockSize)
+{
+    if (!blockSize || blockSize > (D3D11_REQ_RESOURCE_SIZE_IN_MEGABYTES_EXPRESSION_A_TERM * 1024u * 1024u))
+    {
+        throw std::invalid_argument("Invalid arena block size");
+    }
+}
+
+
+_Use_decl_annotations_
+void ModelBufferArena::Add(ID3D11DeviceContext* deviceContext, Model& model)
+{
+    if (!deviceContext)
+    {
+        throw std::invalid_argument("Device context cannot be null");
+    }
+
+    // Collect the distinct buffers used by the model. A buffer can only be moved if every part
+    // that uses it agrees on the element size, since offsets are applied in whole elements.
+    std::map<ID3D11Buffer*, SourceBuffer> sources;
+
+    auto track = [&sources](ID3D11Buffer* buffer, UINT elementSize)
+        {
+            auto it = sources.find(buffer);
+            if (it == sources.end())
+            {
+                sources.emplace(buffer, SourceBuffer{ elementSize, elementSize > 0, nullptr, 0 });
+            }
+            else if (it->second.elementSize != elementSize)
+            {
+                it->second.valid = false;
+            }
+        };
+
+    for (const auto& mit : model.meshes)
+    {
+        auto mesh = mit.get();
+        assert(mesh != nullptr);
+
+        for (const auto& it : mesh->meshParts)
+        {
+            auto part = it.get();
+            assert(part != nullptr);
+
+            if (part->vertexBuffer)
+                track(part->vertexBuffer.Get(), part->vertexStride);
+
+            if (part->indexBuffer)
+                track(part->indexBuffer.Get(), GetIndexSize(part->indexFormat));
+        }
+    }
+
+    ComPtr<ID3D11Device> device;
+    deviceContext->GetDevice(&device);
+
+    for (auto& it : sources)
+    {
+        auto& source = it.second;
+        if (!source.valid)
+            continue;
+
+        auto buffer = it.first;
+
+        // Already in this arena
+        if (std::any_of(mBlocks.cbegin(), mBlocks.cend(),
+            [buffer](const Block& block) noexcept { return block.buffer.Get() == buffer; }))
+        {
+            source.valid = false;
+            continue;
+        }
+
+        D3D11_BUFFER_DESC desc = {};
+        buffer->GetDesc(&desc);
+
+        if ((desc.BindFlags != D3D11_BIND_VERTEX_BUFFER && desc.BindFlags != D3D11_BIND_INDEX_BUFFER)
+            || desc.Usage == D3D11_USAGE_DYNAMIC
+            || desc.Usage == D3D11_USAGE_STAGING
+            || desc.MiscFlags != 0
+            || desc.ByteWidth > mBlockSize)
+        {
+            source.valid = false;
+            continue;
+        }
+
+        // First fit among the blocks with the same bind type and element size
+        Block* target = nullptr;
+        UINT offset = 0;
+        for (auto& block : mBlocks)
+        {
+            if (block.bindFlags != desc.BindFlags || block.elementSize != source.elementSize)
+                continue;
+
+            offset = AlignUp(block.used, source.elementSize);
+            if (uint64_t(offset) + desc.ByteWidth <= mBlockSize)
+            {
+                target = &block;
+                break;
+            }
+        }
+
+        if (!target)
+        {
+            Block block = {};
+            block.bindFlags = desc.BindFlags;
+            block.elementSize = source.elementSize;
+
+            D3D11_BUFFER_DESC blockDesc = {};
+            blockDesc.Usage = D3D11_USAGE_DEFAULT;
+            blockDesc.ByteWidth = static_cast<UINT>(mBlockSize);
+            blockDesc.BindFlags = desc.BindFlags;
+
+            ThrowIfFailed(
+                device->CreateBuffer(&blockDesc, nullptr, block.buffer.GetAddressOf())
+            );
+
+            SetDebugObjectName(block.buffer.Get(), "DirectXTK:ModelBufferArena");
+
+            mBlocks.emplace_back(std::move(block));
+            target = &mBlocks.back();
+            offset = 0;
+        }
+
+        const D3D11_BOX box = { 0, 0, 0, desc.ByteWidth, 1, 1 };
+        deviceContext->CopySubresourceRegion(target->buffer.Get(), 0, offset, 0, 0, buffer, 0, &box);
+
+        target->used = offset + desc.ByteWidth;
+
+        source.target = target->buffer.Get();
+        source.offset = offset / source.elementSize;
+    }
+
+    // Rewrite the mesh parts to use the arena buffers
+    for (const auto& mit : model.meshes)
+    {
+        for (const auto& it : mit->meshParts)
+        {
+            auto part = it.get();
+
+            if (part->vertexBuffer)
+            {
+                auto& source = sources[part->vertexBuffer.Get()];
+                if (source.valid)
+                {
+                    part->vertexBuffer = source.target;
+                    part->vertexOffset += static_cast<int32_t>(source.offset);
+                }
+            }
+
+            if (part->indexBuffer)
+            {
+                auto& source = sources[part->indexBuffer.Get()];
+                if (source.valid)
+                {
+                    part->indexBuffer = source.target;
+                    part->startIndex += source.offset;
+                }
+            }
+        }
+    }
+}
+
+
+void ModelBufferArena::Reset() noexcept
+{
+    mBlocks.clear();
+}
+
+
+size_t ModelBufferArena::GetUsedBytes() const noexcept
+{
+    size_t total = 0;
+    for (const auto& it : mBlocks)
+    {
+        total += it.used;
+    }
+    return total;
+}
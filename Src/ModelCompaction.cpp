@@ -0,0 +1,229 @@
+//--------------------------------------------------------------------------------------
+// File: ModelCompaction.cpp
+//
+// Measures the error introduced by loading a model with ModelLoader_CompactVertices
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "Model.h"
+
+#include "ModelHelpers.h"
+#include "PlatformHelpers.h"
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr uint32_t c_MaxTexCoords = 8;
+
+    // Formats the loaders treat as biased when used for normals
+    bool IsBiasedNormalFormat(DXGI_FORMAT format) noexcept
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R10G10B10A2_UNORM:
+        case DXGI_FORMAT_R11G11B10_FLOAT:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    // One vertex element of a mesh part, decoded from a CPU copy of its vertex buffer
+    class ElementReader
+    {
+    public:
+        ElementReader(const ModelMeshPart& part, const std::vector<uint8_t>& data, _In_z_ const char* semanticName, uint32_t semanticIndex) noexcept :
+            mData(data.data()),
+            mSize(data.size()),
+            mStride(part.vertexStride),
+            mOffset(0),
+            mFormat(DXGI_FORMAT_UNKNOWN)
+        {
+            if (!ModelHelpers::FindVertexElement(*part.vbDecl, semanticName, semanticIndex, mOffset, mFormat))
+            {
+                mFormat = DXGI_FORMAT_UNKNOWN;
+            }
+        }
+
+        bool IsPresent() const noexcept { return mFormat != DXGI_FORMAT_UNKNOWN; }
+
+        XMVECTOR Read(uint32_t vertex) const
+        {
+            const uint64_t pos = uint64_t(vertex) * mStride + mOffset;
+            if (pos + (LoaderHelpers::BitsPerPixel(mFormat) / 8) > mSize)
+                throw std::out_of_range("Vertex index exceeds vertex buffer");
+
+            XMVECTOR value;
+            if (!ModelHelpers::LoadVertexElement(mData + pos, mFormat, value))
+                throw std::runtime_error("Unsupported vertex element format");
+
+            return value;
+        }
+
+        XMVECTOR ReadNormal(uint32_t vertex) const
+        {
+            const XMVECTOR value = Read(vertex);
+            return IsBiasedNormalFormat(mFormat) ? XMVectorMultiplyAdd(value, g_XMTwo, g_XMNegativeOne) : value;
+        }
+
+    private:
+        const uint8_t*  mData;
+        size_t          mSize;
+        uint32_t        mStride;
+        uint32_t        mOffset;
+        DXGI_FORMAT     mFormat;
+    };
+
+    float AngleBetween(FXMVECTOR a, FXMVECTOR b) noexcept
+    {
+        constexpr float c_MinLengthSq = 1e-12f;
+
+        if (XMVectorGetX(XMVector3LengthSq(a)) < c_MinLengthSq || XMVectorGetX(XMVector3LengthSq(b)) < c_MinLengthSq)
+            return 0.f;
+
+        return XMVectorGetX(XMVector3AngleBetweenNormals(XMVector3Normalize(a), XMVector3Normalize(b)));
+    }
+}
+
+
+_Use_decl_annotations_
+ModelCompactionError DirectX::MeasureVertexCompaction(
+    ID3D11DeviceContext* deviceContext,
+    const Model& original,
+    const Model& compacted)
+{
+    if (!deviceContext)
+        throw std::invalid_argument("Direct3D device context is null");
+
+    if (original.meshes.size() != compacted.meshes.size())
+        throw std::invalid_argument("Models must have the same meshes");
+
+    ModelCompactionError result = {};
+
+    // Parts frequently share buffers, so each is read back once
+    std::map<ID3D11Buffer*, std::vector<uint8_t>> data;
+
+    auto readBack = [&](ID3D11Buffer* buffer) -> const std::vector<uint8_t>&
+        {
+            auto& it = data[buffer];
+            if (it.empty())
+            {
+                ModelHelpers::ReadBackBuffer(deviceContext, buffer, it);
+            }
+            return it;
+        };
+
+    std::vector<uint32_t> originalIndices;
+    std::vector<uint32_t> compactedIndices;
+    std::vector<std::pair<uint32_t, uint32_t>> vertices;
+
+    for (size_t meshIndex = 0; meshIndex < original.meshes.size(); ++meshIndex)
+    {
+        auto& omesh = *original.meshes[meshIndex];
+        auto& cmesh = *compacted.meshes[meshIndex];
+
+        if (omesh.meshParts.size() != cmesh.meshParts.size())
+            throw std::invalid_argument("Models must have the same mesh parts");
+
+        const XMVECTOR oscale = XMVectorReplicate(omesh.positionScale);
+        const XMVECTOR obias = XMLoadFloat3(&omesh.positionBias);
+        const XMVECTOR cscale = XMVectorReplicate(cmesh.positionScale);
+        const XMVECTOR cbias = XMLoadFloat3(&cmesh.positionBias);
+
+        for (size_t j = 0; j < omesh.meshParts.size(); ++j)
+        {
+            auto& opart = *omesh.meshParts[j];
+            auto& cpart = *cmesh.meshParts[j];
+
+            if (opart.primitiveType != D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+                || cpart.primitiveType != D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST)
+                continue;
+
+            if (opart.indexCount != cpart.indexCount)
+                throw std::invalid_argument("Models must have the same mesh parts");
+
+            if (!opart.vertexBuffer || !opart.indexBuffer || !opart.vbDecl || !opart.vertexStride
+                || !cpart.vertexBuffer || !cpart.indexBuffer || !cpart.vbDecl || !cpart.vertexStride)
+                continue;
+
+            const auto& oib = readBack(opart.indexBuffer.Get());
+            const auto& cib = readBack(cpart.indexBuffer.Get());
+            ModelHelpers::GetPartIndices(opart, oib.data(), oib.size(), originalIndices);
+            ModelHelpers::GetPartIndices(cpart, cib.data(), cib.size(), compactedIndices);
+
+            // Consolidation may place the vertices at different offsets, so pair them by index position
+            vertices.resize(originalIndices.size());
+            for (size_t k = 0; k < originalIndices.size(); ++k)
+            {
+                vertices[k] = std::make_pair(originalIndices[k], compactedIndices[k]);
+            }
+
+            std::sort(vertices.begin(), vertices.end());
+            vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+
+            auto& ovb = readBack(opart.vertexBuffer.Get());
+            auto& cvb = readBack(cpart.vertexBuffer.Get());
+
+            const ElementReader oposition(opart, ovb, "SV_Position", 0);
+            const ElementReader cposition(cpart, cvb, "SV_Position", 0);
+            const ElementReader onormal(opart, ovb, "NORMAL", 0);
+            const ElementReader cnormal(cpart, cvb, "NORMAL", 0);
+            const ElementReader otangent(opart, ovb, "TANGENT", 0);
+            const ElementReader ctangent(cpart, cvb, "TANGENT", 0);
+
+            const bool hasPosition = oposition.IsPresent() && cposition.IsPresent();
+            const bool hasNormal = onormal.IsPresent() && cnormal.IsPresent();
+            const bool hasTangent = otangent.IsPresent() && ctangent.IsPresent();
+
+            std::vector<std::pair<ElementReader, ElementReader>> texcoords;
+            for (uint32_t t = 0; t < c_MaxTexCoords; ++t)
+            {
+                ElementReader otex(opart, ovb, "TEXCOORD", t);
+                ElementReader ctex(cpart, cvb, "TEXCOORD", t);
+                if (otex.IsPresent() && ctex.IsPresent())
+                {
+                    texcoords.emplace_back(otex, ctex);
+                }
+            }
+
+            for (const auto& it : vertices)
+            {
+                if (hasPosition)
+                {
+                    const XMVECTOR a = XMVectorMultiplyAdd(oposition.Read(it.first), oscale, obias);
+                    const XMVECTOR b = XMVectorMultiplyAdd(cposition.Read(it.second), cscale, cbias);
+                    result.position = std::max(result.position, XMVectorGetX(XMVector3Length(XMVectorSubtract(a, b))));
+                }
+
+                if (hasNormal)
+                {
+                    result.normal = std::max(result.normal, AngleBetween(onormal.ReadNormal(it.first), cnormal.ReadNormal(it.second)));
+                }
+
+                if (hasTangent)
+                {
+                    result.tangent = std::max(result.tangent, AngleBetween(otangent.Read(it.first), ctangent.Read(it.second)));
+                }
+
+                for (const auto& tex : texcoords)
+                {
+                    XMFLOAT2 diff;
+                    XMStoreFloat2(&diff, XMVectorAbs(XMVectorSubtract(tex.first.Read(it.first), tex.second.Read(it.second))));
+                    result.texcoord = std::max(result.texcoord, std::max(diff.x, diff.y));
+                }
+            }
+
+            result.vertexCount += vertices.size();
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,292 @@
+//--------------------------------------------------------------------------------------
+// File: ModelCulling.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "Model.h"
+
+#include "WorkerThreads.h"
+
+#include <cfloat>
+
+using namespace DirectX;
+
+namespace
+{
+    // Bounding spheres are gathered into structure-of-arrays batches, then transformed and tested four at a time
+    constexpr size_t c_BatchSize = 256;
+
+    // Runs are transformed in whole groups of four, so the arrays have room for a partial group
+    constexpr size_t c_BatchPadding = 4;
+
+    // Below this many instances per thread the cost of handing work to a thread outweighs the work
+    constexpr size_t c_MinInstancesPerThread = 256;
+
+    struct FrustumPlanes
+    {
+        XMVECTOR x[6];
+        XMVECTOR y[6];
+        XMVECTOR z[6];
+        XMVECTOR w[6];
+    };
+
+    // Consecutive spheres of one instance, which share a world matrix
+    struct SphereRun
+    {
+        size_t      first;
+        uint32_t    instanceIndex;
+    };
+
+    struct alignas(16) SphereBatch
+    {
+        // Mesh-space centers
+        float               lx[c_BatchSize + c_BatchPadding];
+        float               ly[c_BatchSize + c_BatchPadding];
+        float               lz[c_BatchSize + c_BatchPadding];
+
+        // World-space centers and radii
+        float               x[c_BatchSize + c_BatchPadding];
+        float               y[c_BatchSize + c_BatchPadding];
+        float               z[c_BatchSize + c_BatchPadding];
+        float               r[c_BatchSize + c_BatchPadding];
+
+        ModelMeshVisibility id[c_BatchSize];
+        SphereRun           runs[c_BatchSize];
+        size_t              count;
+        size_t              runCount;
+    };
+
+    // Transforms the centers of each run by its world matrix, four spheres per iteration. A run
+    // ending part way through a group writes past its end; the next run then overwrites those lanes.
+    void TransformBatch(SphereBatch& batch, _In_ const XMMATRIX* worlds) noexcept
+    {
+        for (size_t k = 0; k < batch.runCount; ++k)
+        {
+            const size_t first = batch.runs[k].first;
+            const size_t last = (k + 1 < batch.runCount) ? batch.runs[k + 1].first : batch.count;
+
+            const XMMATRIX world = worlds[batch.runs[k].instanceIndex];
+
+            XMVECTOR m[4][3];
+            for (size_t row = 0; row < 4; ++row)
+            {
+                m[row][0] = XMVectorSplatX(world.r[row]);
+                m[row][1] = XMVectorSplatY(world.r[row]);
+                m[row][2] = XMVectorSplatZ(world.r[row]);
+            }
+
+            for (size_t j = first; j < last; j += 4)
+            {
+                // Lanes past 'last' hold stale values; their results are overwritten or ignored
+                const XMVECTOR cx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&batch.lx[j]));
+                const XMVECTOR cy = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&batch.ly[j]));
+                const XMVECTOR cz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&batch.lz[j]));
+
+                XMVECTOR wx = XMVectorMultiplyAdd(cz, m[2][0], m[3][0]);
+                XMVECTOR wy = XMVectorMultiplyAdd(cz, m[2][1], m[3][1]);
+                XMVECTOR wz = XMVectorMultiplyAdd(cz, m[2][2], m[3][2]);
+                wx = XMVectorMultiplyAdd(cy, m[1][0], wx);
+                wy = XMVectorMultiplyAdd(cy, m[1][1], wy);
+                wz = XMVectorMultiplyAdd(cy, m[1][2], wz);
+                wx = XMVectorMultiplyAdd(cx, m[0][0], wx);
+                wy = XMVectorMultiplyAdd(cx, m[0][1], wy);
+                wz = XMVectorMultiplyAdd(cx, m[0][2], wz);
+
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&batch.x[j]), wx);
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&batch.y[j]), wy);
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&batch.z[j]), wz);
+            }
+        }
+    }
+
+    void TestBatch(const FrustumPlanes& planes, SphereBatch& batch, std::vector<ModelMeshVisibility>& visible)
+    {
+        const size_t count = batch.count;
+
+        // Pad to a whole number of lanes with spheres that are always outside
+        for (size_t j = count; j & 3; ++j)
+        {
+            batch.x[j] = batch.y[j] = batch.z[j] = 0.f;
+            batch.r[j] = -FLT_MAX;
+        }
+
+        for (size_t j = 0; j < count; j += 4)
+        {
+            const XMVECTOR cx = XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(&batch.x[j]));
+            const XMVECTOR cy = XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(&batch.y[j]));
+            const XMVECTOR cz = XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(&batch.z[j]));
+            const XMVECTOR radius = XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(&batch.r[j]));
+
+            // Planes face outward, so a sphere is culled when its center is further than its radius in front of any plane
+            XMVECTOR outside = XMVectorFalseInt();
+            for (size_t p = 0; p < 6; ++p)
+            {
+                XMVECTOR dist = XMVectorMultiplyAdd(planes.z[p], cz, planes.w[p]);
+                dist = XMVectorMultiplyAdd(planes.y[p], cy, dist);
+                dist = XMVectorMultiplyAdd(planes.x[p], cx, dist);
+                outside = XMVectorOrInt(outside, XMVectorGreater(dist, radius));
+            }
+
+            uint32_t mask[4];
+            XMStoreInt4(mask, outside);
+
+            const size_t lanes = std::min<size_t>(4, count - j);
+            for (size_t lane = 0; lane < lanes; ++lane)
+            {
+                if (!mask[lane])
+                    visible.push_back(batch.id[j + lane]);
+            }
+        }
+
+        batch.count = 0;
+        batch.runCount = 0;
+    }
+
+    void CullRange(
+        const FrustumPlanes& planes,
+        size_t first,
+        size_t last,
+        _In_reads_(last) const Model* const* models,
+        _In_reads_(last) const XMMATRIX* worlds,
+        std::vector<ModelMeshVisibility>& visible)
+    {
+        auto batch = std::make_unique<SphereBatch>();
+        batch->count = 0;
+        batch->runCount = 0;
+
+        for (size_t i = first; i < last; ++i)
+        {
+            auto model = models[i];
+            if (!model)
+                continue;
+
+            const XMMATRIX& world = worlds[i];
+
+            // Radius scales by the largest axis scale of the world matrix
+            const XMVECTOR scaleSq = XMVectorMax(XMVectorMax(
+                XMVector3LengthSq(world.r[0]),
+                XMVector3LengthSq(world.r[1])),
+                XMVector3LengthSq(world.r[2]));
+            const float scale = XMVectorGetX(XMVectorSqrt(scaleSq));
+
+            const size_t nmeshes = model->meshes.size();
+            for (size_t m = 0; m < nmeshes; ++m)
+            {
+                auto mesh = model->meshes[m].get();
+                assert(mesh != nullptr);
+
+                if (batch->count >= c_BatchSize)
+                {
+                    TransformBatch(*batch, worlds);
+                    TestBatch(planes, *batch, visible);
+                }
+
+                if (!batch->runCount || batch->runs[batch->runCount - 1].instanceIndex != i)
+                {
+                    batch->runs[batch->runCount++] = SphereRun{ batch->count, static_cast<uint32_t>(i) };
+                }
+
+                const size_t j = batch->count++;
+                batch->lx[j] = mesh->boundingSphere.Center.x;
+                batch->ly[j] = mesh->boundingSphere.Center.y;
+                batch->lz[j] = mesh->boundingSphere.Center.z;
+                batch->r[j] = mesh->boundingSphere.Radius * scale;
+                batch->id[j] = ModelMeshVisibility{ static_cast<uint32_t>(i), static_cast<uint32_t>(m) };
+            }
+        }
+
+        if (batch->count > 0)
+        {
+            TransformBatch(*batch, worlds);
+            TestBatch(planes, *batch, visible);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// ModelCuller
+//--------------------------------------------------------------------------------------
+
+_Use_decl_annotations_
+void ModelCuller::Cull(
+    const BoundingFrustum& frustum,
+    size_t instanceCount,
+    const Model* const* models,
+    const XMMATRIX* worlds,
+    std::vector<ModelMeshVisibility>& visible,
+    unsigned int threadCount)
+{
+    visible.clear();
+
+    if (!instanceCount)
+        return;
+
+    if (!models || !worlds)
+    {
+        throw std::invalid_argument("Models and world matrices arrays required");
+    }
+
+    if (instanceCount > UINT32_MAX)
+    {
+        throw std::out_of_range("Too many instances");
+    }
+
+    FrustumPlanes planes;
+    {
+        XMVECTOR p[6];
+        frustum.GetPlanes(&p[0], &p[1], &p[2], &p[3], &p[4], &p[5]);
+
+        for (size_t j = 0; j < 6; ++j)
+        {
+            planes.x[j] = XMVectorSplatX(p[j]);
+            planes.y[j] = XMVectorSplatY(p[j]);
+            planes.z[j] = XMVectorSplatZ(p[j]);
+            planes.w[j] = XMVectorSplatW(p[j]);
+        }
+    }
+
+    size_t nthreads = std::max(1u, threadCount);
+    nthreads = std::min(nthreads, std::max<size_t>(1, instanceCount / c_MinInstancesPerThread));
+
+    if (nthreads == 1)
+    {
+        CullRange(planes, 0, instanceCount, models, worlds, visible);
+        return;
+    }
+
+    // Each task fills its own list for a contiguous range of instances so the results stay in order
+    if (mThreadResults.size() < nthreads - 1)
+    {
+        mThreadResults.resize(nthreads - 1);
+    }
+
+    if (!mWorkers)
+    {
+        mWorkers = WorkerThreads::Get();
+    }
+
+    const size_t perThread = (instanceCount + nthreads - 1) / nthreads;
+
+    mWorkers->ParallelFor(nthreads, [&](size_t t)
+        {
+            const size_t first = std::min(instanceCount, t * perThread);
+            const size_t last = std::min(instanceCount, first + perThread);
+
+            auto& results = (t > 0) ? mThreadResults[t - 1] : visible;
+            results.clear();
+
+            CullRange(planes, first, last, models, worlds, results);
+        });
+
+    for (size_t t = 0; t < nthreads - 1; ++t)
+    {
+        const auto& results = mThreadResults[t];
+        visible.insert(visible.end(), results.cbegin(), results.cend());
+    }
+}
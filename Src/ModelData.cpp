@@ -0,0 +1,351 @@
+//--------------------------------------------------------------------------------------
+// File: ModelData.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "ModelData.h"
+
+#include "DirectXHelpers.h"
+#include "PlatformHelpers.h"
+
+using namespace DirectX;
+using namespace DirectX::ModelHelpers;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    inline const wchar_t* GetString(const std::wstring& str) noexcept
+    {
+        return str.empty() ? nullptr : str.c_str();
+    }
+
+    inline void SetString(std::wstring& str, _In_opt_z_ const wchar_t* value)
+    {
+        if (value)
+        {
+            str = value;
+        }
+    }
+
+    void CopyInfo(ModelData::Material& material, const IEffectFactory::EffectInfo& info)
+    {
+        material.info = info;
+        material.info.name = nullptr;
+        material.info.diffuseTexture = nullptr;
+        material.info.specularTexture = nullptr;
+        material.info.normalTexture = nullptr;
+        material.info.emissiveTexture = nullptr;
+
+        SetString(material.name, info.name);
+        SetString(material.diffuseTexture, info.diffuseTexture);
+        SetString(material.specularTexture, info.specularTexture);
+        SetString(material.normalTexture, info.normalTexture);
+        SetString(material.emissiveTexture, info.emissiveTexture);
+
+        XMStoreFloat4x4(&material.uvTransform, XMMatrixIdentity());
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+IEffectFactory::EffectInfo ModelData::Material::GetInfo() const
+{
+    IEffectFactory::EffectInfo result = info;
+    result.name = name.c_str();
+    result.diffuseTexture = GetString(diffuseTexture);
+    result.specularTexture = GetString(specularTexture);
+    result.normalTexture = GetString(normalTexture);
+    result.emissiveTexture = GetString(emissiveTexture);
+    return result;
+}
+
+
+DGSLEffectFactory::DGSLEffectInfo ModelData::Material::GetDGSLInfo() const
+{
+    DGSLEffectFactory::DGSLEffectInfo result;
+    static_cast<IEffectFactory::EffectInfo&>(result) = GetInfo();
+    result.pixelShader = pixelShader.c_str();
+
+    for (size_t j = 0; j < std::size(textures); ++j)
+    {
+        result.textures[j] = GetString(textures[j]);
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+uint32_t ModelData::AddBuffer(const void* data, size_t sizeBytes, D3D11_BIND_FLAG bindFlag)
+{
+    if (!data || !sizeBytes)
+        throw std::invalid_argument("Empty buffer found");
+
+    if (sizeBytes > UINT32_MAX)
+        throw std::overflow_error("Buffer too large");
+
+    Buffer buffer;
+    buffer.data = static_cast<const uint8_t*>(data);
+    buffer.sizeBytes = sizeBytes;
+    buffer.bindFlag = bindFlag;
+    mBuffers.emplace_back(std::move(buffer));
+
+    return static_cast<uint32_t>(mBuffers.size() - 1);
+}
+
+
+uint32_t ModelData::AddBuffer(std::vector<uint8_t>&& data, D3D11_BIND_FLAG bindFlag)
+{
+    if (data.empty())
+        throw std::invalid_argument("Empty buffer found");
+
+    if (data.size() > UINT32_MAX)
+        throw std::overflow_error("Buffer too large");
+
+    // The vector's storage does not move with it, so data stays valid as buffers are added
+    Buffer buffer;
+    buffer.storage = std::move(data);
+    buffer.data = buffer.storage.data();
+    buffer.sizeBytes = buffer.storage.size();
+    buffer.bindFlag = bindFlag;
+    mBuffers.emplace_back(std::move(buffer));
+
+    return static_cast<uint32_t>(mBuffers.size() - 1);
+}
+
+
+uint32_t ModelData::AddMaterial(const IEffectFactory::EffectInfo& info)
+{
+    Material material = {};
+    material.type = MATERIAL_FACTORY;
+    CopyInfo(material, info);
+    mMaterials.emplace_back(std::move(material));
+
+    return static_cast<uint32_t>(mMaterials.size() - 1);
+}
+
+
+uint32_t ModelData::AddMaterial(const DGSLEffectFactory::DGSLEffectInfo& info, const XMFLOAT4X4& uvTransform)
+{
+    Material material = {};
+    material.type = MATERIAL_DGSL;
+    CopyInfo(material, info);
+    material.uvTransform = uvTransform;
+    SetString(material.pixelShader, info.pixelShader);
+
+    for (size_t j = 0; j < std::size(material.textures); ++j)
+    {
+        SetString(material.textures[j], info.textures[j]);
+    }
+
+    mMaterials.emplace_back(std::move(material));
+
+    return static_cast<uint32_t>(mMaterials.size() - 1);
+}
+
+
+uint32_t ModelData::AddDefaultMaterial()
+{
+    Material material = {};
+    material.type = MATERIAL_DEFAULT;
+    material.info.diffuseColor = XMFLOAT3(1.f, 1.f, 1.f);
+    material.info.alpha = 1.f;
+    XMStoreFloat4x4(&material.uvTransform, XMMatrixIdentity());
+    mMaterials.emplace_back(std::move(material));
+
+    return static_cast<uint32_t>(mMaterials.size() - 1);
+}
+
+
+_Use_decl_annotations_
+void ModelData::SetPart(const ModelMeshPart* part, uint32_t material, uint32_t vertexBuffer, uint32_t indexBuffer)
+{
+    assert(part != nullptr);
+    mParts[part] = PartResources{ material, vertexBuffer, indexBuffer };
+}
+
+
+_Use_decl_annotations_
+void ModelData::SetPartBuffers(const ModelMeshPart* part, uint32_t vertexBuffer, uint32_t indexBuffer)
+{
+    assert(part != nullptr);
+
+    auto it = mParts.find(part);
+    if (it == mParts.end())
+    {
+        mParts[part] = PartResources{ c_None, vertexBuffer, indexBuffer };
+    }
+    else
+    {
+        it->second.vertexBuffer = vertexBuffer;
+        it->second.indexBuffer = indexBuffer;
+    }
+}
+
+
+_Use_decl_annotations_
+const ModelData::PartResources& ModelData::GetPart(const ModelMeshPart* part) const
+{
+    auto it = mParts.find(part);
+    if (it == mParts.end())
+        throw std::runtime_error("Model mesh part missing buffers and material");
+
+    auto& res = it->second;
+    if (res.material >= mMaterials.size()
+        || res.vertexBuffer >= mBuffers.size()
+        || res.indexBuffer >= mBuffers.size()
+        || mBuffers[res.vertexBuffer].bindFlag != D3D11_BIND_VERTEX_BUFFER
+        || mBuffers[res.indexBuffer].bindFlag != D3D11_BIND_INDEX_BUFFER)
+        throw std::out_of_range("Invalid mesh part resources");
+
+    return res;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Only device objects are created here; everything read from the file is copied as is.
+_Use_decl_annotations_
+std::unique_ptr<Model> ModelData::Create(
+    ID3D11Device* device,
+    IEffectFactory* fxFactory,
+    const std::shared_ptr<IEffect>& defaultEffect) const
+{
+    if (!device)
+        throw std::invalid_argument("Device cannot be null");
+
+    std::vector<ComPtr<ID3D11Buffer>> buffers;
+    buffers.resize(mBuffers.size());
+
+    for (size_t j = 0; j < mBuffers.size(); ++j)
+    {
+        auto& bh = mBuffers[j];
+
+        D3D11_BUFFER_DESC desc = {};
+        desc.Usage = D3D11_USAGE_DEFAULT;
+        desc.ByteWidth = static_cast<UINT>(bh.sizeBytes);
+        desc.BindFlags = static_cast<UINT>(bh.bindFlag);
+
+        D3D11_SUBRESOURCE_DATA initData = { bh.data, 0, 0 };
+
+        ThrowIfFailed(
+            device->CreateBuffer(&desc, &initData, buffers[j].GetAddressOf())
+        );
+
+        SetDebugObjectName(buffers[j].Get(), mDebugName);
+    }
+
+    auto fxFactoryDGSL = dynamic_cast<DGSLEffectFactory*>(fxFactory);
+
+    std::vector<std::shared_ptr<IEffect>> effects;
+    effects.resize(mMaterials.size());
+
+    for (size_t j = 0; j < mMaterials.size(); ++j)
+    {
+        auto& m = mMaterials[j];
+
+        if (m.type == MATERIAL_DEFAULT)
+        {
+            if (defaultEffect)
+            {
+                effects[j] = defaultEffect;
+            }
+            else
+            {
+                auto effect = std::make_shared<BasicEffect>(device);
+                effect->EnableDefaultLighting();
+                effect->SetLightingEnabled(true);
+                effects[j] = std::move(effect);
+            }
+            continue;
+        }
+
+        if (!fxFactory)
+            throw std::invalid_argument("Effect factory is required for model materials");
+
+        if (m.type == MATERIAL_DGSL && fxFactoryDGSL)
+        {
+            const auto info = m.GetDGSLInfo();
+            effects[j] = fxFactoryDGSL->CreateDGSLEffect(info, nullptr);
+
+            auto dgslEffect = static_cast<DGSLEffect*>(effects[j].get());
+            dgslEffect->SetUVTransform(XMLoadFloat4x4(&m.uvTransform));
+        }
+        else
+        {
+            const auto info = m.GetInfo();
+            effects[j] = fxFactory->CreateEffect(info, nullptr);
+        }
+    }
+
+    // Parts with the same material and vertex format share an input layout
+    std::map<std::pair<uint32_t, const ModelMeshPart::InputLayoutCollection*>, ComPtr<ID3D11InputLayout>> inputLayouts;
+
+    auto result = std::make_unique<Model>(model);
+    result->meshes.clear();
+    result->meshes.reserve(model.meshes.size());
+
+    for (const auto& mit : model.meshes)
+    {
+        auto src = mit.get();
+        assert(src != nullptr);
+
+        auto mesh = std::make_shared<ModelMesh>();
+        mesh->boundingSphere = src->boundingSphere;
+        mesh->boundingBox = src->boundingBox;
+        mesh->boneIndex = src->boneIndex;
+        mesh->boneInfluences = src->boneInfluences;
+        mesh->name = src->name;
+        mesh->ccw = src->ccw;
+        mesh->pmalpha = src->pmalpha;
+        mesh->geometry = src->geometry;
+        mesh->positionScale = src->positionScale;
+        mesh->positionBias = src->positionBias;
+
+        mesh->meshParts.reserve(src->meshParts.size());
+
+        for (const auto& it : src->meshParts)
+        {
+            auto srcPart = it.get();
+            assert(srcPart != nullptr);
+
+            if (!srcPart->vbDecl || srcPart->vbDecl->empty())
+                throw std::runtime_error("Model mesh part missing vertex buffer input elements data");
+
+            auto& res = GetPart(srcPart);
+
+            auto part = std::make_unique<ModelMeshPart>(*srcPart);
+            part->vertexBuffer = buffers[res.vertexBuffer];
+            part->indexBuffer = buffers[res.indexBuffer];
+            part->effect = effects[res.material];
+            part->UpdateEffectInterfaces();
+
+            auto& il = inputLayouts[std::make_pair(res.material, srcPart->vbDecl.get())];
+            if (!il)
+            {
+                auto& decl = *srcPart->vbDecl;
+
+                ThrowIfFailed(
+                    CreateInputLayoutFromEffect(device, part->effect.get(), decl.data(), decl.size(), il.GetAddressOf())
+                );
+
+                SetDebugObjectName(il.Get(), mDebugName);
+            }
+
+            part->inputLayout = il;
+
+            mesh->meshParts.emplace_back(std::move(part));
+        }
+
+        result->meshes.emplace_back(std::move(mesh));
+    }
+
+    result->Modified();
+
+    return result;
+}
@@ -0,0 +1,288 @@
+//--------------------------------------------------------------------------------------
+// File: ModelData.h
+//
+// The CPU side of a model read from a file, and the loaders that produce it
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Model.h"
+#include "Effects.h"
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace DirectX
+{
+    namespace ModelHelpers
+    {
+        //--------------------------------------------------------------------------------------
+        // Everything a loader reads from a model file: buffer contents, material descriptions,
+        // and the meshes, parts and bones with no device objects attached. The loaders fill it
+        // in without a device; Create makes the buffers, effects and input layouts for a new
+        // model from it, as many times as needed.
+        //--------------------------------------------------------------------------------------
+        class ModelData
+        {
+        public:
+            static constexpr uint32_t c_None = uint32_t(-1);
+
+            enum MaterialType : uint32_t
+            {
+                MATERIAL_FACTORY = 0,   // IEffectFactory::CreateEffect
+                MATERIAL_DGSL,          // DGSLEffectFactory::CreateDGSLEffect, or CreateEffect with other factories
+                MATERIAL_DEFAULT,       // The effect given to Create, or a BasicEffect with default lighting
+            };
+
+            struct Material
+            {
+                MaterialType                    type;
+                IEffectFactory::EffectInfo      info;           // String pointers are not kept; see GetInfo
+                XMFLOAT4X4                      uvTransform;    // DGSL materials only
+                std::wstring                    name;
+                std::wstring                    diffuseTexture;
+                std::wstring                    specularTexture;
+                std::wstring                    normalTexture;
+                std::wstring                    emissiveTexture;
+                std::wstring                    pixelShader;
+                std::wstring                    textures[DGSLEffect::MaxTextures - DGSLEffectFactory::DGSLEffectInfo::BaseTextureOffset];
+
+                // The strings of the returned descriptions point into the material
+                IEffectFactory::EffectInfo __cdecl GetInfo() const;
+                DGSLEffectFactory::DGSLEffectInfo __cdecl GetDGSLInfo() const;
+            };
+
+            struct Buffer
+            {
+                const uint8_t*          data;
+                size_t                  sizeBytes;
+                D3D11_BIND_FLAG         bindFlag;
+                std::vector<uint8_t>    storage;    // Empty when data refers to the file contents
+            };
+
+            // Buffers and material used by a mesh part of the model
+            struct PartResources
+            {
+                uint32_t material;
+                uint32_t vertexBuffer;
+                uint32_t indexBuffer;
+            };
+
+            explicit ModelData(_In_z_ const char* debugName) noexcept :
+                mDebugName(debugName)
+            {
+            }
+
+            ModelData(ModelData&&) = default;
+            ModelData& operator= (ModelData&&) = default;
+
+            ModelData(ModelData const&) = delete;
+            ModelData& operator= (ModelData const&) = delete;
+
+            // Meshes with their parts and bones; the parts have no buffers, effect or input layout
+            Model model;
+
+            // Refers to data that outlives the model data, such as the file contents
+            uint32_t __cdecl AddBuffer(_In_reads_bytes_(sizeBytes) const void* data, size_t sizeBytes, D3D11_BIND_FLAG bindFlag);
+
+            // Takes data the loader built, such as rewritten vertices or indices
+            uint32_t __cdecl AddBuffer(std::vector<uint8_t>&& data, D3D11_BIND_FLAG bindFlag);
+
+            uint32_t __cdecl AddMaterial(const IEffectFactory::EffectInfo& info);
+            uint32_t __cdecl AddMaterial(const DGSLEffectFactory::DGSLEffectInfo& info, const XMFLOAT4X4& uvTransform);
+            uint32_t __cdecl AddDefaultMaterial();
+
+            // Parts added to the model must be given their material and buffers before Create
+            void __cdecl SetPart(_In_ const ModelMeshPart* part, uint32_t material, uint32_t vertexBuffer, uint32_t indexBuffer);
+            void __cdecl SetPartBuffers(_In_ const ModelMeshPart* part, uint32_t vertexBuffer, uint32_t indexBuffer);
+
+            const std::vector<Buffer>& __cdecl GetBuffers() const noexcept { return mBuffers; }
+            const std::vector<Material>& __cdecl GetMaterials() const noexcept { return mMaterials; }
+            const PartResources& __cdecl GetPart(_In_ const ModelMeshPart* part) const;
+
+            // Creates the device objects for a copy of the model. The factory may be null when
+            // only default materials are used.
+            std::unique_ptr<Model> __cdecl Create(
+                _In_ ID3D11Device* device,
+                _In_opt_ IEffectFactory* fxFactory,
+                const std::shared_ptr<IEffect>& defaultEffect = nullptr) const;
+
+        private:
+            const char*                                     mDebugName;
+            std::vector<Buffer>                             mBuffers;
+            std::vector<Material>                           mMaterials;
+            std::map<const ModelMeshPart*, PartResources>   mParts;
+        };
+
+
+        //--------------------------------------------------------------------------------------
+        // Loaders. These read and validate a file into model data without a device. The loaded
+        // buffers refer to the file contents where the data is used unchanged.
+        //--------------------------------------------------------------------------------------
+        void LoadSDKMESH(
+            ModelData& data,
+            _In_reads_bytes_(dataSize) const uint8_t* meshData, size_t dataSize,
+            ModelLoaderFlags flags);
+
+        // With DGSL materials, the UV transforms are left to the effects rather than applied to the vertices
+        void LoadCMO(
+            ModelData& data,
+            _In_reads_bytes_(dataSize) const uint8_t* meshData, size_t dataSize,
+            ModelLoaderFlags flags,
+            bool dgslMaterials,
+            _Out_opt_ size_t* animsOffset);
+
+        void LoadVBO(
+            ModelData& data,
+            _In_reads_bytes_(dataSize) const uint8_t* meshData, size_t dataSize,
+            ModelLoaderFlags flags);
+
+        void LoadBaked(
+            ModelData& data,
+            _In_reads_bytes_(dataSize) const uint8_t* meshData, size_t dataSize,
+            ModelLoaderFlags flags);
+
+
+        //--------------------------------------------------------------------------------------
+        // Gathers the vertex and index data of a model at load time so it can be placed in a
+        // few large buffers, grouped by bind type and element size, instead of one per source
+        // buffer. Mesh parts are patched with the shared buffers and offsets by Build.
+        //--------------------------------------------------------------------------------------
+        class BufferConsolidator
+        {
+        public:
+            explicit BufferConsolidator(size_t maxBufferSize =
+                D3D11_REQ_RESOURCE_SIZE_IN_MEGABYTES_EXPRESSION_A_TERM * 1024u * 1024u) noexcept :
+                mMaxBufferSize(maxBufferSize)
+            {
+            }
+
+            // Returns an entry used to refer to the data when assigning it to mesh parts
+            uint32_t Add(
+                _In_reads_bytes_(sizeBytes) const void* data,
+                size_t sizeBytes,
+                uint32_t elementSize,
+                D3D11_BIND_FLAG bindFlag)
+            {
+                assert(data != nullptr && elementSize > 0);
+
+                // Element offsets are applied through the base vertex and start index of each part
+                size_t group = 0;
+                for (; group < mGroups.size(); ++group)
+                {
+                    auto& g = mGroups[group];
+                    if (g.bindFlag == bindFlag && g.elementSize == elementSize
+                        && (g.data.empty() || AlignUp(g.data.size(), elementSize) + sizeBytes <= mMaxBufferSize))
+                        break;
+                }
+
+                if (group == mGroups.size())
+                {
+                    Group g;
+                    g.bindFlag = bindFlag;
+                    g.elementSize = elementSize;
+                    mGroups.emplace_back(std::move(g));
+                }
+
+                auto& g = mGroups[group];
+
+                const size_t offset = AlignUp(g.data.size(), elementSize);
+                if (offset + sizeBytes > UINT32_MAX)
+                    throw std::overflow_error("Consolidated buffer too large");
+
+                g.data.resize(offset + sizeBytes);
+                memcpy(g.data.data() + offset, data, sizeBytes);
+
+                Entry entry;
+                entry.group = static_cast<uint32_t>(group);
+                entry.offset = static_cast<uint32_t>(offset / elementSize);
+                mEntries.push_back(entry);
+
+                return static_cast<uint32_t>(mEntries.size() - 1);
+            }
+
+            // The part's buffers, base vertex and start index are set by Build
+            void Assign(_In_ ModelMeshPart* part, uint32_t vertexEntry, uint32_t indexEntry)
+            {
+                assert(part != nullptr);
+
+                if (vertexEntry >= mEntries.size() || indexEntry >= mEntries.size())
+                    throw std::out_of_range("Invalid buffer entry");
+
+                mParts.push_back(PartEntry{ part, vertexEntry, indexEntry });
+            }
+
+            // Hands the gathered data to the model data and points the assigned parts at it
+            void Build(ModelData& data)
+            {
+                std::vector<uint32_t> buffers;
+                buffers.resize(mGroups.size());
+
+                for (size_t j = 0; j < mGroups.size(); ++j)
+                {
+                    auto& g = mGroups[j];
+                    buffers[j] = data.AddBuffer(std::move(g.data), g.bindFlag);
+                }
+
+                mGroups.clear();
+
+                for (const auto& it : mParts)
+                {
+                    auto& vb = mEntries[it.vertexEntry];
+                    auto& ib = mEntries[it.indexEntry];
+
+                    if (int64_t(it.part->vertexOffset) + vb.offset > INT32_MAX
+                        || uint64_t(it.part->startIndex) + ib.offset > UINT32_MAX)
+                        throw std::overflow_error("Consolidated buffer offset too large");
+
+                    data.SetPartBuffers(it.part, buffers[vb.group], buffers[ib.group]);
+                    it.part->vertexOffset += static_cast<int32_t>(vb.offset);
+                    it.part->startIndex += ib.offset;
+                }
+
+                mParts.clear();
+            }
+
+        private:
+            struct Group
+            {
+                D3D11_BIND_FLAG         bindFlag;
+                uint32_t                elementSize;
+                std::vector<uint8_t>    data;
+            };
+
+            struct Entry
+            {
+                uint32_t    group;
+                uint32_t    offset;     // In elements
+            };
+
+            struct PartEntry
+            {
+                ModelMeshPart*  part;
+                uint32_t        vertexEntry;
+                uint32_t        indexEntry;
+            };
+
+            static size_t AlignUp(size_t value, size_t alignment) noexcept
+            {
+                return ((value + alignment - 1) / alignment) * alignment;
+            }
+
+            size_t                  mMaxBufferSize;
+            std::vector<Group>      mGroups;
+            std::vector<Entry>      mEntries;
+            std::vector<PartEntry>  mParts;
+        };
+    }
+}
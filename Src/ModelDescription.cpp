@@ -0,0 +1,656 @@
+//--------------------------------------------------------------------------------------
+// File: ModelDescription.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "Model.h"
+#include "Effects.h"
+#include "BinaryReader.h"
+#include "LoaderHelpers.h"
+#include "ModelData.h"
+#include "PlatformHelpers.h"
+#include "WorkerThreads.h"
+
+#include "ModelBaked.h"
+
+using namespace DirectX;
+using namespace DirectX::ModelHelpers;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    // Returns the index of a semantic name in the baked model semantic table
+    uint32_t GetSemanticIndex(_In_z_ const char* semanticName)
+    {
+        for (size_t j = 0; j < std::size(BakedModel::SEMANTIC_NAMES); ++j)
+        {
+            if (_stricmp(semanticName, BakedModel::SEMANTIC_NAMES[j]) == 0)
+                return static_cast<uint32_t>(j);
+        }
+
+        DebugTrace("ERROR: Baked models do not support the input element semantic '%s'\n", semanticName);
+        throw std::runtime_error("Unsupported input element semantic");
+    }
+
+    // Accumulates the tables of a baked model file
+    class BakedModelBuilder
+    {
+    public:
+        explicit BakedModelBuilder(const ModelData& data) :
+            strings(1, L'\0'),
+            mData(data)
+        {}
+
+        std::vector<BakedModel::Buffer>         buffers;
+        std::vector<const ModelData::Buffer*>   bufferData;
+        std::vector<BakedModel::ElementSet>     elementSets;
+        std::vector<BakedModel::Element>        elements;
+        std::vector<BakedModel::Material>       materials;
+        std::vector<BakedModel::Mesh>           meshes;
+        std::vector<BakedModel::Part>           parts;
+        std::vector<uint32_t>                   influences;
+        std::vector<BakedModel::Bone>           bones;
+        std::vector<XMFLOAT4X4>                 matrices;
+        std::vector<wchar_t>                    strings;
+        uint32_t                                flags = 0;
+
+        uint32_t AddString(const std::wstring& str)
+        {
+            if (str.empty())
+                return 0;
+
+            auto it = mStringOffsets.find(str);
+            if (it != mStringOffsets.end())
+                return it->second;
+
+            const auto offset = static_cast<uint32_t>(strings.size() * sizeof(wchar_t));
+            strings.insert(strings.end(), str.cbegin(), str.cend());
+            strings.push_back(L'\0');
+            mStringOffsets.emplace(str, offset);
+            return offset;
+        }
+
+        uint32_t AddBuffer(uint32_t buffer)
+        {
+            auto it = mBufferIndices.find(buffer);
+            if (it != mBufferIndices.end())
+                return it->second;
+
+            auto& source = mData.GetBuffers()[buffer];
+
+            BakedModel::Buffer bh = {};
+            bh.BindFlags = static_cast<uint32_t>(source.bindFlag);
+            bh.SizeBytes = static_cast<uint32_t>(source.sizeBytes);
+            buffers.push_back(bh);
+            bufferData.push_back(&source);
+
+            const auto index = static_cast<uint32_t>(buffers.size() - 1);
+            mBufferIndices.emplace(buffer, index);
+            return index;
+        }
+
+        uint32_t AddElementSet(const ModelMeshPart::InputLayoutCollection& decl)
+        {
+            auto it = mElementSetIndices.find(&decl);
+            if (it != mElementSetIndices.end())
+                return it->second;
+
+            BakedModel::ElementSet sh = {};
+            sh.FirstElement = static_cast<uint32_t>(elements.size());
+            sh.ElementCount = static_cast<uint32_t>(decl.size());
+
+            for (const auto& element : decl)
+            {
+                BakedModel::Element eh = {};
+                eh.Semantic = GetSemanticIndex(element.SemanticName);
+                eh.SemanticIndex = element.SemanticIndex;
+                eh.Format = static_cast<uint32_t>(element.Format);
+                eh.InputSlot = element.InputSlot;
+                eh.AlignedByteOffset = element.AlignedByteOffset;
+                eh.InputSlotClass = static_cast<uint32_t>(element.InputSlotClass);
+                eh.InstanceDataStepRate = element.InstanceDataStepRate;
+                elements.push_back(eh);
+            }
+
+            elementSets.push_back(sh);
+
+            const auto index = static_cast<uint32_t>(elementSets.size() - 1);
+            mElementSetIndices.emplace(&decl, index);
+            return index;
+        }
+
+        uint32_t AddMaterial(uint32_t material)
+        {
+            auto it = mMaterialIndices.find(material);
+            if (it != mMaterialIndices.end())
+                return it->second;
+
+            auto& m = mData.GetMaterials()[material];
+
+            BakedModel::Material mh = {};
+
+            if (m.type == ModelData::MATERIAL_DEFAULT)
+            {
+                // Baked models always create their effects through the factory
+                DebugTrace("WARNING: Baked model using a factory material in place of the default effect\n");
+            }
+
+            auto& info = m.info;
+            mh.Name = AddString(m.name);
+            mh.DiffuseTexture = AddString(m.diffuseTexture);
+            mh.SpecularTexture = AddString(m.specularTexture);
+            mh.NormalTexture = AddString(m.normalTexture);
+            mh.EmissiveTexture = AddString(m.emissiveTexture);
+            mh.Flags = (info.perVertexColor ? BakedModel::MATERIAL_PER_VERTEX_COLOR : 0u)
+                | (info.enableSkinning ? BakedModel::MATERIAL_SKINNING : 0u)
+                | (info.enableDualTexture ? BakedModel::MATERIAL_DUAL_TEXTURE : 0u)
+                | (info.enableNormalMaps ? BakedModel::MATERIAL_NORMAL_MAPS : 0u)
+                | (info.biasedVertexNormals ? BakedModel::MATERIAL_BIASED_VERTEX_NORMALS : 0u);
+            mh.SpecularPower = info.specularPower;
+            mh.Alpha = info.alpha;
+            mh.AmbientColor = info.ambientColor;
+            mh.DiffuseColor = info.diffuseColor;
+            mh.SpecularColor = info.specularColor;
+            mh.EmissiveColor = info.emissiveColor;
+
+            materials.push_back(mh);
+
+            const auto index = static_cast<uint32_t>(materials.size() - 1);
+            mMaterialIndices.emplace(material, index);
+            return index;
+        }
+
+        std::vector<uint8_t> Build() const
+        {
+            BakedModel::Header header = {};
+            header.Magic = BakedModel::MAGIC;
+            header.Version = BakedModel::VERSION;
+            header.HeaderSize = sizeof(BakedModel::Header);
+            header.Flags = flags;
+
+            uint64_t offset = sizeof(BakedModel::Header);
+
+            auto place = [&offset](BakedModel::Table& table, size_t count, size_t elementSize, uint64_t alignment)
+                {
+                    offset = (offset + alignment - 1) & ~(alignment - 1);
+                    table.Offset = static_cast<uint32_t>(offset);
+                    table.Count = static_cast<uint32_t>(count);
+                    offset += uint64_t(count) * elementSize;
+                };
+
+            place(header.Buffers, buffers.size(), sizeof(BakedModel::Buffer), 4);
+            place(header.ElementSets, elementSets.size(), sizeof(BakedModel::ElementSet), 4);
+            place(header.Elements, elements.size(), sizeof(BakedModel::Element), 4);
+            place(header.Materials, materials.size(), sizeof(BakedModel::Material), 4);
+            place(header.Meshes, meshes.size(), sizeof(BakedModel::Mesh), 4);
+            place(header.Parts, parts.size(), sizeof(BakedModel::Part), 4);
+            place(header.Influences, influences.size(), sizeof(uint32_t), 4);
+            place(header.Bones, bones.size(), sizeof(BakedModel::Bone), 4);
+            place(header.Matrices, matrices.size(), sizeof(XMFLOAT4X4), 4);
+
+            auto bufferTable = buffers;
+            for (size_t j = 0; j < bufferTable.size(); ++j)
+            {
+                BakedModel::Table blob = {};
+                place(blob, bufferData[j]->sizeBytes, sizeof(uint8_t), BakedModel::BUFFER_ALIGNMENT);
+                bufferTable[j].DataOffset = blob.Offset;
+            }
+
+            place(header.Strings, strings.size() * sizeof(wchar_t), sizeof(uint8_t), 4);
+
+            if (offset > UINT32_MAX)
+                throw std::runtime_error("Baked model too large");
+
+            std::vector<uint8_t> file(static_cast<size_t>(offset), 0);
+
+            auto copy = [&file](const BakedModel::Table& table, const void* data, size_t sizeBytes)
+                {
+                    if (sizeBytes > 0)
+                    {
+                        memcpy(file.data() + table.Offset, data, sizeBytes);
+                    }
+                };
+
+            memcpy(file.data(), &header, sizeof(header));
+            copy(header.Buffers, bufferTable.data(), bufferTable.size() * sizeof(BakedModel::Buffer));
+            copy(header.ElementSets, elementSets.data(), elementSets.size() * sizeof(BakedModel::ElementSet));
+            copy(header.Elements, elements.data(), elements.size() * sizeof(BakedModel::Element));
+            copy(header.Materials, materials.data(), materials.size() * sizeof(BakedModel::Material));
+            copy(header.Meshes, meshes.data(), meshes.size() * sizeof(BakedModel::Mesh));
+            copy(header.Parts, parts.data(), parts.size() * sizeof(BakedModel::Part));
+            copy(header.Influences, influences.data(), influences.size() * sizeof(uint32_t));
+            copy(header.Bones, bones.data(), bones.size() * sizeof(BakedModel::Bone));
+            copy(header.Matrices, matrices.data(), matrices.size() * sizeof(XMFLOAT4X4));
+            copy(header.Strings, strings.data(), strings.size() * sizeof(wchar_t));
+
+            for (size_t j = 0; j < bufferTable.size(); ++j)
+            {
+                memcpy(file.data() + bufferTable[j].DataOffset, bufferData[j]->data, bufferData[j]->sizeBytes);
+            }
+
+            return file;
+        }
+
+    private:
+        const ModelData&                                                mData;
+        std::map<std::wstring, uint32_t>                                mStringOffsets;
+        std::map<uint32_t, uint32_t>                                    mBufferIndices;
+        std::map<const ModelMeshPart::InputLayoutCollection*, uint32_t> mElementSetIndices;
+        std::map<uint32_t, uint32_t>                                    mMaterialIndices;
+    };
+
+    HRESULT WriteEntireFile(_In_z_ const wchar_t* fileName, const std::vector<uint8_t>& data)
+    {
+        ScopedHandle hFile(safe_handle(CreateFile2(
+            fileName,
+            GENERIC_WRITE | DELETE, 0, CREATE_ALWAYS,
+            nullptr)));
+        if (!hFile)
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        LoaderHelpers::auto_delete_file delonfail(hFile.get());
+
+        DWORD bytesWritten = 0;
+        if (!WriteFile(hFile.get(), data.data(), static_cast<DWORD>(data.size()), &bytesWritten, nullptr))
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        if (bytesWritten != data.size())
+            return E_FAIL;
+
+        delonfail.clear();
+
+        return S_OK;
+    }
+
+    const char* GetDebugName(ModelFileFormat format)
+    {
+        switch (format)
+        {
+        case ModelFile_SDKMESH: return "ModelSDKMESH";
+        case ModelFile_CMO:     return "ModelCMO";
+        case ModelFile_VBO:     return "ModelVBO";
+        case ModelFile_Baked:   return "ModelBaked";
+        default:
+            throw std::invalid_argument("Unknown model file format");
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// ModelDescription::Impl
+//--------------------------------------------------------------------------------------
+
+// Holds the file contents, which the unchanged vertex and index data of the model data refers to
+class ModelDescription::Impl
+{
+public:
+    Impl(ModelFileFormat format, ModelLoaderFlags flags) :
+        mDataSize(0),
+        mFormat(format),
+        mFlags(flags),
+        mAnimsOffset(0),
+        mModelData(GetDebugName(format))
+    {}
+
+    void Load()
+    {
+        switch (mFormat)
+        {
+        case ModelFile_SDKMESH: LoadSDKMESH(mModelData, mData.get(), mDataSize, mFlags); break;
+        case ModelFile_CMO:     LoadCMO(mModelData, mData.get(), mDataSize, mFlags, false, &mAnimsOffset); break;
+        case ModelFile_VBO:     LoadVBO(mModelData, mData.get(), mDataSize, mFlags); break;
+        case ModelFile_Baked:   LoadBaked(mModelData, mData.get(), mDataSize, mFlags); break;
+        default:
+            throw std::invalid_argument("Unknown model file format");
+        }
+    }
+
+    void WriteBaked(_In_z_ const wchar_t* szFileName) const;
+
+    std::unique_ptr<uint8_t[]>  mData;
+    size_t                      mDataSize;
+    std::wstring                mName;
+    ModelFileFormat             mFormat;
+    ModelLoaderFlags            mFlags;
+    size_t                      mAnimsOffset;
+    ModelData                   mModelData;
+};
+
+
+// Everything written comes from the description, so the baked file matches what phase one read
+_Use_decl_annotations_
+void ModelDescription::Impl::WriteBaked(const wchar_t* szFileName) const
+{
+    auto& model = mModelData.model;
+
+    BakedModelBuilder builder(mModelData);
+
+    for (const auto& mit : model.meshes)
+    {
+        auto mesh = mit.get();
+        assert(mesh != nullptr);
+
+        BakedModel::Mesh mh = {};
+        mh.Name = builder.AddString(mesh->name);
+        mh.FirstPart = static_cast<uint32_t>(builder.parts.size());
+        mh.PartCount = static_cast<uint32_t>(mesh->meshParts.size());
+        mh.BoneIndex = mesh->boneIndex;
+        mh.FirstInfluence = static_cast<uint32_t>(builder.influences.size());
+        mh.InfluenceCount = static_cast<uint32_t>(mesh->boneInfluences.size());
+        mh.Flags = (mesh->ccw ? BakedModel::MESH_CCW : 0u) | (mesh->pmalpha ? BakedModel::MESH_PMALPHA : 0u);
+        mh.SphereCenter = mesh->boundingSphere.Center;
+        mh.SphereRadius = mesh->boundingSphere.Radius;
+        mh.BoxCenter = mesh->boundingBox.Center;
+        mh.BoxExtents = mesh->boundingBox.Extents;
+        mh.PositionScale = mesh->positionScale;
+        mh.PositionBias = mesh->positionBias;
+
+        builder.influences.insert(builder.influences.end(), mesh->boneInfluences.cbegin(), mesh->boneInfluences.cend());
+
+        for (const auto& it : mesh->meshParts)
+        {
+            auto part = it.get();
+            assert(part != nullptr);
+
+            if (!part->vbDecl || part->vbDecl->empty())
+                throw std::runtime_error("Model mesh part missing vertex buffer input elements data");
+
+            auto& res = mModelData.GetPart(part);
+
+            BakedModel::Part ph = {};
+            ph.Material = builder.AddMaterial(res.material);
+            ph.VertexBuffer = builder.AddBuffer(res.vertexBuffer);
+            ph.IndexBuffer = builder.AddBuffer(res.indexBuffer);
+            ph.ElementSet = builder.AddElementSet(*part->vbDecl);
+            ph.IndexCount = part->indexCount;
+            ph.StartIndex = part->startIndex;
+            ph.VertexOffset = part->vertexOffset;
+            ph.VertexStride = part->vertexStride;
+            ph.PrimitiveType = static_cast<uint32_t>(part->primitiveType);
+            ph.IndexFormat = static_cast<uint32_t>(part->indexFormat);
+            ph.Flags = part->isAlpha ? BakedModel::PART_ALPHA : 0u;
+            ph.VertexCount = part->vertexCount;
+            builder.parts.push_back(ph);
+        }
+
+        builder.meshes.push_back(mh);
+    }
+
+    // Bones keep their indices, since meshes and animation clips refer to them
+    if (!model.bones.empty())
+    {
+        const size_t nbones = model.bones.size();
+
+        if (!model.boneMatrices)
+            throw std::runtime_error("Model bone matrices are missing");
+
+        builder.bones.reserve(nbones);
+        builder.matrices.resize(model.invBindPoseMatrices ? nbones * 2 : nbones);
+
+        for (size_t j = 0; j < nbones; ++j)
+        {
+            const auto& bone = model.bones[j];
+
+            BakedModel::Bone bh = {};
+            bh.Name = builder.AddString(bone.name);
+            bh.ParentIndex = bone.parentIndex;
+            bh.ChildIndex = bone.childIndex;
+            bh.SiblingIndex = bone.siblingIndex;
+            builder.bones.push_back(bh);
+
+            XMStoreFloat4x4(&builder.matrices[j], model.boneMatrices[j]);
+        }
+
+        if (model.invBindPoseMatrices)
+        {
+            builder.flags |= BakedModel::HEADER_INV_BIND_POSE;
+
+            for (size_t j = 0; j < nbones; ++j)
+            {
+                XMStoreFloat4x4(&builder.matrices[nbones + j], model.invBindPoseMatrices[j]);
+            }
+        }
+    }
+
+    auto file = builder.Build();
+
+    HRESULT hr = WriteEntireFile(szFileName, file);
+    if (FAILED(hr))
+    {
+        DebugTrace("ERROR: ModelDescription::WriteBaked failed (%08X) writing '%ls'\n",
+            static_cast<unsigned int>(hr), szFileName);
+        throw std::runtime_error("ModelDescription::WriteBaked");
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// ModelDescription
+//--------------------------------------------------------------------------------------
+
+ModelDescription::ModelDescription(std::unique_ptr<Impl>&& impl) noexcept :
+    pImpl(std::move(impl))
+{}
+
+ModelDescription::ModelDescription(ModelDescription&&) noexcept = default;
+ModelDescription& ModelDescription::operator= (ModelDescription&&) noexcept = default;
+ModelDescription::~ModelDescription() = default;
+
+
+_Use_decl_annotations_
+std::unique_ptr<ModelDescription> ModelDescription::CreateFromMemory(
+    ModelFileFormat format,
+    const uint8_t* meshData, size_t dataSize,
+    ModelLoaderFlags flags)
+{
+    if (!meshData || !dataSize)
+        throw std::invalid_argument("meshData cannot be null");
+
+    // The description keeps its own copy, since the model data refers to it
+    auto impl = std::make_unique<Impl>(format, flags);
+    impl->mData = std::make_unique<uint8_t[]>(dataSize);
+    memcpy(impl->mData.get(), meshData, dataSize);
+    impl->mDataSize = dataSize;
+    impl->Load();
+
+    return std::unique_ptr<ModelDescription>(new ModelDescription(std::move(impl)));
+}
+
+
+_Use_decl_annotations_
+std::unique_ptr<ModelDescription> ModelDescription::CreateFromFile(
+    ModelFileFormat format,
+    const wchar_t* szFileName,
+    ModelLoaderFlags flags)
+{
+    if (!szFileName)
+        throw std::invalid_argument("szFileName cannot be null");
+
+    auto impl = std::make_unique<Impl>(format, flags);
+
+    HRESULT hr = BinaryReader::ReadEntireFile(szFileName, impl->mData, &impl->mDataSize);
+    if (FAILED(hr))
+    {
+        DebugTrace("ERROR: ModelDescription::CreateFromFile failed (%08X) loading '%ls'\n",
+            static_cast<unsigned int>(hr), szFileName);
+        throw std::runtime_error("ModelDescription::CreateFromFile");
+    }
+
+    impl->mName = szFileName;
+    impl->mModelData.model.name = szFileName;
+    impl->Load();
+
+    return std::unique_ptr<ModelDescription>(new ModelDescription(std::move(impl)));
+}
+
+
+// Loads textures on the shared worker threads so that disk reads and decoding overlap.
+void ModelDescription::RequestTextures(IEffectFactory& fxFactory) const
+{
+    auto& names = pImpl->mModelData.model.textureNames;
+    if (names.empty())
+        return;
+
+    WorkerThreads::Get()->ParallelFor(names.size(), [&](size_t j)
+        {
+            // Failures are reported when the effect that uses the texture is created
+            try
+            {
+                ComPtr<ID3D11ShaderResourceView> srv;
+                fxFactory.CreateTexture(names[j].c_str(), nullptr, srv.GetAddressOf());
+            }
+            catch (const std::exception& e)
+            {
+                DebugTrace("WARNING: ModelDescription could not load texture '%ls' (%s)\n",
+                    names[j].c_str(), e.what());
+            }
+        });
+}
+
+
+_Use_decl_annotations_
+std::unique_ptr<Model> ModelDescription::CreateModel(
+    ID3D11Device* device,
+    IEffectFactory& fxFactory) const
+{
+    if (!device)
+        throw std::invalid_argument("Device cannot be null");
+
+    return pImpl->mModelData.Create(device, &fxFactory);
+}
+
+
+_Use_decl_annotations_
+void ModelDescription::WriteBaked(const wchar_t* szFileName) const
+{
+    if (!szFileName)
+        throw std::invalid_argument("szFileName cannot be null");
+
+    pImpl->WriteBaked(szFileName);
+}
+
+
+_Use_decl_annotations_
+std::future<std::unique_ptr<Model>> ModelDescription::CreateModelAsync(
+    ID3D11Device* device,
+    IEffectFactory& fxFactory,
+    std::shared_ptr<const ModelDescription> description)
+{
+    if (!device || !description)
+        throw std::invalid_argument("Device and description cannot be null");
+
+    // Direct3D 11 devices are free-threaded, so buffers and input layouts can be created off the render thread
+    ComPtr<ID3D11Device> d3dDevice(device);
+    IEffectFactory* factory = &fxFactory;
+
+    return std::async(std::launch::async, [d3dDevice, factory, description]()
+        {
+            return description->CreateModel(d3dDevice.Get(), *factory);
+        });
+}
+
+
+_Use_decl_annotations_
+std::future<std::unique_ptr<Model>> ModelDescription::CreateModelAsync(
+    ID3D11Device* device,
+    IEffectFactory& fxFactory,
+    ModelFileFormat format,
+    const wchar_t* szFileName,
+    ModelLoaderFlags flags)
+{
+    if (!device || !szFileName)
+        throw std::invalid_argument("Device and szFileName cannot be null");
+
+    ComPtr<ID3D11Device> d3dDevice(device);
+    IEffectFactory* factory = &fxFactory;
+    std::wstring fileName(szFileName);
+
+    return std::async(std::launch::async, [d3dDevice, factory, format, fileName, flags]()
+        {
+            auto desc = CreateFromFile(format, fileName.c_str(), flags);
+            desc->RequestTextures(*factory);
+            return desc->CreateModel(d3dDevice.Get(), *factory);
+        });
+}
+
+
+// Properties
+ModelFileFormat ModelDescription::GetFormat() const noexcept
+{
+    return pImpl->mFormat;
+}
+
+ModelLoaderFlags ModelDescription::GetFlags() const noexcept
+{
+    return pImpl->mFlags;
+}
+
+const std::wstring& ModelDescription::GetName() const noexcept
+{
+    return pImpl->mName;
+}
+
+const uint8_t* ModelDescription::GetData() const noexcept
+{
+    return pImpl->mData.get();
+}
+
+size_t ModelDescription::GetDataSize() const noexcept
+{
+    return pImpl->mDataSize;
+}
+
+size_t ModelDescription::GetMeshCount() const noexcept
+{
+    return pImpl->mModelData.model.meshes.size();
+}
+
+const std::vector<std::wstring>& ModelDescription::GetTextureNames() const noexcept
+{
+    return pImpl->mModelData.model.textureNames;
+}
+
+size_t ModelDescription::GetAnimationsOffset() const noexcept
+{
+    return pImpl->mAnimsOffset;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Adapters for /Zc:wchar_t- clients
+
+#if defined(_MSC_VER) && !defined(_NATIVE_WCHAR_T_DEFINED)
+
+_Use_decl_annotations_
+void ModelDescription::WriteBaked(const __wchar_t* szFileName) const
+{
+    WriteBaked(reinterpret_cast<const unsigned short*>(szFileName));
+}
+
+_Use_decl_annotations_
+std::unique_ptr<ModelDescription> ModelDescription::CreateFromFile(
+    ModelFileFormat format,
+    const __wchar_t* szFileName,
+    ModelLoaderFlags flags)
+{
+    return CreateFromFile(format, reinterpret_cast<const unsigned short*>(szFileName), flags);
+}
+
+_Use_decl_annotations_
+std::future<std::unique_ptr<Model>> ModelDescription::CreateModelAsync(
+    ID3D11Device* device,
+    IEffectFactory& fxFactory,
+    ModelFileFormat format,
+    const __wchar_t* szFileName,
+    ModelLoaderFlags flags)
+{
+    return CreateModelAsync(device, fxFactory, format, reinterpret_cast<const unsigned short*>(szFileName), flags);
+}
+
+#endif
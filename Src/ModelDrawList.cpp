@@ -0,0 +1,286 @@
+//--------------------------------------------------------------------------------------
+// File: ModelDrawList.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "Model.h"
+#include "CommonStates.h"
+#include "Effects.h"
+#include "PlatformHelpers.h"
+
+using namespace DirectX;
+
+
+//--------------------------------------------------------------------------------------
+// ModelDrawList
+//--------------------------------------------------------------------------------------
+
+ModelDrawList::ModelDrawList() noexcept :
+    mStats{},
+    mSorted(true)
+{}
+
+
+ModelDrawList::~ModelDrawList()
+{}
+
+
+// Adds all meshes in a model given a world matrix.
+void XM_CALLCONV ModelDrawList::Add(const Model& model, FXMMATRIX world)
+{
+    for (const auto& mit : model.meshes)
+    {
+        auto mesh = mit.get();
+        assert(mesh != nullptr);
+
+        AddMesh(*mesh, world);
+    }
+}
+
+
+// Adds all meshes in a model using model bones.
+_Use_decl_annotations_
+void XM_CALLCONV ModelDrawList::Add(
+    const Model& model,
+    size_t nbones,
+    const XMMATRIX* boneTransforms,
+    FXMMATRIX world)
+{
+    if (!nbones || !boneTransforms)
+    {
+        throw std::invalid_argument("Bone transforms array required");
+    }
+
+    for (const auto& mit : model.meshes)
+    {
+        auto mesh = mit.get();
+        assert(mesh != nullptr);
+
+        if (mesh->boneIndex != ModelBone::c_Invalid && mesh->boneIndex < nbones)
+        {
+            AddMesh(*mesh, XMMatrixMultiply(boneTransforms[mesh->boneIndex], world));
+        }
+        else
+        {
+            AddMesh(*mesh, world);
+        }
+    }
+}
+
+
+void ModelDrawList::Clear() noexcept
+{
+    mOpaque.clear();
+    mAlpha.clear();
+    mWorlds.clear();
+    mSorted = true;
+}
+
+
+// Sorts opaque parts so that parts sharing an effect, input layout, and buffers are adjacent.
+void ModelDrawList::Compile()
+{
+    std::stable_sort(mOpaque.begin(), mOpaque.end(), [](const Entry& a, const Entry& b) noexcept
+        {
+            const ModelMeshPart* pa = a.part;
+            const ModelMeshPart* pb = b.part;
+
+            return std::make_tuple(pa->effect.get(), pa->inputLayout.Get(), pa->vertexBuffer.Get(), pa->vertexStride,
+                    pa->indexBuffer.Get(), pa->indexFormat, pa->primitiveType, a.mesh->ccw, a.worldIndex)
+                < std::make_tuple(pb->effect.get(), pb->inputLayout.Get(), pb->vertexBuffer.Get(), pb->vertexStride,
+                    pb->indexBuffer.Get(), pb->indexFormat, pb->primitiveType, b.mesh->ccw, b.worldIndex);
+        });
+
+    mSorted = true;
+}
+
+
+// Draws all opaque parts in sorted order, then all alpha parts in the order they were added.
+_Use_decl_annotations_
+void XM_CALLCONV ModelDrawList::Draw(
+    ID3D11DeviceContext* deviceContext,
+    const CommonStates& states,
+    FXMMATRIX view,
+    CXMMATRIX projection,
+    bool wireframe,
+    std::function<void()> setCustomState)
+{
+    assert(deviceContext != nullptr);
+
+    if (!mSorted)
+    {
+        Compile();
+    }
+
+    mStats = {};
+
+    DrawEntries(deviceContext, states, mOpaque, false, view, projection, wireframe, setCustomState);
+    DrawEntries(deviceContext, states, mAlpha, true, view, projection, wireframe, setCustomState);
+}
+
+
+void XM_CALLCONV ModelDrawList::AddMesh(const ModelMesh& mesh, FXMMATRIX world)
+{
+    if (mWorlds.size() >= UINT32_MAX)
+        throw std::runtime_error("Too many meshes in draw list");
+
+    const auto worldIndex = static_cast<uint32_t>(mWorlds.size());
+
+    XMFLOAT4X4 m;
+    XMStoreFloat4x4(&m, mesh.GetVertexTransform(world));
+    mWorlds.emplace_back(m);
+
+    for (const auto& it : mesh.meshParts)
+    {
+        auto part = it.get();
+        assert(part != nullptr);
+
+        if (part->isAlpha)
+        {
+            mAlpha.emplace_back(Entry{ part, &mesh, worldIndex });
+        }
+        else
+        {
+            mOpaque.emplace_back(Entry{ part, &mesh, worldIndex });
+            mSorted = false;
+        }
+    }
+}
+
+
+// Private helper for replaying entries while skipping state that is already set.
+_Use_decl_annotations_
+void XM_CALLCONV ModelDrawList::DrawEntries(
+    ID3D11DeviceContext* deviceContext,
+    const CommonStates& states,
+    const std::vector<Entry>& entries,
+    bool alpha,
+    FXMMATRIX view,
+    CXMMATRIX projection,
+    bool wireframe,
+    const std::function<void()>& setCustomState)
+{
+    const ModelMesh* stateMesh = nullptr;
+    IEffect* currentEffect = nullptr;
+    uint32_t currentWorld = UINT32_MAX;
+    ID3D11InputLayout* currentLayout = nullptr;
+    ID3D11Buffer* currentVB = nullptr;
+    UINT currentStride = 0;
+    ID3D11Buffer* currentIB = nullptr;
+    DXGI_FORMAT currentFormat = DXGI_FORMAT_UNKNOWN;
+    D3D_PRIMITIVE_TOPOLOGY currentTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+
+    for (const auto& it : entries)
+    {
+        auto part = it.part;
+        auto mesh = it.mesh;
+
+        // Blend, depth, rasterizer, and sampler states only vary with winding and alpha mode
+        if (!stateMesh
+            || mesh->ccw != stateMesh->ccw
+            || (alpha && mesh->pmalpha != stateMesh->pmalpha))
+        {
+            mesh->PrepareForRendering(deviceContext, states, alpha, wireframe);
+            stateMesh = mesh;
+            ++mStats.stateChanges;
+        }
+        else
+        {
+            ++mStats.stateChangesSkipped;
+        }
+
+        auto layout = part->inputLayout.Get();
+        if (layout != currentLayout)
+        {
+            deviceContext->IASetInputLayout(layout);
+            currentLayout = layout;
+            ++mStats.stateChanges;
+        }
+        else
+        {
+            ++mStats.stateChangesSkipped;
+        }
+
+        auto vb = part->vertexBuffer.Get();
+        const UINT vbStride = part->vertexStride;
+        if (vb != currentVB || vbStride != currentStride)
+        {
+            constexpr UINT vbOffset = 0;
+            deviceContext->IASetVertexBuffers(0, 1, &vb, &vbStride, &vbOffset);
+            currentVB = vb;
+            currentStride = vbStride;
+            ++mStats.stateChanges;
+        }
+        else
+        {
+            ++mStats.stateChangesSkipped;
+        }
+
+        auto ib = part->indexBuffer.Get();
+        if (ib != currentIB || part->indexFormat != currentFormat)
+        {
+            deviceContext->IASetIndexBuffer(ib, part->indexFormat, 0);
+            currentIB = ib;
+            currentFormat = part->indexFormat;
+            ++mStats.stateChanges;
+        }
+        else
+        {
+            ++mStats.stateChangesSkipped;
+        }
+
+        // The effect only needs applying again when it or its world matrix changes
+        auto effect = part->effect.get();
+        assert(effect != nullptr);
+        if (effect != currentEffect || it.worldIndex != currentWorld)
+        {
+            auto imatrices = part->GetEffectMatrices();
+            if (imatrices)
+            {
+                const XMMATRIX world = XMLoadFloat4x4(&mWorlds[it.worldIndex]);
+                imatrices->SetMatrices(world, view, projection);
+            }
+
+            effect->Apply(deviceContext);
+            currentEffect = effect;
+            currentWorld = it.worldIndex;
+            ++mStats.effectApplies;
+        }
+        else
+        {
+            ++mStats.effectAppliesSkipped;
+        }
+
+        // Hook lets the caller replace our shaders or state settings with whatever else they see fit.
+        if (setCustomState)
+        {
+            setCustomState();
+
+            // The hook may have changed anything, so nothing set so far can be reused
+            stateMesh = nullptr;
+            currentEffect = nullptr;
+            currentLayout = nullptr;
+            currentVB = currentIB = nullptr;
+            currentTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+        }
+
+        if (part->primitiveType != currentTopology)
+        {
+            deviceContext->IASetPrimitiveTopology(part->primitiveType);
+            currentTopology = part->primitiveType;
+            ++mStats.stateChanges;
+        }
+        else
+        {
+            ++mStats.stateChangesSkipped;
+        }
+
+        deviceContext->DrawIndexed(part->indexCount, part->startIndex, part->vertexOffset);
+        ++mStats.drawCalls;
+    }
+}
@@ -0,0 +1,840 @@
+//--------------------------------------------------------------------------------------
+// File: ModelHelpers.h
+//
+// Helper functions for CPU-side processing of model mesh part data
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Model.h"
+#include "Effects.h"
+#include "ModelPicking.h"
+#include "LoaderHelpers.h"
+#include "PlatformHelpers.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace DirectX
+{
+    namespace ModelHelpers
+    {
+        //--------------------------------------------------------------------------------------
+        // Copies the contents of a buffer to CPU memory via a staging resource
+        //--------------------------------------------------------------------------------------
+        inline void ReadBackBuffer(
+            _In_ ID3D11DeviceContext* deviceContext,
+            _In_ ID3D11Buffer* buffer,
+            std::vector<uint8_t>& data)
+        {
+            assert(deviceContext != nullptr && buffer != nullptr);
+
+            D3D11_BUFFER_DESC desc = {};
+            buffer->GetDesc(&desc);
+
+            desc.Usage = D3D11_USAGE_STAGING;
+            desc.BindFlags = 0;
+            desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+            desc.MiscFlags = 0;
+
+            Microsoft::WRL::ComPtr<ID3D11Device> device;
+            deviceContext->GetDevice(&device);
+
+            Microsoft::WRL::ComPtr<ID3D11Buffer> staging;
+            ThrowIfFailed(device->CreateBuffer(&desc, nullptr, staging.GetAddressOf()));
+
+            deviceContext->CopyResource(staging.Get(), buffer);
+
+            D3D11_MAPPED_SUBRESOURCE mapped = {};
+            ThrowIfFailed(deviceContext->Map(staging.Get(), 0, D3D11_MAP_READ, 0, &mapped));
+
+            data.resize(desc.ByteWidth);
+            memcpy(data.data(), mapped.pData, desc.ByteWidth);
+
+            deviceContext->Unmap(staging.Get(), 0);
+        }
+
+
+        //--------------------------------------------------------------------------------------
+        // Locates a per-vertex element in slot 0 of a mesh part input layout
+        //--------------------------------------------------------------------------------------
+        inline bool FindVertexElement(
+            const ModelMeshPart::InputLayoutCollection& decl,
+            _In_z_ const char* semanticName,
+            uint32_t semanticIndex,
+            uint32_t& offset,
+            DXGI_FORMAT& format) noexcept
+        {
+            uint32_t current = 0;
+            for (const auto& it : decl)
+            {
+                if (it.InputSlot != 0 || it.InputSlotClass != D3D11_INPUT_PER_VERTEX_DATA)
+                    continue;
+
+                if (it.AlignedByteOffset != D3D11_APPEND_ALIGNED_ELEMENT)
+                    current = it.AlignedByteOffset;
+
+                if (_stricmp(it.SemanticName, semanticName) == 0 && it.SemanticIndex == semanticIndex)
+                {
+                    offset = current;
+                    format = it.Format;
+                    return true;
+                }
+
+                current += static_cast<uint32_t>(LoaderHelpers::BitsPerPixel(it.Format) / 8);
+            }
+
+            return false;
+        }
+
+        inline bool FindPositionElement(
+            const ModelMeshPart::InputLayoutCollection& decl,
+            uint32_t& offset,
+            DXGI_FORMAT& format) noexcept
+        {
+            return FindVertexElement(decl, "SV_Position", 0, offset, format)
+                || FindVertexElement(decl, "POSITION", 0, offset, format);
+        }
+
+
+        //--------------------------------------------------------------------------------------
+        // Reads the triangle list indices of a mesh part from a CPU copy of its index buffer,
+        // widened to 32-bit and with the part's base vertex applied
+        //--------------------------------------------------------------------------------------
+        inline void GetPartIndices(
+            const ModelMeshPart& part,
+            _In_reads_bytes_(ibSize) const uint8_t* ibData, size_t ibSize,
+            std::vector<uint32_t>& indices)
+        {
+            if (part.primitiveType != D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST)
+                throw std::invalid_argument("Mesh part must be a triangle list");
+
+            const size_t indexSize = (part.indexFormat == DXGI_FORMAT_R32_UINT) ? sizeof(uint32_t) : sizeof(uint16_t);
+
+            if ((uint64_t(part.startIndex) + uint64_t(part.indexCount)) * indexSize > ibSize)
+                throw std::out_of_range("Mesh part indices exceed index buffer");
+
+            indices.resize(part.indexCount);
+            for (size_t j = 0; j < part.indexCount; ++j)
+            {
+                auto ptr = ibData + (size_t(part.startIndex) + j) * indexSize;
+
+                uint32_t index;
+                if (indexSize == sizeof(uint32_t))
+                {
+                    memcpy(&index, ptr, sizeof(uint32_t));
+                }
+                else
+                {
+                    uint16_t index16;
+                    memcpy(&index16, ptr, sizeof(uint16_t));
+                    index = index16;
+                }
+
+                const int64_t vertex = int64_t(index) + part.vertexOffset;
+                if (vertex < 0 || vertex > UINT32_MAX)
+                    throw std::out_of_range("Mesh part vertex index out of range");
+
+                indices[j] = static_cast<uint32_t>(vertex);
+            }
+        }
+
+        // Reads back the index buffer of a mesh part from the GPU for GetPartIndices
+        inline void ReadPartIndices(
+            _In_ ID3D11DeviceContext* deviceContext,
+            const ModelMeshPart& part,
+            std::vector<uint32_t>& indices)
+        {
+            if (!part.indexBuffer)
+                throw std::invalid_argument("Mesh part requires an index buffer");
+
+            std::vector<uint8_t> data;
+            ReadBackBuffer(deviceContext, part.indexBuffer.Get(), data);
+
+            GetPartIndices(part, data.data(), data.size(), indices);
+        }
+
+
+        //--------------------------------------------------------------------------------------
+        // Reads back the float3 positions of a mesh part vertex buffer
+        //--------------------------------------------------------------------------------------
+        inline void ReadPartPositions(
+            _In_ ID3D11DeviceContext* deviceContext,
+            const ModelMeshPart& part,
+            std::vector<XMFLOAT3>& positions)
+        {
+            if (!part.vbDecl || !part.vertexBuffer || !part.vertexStride)
+                throw std::invalid_argument("Mesh part requires a vertex buffer and input layout description");
+
+            uint32_t offset = 0;
+            DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+            if (!FindPositionElement(*part.vbDecl, offset, format))
+                throw std::runtime_error("SV_Position is required");
+
+            if (format != DXGI_FORMAT_R32G32B32_FLOAT && format != DXGI_FORMAT_R32G32B32A32_FLOAT)
+                throw std::runtime_error("Unsupported vertex position format");
+
+            std::vector<uint8_t> data;
+            ReadBackBuffer(deviceContext, part.vertexBuffer.Get(), data);
+
+            if (offset + sizeof(XMFLOAT3) > part.vertexStride)
+                throw std::runtime_error("Vertex position exceeds vertex stride");
+
+            const size_t nVerts = data.size() / part.vertexStride;
+            positions.resize(nVerts);
+            for (size_t j = 0; j < nVerts; ++j)
+            {
+                memcpy(&positions[j], &data[j * part.vertexStride + offset], sizeof(XMFLOAT3));
+            }
+        }
+
+
+        //--------------------------------------------------------------------------------------
+        // Decodes one vertex element to floats. Normalized integer formats are returned in
+        // their natural range; normals stored as UNORM still need BiasX2 applied.
+        //--------------------------------------------------------------------------------------
+        inline bool LoadVertexElement(
+            _In_ const uint8_t* ptr,
+            DXGI_FORMAT format,
+            XMVECTOR& value) noexcept
+        {
+            using namespace DirectX::PackedVector;
+
+            switch (format)
+            {
+            case DXGI_FORMAT_R32G32B32A32_FLOAT: value = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(ptr)); break;
+            case DXGI_FORMAT_R32G32B32_FLOAT:    value = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(ptr)); break;
+            case DXGI_FORMAT_R32G32_FLOAT:       value = XMLoadFloat2(reinterpret_cast<const XMFLOAT2*>(ptr)); break;
+            case DXGI_FORMAT_R32_FLOAT:          value = XMLoadFloat(reinterpret_cast<const float*>(ptr)); break;
+            case DXGI_FORMAT_R16G16B16A16_FLOAT: value = XMLoadHalf4(reinterpret_cast<const XMHALF4*>(ptr)); break;
+            case DXGI_FORMAT_R16G16B16A16_SNORM: value = XMLoadShortN4(reinterpret_cast<const XMSHORTN4*>(ptr)); break;
+            case DXGI_FORMAT_R16G16_FLOAT:       value = XMLoadHalf2(reinterpret_cast<const XMHALF2*>(ptr)); break;
+            case DXGI_FORMAT_R16G16_UNORM:       value = XMLoadUShortN2(reinterpret_cast<const XMUSHORTN2*>(ptr)); break;
+            case DXGI_FORMAT_R10G10B10A2_UNORM:  value = XMLoadUDecN4(reinterpret_cast<const XMUDECN4*>(ptr)); break;
+            case DXGI_FORMAT_R11G11B10_FLOAT:    value = XMLoadFloat3PK(reinterpret_cast<const XMFLOAT3PK*>(ptr)); break;
+            case DXGI_FORMAT_R8G8B8A8_SNORM:     value = XMLoadByteN4(reinterpret_cast<const XMBYTEN4*>(ptr)); break;
+            case DXGI_FORMAT_R8G8B8A8_UNORM:     value = XMLoadUByteN4(reinterpret_cast<const XMUBYTEN4*>(ptr)); break;
+            case DXGI_FORMAT_B8G8R8A8_UNORM:     value = XMLoadColor(reinterpret_cast<const XMCOLOR*>(ptr)); break;
+
+            default:
+                value = XMVectorZero();
+                return false;
+            }
+
+            return true;
+        }
+
+
+        //--------------------------------------------------------------------------------------
+        // Adds the triangles of a mesh part to picking geometry from CPU copies of its vertex
+        // and index buffers, laid out as described by vbDecl and vertexStride. Positions
+        // compacted to SNORM16 are decoded with the mesh's positionScale and positionBias.
+        // Returns false for parts that are not triangle lists with float3 or compacted positions.
+        //--------------------------------------------------------------------------------------
+        inline bool AddPartGeometry(
+            ModelMeshGeometry& geometry,
+            uint32_t partIndex,
+            const ModelMesh& mesh,
+            const ModelMeshPart& part,
+            const ModelMeshPart::InputLayoutCollection& vbDecl,
+            uint32_t vertexStride,
+            _In_reads_bytes_(vbSize) const uint8_t* vbData, size_t vbSize,
+            _In_reads_bytes_(ibSize) const uint8_t* ibData, size_t ibSize)
+        {
+            if (part.primitiveType != D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+                || !vertexStride || part.vertexOffset < 0 || part.indexCount < 3)
+                return false;
+
+            uint32_t offset = 0;
+            DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+            if (!FindPositionElement(vbDecl, offset, format))
+                return false;
+
+            size_t positionSize = 0;
+            switch (format)
+            {
+            case DXGI_FORMAT_R32G32B32_FLOAT:
+            case DXGI_FORMAT_R32G32B32A32_FLOAT:
+                positionSize = sizeof(XMFLOAT3);
+                break;
+
+            case DXGI_FORMAT_R16G16B16A16_SNORM:
+                positionSize = sizeof(PackedVector::XMSHORTN4);
+                break;
+
+            default:
+                return false;
+            }
+
+            if (offset + positionSize > vertexStride)
+                return false;
+
+            const size_t indexSize = (part.indexFormat == DXGI_FORMAT_R32_UINT) ? sizeof(uint32_t) : sizeof(uint16_t);
+
+            if ((uint64_t(part.startIndex) + uint64_t(part.indexCount)) * indexSize > ibSize)
+                throw std::out_of_range("Mesh part indices exceed index buffer");
+
+            const size_t totalVerts = vbSize / vertexStride;
+            const auto firstVertex = static_cast<size_t>(part.vertexOffset);
+            if (firstVertex >= totalVerts)
+                throw std::out_of_range("Mesh part vertices exceed vertex buffer");
+
+            const uint8_t* positions = vbData + firstVertex * vertexStride + offset;
+            size_t positionStride = vertexStride;
+            const size_t nVerts = totalVerts - firstVertex;
+
+            std::vector<XMFLOAT3> decoded;
+            if (format == DXGI_FORMAT_R16G16B16A16_SNORM)
+            {
+                const XMVECTOR scale = XMVectorReplicate(mesh.positionScale);
+                const XMVECTOR bias = XMLoadFloat3(&mesh.positionBias);
+
+                decoded.resize(nVerts);
+                for (size_t j = 0; j < nVerts; ++j)
+                {
+                    XMVECTOR v;
+                    (void)LoadVertexElement(positions + j * vertexStride, format, v);
+                    XMStoreFloat3(&decoded[j], XMVectorMultiplyAdd(v, scale, bias));
+                }
+
+                positions = reinterpret_cast<const uint8_t*>(decoded.data());
+                positionStride = sizeof(XMFLOAT3);
+            }
+
+            const size_t nFaces = part.indexCount / 3;
+
+            if (indexSize == sizeof(uint32_t))
+            {
+                geometry.AddTriangles(partIndex,
+                    reinterpret_cast<const uint32_t*>(ibData + size_t(part.startIndex) * indexSize), nFaces,
+                    positions, positionStride, nVerts);
+            }
+            else
+            {
+                geometry.AddTriangles(partIndex,
+                    reinterpret_cast<const uint16_t*>(ibData + size_t(part.startIndex) * indexSize), nFaces,
+                    positions, positionStride, nVerts);
+            }
+
+            return true;
+        }
+
+
+        //--------------------------------------------------------------------------------------
+        // Load-time vertex compaction (ModelLoader_CompactVertices). Streams with BLENDINDICES
+        // keep float positions, normals and tangents for the skinning paths.
+        //--------------------------------------------------------------------------------------
+        enum COMPACT_VERTEX_OPTIONS : unsigned int
+        {
+            COMPACT_POSITIONS = 0x1,        // float3 to SNORM16 using a scale and bias from PositionBounds
+            COMPACT_NORMALS = 0x2,          // float3 normals to SNORM16, tangents and binormals to SNORM8
+            COMPACT_BIASED_NORMALS = 0x4,   // normals to UNORM 10:10:10:2 instead, for effects with biased normals
+            COMPACT_TEXCOORDS = 0x8,        // float2 to UNORM16 when every value is within [0, 1]
+        };
+
+        inline bool IsSkinnedVertexStream(const ModelMeshPart::InputLayoutCollection& decl) noexcept
+        {
+            uint32_t offset = 0;
+            DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+            return FindVertexElement(decl, "BLENDINDICES", 0, offset, format);
+        }
+
+        // Gathers the extents of the float3 positions of one or more vertex streams
+        class PositionBounds
+        {
+        public:
+            PositionBounds() noexcept :
+                mMin(FLT_MAX, FLT_MAX, FLT_MAX),
+                mMax(-FLT_MAX, -FLT_MAX, -FLT_MAX)
+            {
+            }
+
+            void Add(
+                const ModelMeshPart::InputLayoutCollection& decl,
+                uint32_t vertexStride,
+                _In_reads_bytes_(nVerts * vertexStride) const uint8_t* vertices,
+                size_t nVerts) noexcept
+            {
+                uint32_t offset = 0;
+                DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+                if (!FindPositionElement(decl, offset, format)
+                    || format != DXGI_FORMAT_R32G32B32_FLOAT
+                    || offset + sizeof(XMFLOAT3) > vertexStride
+                    || IsSkinnedVertexStream(decl))
+                    return;
+
+                XMVECTOR vmin = XMLoadFloat3(&mMin);
+                XMVECTOR vmax = XMLoadFloat3(&mMax);
+
+                auto ptr = vertices + offset;
+                for (size_t j = 0; j < nVerts; ++j, ptr += vertexStride)
+                {
+                    const XMVECTOR p = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(ptr));
+                    vmin = XMVectorMin(vmin, p);
+                    vmax = XMVectorMax(vmax, p);
+                }
+
+                XMStoreFloat3(&mMin, vmin);
+                XMStoreFloat3(&mMax, vmax);
+            }
+
+            // Returns false if there were no positions to compact. Positions are encoded as
+            // (p - bias) / scale; the scale is uniform so normals are unaffected by the decode.
+            bool GetScaleBias(float& scale, XMFLOAT3& bias) const noexcept
+            {
+                scale = 1.f;
+                bias = XMFLOAT3(0.f, 0.f, 0.f);
+
+                if (mMin.x > mMax.x)
+                    return false;
+
+                const XMVECTOR vmin = XMLoadFloat3(&mMin);
+                const XMVECTOR vmax = XMLoadFloat3(&mMax);
+
+                XMFLOAT3 extents;
+                XMStoreFloat3(&extents, XMVectorScale(XMVectorSubtract(vmax, vmin), 0.5f));
+                XMStoreFloat3(&bias, XMVectorScale(XMVectorAdd(vmin, vmax), 0.5f));
+
+                const float halfSize = std::max(std::max(extents.x, extents.y), extents.z);
+                if (!std::isfinite(halfSize))
+                {
+                    bias = XMFLOAT3(0.f, 0.f, 0.f);
+                    return false;
+                }
+
+                if (halfSize > 0.f)
+                {
+                    scale = halfSize;
+                }
+
+                return true;
+            }
+
+        private:
+            XMFLOAT3    mMin;
+            XMFLOAT3    mMax;
+        };
+
+        // Rewrites a single-slot vertex stream with the compact encodings selected by 'options'.
+        // Returns false, leaving the outputs empty, when no element changed. 'biasedNormals' is
+        // set when normals were written for decoding with BiasX2.
+        inline bool CompactVertices(
+            const ModelMeshPart::InputLayoutCollection& decl,
+            uint32_t vertexStride,
+            _In_reads_bytes_(nVerts * vertexStride) const uint8_t* vertices,
+            size_t nVerts,
+            unsigned int options,
+            float positionScale,
+            const XMFLOAT3& positionBias,
+            ModelMeshPart::InputLayoutCollection& compactDecl,
+            uint32_t& compactStride,
+            std::vector<uint8_t>& compactVertices,
+            bool& biasedNormals)
+        {
+            using namespace DirectX::PackedVector;
+
+            compactDecl.clear();
+            compactStride = 0;
+            compactVertices.clear();
+            biasedNormals = false;
+
+            if (!vertexStride || !nVerts || !vertices)
+                return false;
+
+            if (IsSkinnedVertexStream(decl))
+            {
+                options &= COMPACT_TEXCOORDS;
+            }
+
+            enum class Encoding { Copy, Position, Normal, BiasedNormal, Tangent, TexCoord };
+
+            struct Element
+            {
+                Encoding    encoding;
+                uint32_t    srcOffset;
+                uint32_t    srcSize;
+                uint32_t    dstOffset;
+                uint32_t    dstSize;
+            };
+
+            std::vector<Element> elements;
+            elements.reserve(decl.size());
+
+            bool changed = false;
+            uint32_t srcOffset = 0;
+            uint32_t dstOffset = 0;
+            for (const auto& it : decl)
+            {
+                if (it.InputSlot != 0 || it.InputSlotClass != D3D11_INPUT_PER_VERTEX_DATA)
+                    return false;
+
+                if (it.AlignedByteOffset != D3D11_APPEND_ALIGNED_ELEMENT)
+                    srcOffset = it.AlignedByteOffset;
+
+                const auto srcSize = static_cast<uint32_t>(LoaderHelpers::BitsPerPixel(it.Format) / 8);
+                if (!srcSize || uint64_t(srcOffset) + srcSize > vertexStride)
+                    return false;
+
+                Element element = { Encoding::Copy, srcOffset, srcSize, 0, srcSize };
+                D3D11_INPUT_ELEMENT_DESC desc = it;
+
+                const bool isPosition = (_stricmp(it.SemanticName, "SV_Position") == 0 || _stricmp(it.SemanticName, "POSITION") == 0)
+                    && it.SemanticIndex == 0;
+
+                if (isPosition && (options & COMPACT_POSITIONS) && it.Format == DXGI_FORMAT_R32G32B32_FLOAT)
+                {
+                    element.encoding = Encoding::Position;
+                    desc.Format = DXGI_FORMAT_R16G16B16A16_SNORM;
+                }
+                else if (_stricmp(it.SemanticName, "NORMAL") == 0
+                    && (options & COMPACT_NORMALS) && it.Format == DXGI_FORMAT_R32G32B32_FLOAT)
+                {
+                    if (options & COMPACT_BIASED_NORMALS)
+                    {
+                        element.encoding = Encoding::BiasedNormal;
+                        desc.Format = DXGI_FORMAT_R10G10B10A2_UNORM;
+                    }
+                    else
+                    {
+                        element.encoding = Encoding::Normal;
+                        desc.Format = DXGI_FORMAT_R16G16B16A16_SNORM;
+                    }
+                }
+                else if ((_stricmp(it.SemanticName, "TANGENT") == 0 || _stricmp(it.SemanticName, "BINORMAL") == 0)
+                    && (options & COMPACT_NORMALS)
+                    && (it.Format == DXGI_FORMAT_R32G32B32_FLOAT || it.Format == DXGI_FORMAT_R32G32B32A32_FLOAT))
+                {
+                    element.encoding = Encoding::Tangent;
+                    desc.Format = DXGI_FORMAT_R8G8B8A8_SNORM;
+                }
+                else if (_stricmp(it.SemanticName, "TEXCOORD") == 0
+                    && (options & COMPACT_TEXCOORDS) && it.Format == DXGI_FORMAT_R32G32_FLOAT)
+                {
+                    bool inRange = true;
+                    auto ptr = vertices + srcOffset;
+                    for (size_t j = 0; j < nVerts && inRange; ++j, ptr += vertexStride)
+                    {
+                        XMFLOAT2 uv;
+                        memcpy(&uv, ptr, sizeof(XMFLOAT2));
+                        inRange = (uv.x >= 0.f && uv.x <= 1.f && uv.y >= 0.f && uv.y <= 1.f);
+                    }
+
+                    if (inRange)
+                    {
+                        element.encoding = Encoding::TexCoord;
+                        desc.Format = DXGI_FORMAT_R16G16_UNORM;
+                    }
+                }
+
+                if (element.encoding != Encoding::Copy)
+                {
+                    changed = true;
+                    element.dstSize = static_cast<uint32_t>(LoaderHelpers::BitsPerPixel(desc.Format) / 8);
+                }
+
+                // The compact formats are all multiples of 4 bytes, so offsets stay aligned
+                element.dstOffset = dstOffset;
+                desc.AlignedByteOffset = dstOffset;
+                dstOffset += element.dstSize;
+
+                elements.push_back(element);
+                compactDecl.push_back(desc);
+
+                srcOffset += srcSize;
+            }
+
+            if (!changed)
+            {
+                compactDecl.clear();
+                return false;
+            }
+
+            compactStride = (dstOffset + 3u) & ~3u;
+            compactVertices.resize(nVerts * compactStride);
+
+            const XMVECTOR invScale = XMVectorReplicate(1.f / positionScale);
+            const XMVECTOR bias = XMLoadFloat3(&positionBias);
+
+            for (size_t j = 0; j < nVerts; ++j)
+            {
+                auto src = vertices + j * vertexStride;
+                auto dst = compactVertices.data() + j * compactStride;
+
+                for (const auto& element : elements)
+                {
+                    auto sptr = src + element.srcOffset;
+                    auto dptr = dst + element.dstOffset;
+
+                    switch (element.encoding)
+                    {
+                    case Encoding::Position:
+                        {
+                            XMVECTOR v = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(sptr));
+                            v = XMVectorMultiply(XMVectorSubtract(v, bias), invScale);
+                            v = XMVectorSelect(g_XMOne, v, g_XMSelect1110);
+                            XMStoreShortN4(reinterpret_cast<XMSHORTN4*>(dptr), v);
+                        }
+                        break;
+
+                    case Encoding::Normal:
+                        {
+                            const XMVECTOR v = XMVector3Normalize(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(sptr)));
+                            XMStoreShortN4(reinterpret_cast<XMSHORTN4*>(dptr), XMVectorSelect(g_XMZero, v, g_XMSelect1110));
+                        }
+                        break;
+
+                    case Encoding::BiasedNormal:
+                        {
+                            XMVECTOR v = XMVector3Normalize(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(sptr)));
+                            v = XMVectorMultiplyAdd(v, g_XMOneHalf, g_XMOneHalf);
+                            XMStoreUDecN4(reinterpret_cast<XMUDECN4*>(dptr), XMVectorSelect(g_XMZero, v, g_XMSelect1110));
+                        }
+                        break;
+
+                    case Encoding::Tangent:
+                        {
+                            XMVECTOR v;
+                            if (element.srcSize == sizeof(XMFLOAT4))
+                            {
+                                // Keep the handedness in w
+                                v = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(sptr));
+                                v = XMVectorSelect(v, XMVector3Normalize(v), g_XMSelect1110);
+                            }
+                            else
+                            {
+                                v = XMVector3Normalize(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(sptr)));
+                                v = XMVectorSelect(g_XMZero, v, g_XMSelect1110);
+                            }
+                            XMStoreByteN4(reinterpret_cast<XMBYTEN4*>(dptr), v);
+                        }
+                        break;
+
+                    case Encoding::TexCoord:
+                        XMStoreUShortN2(reinterpret_cast<XMUSHORTN2*>(dptr), XMLoadFloat2(reinterpret_cast<const XMFLOAT2*>(sptr)));
+                        break;
+
+                    default:
+                        memcpy(dptr, sptr, element.srcSize);
+                        break;
+                    }
+                }
+            }
+
+            biasedNormals = std::any_of(elements.cbegin(), elements.cend(),
+                [](const Element& element) noexcept { return element.encoding == Encoding::BiasedNormal; });
+
+            return true;
+        }
+
+
+        //--------------------------------------------------------------------------------------
+        // Merges runs of adjacent mesh parts that draw with the same state into single parts at
+        // load time (ModelLoader_MergeParts). Parts are added in draw order; a run continues while
+        // the key and index buffer match and the indices, rebased to the lowest base vertex of
+        // the run, still fit the index format. The index buffers are rewritten so every merged
+        // part covers a contiguous range, which keeps the triangles and their order unchanged.
+        //--------------------------------------------------------------------------------------
+        class PartMerger
+        {
+        public:
+            struct Range
+            {
+                uint32_t    startIndex;
+                uint32_t    indexCount;
+                int32_t     vertexOffset;
+                uint32_t    vertexCount;
+            };
+
+            // 'key' must identify the mesh, effect, input layout and vertex buffer of the part.
+            // Parts that are not triangle lists are added with 'mergeable' false.
+            void AddPart(
+                uint32_t indexBuffer,
+                _In_reads_bytes_(ibSize) const uint8_t* ibData, size_t ibSize, bool use32bit,
+                uint32_t startIndex, uint32_t indexCount, int32_t vertexOffset,
+                uint64_t key, bool mergeable)
+            {
+                assert(ibData != nullptr);
+
+                const size_t indexSize = use32bit ? sizeof(uint32_t) : sizeof(uint16_t);
+                if ((uint64_t(startIndex) + uint64_t(indexCount)) * indexSize > ibSize)
+                    throw std::out_of_range("Mesh part indices exceed index buffer");
+
+                Part part = { ibData + size_t(startIndex) * indexSize, indexCount, vertexOffset };
+
+                uint32_t maxIndex = 0;
+                for (size_t j = 0; j < indexCount; ++j)
+                {
+                    maxIndex = std::max(maxIndex, ReadIndex(part.indices, j, use32bit));
+                }
+
+                const int64_t lastVertex = int64_t(maxIndex) + vertexOffset;
+
+                if (mergeable && !mGroups.empty())
+                {
+                    auto& g = mGroups.back();
+                    if (g.mergeable && g.key == key && g.indexBuffer == indexBuffer && g.use32bit == use32bit
+                        && uint64_t(g.indexCount) + indexCount <= UINT32_MAX)
+                    {
+                        const int32_t base = std::min(g.vertexOffset, vertexOffset);
+                        const int64_t limit = use32bit ? int64_t(UINT32_MAX) : int64_t(UINT16_MAX);
+                        if (std::max(g.lastVertex, lastVertex) - base <= limit)
+                        {
+                            g.vertexOffset = base;
+                            g.lastVertex = std::max(g.lastVertex, lastVertex);
+                            g.indexCount += indexCount;
+                            ++g.partCount;
+
+                            mParts.push_back(part);
+                            mPartGroups.push_back(static_cast<uint32_t>(mGroups.size() - 1));
+                            return;
+                        }
+                    }
+                }
+
+                Group g = {};
+                g.key = key;
+                g.indexBuffer = indexBuffer;
+                g.use32bit = use32bit;
+                g.mergeable = mergeable;
+                g.vertexOffset = vertexOffset;
+                g.lastVertex = lastVertex;
+                g.indexCount = indexCount;
+                g.firstPart = mParts.size();
+                g.partCount = 1;
+                mGroups.push_back(g);
+
+                mParts.push_back(part);
+                mPartGroups.push_back(static_cast<uint32_t>(mGroups.size() - 1));
+            }
+
+            // Builds the new contents of an index buffer and assigns the ranges of its parts. Returns
+            // an empty buffer if no part uses it.
+            void MergeIndices(uint32_t indexBuffer, std::vector<uint8_t>& data)
+            {
+                data.clear();
+
+                size_t count = 0;
+                for (auto& g : mGroups)
+                {
+                    if (g.indexBuffer != indexBuffer)
+                        continue;
+
+                    if (count + g.indexCount > UINT32_MAX)
+                        throw std::overflow_error("Merged index buffer too large");
+
+                    const size_t indexSize = g.use32bit ? sizeof(uint32_t) : sizeof(uint16_t);
+
+                    g.startIndex = static_cast<uint32_t>(count);
+                    data.resize((count + g.indexCount) * indexSize);
+
+                    auto dest = data.data() + count * indexSize;
+                    for (size_t k = 0; k < g.partCount; ++k)
+                    {
+                        const auto& part = mParts[g.firstPart + k];
+                        const auto rebase = static_cast<uint32_t>(part.vertexOffset - g.vertexOffset);
+
+                        for (size_t j = 0; j < part.indexCount; ++j, dest += indexSize)
+                        {
+                            const uint32_t index = ReadIndex(part.indices, j, g.use32bit) + rebase;
+                            if (g.use32bit)
+                            {
+                                memcpy(dest, &index, sizeof(uint32_t));
+                            }
+                            else
+                            {
+                                const auto index16 = static_cast<uint16_t>(index);
+                                memcpy(dest, &index16, sizeof(uint16_t));
+                            }
+                        }
+                    }
+
+                    count += g.indexCount;
+                }
+            }
+
+            // Only the first part of each run is created; the others are drawn by it
+            bool IsFirstInGroup(size_t part) const
+            {
+                return mGroups[mPartGroups.at(part)].firstPart == part;
+            }
+
+            // Valid once MergeIndices has been called for the part's index buffer
+            Range GetRange(size_t part) const
+            {
+                const auto& g = mGroups[mPartGroups.at(part)];
+                return Range{ g.startIndex, g.indexCount, g.vertexOffset, static_cast<uint32_t>(g.lastVertex - g.vertexOffset + 1) };
+            }
+
+        private:
+            struct Part
+            {
+                const uint8_t*  indices;
+                uint32_t        indexCount;
+                int32_t         vertexOffset;
+            };
+
+            struct Group
+            {
+                uint64_t    key;
+                uint32_t    indexBuffer;
+                bool        use32bit;
+                bool        mergeable;
+                int32_t     vertexOffset;
+                int64_t     lastVertex;
+                uint32_t    startIndex;
+                uint32_t    indexCount;
+                size_t      firstPart;
+                size_t      partCount;
+            };
+
+            static uint32_t ReadIndex(_In_ const uint8_t* indices, size_t j, bool use32bit) noexcept
+            {
+                if (use32bit)
+                {
+                    uint32_t index;
+                    memcpy(&index, indices + j * sizeof(uint32_t), sizeof(uint32_t));
+                    return index;
+                }
+
+                uint16_t index16;
+                memcpy(&index16, indices + j * sizeof(uint16_t), sizeof(uint16_t));
+                return index16;
+            }
+
+            std::vector<Part>       mParts;
+            std::vector<uint32_t>   mPartGroups;
+            std::vector<Group>      mGroups;
+        };
+
+
+        //--------------------------------------------------------------------------------------
+        // Records the textures a loader requests from the effect factory in Model::textureNames
+        //--------------------------------------------------------------------------------------
+        inline void RecordTextureName(std::vector<std::wstring>& names, _In_opt_z_ const wchar_t* name)
+        {
+            if (name && *name && std::find(names.cbegin(), names.cend(), name) == names.cend())
+            {
+                names.emplace_back(name);
+            }
+        }
+
+        inline void RecordTextureNames(std::vector<std::wstring>& names, const IEffectFactory::EffectInfo& info)
+        {
+            RecordTextureName(names, info.diffuseTexture);
+            RecordTextureName(names, info.specularTexture);
+            RecordTextureName(names, info.normalTexture);
+            RecordTextureName(names, info.emissiveTexture);
+        }
+    }
+}
@@ -0,0 +1,353 @@
+//--------------------------------------------------------------------------------------
+// File: ModelInstancing.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "Model.h"
+#include "CommonStates.h"
+#include "DirectXHelpers.h"
+#include "Effects.h"
+#include "PlatformHelpers.h"
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    // Per-instance data is a transposed 3x4 world matrix, optionally followed by a color
+    constexpr UINT c_InstanceTransformSize = sizeof(XMFLOAT3X4);
+    constexpr UINT c_InstanceColorSize = sizeof(XMUBYTEN4);
+
+    constexpr size_t c_MinInstanceBufferSize = 64 * 1024;
+
+    const D3D11_INPUT_ELEMENT_DESC c_InstanceElements[] =
+    {
+        { "InstMatrix", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0,  D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "InstMatrix", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "InstMatrix", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+    };
+
+    const D3D11_INPUT_ELEMENT_DESC c_InstanceColorElement =
+        { "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 1, c_InstanceTransformSize, D3D11_INPUT_PER_INSTANCE_DATA, 1 };
+
+    static_assert(c_InstanceTransformSize == 48, "Instance transform size mismatch");
+}
+
+
+//--------------------------------------------------------------------------------------
+// ModelInstanceBuffer
+//--------------------------------------------------------------------------------------
+
+class ModelInstanceBuffer::Impl
+{
+public:
+    Impl() noexcept :
+        capacity(0),
+        position(0)
+    {
+    }
+
+    ComPtr<ID3D11Buffer>    buffer;
+    size_t                  capacity;
+    size_t                  position;
+
+    UINT Write(
+        _In_ ID3D11DeviceContext* deviceContext,
+        size_t instanceCount,
+        _In_reads_(instanceCount) const XMMATRIX* instanceTransforms,
+        _In_reads_opt_(instanceCount) const XMFLOAT4* instanceColors);
+
+    ID3D11InputLayout* GetInputLayout(
+        _In_ ID3D11Device* device,
+        const ModelMeshPart& part,
+        bool color);
+
+    void Reset() noexcept
+    {
+        buffer.Reset();
+        capacity = position = 0;
+        layouts.clear();
+    }
+
+private:
+    // Layouts are keyed by the declaration and effect that own them rather than by the part,
+    // so a part freed and reallocated at the same address cannot pick up a stale layout
+    struct LayoutKey
+    {
+        std::weak_ptr<ModelMeshPart::InputLayoutCollection> vbDecl;
+        std::weak_ptr<IEffect>                              effect;
+        bool                                                color;
+
+        bool operator< (const LayoutKey& other) const noexcept
+        {
+            if (vbDecl.owner_before(other.vbDecl))
+                return true;
+            if (other.vbDecl.owner_before(vbDecl))
+                return false;
+            if (effect.owner_before(other.effect))
+                return true;
+            if (other.effect.owner_before(effect))
+                return false;
+            return !color && other.color;
+        }
+
+        bool Expired() const noexcept { return vbDecl.expired() || effect.expired(); }
+    };
+
+    std::map<LayoutKey, ComPtr<ID3D11InputLayout>> layouts;
+};
+
+
+// Appends instance data to the ring buffer, returning the byte offset it was written to.
+_Use_decl_annotations_
+UINT ModelInstanceBuffer::Impl::Write(
+    ID3D11DeviceContext* deviceContext,
+    size_t instanceCount,
+    const XMMATRIX* instanceTransforms,
+    const XMFLOAT4* instanceColors)
+{
+    const size_t stride = c_InstanceTransformSize + (instanceColors ? c_InstanceColorSize : 0);
+    const size_t bytes = instanceCount * stride;
+
+    if (bytes > capacity)
+    {
+        size_t newCapacity = std::max(capacity * 2, c_MinInstanceBufferSize);
+        while (newCapacity < bytes)
+            newCapacity *= 2;
+
+        if (newCapacity > D3D11_REQ_RESOURCE_SIZE_IN_MEGABYTES_EXPRESSION_A_TERM * 1024u * 1024u)
+            throw std::out_of_range("Too many instances for instance buffer");
+
+        ComPtr<ID3D11Device> device;
+        deviceContext->GetDevice(&device);
+
+        D3D11_BUFFER_DESC desc = {};
+        desc.ByteWidth = static_cast<UINT>(newCapacity);
+        desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+        desc.Usage = D3D11_USAGE_DYNAMIC;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+        ThrowIfFailed(device->CreateBuffer(&desc, nullptr, buffer.ReleaseAndGetAddressOf()));
+
+        SetDebugObjectName(buffer.Get(), "DirectXTK:ModelInstancing");
+
+        capacity = newCapacity;
+        position = 0;
+    }
+
+    // Deferred contexts must start each command list with a discard.
+    D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+    if (!position
+        || position + bytes > capacity
+        || deviceContext->GetType() == D3D11_DEVICE_CONTEXT_DEFERRED)
+    {
+        mapType = D3D11_MAP_WRITE_DISCARD;
+        position = 0;
+    }
+
+    D3D11_MAPPED_SUBRESOURCE mapped = {};
+    ThrowIfFailed(deviceContext->Map(buffer.Get(), 0, mapType, 0, &mapped));
+
+    auto dest = static_cast<uint8_t*>(mapped.pData) + position;
+    for (size_t j = 0; j < instanceCount; ++j, dest += stride)
+    {
+        // XMStoreFloat3x4 transposes into the row layout expected by the InstMatrix input
+        XMStoreFloat3x4(reinterpret_cast<XMFLOAT3X4*>(dest), instanceTransforms[j]);
+
+        if (instanceColors)
+        {
+            XMStoreUByteN4(reinterpret_cast<XMUBYTEN4*>(dest + c_InstanceTransformSize),
+                XMLoadFloat4(&instanceColors[j]));
+        }
+    }
+
+    deviceContext->Unmap(buffer.Get(), 0);
+
+    const auto offset = static_cast<UINT>(position);
+    position += bytes;
+    return offset;
+}
+
+
+// Returns the instancing input layout for a part's declaration and effect, creating it on first use.
+_Use_decl_annotations_
+ID3D11InputLayout* ModelInstanceBuffer::Impl::GetInputLayout(
+    ID3D11Device* device,
+    const ModelMeshPart& part,
+    bool color)
+{
+    if (!part.vbDecl || part.vbDecl->empty())
+        throw std::runtime_error("Model mesh part missing vertex buffer input elements data");
+
+    LayoutKey key = { part.vbDecl, part.effect, color };
+
+    auto it = layouts.find(key);
+    if (it != layouts.end())
+        return it->second.Get();
+
+    ModelMeshPart::InputLayoutCollection desc(*part.vbDecl);
+    desc.insert(desc.end(), std::cbegin(c_InstanceElements), std::cend(c_InstanceElements));
+
+    if (color)
+    {
+        const bool hasColor = std::any_of(part.vbDecl->cbegin(), part.vbDecl->cend(),
+            [](const D3D11_INPUT_ELEMENT_DESC& element) noexcept
+            {
+                return _stricmp(element.SemanticName, "COLOR") == 0 && element.SemanticIndex == 0;
+            });
+
+        if (hasColor)
+        {
+            DebugTrace("WARNING: Model::DrawInstanced ignoring instance colors for a mesh part with vertex colors\n");
+        }
+        else
+        {
+            desc.push_back(c_InstanceColorElement);
+        }
+    }
+
+    if (desc.size() > 32 /* D3D11_IA_VERTEX_INPUT_STRUCTURE_ELEMENT_COUNT */)
+        throw std::runtime_error("Model mesh part input layout size is too large for DirectX 11");
+
+    ComPtr<ID3D11InputLayout> inputLayout;
+    ThrowIfFailed(
+        CreateInputLayoutFromEffect(device, part.effect.get(), desc.data(), desc.size(), inputLayout.GetAddressOf())
+    );
+
+    SetDebugObjectName(inputLayout.Get(), "DirectXTK:ModelInstancing");
+
+    // Drop layouts for declarations and effects that no longer exist
+    for (auto lit = layouts.begin(); lit != layouts.end();)
+    {
+        lit = lit->first.Expired() ? layouts.erase(lit) : std::next(lit);
+    }
+
+    layouts.emplace(std::move(key), inputLayout);
+    return inputLayout.Get();
+}
+
+
+ModelInstanceBuffer::ModelInstanceBuffer() noexcept(false) :
+    pImpl(std::make_unique<Impl>())
+{
+}
+
+
+ModelInstanceBuffer::ModelInstanceBuffer(ModelInstanceBuffer&&) noexcept = default;
+ModelInstanceBuffer& ModelInstanceBuffer::operator= (ModelInstanceBuffer&&) noexcept = default;
+ModelInstanceBuffer::~ModelInstanceBuffer() = default;
+
+
+void ModelInstanceBuffer::Reset() noexcept
+{
+    pImpl->Reset();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Model
+//--------------------------------------------------------------------------------------
+
+// Draw all meshes in model once per instance.
+_Use_decl_annotations_
+void XM_CALLCONV Model::DrawInstanced(
+    ID3D11DeviceContext* deviceContext,
+    const CommonStates& states,
+    ModelInstanceBuffer& instanceBuffer,
+    size_t instanceCount,
+    const XMMATRIX* instanceTransforms,
+    FXMMATRIX view,
+    CXMMATRIX projection,
+    const XMFLOAT4* instanceColors,
+    bool wireframe,
+    std::function<void()> setCustomState) const
+{
+    assert(deviceContext != nullptr);
+
+    if (!instanceCount)
+        return;
+
+    if (!instanceTransforms)
+    {
+        throw std::invalid_argument("Instance transforms array required");
+    }
+
+    if (instanceCount > UINT32_MAX)
+    {
+        throw std::out_of_range("Too many instances");
+    }
+
+    // Checked before anything is drawn, so an unsupported mesh never leaves a frame half drawn
+    for (const auto& mit : meshes)
+    {
+        auto mesh = mit.get();
+        assert(mesh != nullptr);
+
+        if (mesh->positionScale != 1.f
+            || mesh->positionBias.x != 0.f || mesh->positionBias.y != 0.f || mesh->positionBias.z != 0.f)
+        {
+            // The instance transform is applied before the world matrix that would decode these
+            throw std::runtime_error("DrawInstanced does not support meshes loaded with ModelLoader_CompactVertices");
+        }
+    }
+
+    auto instancing = instanceBuffer.pImpl.get();
+    assert(instancing != nullptr);
+
+    const UINT instanceStride = c_InstanceTransformSize + (instanceColors ? c_InstanceColorSize : 0);
+    const UINT instanceOffset = instancing->Write(deviceContext, instanceCount, instanceTransforms, instanceColors);
+
+    ComPtr<ID3D11Device> device;
+    deviceContext->GetDevice(&device);
+
+    // Instance transforms take the place of the world matrix
+    const XMMATRIX world = XMMatrixIdentity();
+
+    // Draw opaque parts, then alpha parts
+    for (const bool alpha : { false, true })
+    {
+        for (const auto& mit : meshes)
+        {
+            auto mesh = mit.get();
+            assert(mesh != nullptr);
+
+            bool prepared = false;
+
+            for (const auto& it : mesh->meshParts)
+            {
+                auto part = it.get();
+                assert(part != nullptr);
+
+                if (part->isAlpha != alpha)
+                    continue;
+
+                if (!prepared)
+                {
+                    mesh->PrepareForRendering(deviceContext, states, alpha, wireframe);
+                    prepared = true;
+                }
+
+                auto inputLayout = instancing->GetInputLayout(device.Get(), *part, instanceColors != nullptr);
+
+                auto imatrices = part->GetEffectMatrices();
+                if (imatrices)
+                {
+                    imatrices->SetMatrices(world, view, projection);
+                }
+
+                // ModelMeshPart::DrawInstanced binds slot 0, leaving the instance data in slot 1
+                auto vertexBuffer = instancing->buffer.Get();
+                deviceContext->IASetVertexBuffers(1, 1, &vertexBuffer, &instanceStride, &instanceOffset);
+
+                part->DrawInstanced(deviceContext, part->effect.get(), inputLayout,
+                    static_cast<uint32_t>(instanceCount), 0, setCustomState);
+            }
+        }
+    }
+}
@@ -0,0 +1,808 @@
+//--------------------------------------------------------------------------------------
+// File: ModelLOD.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "ModelLOD.h"
+
+#include "BufferHelpers.h"
+#include "CommonStates.h"
+#include "DirectXHelpers.h"
+#include "Effects.h"
+#include "Model.h"
+#include "ModelHelpers.h"
+#include "PlatformHelpers.h"
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    //--------------------------------------------------------------------------------------
+    // Symmetric 4x4 error quadric: the sum of squared distances to a set of planes.
+    struct Quadric
+    {
+        double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+        void AddPlane(double a, double b, double c, double d) noexcept
+        {
+            a2 += a * a; ab += a * b; ac += a * c; ad += a * d;
+            b2 += b * b; bc += b * c; bd += b * d;
+            c2 += c * c; cd += c * d;
+            d2 += d * d;
+        }
+
+        void Add(const Quadric& q) noexcept
+        {
+            a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+            b2 += q.b2; bc += q.bc; bd += q.bd;
+            c2 += q.c2; cd += q.cd;
+            d2 += q.d2;
+        }
+
+        double Evaluate(const XMFLOAT3& p) const noexcept
+        {
+            const double x = p.x;
+            const double y = p.y;
+            const double z = p.z;
+
+            return a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x
+                + b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y
+                + c2 * z * z + 2.0 * cd * z
+                + d2;
+        }
+    };
+
+    struct Collapse
+    {
+        double      cost;
+        uint32_t    from;
+        uint32_t    to;
+        uint32_t    fromStamp;
+        uint32_t    toStamp;
+
+        bool operator > (const Collapse& other) const noexcept { return cost > other.cost; }
+    };
+
+    inline XMVECTOR FaceNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2) noexcept
+    {
+        const XMVECTOR v0 = XMLoadFloat3(&p0);
+        const XMVECTOR v1 = XMLoadFloat3(&p1);
+        const XMVECTOR v2 = XMLoadFloat3(&p2);
+
+        return XMVector3Cross(XMVectorSubtract(v1, v0), XMVectorSubtract(v2, v0));
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Half-edge collapse simplification (Garland & Heckbert quadrics restricted to the
+    // existing vertices). Collapses are taken cheapest first from a heap that is updated
+    // lazily: each vertex carries a stamp that is bumped when its neighborhood changes, and
+    // entries recorded with an older stamp are discarded when popped.
+    template<typename index_t>
+    float Simplify(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        _In_reads_bytes_(nVerts * vertexStride) const void* positions, size_t vertexStride, size_t nVerts,
+        size_t targetFaces,
+        float maxError,
+        std::vector<index_t>& simplifiedIndices)
+    {
+        if (!indices || !nFaces || !positions || !nVerts)
+            throw std::invalid_argument("Requires both vertices and indices");
+
+        if (vertexStride < sizeof(XMFLOAT3))
+            throw std::invalid_argument("Invalid vertex stride");
+
+        if (maxError < 0.f)
+            throw std::invalid_argument("Maximum error cannot be negative");
+
+        if (nFaces * 3 > UINT32_MAX || nVerts >= UINT32_MAX)
+            throw std::out_of_range("Too many faces or vertices");
+
+        std::vector<XMFLOAT3> pos(nVerts);
+        {
+            auto ptr = static_cast<const uint8_t*>(positions);
+            for (size_t j = 0; j < nVerts; ++j, ptr += vertexStride)
+            {
+                memcpy(&pos[j], ptr, sizeof(XMFLOAT3));
+            }
+        }
+
+        std::vector<uint32_t> faces(nFaces * 3);
+        for (size_t j = 0; j < nFaces * 3; ++j)
+        {
+            if (indices[j] >= nVerts)
+                throw std::out_of_range("Index not in vertices list");
+
+            faces[j] = static_cast<uint32_t>(indices[j]);
+        }
+
+        std::vector<uint8_t> faceAlive(nFaces, 1);
+        size_t faceCount = nFaces;
+
+        // Degenerate input triangles carry no surface, so they are dropped up front.
+        for (size_t face = 0; face < nFaces; ++face)
+        {
+            const uint32_t* f = &faces[face * 3];
+            if (f[0] == f[1] || f[1] == f[2] || f[0] == f[2])
+            {
+                faceAlive[face] = 0;
+                --faceCount;
+            }
+        }
+
+        // Vertices that share a position with another referenced vertex sit on an attribute seam.
+        std::vector<uint8_t> locked(nVerts, 0);
+        {
+            std::vector<uint32_t> used;
+            used.reserve(nVerts);
+            {
+                std::vector<uint8_t> referenced(nVerts, 0);
+                for (size_t face = 0; face < nFaces; ++face)
+                {
+                    if (!faceAlive[face])
+                        continue;
+
+                    for (size_t k = 0; k < 3; ++k)
+                    {
+                        const uint32_t v = faces[face * 3 + k];
+                        if (!referenced[v])
+                        {
+                            referenced[v] = 1;
+                            used.push_back(v);
+                        }
+                    }
+                }
+            }
+
+            auto less = [&pos](uint32_t a, uint32_t b) noexcept
+                {
+                    const XMFLOAT3& pa = pos[a];
+                    const XMFLOAT3& pb = pos[b];
+                    if (pa.x != pb.x)
+                        return pa.x < pb.x;
+                    if (pa.y != pb.y)
+                        return pa.y < pb.y;
+                    return pa.z < pb.z;
+                };
+
+            std::sort(used.begin(), used.end(), less);
+
+            for (size_t j = 1; j < used.size(); ++j)
+            {
+                if (!less(used[j - 1], used[j]))
+                {
+                    locked[used[j - 1]] = 1;
+                    locked[used[j]] = 1;
+                }
+            }
+        }
+
+        // Edges not shared by exactly two triangles lie on an open border or a non-manifold fan.
+        {
+            std::vector<uint64_t> edges;
+            edges.reserve(faceCount * 3);
+            for (size_t face = 0; face < nFaces; ++face)
+            {
+                if (!faceAlive[face])
+                    continue;
+
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    const uint32_t a = faces[face * 3 + k];
+                    const uint32_t b = faces[face * 3 + ((k + 1) % 3)];
+                    edges.push_back((uint64_t(std::min(a, b)) << 32) | std::max(a, b));
+                }
+            }
+
+            std::sort(edges.begin(), edges.end());
+
+            for (size_t j = 0; j < edges.size();)
+            {
+                size_t run = j + 1;
+                while (run < edges.size() && edges[run] == edges[j])
+                    ++run;
+
+                if (run - j != 2)
+                {
+                    locked[static_cast<uint32_t>(edges[j] >> 32)] = 1;
+                    locked[static_cast<uint32_t>(edges[j] & 0xFFFFFFFF)] = 1;
+                }
+
+                j = run;
+            }
+        }
+
+        // Per-vertex quadrics and vertex to triangle adjacency.
+        std::vector<Quadric> quadrics(nVerts, Quadric{});
+        std::vector<std::vector<uint32_t>> vertexFaces(nVerts);
+
+        for (size_t face = 0; face < nFaces; ++face)
+        {
+            if (!faceAlive[face])
+                continue;
+
+            const uint32_t* f = &faces[face * 3];
+
+            XMVECTOR n = FaceNormal(pos[f[0]], pos[f[1]], pos[f[2]]);
+            if (!XMVector3Less(XMVector3LengthSq(n), g_XMEpsilon))
+            {
+                n = XMVector3Normalize(n);
+
+                XMFLOAT3 plane;
+                XMStoreFloat3(&plane, n);
+                const double d = -(double(plane.x) * pos[f[0]].x + double(plane.y) * pos[f[0]].y + double(plane.z) * pos[f[0]].z);
+
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    quadrics[f[k]].AddPlane(plane.x, plane.y, plane.z, d);
+                }
+            }
+
+            for (size_t k = 0; k < 3; ++k)
+            {
+                vertexFaces[f[k]].push_back(static_cast<uint32_t>(face));
+            }
+        }
+
+        std::vector<uint32_t> stamps(nVerts, 0);
+        std::vector<uint8_t> vertexAlive(nVerts, 1);
+
+        std::vector<Collapse> heap;
+        heap.reserve(faceCount * 3);
+
+        auto push = [&](uint32_t from, uint32_t to)
+            {
+                if (locked[from])
+                    return;
+
+                Quadric q = quadrics[from];
+                q.Add(quadrics[to]);
+
+                heap.push_back(Collapse{ std::max(q.Evaluate(pos[to]), 0.0), from, to, stamps[from], stamps[to] });
+                std::push_heap(heap.begin(), heap.end(), std::greater<Collapse>());
+            };
+
+        for (size_t face = 0; face < nFaces; ++face)
+        {
+            if (!faceAlive[face])
+                continue;
+
+            for (size_t k = 0; k < 3; ++k)
+            {
+                const uint32_t a = faces[face * 3 + k];
+                const uint32_t b = faces[face * 3 + ((k + 1) % 3)];
+                push(a, b);
+                push(b, a);
+            }
+        }
+
+        const double maxCost = double(maxError) * double(maxError);
+        double resultCost = 0.0;
+
+        std::vector<uint32_t> neighbors;
+
+        while (faceCount > targetFaces && !heap.empty())
+        {
+            std::pop_heap(heap.begin(), heap.end(), std::greater<Collapse>());
+            const Collapse c = heap.back();
+            heap.pop_back();
+
+            if (!vertexAlive[c.from] || !vertexAlive[c.to]
+                || stamps[c.from] != c.fromStamp || stamps[c.to] != c.toStamp)
+                continue;
+
+            if (c.cost > maxCost)
+                break;
+
+            // Link condition: the two vertices may only share the neighbors opposite the
+            // edge, otherwise the collapse would pinch the surface into a non-manifold shape.
+            neighbors.clear();
+            for (const auto face : vertexFaces[c.to])
+            {
+                if (!faceAlive[face])
+                    continue;
+
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    const uint32_t v = faces[face * 3 + k];
+                    if (v != c.to)
+                        neighbors.push_back(v);
+                }
+            }
+
+            std::sort(neighbors.begin(), neighbors.end());
+            neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+
+            size_t sharedFaces = 0;
+            size_t sharedVerts = 0;
+            bool valid = true;
+
+            for (const auto face : vertexFaces[c.from])
+            {
+                if (!faceAlive[face])
+                    continue;
+
+                const uint32_t* f = &faces[face * 3];
+                if (f[0] == c.to || f[1] == c.to || f[2] == c.to)
+                {
+                    ++sharedFaces;
+                    continue;
+                }
+
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    if (f[k] != c.from && std::binary_search(neighbors.cbegin(), neighbors.cend(), f[k]))
+                        ++sharedVerts;
+                }
+
+                // Reject collapses that would flip or flatten a surviving triangle.
+                XMFLOAT3 moved[3] = { pos[f[0]], pos[f[1]], pos[f[2]] };
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    if (f[k] == c.from)
+                        moved[k] = pos[c.to];
+                }
+
+                const XMVECTOR before = FaceNormal(pos[f[0]], pos[f[1]], pos[f[2]]);
+                const XMVECTOR after = FaceNormal(moved[0], moved[1], moved[2]);
+
+                if (XMVector3Less(XMVector3LengthSq(after), g_XMEpsilon)
+                    || XMVectorGetX(XMVector3Dot(before, after)) <= 0.f)
+                {
+                    valid = false;
+                    break;
+                }
+            }
+
+            // Around an interior vertex each opposite vertex is met once more, in the face across
+            // the edge to it; any other common neighbor shows up twice.
+            if (!valid || sharedVerts > sharedFaces)
+                continue;
+
+            // Apply the collapse
+            auto& toFaces = vertexFaces[c.to];
+            for (const auto face : vertexFaces[c.from])
+            {
+                if (!faceAlive[face])
+                    continue;
+
+                uint32_t* f = &faces[face * 3];
+                if (f[0] == c.to || f[1] == c.to || f[2] == c.to)
+                {
+                    faceAlive[face] = 0;
+                    --faceCount;
+                    continue;
+                }
+
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    if (f[k] == c.from)
+                        f[k] = c.to;
+                }
+
+                toFaces.push_back(face);
+            }
+
+            vertexAlive[c.from] = 0;
+            vertexFaces[c.from].clear();
+            vertexFaces[c.from].shrink_to_fit();
+
+            toFaces.erase(std::remove_if(toFaces.begin(), toFaces.end(),
+                [&faceAlive](uint32_t face) noexcept { return !faceAlive[face]; }), toFaces.end());
+
+            quadrics[c.to].Add(quadrics[c.from]);
+            ++stamps[c.to];
+
+            resultCost = std::max(resultCost, c.cost);
+
+            for (const auto face : toFaces)
+            {
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    const uint32_t v = faces[face * 3 + k];
+                    if (v != c.to)
+                    {
+                        push(c.to, v);
+                        push(v, c.to);
+                    }
+                }
+            }
+        }
+
+        simplifiedIndices.clear();
+        simplifiedIndices.reserve(faceCount * 3);
+        for (size_t face = 0; face < nFaces; ++face)
+        {
+            if (!faceAlive[face])
+                continue;
+
+            for (size_t k = 0; k < 3; ++k)
+            {
+                simplifiedIndices.push_back(static_cast<index_t>(faces[face * 3 + k]));
+            }
+        }
+
+        return static_cast<float>(sqrt(resultCost));
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Mesh simplification
+//--------------------------------------------------------------------------------------
+
+_Use_decl_annotations_
+float DirectX::SimplifyMesh(
+    const uint16_t* indices, size_t nFaces,
+    const void* positions, size_t vertexStride, size_t nVerts,
+    size_t targetFaces,
+    float maxError,
+    std::vector<uint16_t>& simplifiedIndices)
+{
+    return Simplify(indices, nFaces, positions, vertexStride, nVerts, targetFaces, maxError, simplifiedIndices);
+}
+
+_Use_decl_annotations_
+float DirectX::SimplifyMesh(
+    const uint32_t* indices, size_t nFaces,
+    const void* positions, size_t vertexStride, size_t nVerts,
+    size_t targetFaces,
+    float maxError,
+    std::vector<uint32_t>& simplifiedIndices)
+{
+    return Simplify(indices, nFaces, positions, vertexStride, nVerts, targetFaces, maxError, simplifiedIndices);
+}
+
+
+//--------------------------------------------------------------------------------------
+// ModelLOD::Impl
+//--------------------------------------------------------------------------------------
+
+class ModelLOD::Impl
+{
+public:
+    struct Level
+    {
+        ComPtr<ID3D11Buffer>    indexBuffer;
+        uint32_t                indexCount;
+    };
+
+    Impl() noexcept = default;
+
+    void Create(ID3D11DeviceContext* deviceContext, const Model& model, size_t levelCount, float reduction, float maxError);
+
+    void DrawPart(
+        ID3D11DeviceContext* deviceContext,
+        const ModelMeshPart& part,
+        const Level& level,
+        std::function<void()>& setCustomState) const;
+
+    std::vector<std::shared_ptr<ModelMesh>>             meshes;
+    std::vector<float>                                  thresholds;
+
+    // Levels 1 and up of each simplified part; level 0 is the part itself
+    std::map<const ModelMeshPart*, std::vector<Level>>  parts;
+};
+
+
+void ModelLOD::Impl::Create(
+    ID3D11DeviceContext* deviceContext,
+    const Model& model,
+    size_t levelCount,
+    float reduction,
+    float maxError)
+{
+    meshes = model.meshes;
+
+    thresholds.resize(levelCount + 1);
+    thresholds[0] = 1.f;
+    for (size_t j = 1; j <= levelCount; ++j)
+    {
+        thresholds[j] = thresholds[j - 1] * 0.5f;
+    }
+
+    if (!levelCount)
+        return;
+
+    ComPtr<ID3D11Device> device;
+    deviceContext->GetDevice(&device);
+
+    // Parts frequently share a vertex buffer, so positions are read back once per buffer
+    using PositionKey = std::pair<ID3D11Buffer*, const ModelMeshPart::InputLayoutCollection*>;
+    std::map<PositionKey, std::vector<XMFLOAT3>> positionCache;
+
+    for (const auto& mit : meshes)
+    {
+        auto mesh = mit.get();
+        assert(mesh != nullptr);
+
+        for (const auto& it : mesh->meshParts)
+        {
+            auto part = it.get();
+            assert(part != nullptr);
+
+            if (part->primitiveType != D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+                || !part->indexBuffer || !part->vertexBuffer || !part->vbDecl || part->indexCount < 3)
+                continue;
+
+            uint32_t offset = 0;
+            DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+            if (!ModelHelpers::FindPositionElement(*part->vbDecl, offset, format)
+                || (format != DXGI_FORMAT_R32G32B32_FLOAT && format != DXGI_FORMAT_R32G32B32A32_FLOAT))
+            {
+                DebugTrace("WARNING: ModelLOD skipping mesh part without a float3 position\n");
+                continue;
+            }
+
+            auto& positions = positionCache[PositionKey(part->vertexBuffer.Get(), part->vbDecl.get())];
+            if (positions.empty())
+            {
+                ModelHelpers::ReadPartPositions(deviceContext, *part, positions);
+            }
+
+            std::vector<uint32_t> current;
+            ModelHelpers::ReadPartIndices(deviceContext, *part, current);
+            current.resize(current.size() - (current.size() % 3));
+
+            std::vector<Level> levels;
+            levels.reserve(levelCount);
+
+            std::vector<uint32_t> simplified;
+            for (size_t j = 0; j < levelCount; ++j)
+            {
+                const size_t nFaces = current.size() / 3;
+
+                if (nFaces > 1)
+                {
+                    auto target = static_cast<size_t>(float(nFaces) * reduction);
+                    SimplifyMesh(current.data(), nFaces,
+                        positions.data(), sizeof(XMFLOAT3), positions.size(),
+                        target, maxError, simplified);
+                }
+                else
+                {
+                    simplified = current;
+                }
+
+                // No further reduction was possible within the error limit
+                if (simplified.size() >= current.size() || simplified.empty())
+                {
+                    levels.push_back(levels.empty()
+                        ? Level{ nullptr, part->indexCount }
+                        : levels.back());
+                    continue;
+                }
+
+                std::swap(current, simplified);
+
+                // Store in the part's original index format, relative to its base vertex.
+                Level level = { nullptr, static_cast<uint32_t>(current.size()) };
+                if (part->indexFormat == DXGI_FORMAT_R32_UINT)
+                {
+                    std::vector<uint32_t> lod(current.size());
+                    for (size_t k = 0; k < current.size(); ++k)
+                    {
+                        lod[k] = static_cast<uint32_t>(int64_t(current[k]) - part->vertexOffset);
+                    }
+
+                    ThrowIfFailed(CreateStaticBuffer(device.Get(), lod, D3D11_BIND_INDEX_BUFFER, level.indexBuffer.GetAddressOf()));
+                }
+                else
+                {
+                    std::vector<uint16_t> lod(current.size());
+                    for (size_t k = 0; k < current.size(); ++k)
+                    {
+                        lod[k] = static_cast<uint16_t>(int64_t(current[k]) - part->vertexOffset);
+                    }
+
+                    ThrowIfFailed(CreateStaticBuffer(device.Get(), lod, D3D11_BIND_INDEX_BUFFER, level.indexBuffer.GetAddressOf()));
+                }
+
+                SetDebugObjectName(level.indexBuffer.Get(), "ModelLOD");
+
+                levels.emplace_back(std::move(level));
+            }
+
+            parts.emplace(part, std::move(levels));
+        }
+    }
+}
+
+
+void ModelLOD::Impl::DrawPart(
+    ID3D11DeviceContext* deviceContext,
+    const ModelMeshPart& part,
+    const Level& level,
+    std::function<void()>& setCustomState) const
+{
+    deviceContext->IASetInputLayout(part.inputLayout.Get());
+
+    auto vb = part.vertexBuffer.Get();
+    const UINT vbStride = part.vertexStride;
+    constexpr UINT vbOffset = 0;
+    deviceContext->IASetVertexBuffers(0, 1, &vb, &vbStride, &vbOffset);
+
+    deviceContext->IASetIndexBuffer(level.indexBuffer.Get(), part.indexFormat, 0);
+
+    assert(part.effect != nullptr);
+    part.effect->Apply(deviceContext);
+
+    // Hook lets the caller replace our shaders or state settings with whatever else they see fit.
+    if (setCustomState)
+    {
+        setCustomState();
+    }
+
+    deviceContext->IASetPrimitiveTopology(part.primitiveType);
+
+    deviceContext->DrawIndexed(level.indexCount, 0, part.vertexOffset);
+}
+
+
+//--------------------------------------------------------------------------------------
+// ModelLOD
+//--------------------------------------------------------------------------------------
+
+_Use_decl_annotations_
+ModelLOD::ModelLOD(
+    ID3D11DeviceContext* deviceContext,
+    const Model& model,
+    size_t levelCount,
+    float reduction,
+    float maxError) :
+    pImpl(std::make_unique<Impl>())
+{
+    if (!deviceContext)
+        throw std::invalid_argument("Direct3D device context is null");
+
+    if (!(reduction > 0.f && reduction < 1.f))
+        throw std::invalid_argument("Reduction must be between 0 and 1");
+
+    if (maxError < 0.f)
+        throw std::invalid_argument("Maximum error cannot be negative");
+
+    pImpl->Create(deviceContext, model, levelCount, reduction, maxError);
+}
+
+ModelLOD::ModelLOD(ModelLOD&&) noexcept = default;
+ModelLOD& ModelLOD::operator= (ModelLOD&&) noexcept = default;
+ModelLOD::~ModelLOD() = default;
+
+
+size_t ModelLOD::GetLevelCount() const noexcept
+{
+    return pImpl->thresholds.size();
+}
+
+
+void ModelLOD::SetScreenSizeThreshold(size_t level, float size)
+{
+    if (!level || level >= pImpl->thresholds.size())
+        throw std::out_of_range("Invalid level of detail");
+
+    pImpl->thresholds[level] = size;
+}
+
+
+_Use_decl_annotations_
+size_t XM_CALLCONV ModelLOD::SelectLevel(
+    const ModelMesh& mesh,
+    FXMMATRIX world,
+    CXMMATRIX view,
+    CXMMATRIX projection) const
+{
+    BoundingSphere sphere;
+    mesh.boundingSphere.Transform(sphere, world);
+
+    // The projected diameter as a fraction of the viewport height is r * P22 / distance for a
+    // perspective projection, which has its depth in w, and r * P22 for an orthographic one.
+    float size = sphere.Radius * XMVectorGetY(projection.r[1]);
+    if (XMVectorGetW(projection.r[2]) != 0.f)
+    {
+        const XMVECTOR center = XMVector3Transform(XMLoadFloat3(&sphere.Center), view);
+        const float distance = fabsf(XMVectorGetZ(center));
+
+        // Inside or touching the bounds
+        if (distance <= sphere.Radius)
+            return 0;
+
+        size /= distance;
+    }
+
+    size = fabsf(size);
+
+    size_t level = 0;
+    for (size_t j = 1; j < pImpl->thresholds.size(); ++j)
+    {
+        if (size < pImpl->thresholds[j])
+            level = j;
+    }
+
+    return level;
+}
+
+
+uint32_t ModelLOD::GetIndexCount(const ModelMeshPart& part, size_t level) const
+{
+    if (level >= pImpl->thresholds.size())
+        throw std::out_of_range("Invalid level of detail");
+
+    if (level > 0)
+    {
+        auto it = pImpl->parts.find(&part);
+        if (it != pImpl->parts.cend())
+        {
+            return it->second[level - 1].indexCount;
+        }
+    }
+
+    return part.indexCount;
+}
+
+
+_Use_decl_annotations_
+void XM_CALLCONV ModelLOD::Draw(
+    ID3D11DeviceContext* deviceContext,
+    const CommonStates& states,
+    FXMMATRIX world,
+    CXMMATRIX view,
+    CXMMATRIX projection,
+    bool wireframe,
+    std::function<void()> setCustomState) const
+{
+    assert(deviceContext != nullptr);
+
+    for (const bool alpha : { false, true })
+    {
+        for (const auto& mit : pImpl->meshes)
+        {
+            const auto mesh = mit.get();
+            assert(mesh != nullptr);
+
+            mesh->PrepareForRendering(deviceContext, states, alpha, wireframe);
+
+            const size_t level = SelectLevel(*mesh, world, view, projection);
+            const XMMATRIX local = mesh->GetVertexTransform(world);
+
+            for (const auto& it : mesh->meshParts)
+            {
+                auto part = it.get();
+                assert(part != nullptr);
+
+                if (part->isAlpha != alpha)
+                    continue;
+
+                auto imatrices = part->GetEffectMatrices();
+                if (imatrices)
+                {
+                    imatrices->SetMatrices(local, view, projection);
+                }
+
+                const Impl::Level* lod = nullptr;
+                if (level > 0)
+                {
+                    auto pit = pImpl->parts.find(part);
+                    if (pit != pImpl->parts.cend() && pit->second[level - 1].indexBuffer)
+                    {
+                        lod = &pit->second[level - 1];
+                    }
+                }
+
+                if (lod)
+                {
+                    pImpl->DrawPart(deviceContext, *part, *lod, setCustomState);
+                }
+                else
+                {
+                    part->Draw(deviceContext, part->effect.get(), part->inputLayout.Get(), setCustomState);
+                }
+            }
+        }
+    }
+}
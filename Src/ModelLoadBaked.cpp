@@ -0,0 +1,454 @@
+//--------------------------------------------------------------------------------------
+// File: ModelLoadBaked.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "Model.h"
+#include "DirectXHelpers.h"
+#include "Effects.h"
+#include "BinaryReader.h"
+#include "ModelHelpers.h"
+#include "ModelData.h"
+#include "PlatformHelpers.h"
+
+#include "ModelBaked.h"
+
+using namespace DirectX;
+using namespace DirectX::ModelHelpers;
+
+static_assert(sizeof(wchar_t) == sizeof(uint16_t), "Baked model strings are UTF-16");
+
+namespace
+{
+    template<typename T>
+    const T* GetTable(const uint8_t* meshData, size_t dataSize, const BakedModel::Table& table)
+    {
+        const uint64_t sizeBytes = uint64_t(table.Count) * sizeof(T);
+        if (sizeBytes > UINT32_MAX)
+            throw std::runtime_error("Baked model table too large");
+
+        if (table.Offset & 3)
+            throw std::runtime_error("Baked model table misaligned");
+
+        if (uint64_t(table.Offset) + sizeBytes > dataSize)
+            throw std::runtime_error("End of file");
+
+        return reinterpret_cast<const T*>(meshData + table.Offset);
+    }
+
+    class StringTable
+    {
+    public:
+        StringTable(const uint8_t* meshData, size_t dataSize, const BakedModel::Table& table) :
+            mStrings(nullptr),
+            mCount(table.Count / sizeof(wchar_t))
+        {
+            if ((table.Count & 1) || mCount < 1)
+                throw std::runtime_error("Invalid baked model string table");
+
+            if (uint64_t(table.Offset) + table.Count > dataSize)
+                throw std::runtime_error("End of file");
+
+            mStrings = reinterpret_cast<const wchar_t*>(static_cast<const void*>(meshData + table.Offset)); // CodeQL [SM02986] The cast here is intentional to interpret the string in the buffer.
+
+            // With the table terminated, every string that starts inside it is too
+            if (mStrings[0] != 0 || mStrings[mCount - 1] != 0)
+                throw std::runtime_error("Invalid baked model string table");
+        }
+
+        const wchar_t* Get(uint32_t offset) const
+        {
+            if ((offset & 1) || (offset / sizeof(wchar_t)) >= mCount)
+                throw std::runtime_error("Invalid baked model string");
+
+            return mStrings + offset / sizeof(wchar_t);
+        }
+
+    private:
+        const wchar_t*  mStrings;
+        size_t          mCount;
+    };
+}
+
+
+//======================================================================================
+// Model Loader
+//======================================================================================
+
+_Use_decl_annotations_
+void ModelHelpers::LoadBaked(
+    ModelData& data,
+    const uint8_t* meshData,
+    size_t dataSize,
+    ModelLoaderFlags flags)
+{
+    if (!meshData)
+        throw std::invalid_argument("meshData cannot be null");
+
+    // File header
+    if (dataSize < sizeof(BakedModel::Header))
+        throw std::runtime_error("End of file");
+    auto header = reinterpret_cast<const BakedModel::Header*>(meshData);
+
+    if (header->Magic != BakedModel::MAGIC || header->HeaderSize != sizeof(BakedModel::Header))
+        throw std::runtime_error("Not a valid baked model file");
+
+    if (header->Version != BakedModel::VERSION)
+        throw std::runtime_error("Not a supported baked model version");
+
+    if (!header->Buffers.Count)
+        throw std::runtime_error("No buffers found");
+
+    if (!header->Meshes.Count)
+        throw std::runtime_error("No meshes found");
+
+    auto bufferArray = GetTable<BakedModel::Buffer>(meshData, dataSize, header->Buffers);
+    auto elementSetArray = GetTable<BakedModel::ElementSet>(meshData, dataSize, header->ElementSets);
+    auto elementArray = GetTable<BakedModel::Element>(meshData, dataSize, header->Elements);
+    auto materialArray = GetTable<BakedModel::Material>(meshData, dataSize, header->Materials);
+    auto meshArray = GetTable<BakedModel::Mesh>(meshData, dataSize, header->Meshes);
+    auto partArray = GetTable<BakedModel::Part>(meshData, dataSize, header->Parts);
+    auto influenceArray = GetTable<uint32_t>(meshData, dataSize, header->Influences);
+    auto boneArray = GetTable<BakedModel::Bone>(meshData, dataSize, header->Bones);
+    auto matrixArray = GetTable<XMFLOAT4X4>(meshData, dataSize, header->Matrices);
+
+    const StringTable strings(meshData, dataSize, header->Strings);
+
+    // Vertex and index buffers refer to the file data
+    std::vector<uint32_t> buffers;
+    buffers.resize(header->Buffers.Count);
+
+    for (size_t j = 0; j < header->Buffers.Count; ++j)
+    {
+        auto& bh = bufferArray[j];
+
+        if (!bh.SizeBytes)
+            throw std::runtime_error("Empty buffer found");
+
+        if (bh.BindFlags != D3D11_BIND_VERTEX_BUFFER && bh.BindFlags != D3D11_BIND_INDEX_BUFFER)
+            throw std::runtime_error("Invalid buffer type found");
+
+        if (!(flags & ModelLoader_AllowLargeModels))
+        {
+            if (bh.SizeBytes > (D3D11_REQ_RESOURCE_SIZE_IN_MEGABYTES_EXPRESSION_A_TERM * 1024u * 1024u))
+                throw std::runtime_error("Buffer too large for DirectX 11");
+        }
+
+        if (uint64_t(bh.DataOffset) + bh.SizeBytes > dataSize)
+            throw std::runtime_error("End of file");
+
+        buffers[j] = data.AddBuffer(meshData + bh.DataOffset, bh.SizeBytes, static_cast<D3D11_BIND_FLAG>(bh.BindFlags));
+    }
+
+    // Input element descriptions
+    std::vector<std::shared_ptr<ModelMeshPart::InputLayoutCollection>> vbDecls;
+    vbDecls.reserve(header->ElementSets.Count);
+
+    for (size_t j = 0; j < header->ElementSets.Count; ++j)
+    {
+        auto& sh = elementSetArray[j];
+
+        if (!sh.ElementCount
+            || sh.ElementCount > D3D11_IA_VERTEX_INPUT_STRUCTURE_ELEMENT_COUNT
+            || uint64_t(sh.FirstElement) + sh.ElementCount > header->Elements.Count)
+            throw std::runtime_error("Invalid input layout found");
+
+        auto decl = std::make_shared<ModelMeshPart::InputLayoutCollection>();
+        decl->reserve(sh.ElementCount);
+
+        for (size_t k = 0; k < sh.ElementCount; ++k)
+        {
+            auto& eh = elementArray[sh.FirstElement + k];
+
+            if (eh.Semantic >= std::size(BakedModel::SEMANTIC_NAMES))
+                throw std::runtime_error("Invalid input element semantic found");
+
+            D3D11_INPUT_ELEMENT_DESC element = {};
+            element.SemanticName = BakedModel::SEMANTIC_NAMES[eh.Semantic];
+            element.SemanticIndex = eh.SemanticIndex;
+            element.Format = static_cast<DXGI_FORMAT>(eh.Format);
+            element.InputSlot = eh.InputSlot;
+            element.AlignedByteOffset = eh.AlignedByteOffset;
+            element.InputSlotClass = static_cast<D3D11_INPUT_CLASSIFICATION>(eh.InputSlotClass);
+            element.InstanceDataStepRate = eh.InstanceDataStepRate;
+            decl->push_back(element);
+        }
+
+        vbDecls.emplace_back(std::move(decl));
+    }
+
+    // Materials
+    auto model = &data.model;
+
+    std::vector<uint32_t> materials;
+    materials.reserve(header->Materials.Count);
+
+    for (size_t j = 0; j < header->Materials.Count; ++j)
+    {
+        auto& mh = materialArray[j];
+
+        EffectFactory::EffectInfo info;
+        info.name = strings.Get(mh.Name);
+        info.perVertexColor = (mh.Flags & BakedModel::MATERIAL_PER_VERTEX_COLOR) != 0;
+        info.enableSkinning = (mh.Flags & BakedModel::MATERIAL_SKINNING) != 0;
+        info.enableDualTexture = (mh.Flags & BakedModel::MATERIAL_DUAL_TEXTURE) != 0;
+        info.enableNormalMaps = (mh.Flags & BakedModel::MATERIAL_NORMAL_MAPS) != 0;
+        info.biasedVertexNormals = (mh.Flags & BakedModel::MATERIAL_BIASED_VERTEX_NORMALS) != 0;
+        info.specularPower = mh.SpecularPower;
+        info.alpha = mh.Alpha;
+        info.ambientColor = mh.AmbientColor;
+        info.diffuseColor = mh.DiffuseColor;
+        info.specularColor = mh.SpecularColor;
+        info.emissiveColor = mh.EmissiveColor;
+        info.diffuseTexture = strings.Get(mh.DiffuseTexture);
+        info.specularTexture = strings.Get(mh.SpecularTexture);
+        info.normalTexture = strings.Get(mh.NormalTexture);
+        info.emissiveTexture = strings.Get(mh.EmissiveTexture);
+
+        ModelHelpers::RecordTextureNames(model->textureNames, info);
+
+        materials.push_back(data.AddMaterial(info));
+    }
+
+    // Build meshes
+    model->meshes.reserve(header->Meshes.Count);
+
+    for (size_t meshIndex = 0; meshIndex < header->Meshes.Count; ++meshIndex)
+    {
+        auto& mh = meshArray[meshIndex];
+
+        if (uint64_t(mh.FirstPart) + mh.PartCount > header->Parts.Count)
+            throw std::runtime_error("Invalid mesh found");
+
+        if (uint64_t(mh.FirstInfluence) + mh.InfluenceCount > header->Influences.Count)
+            throw std::runtime_error("Invalid mesh bone influences found");
+
+        if (!(mh.PositionScale > 0.f) || !std::isfinite(mh.PositionScale))
+            throw std::runtime_error("Invalid mesh position decode found");
+
+        auto mesh = std::make_shared<ModelMesh>();
+        mesh->name = strings.Get(mh.Name);
+        mesh->ccw = (mh.Flags & BakedModel::MESH_CCW) != 0;
+        mesh->pmalpha = (mh.Flags & BakedModel::MESH_PMALPHA) != 0;
+        mesh->boneIndex = mh.BoneIndex;
+        mesh->boundingSphere = BoundingSphere(mh.SphereCenter, mh.SphereRadius);
+        mesh->boundingBox = BoundingBox(mh.BoxCenter, mh.BoxExtents);
+        mesh->positionScale = mh.PositionScale;
+        mesh->positionBias = mh.PositionBias;
+
+        if (mh.InfluenceCount > 0)
+        {
+            for (size_t k = 0; k < mh.InfluenceCount; ++k)
+            {
+                if (influenceArray[mh.FirstInfluence + k] >= header->Bones.Count)
+                    throw std::runtime_error("Invalid mesh bone influence index found");
+            }
+
+            mesh->boneInfluences.assign(influenceArray + mh.FirstInfluence, influenceArray + mh.FirstInfluence + mh.InfluenceCount);
+        }
+
+        std::shared_ptr<ModelMeshGeometry> geometry;
+        if (flags & ModelLoader_RetainGeometry)
+        {
+            geometry = std::make_shared<ModelMeshGeometry>();
+        }
+
+        mesh->meshParts.reserve(mh.PartCount);
+
+        for (size_t k = 0; k < mh.PartCount; ++k)
+        {
+            auto& ph = partArray[mh.FirstPart + k];
+
+            if (ph.Material >= materials.size()
+                || ph.ElementSet >= vbDecls.size()
+                || ph.VertexBuffer >= buffers.size()
+                || ph.IndexBuffer >= buffers.size()
+                || bufferArray[ph.VertexBuffer].BindFlags != D3D11_BIND_VERTEX_BUFFER
+                || bufferArray[ph.IndexBuffer].BindFlags != D3D11_BIND_INDEX_BUFFER)
+                throw std::runtime_error("Invalid mesh part found");
+
+            if (ph.IndexFormat != DXGI_FORMAT_R16_UINT && ph.IndexFormat != DXGI_FORMAT_R32_UINT)
+                throw std::runtime_error("Invalid index format found");
+
+            switch (ph.PrimitiveType)
+            {
+            case D3D11_PRIMITIVE_TOPOLOGY_POINTLIST:
+            case D3D11_PRIMITIVE_TOPOLOGY_LINELIST:
+            case D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP:
+            case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST:
+            case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP:
+            case D3D11_PRIMITIVE_TOPOLOGY_LINELIST_ADJ:
+            case D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP_ADJ:
+            case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST_ADJ:
+            case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP_ADJ:
+                break;
+
+            default:
+                throw std::runtime_error("Unknown primitive type");
+            }
+
+            if (!ph.VertexStride || ph.VertexStride > D3D11_REQ_MULTI_ELEMENT_STRUCTURE_SIZE_IN_BYTES)
+                throw std::runtime_error("Invalid vertex stride found");
+
+            // The part must draw within its buffers, whether or not geometry is retained
+            const size_t indexSize = (ph.IndexFormat == DXGI_FORMAT_R32_UINT) ? sizeof(uint32_t) : sizeof(uint16_t);
+            if ((uint64_t(ph.StartIndex) + uint64_t(ph.IndexCount)) * indexSize > bufferArray[ph.IndexBuffer].SizeBytes)
+                throw std::runtime_error("Mesh part indices exceed index buffer");
+
+            if (ph.VertexOffset >= 0
+                && (uint64_t(ph.VertexOffset) + std::max(ph.VertexCount, 1u)) * ph.VertexStride
+                    > bufferArray[ph.VertexBuffer].SizeBytes)
+                throw std::runtime_error("Mesh part vertices exceed vertex buffer");
+
+            auto part = std::make_unique<ModelMeshPart>();
+            part->indexCount = ph.IndexCount;
+            part->startIndex = ph.StartIndex;
+            part->vertexOffset = ph.VertexOffset;
+            part->vertexStride = ph.VertexStride;
+            part->primitiveType = static_cast<D3D_PRIMITIVE_TOPOLOGY>(ph.PrimitiveType);
+            part->indexFormat = static_cast<DXGI_FORMAT>(ph.IndexFormat);
+            part->vbDecl = vbDecls[ph.ElementSet];
+            part->isAlpha = (ph.Flags & BakedModel::PART_ALPHA) != 0;
+            part->vertexCount = ph.VertexCount;
+
+            data.SetPart(part.get(), materials[ph.Material], buffers[ph.VertexBuffer], buffers[ph.IndexBuffer]);
+
+            if (geometry)
+            {
+                auto& vh = bufferArray[ph.VertexBuffer];
+                auto& ih = bufferArray[ph.IndexBuffer];
+
+                ModelHelpers::AddPartGeometry(*geometry, static_cast<uint32_t>(k), *mesh, *part, *part->vbDecl, part->vertexStride,
+                    meshData + vh.DataOffset, vh.SizeBytes,
+                    meshData + ih.DataOffset, ih.SizeBytes);
+            }
+
+            mesh->meshParts.emplace_back(std::move(part));
+        }
+
+        if (geometry)
+        {
+            geometry->Build();
+            mesh->geometry = std::move(geometry);
+        }
+
+        model->meshes.emplace_back(mesh);
+    }
+
+    // Load model bones (if present)
+    if (header->Bones.Count > 0)
+    {
+        const size_t nbones = header->Bones.Count;
+        const bool hasInvBindPose = (header->Flags & BakedModel::HEADER_INV_BIND_POSE) != 0;
+
+        if (header->Matrices.Count != (hasInvBindPose ? nbones * 2 : nbones))
+            throw std::runtime_error("Bone matrices are missing");
+
+        ModelBone::Collection bones;
+        bones.reserve(nbones);
+
+        for (size_t j = 0; j < nbones; ++j)
+        {
+            auto& bh = boneArray[j];
+
+            if ((bh.ParentIndex != ModelBone::c_Invalid && bh.ParentIndex >= nbones)
+                || (bh.ChildIndex != ModelBone::c_Invalid && bh.ChildIndex >= nbones)
+                || (bh.SiblingIndex != ModelBone::c_Invalid && bh.SiblingIndex >= nbones))
+                throw std::runtime_error("Skeleton bones corrupt");
+
+            ModelBone bone(bh.ParentIndex, bh.ChildIndex, bh.SiblingIndex);
+            bone.name = strings.Get(bh.Name);
+            bones.emplace_back(std::move(bone));
+        }
+
+        auto transforms = ModelBone::MakeArray(nbones);
+        for (size_t j = 0; j < nbones; ++j)
+        {
+            transforms[j] = XMLoadFloat4x4(&matrixArray[j]);
+        }
+
+        ModelBone::TransformArray invTransforms;
+        if (hasInvBindPose)
+        {
+            invTransforms = ModelBone::MakeArray(nbones);
+            for (size_t j = 0; j < nbones; ++j)
+            {
+                invTransforms[j] = XMLoadFloat4x4(&matrixArray[nbones + j]);
+            }
+        }
+
+        std::swap(model->bones, bones);
+        std::swap(model->boneMatrices, transforms);
+        std::swap(model->invBindPoseMatrices, invTransforms);
+        model->Modified();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+std::unique_ptr<Model> Model::CreateFromBaked(
+    ID3D11Device* device,
+    const uint8_t* meshData,
+    size_t dataSize,
+    IEffectFactory& fxFactory,
+    ModelLoaderFlags flags)
+{
+    if (!device || !meshData)
+        throw std::invalid_argument("Device and meshData cannot be null");
+
+    ModelData data("ModelBaked");
+    LoadBaked(data, meshData, dataSize, flags);
+
+    return data.Create(device, &fxFactory);
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+std::unique_ptr<Model> Model::CreateFromBaked(
+    ID3D11Device* device,
+    const wchar_t* szFileName,
+    IEffectFactory& fxFactory,
+    ModelLoaderFlags flags)
+{
+    // Baked files are laid out for upload, so they are always mapped rather than read
+    size_t dataSize = 0;
+    ScopedFileView view;
+    HRESULT hr = BinaryReader::MapEntireFile(szFileName, view, &dataSize);
+    if (FAILED(hr))
+    {
+        DebugTrace("ERROR: CreateFromBaked failed (%08X) loading '%ls'\n",
+            static_cast<unsigned int>(hr), szFileName);
+        throw std::runtime_error("CreateFromBaked");
+    }
+
+    auto model = CreateFromBaked(device, static_cast<const uint8_t*>(view.get()), dataSize, fxFactory, flags);
+
+    model->name = szFileName;
+
+    return model;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Adapters for /Zc:wchar_t- clients
+
+#if defined(_MSC_VER) && !defined(_NATIVE_WCHAR_T_DEFINED)
+
+_Use_decl_annotations_
+std::unique_ptr<Model> Model::CreateFromBaked(
+    ID3D11Device* device,
+    const __wchar_t* szFileName,
+    IEffectFactory& fxFactory,
+    ModelLoaderFlags flags)
+{
+    return CreateFromBaked(device, reinterpret_cast<const unsigned short*>(szFileName), fxFactory, flags);
+}
+
+#endif
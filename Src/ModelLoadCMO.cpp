@@ -13,10 +13,12 @@
 #include "Effects.h"
 #include "VertexTypes.h"
 #include "BinaryReader.h"
+#include "ModelHelpers.h"
+#include "ModelData.h"
 #include "PlatformHelpers.h"
 
 using namespace DirectX;
-using Microsoft::WRL::ComPtr;
+using namespace DirectX::ModelHelpers;
 
 #include "CMO.h"
 
@@ -32,37 +34,15 @@ namespace
         std::wstring                    name;
         std::wstring                    pixelShader;
         std::wstring                    texture[VSD3DStarter::MAX_TEXTURE];
-        std::shared_ptr<IEffect>        effect;
-        ComPtr<ID3D11InputLayout>       il;
+        uint32_t                        material;
 
         MaterialRecordCMO() noexcept :
             pMaterial(nullptr),
-            texture{}
+            texture{},
+            material(ModelData::c_None)
         {}
     };
 
-    // Helper for creating a D3D input layout.
-    void CreateCMOInputLayout(_In_ ID3D11Device* device, _In_ IEffect* effect, _Outptr_ ID3D11InputLayout** pInputLayout, bool skinning)
-    {
-        if (skinning)
-        {
-            ThrowIfFailed(
-                CreateInputLayoutFromEffect<VertexPositionNormalTangentColorTextureSkinning>(device, effect, pInputLayout)
-            );
-        }
-        else
-        {
-            ThrowIfFailed(
-                CreateInputLayoutFromEffect<VertexPositionNormalTangentColorTexture>(device, effect, pInputLayout)
-            );
-        }
-
-        assert(pInputLayout != nullptr && *pInputLayout != nullptr);
-        _Analysis_assume_(pInputLayout != nullptr && *pInputLayout != nullptr);
-
-        SetDebugObjectName(*pInputLayout, "ModelCMO");
-    }
-
     // Shared VB input element description
     INIT_ONCE g_InitOnce = INIT_ONCE_STATIC_INIT;
     std::shared_ptr<ModelMeshPart::InputLayoutCollection> g_vbdecl;
@@ -108,11 +88,11 @@ namespace
 //======================================================================================
 
 _Use_decl_annotations_
-std::unique_ptr<Model> Model::CreateFromCMO(
-    ID3D11Device* device,
+void ModelHelpers::LoadCMO(
+    ModelData& data,
     const uint8_t* meshData, size_t dataSize,
-    IEffectFactory& fxFactory,
     ModelLoaderFlags flags,
+    bool dgslMaterials,
     size_t* animsOffset)
 {
     if (animsOffset)
@@ -123,10 +103,8 @@ std::unique_ptr<Model> Model::CreateFromCMO(
     if (!InitOnceExecuteOnce(&g_InitOnce, InitializeDecl, nullptr, nullptr))
         throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "InitOnceExecuteOnce");
 
-    if (!device || !meshData)
-        throw std::invalid_argument("Device and meshData cannot be null");
-
-    auto fxFactoryDGSL = dynamic_cast<DGSLEffectFactory*>(&fxFactory);
+    if (!meshData)
+        throw std::invalid_argument("meshData cannot be null");
 
     // Meshes
     auto nMesh = reinterpret_cast<const uint32_t*>(meshData);
@@ -140,7 +118,11 @@ std::unique_ptr<Model> Model::CreateFromCMO(
     if (*nMesh > UINT16_MAX)
         throw std::runtime_error("Too many meshes in a file");
 
-    auto model = std::make_unique<Model>();
+    auto model = &data.model;
+
+    // When consolidating, buffer data for all meshes is gathered and the buffers are added at the end
+    const bool consolidate = (flags & ModelLoader_ConsolidateBuffers) != 0;
+    BufferConsolidator consolidator;
 
     for (size_t meshIndex = 0; meshIndex < *nMesh; ++meshIndex)
     {
@@ -283,8 +265,26 @@ std::unique_ptr<Model> Model::CreateFromCMO(
         std::vector<IBData> ibData;
         ibData.reserve(*nIBs);
 
-        std::vector<ComPtr<ID3D11Buffer>> ibs;
-        ibs.resize(*nIBs);
+        std::vector<uint32_t> ibs;
+        ibs.resize(*nIBs, ModelData::c_None);
+
+        std::vector<uint32_t> ibEntries;
+        ibEntries.resize(*nIBs);
+
+        // Index data read from the file is referenced in place
+        auto createIndexBuffer = [&](size_t j, const void* indexes, size_t ibBytes)
+            {
+                if (consolidate)
+                {
+                    ibEntries[j] = consolidator.Add(indexes, ibBytes, sizeof(uint16_t), D3D11_BIND_INDEX_BUFFER);
+                    return;
+                }
+
+                ibs[j] = data.AddBuffer(indexes, ibBytes, D3D11_BIND_INDEX_BUFFER);
+            };
+
+        // Merging adjacent submeshes rewrites the index buffers, so they are created once all are read
+        const bool mergeParts = (flags & ModelLoader_MergeParts) != 0;
 
         for (size_t j = 0; j < *nIBs; ++j)
         {
@@ -319,23 +319,61 @@ std::unique_ptr<Model> Model::CreateFromCMO(
             ib.ptr = indexes;
             ibData.emplace_back(ib);
 
-            D3D11_BUFFER_DESC desc = {};
-            desc.Usage = D3D11_USAGE_DEFAULT;
-            desc.ByteWidth = static_cast<UINT>(ibBytes);
-            desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-
-            D3D11_SUBRESOURCE_DATA initData = { indexes, 0, 0 };
-
-            ThrowIfFailed(
-                device->CreateBuffer(&desc, &initData, &ibs[j])
-            );
-
-            SetDebugObjectName(ibs[j].Get(), "ModelCMO");
+            if (!mergeParts)
+            {
+                createIndexBuffer(j, indexes, ibBytes);
+            }
         }
 
         assert(ibData.size() == *nIBs);
         assert(ibs.size() == *nIBs);
 
+        // Retained geometry reads merged indices from wherever they end up
+        ModelHelpers::PartMerger merger;
+        std::vector<std::vector<uint8_t>> mergedIndices;
+        std::vector<const uint8_t*> mergedData;
+        if (mergeParts)
+        {
+            for (size_t j = 0; j < *nSubmesh; ++j)
+            {
+                auto& sm = subMesh[j];
+
+                if (sm.IndexBufferIndex >= *nIBs
+                    || uint64_t(sm.PrimCount) * 3 > UINT32_MAX)
+                    throw std::out_of_range("Invalid submesh found\n");
+
+                auto& ib = ibData[sm.IndexBufferIndex];
+
+                // Submeshes with the same material and vertex buffer draw with the same effect and input layout
+                merger.AddPart(sm.IndexBufferIndex,
+                    reinterpret_cast<const uint8_t*>(ib.ptr), ib.nIndices * sizeof(uint16_t), false,
+                    sm.StartIndex, sm.PrimCount * 3, 0,
+                    (uint64_t(sm.MaterialIndex) << 32) | sm.VertexBufferIndex, true);
+            }
+
+            mergedIndices.resize(*nIBs);
+            mergedData.resize(*nIBs);
+            for (size_t j = 0; j < *nIBs; ++j)
+            {
+                merger.MergeIndices(static_cast<uint32_t>(j), mergedIndices[j]);
+                mergedData[j] = mergedIndices[j].data();
+
+                if (mergedIndices[j].empty())
+                {
+                    createIndexBuffer(j, ibData[j].ptr, ibData[j].nIndices * sizeof(uint16_t));
+                }
+                else if (consolidate)
+                {
+                    createIndexBuffer(j, mergedIndices[j].data(), mergedIndices[j].size());
+                }
+                else
+                {
+                    ibs[j] = data.AddBuffer(std::move(mergedIndices[j]), D3D11_BIND_INDEX_BUFFER);
+                    mergedData[j] = data.GetBuffers()[ibs[j]].data;
+                }
+            }
+        }
+
         // Vertex buffers
         auto nVBs = reinterpret_cast<const uint32_t*>(meshData + usedSize);
         usedSize += sizeof(uint32_t);
@@ -546,6 +584,7 @@ std::unique_ptr<Model> Model::CreateFromCMO(
             std::swap(model->bones, bones);
             std::swap(model->boneMatrices, transforms);
             std::swap(model->invBindPoseMatrices, invTransforms);
+            model->Modified();
 
             // Animation Clips
             if (animsOffset)
@@ -569,12 +608,48 @@ std::unique_ptr<Model> Model::CreateFromCMO(
         const bool enableSkinning = (*nSkinVBs) != 0 && !(flags & ModelLoader_DisableSkinning);
 
         // Build vertex buffers
-        std::vector<ComPtr<ID3D11Buffer>> vbs;
-        vbs.resize(*nVBs);
+        std::vector<uint32_t> vbs;
+        vbs.resize(*nVBs, ModelData::c_None);
+
+        std::vector<uint32_t> vbEntries;
+        vbEntries.resize(*nVBs);
 
         const size_t stride = enableSkinning ? sizeof(VertexPositionNormalTangentColorTextureSkinning)
             : sizeof(VertexPositionNormalTangentColorTexture);
 
+        // Compacted vertex buffers each get their own layout and stride, with one position decode per mesh
+        const bool compactVertices = (flags & ModelLoader_CompactVertices) != 0;
+
+        std::vector<std::shared_ptr<ModelMeshPart::InputLayoutCollection>> vbDecls;
+        vbDecls.resize(*nVBs, enableSkinning ? g_vbdeclSkinning : g_vbdecl);
+
+        std::vector<uint32_t> vbStrides;
+        vbStrides.resize(*nVBs, static_cast<uint32_t>(stride));
+
+        unsigned int compactOptions = 0;
+        bool biasedNormals = false;
+        if (compactVertices)
+        {
+            // DGSL shaders do not read biased normals
+            compactOptions = ModelHelpers::COMPACT_NORMALS | ModelHelpers::COMPACT_TEXCOORDS
+                | (dgslMaterials ? 0u : static_cast<unsigned int>(ModelHelpers::COMPACT_BIASED_NORMALS));
+
+            if (!enableSkinning)
+            {
+                ModelHelpers::PositionBounds bounds;
+                for (size_t j = 0; j < *nVBs; ++j)
+                {
+                    bounds.Add(*g_vbdecl, static_cast<uint32_t>(sizeof(VertexPositionNormalTangentColorTexture)),
+                        reinterpret_cast<const uint8_t*>(vbData[j].ptr), vbData[j].nVerts);
+                }
+
+                if (bounds.GetScaleBias(mesh->positionScale, mesh->positionBias))
+                {
+                    compactOptions |= ModelHelpers::COMPACT_POSITIONS;
+                }
+            }
+        }
+
         for (size_t j = 0; j < *nVBs; ++j)
         {
             const size_t nVerts = vbData[j].nVerts;
@@ -592,26 +667,23 @@ std::unique_ptr<Model> Model::CreateFromCMO(
 
             const size_t bytes = static_cast<size_t>(sizeInBytes);
 
-            D3D11_BUFFER_DESC desc = {};
-            desc.Usage = D3D11_USAGE_DEFAULT;
-            desc.ByteWidth = static_cast<UINT>(bytes);
-            desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-
-            if (fxFactoryDGSL && !enableSkinning)
+            if (dgslMaterials && !enableSkinning && !compactVertices)
             {
                 // Can use CMO vertex data directly
-                D3D11_SUBRESOURCE_DATA initData = { vbData[j].ptr, 0, 0 };
+                if (consolidate)
+                {
+                    vbEntries[j] = consolidator.Add(vbData[j].ptr, bytes, static_cast<uint32_t>(stride), D3D11_BIND_VERTEX_BUFFER);
+                    continue;
+                }
 
-                ThrowIfFailed(
-                    device->CreateBuffer(&desc, &initData, &vbs[j])
-                );
+                vbs[j] = data.AddBuffer(vbData[j].ptr, bytes, D3D11_BIND_VERTEX_BUFFER);
             }
             else
             {
-                auto temp = std::make_unique<uint8_t[]>(bytes + (sizeof(uint32_t) * nVerts));
+                std::vector<uint8_t> temp(bytes);
 
-                auto visited = reinterpret_cast<uint32_t*>(temp.get() + bytes);
-                memset(visited, 0xff, sizeof(uint32_t) * nVerts);
+                std::vector<uint32_t> visited;
+                visited.resize(nVerts, uint32_t(-1));
 
                 assert(vbData[j].ptr != nullptr);
 
@@ -621,7 +693,7 @@ std::unique_ptr<Model> Model::CreateFromCMO(
                     auto skinptr = vbData[j].skinPtr;
                     assert(skinptr != nullptr);
 
-                    uint8_t* ptr = temp.get();
+                    uint8_t* ptr = temp.data();
 
                     auto sptr = vbData[j].ptr;
 
@@ -638,10 +710,10 @@ std::unique_ptr<Model> Model::CreateFromCMO(
                 }
                 else
                 {
-                    memcpy(temp.get(), vbData[j].ptr, bytes);
+                    memcpy(temp.data(), vbData[j].ptr, bytes);
                 }
 
-                if (!fxFactoryDGSL)
+                if (!dgslMaterials)
                 {
                     // Need to fix up VB tex coords for UV transform which is not supported by basic effects
                     for (size_t k = 0; k < *nSubmesh; ++k)
@@ -668,7 +740,7 @@ std::unique_ptr<Model> Model::CreateFromCMO(
                             if (v >= nVerts)
                                 throw std::out_of_range("Invalid index found\n");
 
-                            auto verts = reinterpret_cast<VertexPositionNormalTangentColorTexture*>(temp.get() + (v * stride));
+                            auto verts = reinterpret_cast<VertexPositionNormalTangentColorTexture*>(temp.data() + (v * stride));
                             if (visited[v] == uint32_t(-1))
                             {
                                 visited[v] = sm.MaterialIndex;
@@ -699,15 +771,32 @@ std::unique_ptr<Model> Model::CreateFromCMO(
                     }
                 }
 
-                // Create vertex buffer from temporary buffer
-                D3D11_SUBRESOURCE_DATA initData = { temp.get(), 0, 0 };
+                if (compactVertices)
+                {
+                    auto decl = std::make_shared<ModelMeshPart::InputLayoutCollection>();
+                    uint32_t compactStride = 0;
+                    bool biased = false;
+                    std::vector<uint8_t> compacted;
+                    if (ModelHelpers::CompactVertices(*vbDecls[j], vbStrides[j], temp.data(), nVerts, compactOptions,
+                        mesh->positionScale, mesh->positionBias, *decl, compactStride, compacted, biased))
+                    {
+                        vbDecls[j] = decl;
+                        vbStrides[j] = compactStride;
+                        biasedNormals |= biased;
 
-                ThrowIfFailed(
-                    device->CreateBuffer(&desc, &initData, &vbs[j])
-                );
-            }
+                        std::swap(temp, compacted);
+                    }
+                }
+
+                if (consolidate)
+                {
+                    vbEntries[j] = consolidator.Add(temp.data(), temp.size(), vbStrides[j], D3D11_BIND_VERTEX_BUFFER);
+                    continue;
+                }
 
-            SetDebugObjectName(vbs[j].Get(), "ModelCMO");
+                // The model data takes the rewritten vertices
+                vbs[j] = data.AddBuffer(std::move(temp), D3D11_BIND_VERTEX_BUFFER);
+            }
         }
 
         assert(vbs.size() == *nVBs);
@@ -719,7 +808,7 @@ std::unique_ptr<Model> Model::CreateFromCMO(
         {
             auto& m = materials[j];
 
-            if (fxFactoryDGSL)
+            if (dgslMaterials)
             {
                 DGSLEffectFactory::DGSLEffectInfo info;
                 info.name = m.name.c_str();
@@ -743,10 +832,13 @@ std::unique_ptr<Model> Model::CreateFromCMO(
                     info.textures[i] = m.texture[i + offset].empty() ? nullptr : m.texture[i + offset].c_str();
                 }
 
-                m.effect = fxFactoryDGSL->CreateDGSLEffect(info, nullptr);
+                ModelHelpers::RecordTextureNames(model->textureNames, info);
+                for (int i = 0; i < (DGSLEffect::MaxTextures - offset); ++i)
+                {
+                    ModelHelpers::RecordTextureName(model->textureNames, info.textures[i]);
+                }
 
-                auto dgslEffect = static_cast<DGSLEffect*>(m.effect.get());
-                dgslEffect->SetUVTransform(XMLoadFloat4x4(&m.pMaterial->UVTransform));
+                m.material = data.AddMaterial(info, m.pMaterial->UVTransform);
             }
             else
             {
@@ -762,10 +854,18 @@ std::unique_ptr<Model> Model::CreateFromCMO(
                 info.emissiveColor = GetMaterialColor(m.pMaterial->Emissive.x, m.pMaterial->Emissive.y, m.pMaterial->Emissive.z, srgb);
                 info.diffuseTexture = m.texture[0].c_str();
 
-                m.effect = fxFactory.CreateEffect(info, nullptr);
+                info.biasedVertexNormals = biasedNormals;
+
+                ModelHelpers::RecordTextureNames(model->textureNames, info);
+
+                m.material = data.AddMaterial(info);
             }
+        }
 
-            CreateCMOInputLayout(device, m.effect.get(), &m.il, enableSkinning);
+        std::shared_ptr<ModelMeshGeometry> geometry;
+        if (flags & ModelLoader_RetainGeometry)
+        {
+            geometry = std::make_shared<ModelMeshGeometry>();
         }
 
         // Build mesh parts
@@ -778,6 +878,12 @@ std::unique_ptr<Model> Model::CreateFromCMO(
                 || (sm.MaterialIndex >= materials.size()))
                 throw std::out_of_range("Invalid submesh found\n");
 
+            if (mergeParts && !merger.IsFirstInGroup(j))
+            {
+                // Drawn by the part this submesh was merged into
+                continue;
+            }
+
             auto& mat = materials[sm.MaterialIndex];
 
             auto part = std::make_unique<ModelMeshPart>();
@@ -787,20 +893,91 @@ std::unique_ptr<Model> Model::CreateFromCMO(
 
             part->indexCount = sm.PrimCount * 3;
             part->startIndex = sm.StartIndex;
-            part->vertexStride = static_cast<UINT>(stride);
-            part->inputLayout = mat.il;
-            part->indexBuffer = ibs[sm.IndexBufferIndex];
-            part->vertexBuffer = vbs[sm.VertexBufferIndex];
-            part->effect = mat.effect;
-            part->vbDecl = enableSkinning ? g_vbdeclSkinning : g_vbdecl;
+            part->vertexCount = static_cast<uint32_t>(vbData[sm.VertexBufferIndex].nVerts);
+
+            if (mergeParts)
+            {
+                const auto range = merger.GetRange(j);
+                part->indexCount = range.indexCount;
+                part->startIndex = range.startIndex;
+                part->vertexCount = range.vertexCount;
+            }
+            part->vertexStride = vbStrides[sm.VertexBufferIndex];
+
+            // Compacted vertex buffers each have their own layout, so the input layout follows vbDecl
+            part->vbDecl = vbDecls[sm.VertexBufferIndex];
+
+            data.SetPart(part.get(), mat.material, vbs[sm.VertexBufferIndex], ibs[sm.IndexBufferIndex]);
+
+            if (geometry)
+            {
+                // Positions come from the file data, which is laid out the same with or without skinning
+                auto& ib = ibData[sm.IndexBufferIndex];
+                auto& vb = vbData[sm.VertexBufferIndex];
+
+                if (uint64_t(sm.StartIndex) + uint64_t(sm.PrimCount) * 3 > ib.nIndices)
+                    throw std::out_of_range("Invalid submesh found\n");
+
+                const uint16_t* indices = ib.ptr + sm.StartIndex;
+                size_t nFaces = sm.PrimCount;
+                if (mergeParts)
+                {
+                    indices = reinterpret_cast<const uint16_t*>(mergedData[sm.IndexBufferIndex]) + part->startIndex;
+                    nFaces = part->indexCount / 3;
+                }
+
+                geometry->AddTriangles(static_cast<uint32_t>(mesh->meshParts.size()), indices, nFaces,
+                    &vb.ptr->position, sizeof(VertexPositionNormalTangentColorTexture), vb.nVerts);
+            }
+
+            if (consolidate)
+            {
+                consolidator.Assign(part.get(), vbEntries[sm.VertexBufferIndex], ibEntries[sm.IndexBufferIndex]);
+            }
 
             mesh->meshParts.emplace_back(std::move(part));
         }
 
+        if (geometry)
+        {
+            geometry->Build();
+            mesh->geometry = std::move(geometry);
+        }
+
         model->meshes.emplace_back(mesh);
     }
 
-    return model;
+    if (consolidate)
+    {
+        consolidator.Build(data);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+std::unique_ptr<Model> Model::CreateFromCMO(
+    ID3D11Device* device,
+    const uint8_t* meshData, size_t dataSize,
+    IEffectFactory& fxFactory,
+    ModelLoaderFlags flags,
+    size_t* animsOffset)
+{
+    if (animsOffset)
+    {
+        *animsOffset = 0;
+    }
+
+    if (!device || !meshData)
+        throw std::invalid_argument("Device and meshData cannot be null");
+
+    // DGSL materials keep the UV transforms in the effects rather than in the vertices
+    auto fxFactoryDGSL = dynamic_cast<DGSLEffectFactory*>(&fxFactory);
+
+    ModelData data("ModelCMO");
+    LoadCMO(data, meshData, dataSize, flags, fxFactoryDGSL != nullptr, animsOffset);
+
+    return data.Create(device, &fxFactory);
 }
 
 
@@ -818,9 +995,13 @@ std::unique_ptr<Model> Model::CreateFromCMO(
         *animsOffset = 0;
     }
 
+    // A mapped file lets buffer creation read the vertex and index data in place
     size_t dataSize = 0;
     std::unique_ptr<uint8_t[]> data;
-    HRESULT hr = BinaryReader::ReadEntireFile(szFileName, data, &dataSize);
+    ScopedFileView view;
+    HRESULT hr = (flags & ModelLoader_MemoryMappedFile)
+        ? BinaryReader::MapEntireFile(szFileName, view, &dataSize)
+        : BinaryReader::ReadEntireFile(szFileName, data, &dataSize);
     if (FAILED(hr))
     {
         DebugTrace("ERROR: CreateFromCMO failed (%08X) loading '%ls'\n",
@@ -828,7 +1009,9 @@ std::unique_ptr<Model> Model::CreateFromCMO(
         throw std::runtime_error("CreateFromCMO");
     }
 
-    auto model = CreateFromCMO(device, data.get(), dataSize, fxFactory, flags, animsOffset);
+    auto meshData = view ? static_cast<const uint8_t*>(view.get()) : data.get();
+
+    auto model = CreateFromCMO(device, meshData, dataSize, fxFactory, flags, animsOffset);
 
     model->name = szFileName;
 
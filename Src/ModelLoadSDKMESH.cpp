@@ -13,11 +13,13 @@
 #include "Effects.h"
 #include "VertexTypes.h"
 #include "BinaryReader.h"
+#include "ModelHelpers.h"
+#include "ModelData.h"
 #include "PlatformHelpers.h"
 #include "SDKMesh.h"
 
 using namespace DirectX;
-using Microsoft::WRL::ComPtr;
+using namespace DirectX::ModelHelpers;
 
 namespace
 {
@@ -33,10 +35,10 @@ namespace
 
     struct MaterialRecordSDKMESH
     {
-        std::shared_ptr<IEffect> effect;
+        uint32_t material;
         bool alpha;
 
-        MaterialRecordSDKMESH() noexcept : alpha(false) {}
+        MaterialRecordSDKMESH() noexcept : material(ModelData::c_None), alpha(false) {}
     };
 
     inline XMFLOAT3 GetMaterialColor(float r, float g, float b, bool srgb)
@@ -56,22 +58,12 @@ namespace
         }
     }
 
-    template<size_t sizeOfBuffer>
-    inline void ASCIIToWChar(wchar_t(&buffer)[sizeOfBuffer], const char *ascii)
-    {
-    #ifdef _WIN32
-        MultiByteToWideChar(CP_UTF8, 0, ascii, -1, buffer, sizeOfBuffer);
-    #else
-        mbtowc(nullptr, nullptr, 0);
-        mbtowc(buffer, ascii, sizeOfBuffer);
-    #endif
-    }
-
     void LoadMaterial(const DXUT::SDKMESH_MATERIAL& mh,
         unsigned int flags,
-        IEffectFactory& fxFactory,
+        ModelData& data,
         MaterialRecordSDKMESH& m,
-        bool srgb)
+        bool srgb,
+        std::vector<std::wstring>& textureNames)
     {
         wchar_t matName[DXUT::MAX_MATERIAL_NAME] = {};
         ASCIIToWChar(matName, mh.Name);
@@ -135,14 +127,17 @@ namespace
         info.specularTexture = specularName;
         info.normalTexture = normalName;
 
-        m.effect = fxFactory.CreateEffect(info, nullptr);
+        ModelHelpers::RecordTextureNames(textureNames, info);
+
+        m.material = data.AddMaterial(info);
         m.alpha = (info.alpha < 1.f);
     }
 
     void LoadMaterial(const DXUT::SDKMESH_MATERIAL_V2& mh,
         unsigned int flags,
-        IEffectFactory& fxFactory,
-        MaterialRecordSDKMESH& m)
+        ModelData& data,
+        MaterialRecordSDKMESH& m,
+        std::vector<std::wstring>& textureNames)
     {
         wchar_t matName[DXUT::MAX_MATERIAL_NAME] = {};
         ASCIIToWChar(matName, mh.Name);
@@ -173,7 +168,9 @@ namespace
         info.normalTexture = normalName;
         info.emissiveTexture = emissiveName;
 
-        m.effect = fxFactory.CreateEffect(info, nullptr);
+        ModelHelpers::RecordTextureNames(textureNames, info);
+
+        m.material = data.AddMaterial(info);
         m.alpha = (info.alpha < 1.f);
     }
 
@@ -369,15 +366,14 @@ namespace
 //======================================================================================
 
 _Use_decl_annotations_
-std::unique_ptr<Model> Model::CreateFromSDKMESH(
-    ID3D11Device* d3dDevice,
+void ModelHelpers::LoadSDKMESH(
+    ModelData& data,
     const uint8_t* meshData,
     size_t idataSize,
-    IEffectFactory& fxFactory,
     ModelLoaderFlags flags)
 {
-    if (!d3dDevice || !meshData)
-        throw std::invalid_argument("Device and meshData cannot be null");
+    if (!meshData)
+        throw std::invalid_argument("meshData cannot be null");
 
     const uint64_t dataSize = idataSize;
 
@@ -496,9 +492,16 @@ std::unique_ptr<Model> Model::CreateFromSDKMESH(
         throw std::runtime_error("End of file");
     const uint8_t* bufferData = meshData + bufferDataOffset;
 
-    // Create vertex buffers
-    std::vector<ComPtr<ID3D11Buffer>> vbs;
-    vbs.resize(header->NumVertexBuffers);
+    // When consolidating, buffer data is gathered and the buffers are added after the mesh parts
+    const bool consolidate = (flags & ModelLoader_ConsolidateBuffers) != 0;
+    BufferConsolidator consolidator;
+
+    std::vector<uint32_t> vbEntries;
+    std::vector<uint32_t> ibEntries;
+
+    // Vertex buffers; data the loader does not rewrite is referenced in place
+    std::vector<uint32_t> vbs;
+    vbs.resize(header->NumVertexBuffers, ModelData::c_None);
 
     std::vector<std::shared_ptr<ModelMeshPart::InputLayoutCollection>> vbDecls;
     vbDecls.resize(header->NumVertexBuffers);
@@ -506,6 +509,23 @@ std::unique_ptr<Model> Model::CreateFromSDKMESH(
     std::vector<unsigned int> materialFlags;
     materialFlags.resize(header->NumVertexBuffers);
 
+    // Compacted vertex buffers get a new layout and stride, and a position decode for their meshes.
+    // Retained geometry is still built from the file data using the original layout.
+    const bool compactVertices = (flags & ModelLoader_CompactVertices) != 0;
+
+    std::vector<uint32_t> vbStrides;
+    vbStrides.resize(header->NumVertexBuffers);
+
+    std::vector<std::shared_ptr<ModelMeshPart::InputLayoutCollection>> fileDecls;
+    std::vector<float> positionScales;
+    std::vector<XMFLOAT3> positionBiases;
+    if (compactVertices)
+    {
+        fileDecls.resize(header->NumVertexBuffers);
+        positionScales.resize(header->NumVertexBuffers, 1.f);
+        positionBiases.resize(header->NumVertexBuffers, XMFLOAT3(0.f, 0.f, 0.f));
+    }
+
     bool dec3nwarning = false;
     for (size_t j = 0; j < header->NumVertexBuffers; ++j)
     {
@@ -541,22 +561,65 @@ std::unique_ptr<Model> Model::CreateFromSDKMESH(
             dec3nwarning = true;
         }
 
-        materialFlags[j] = ilflags;
-
         auto verts = bufferData + (vh.DataOffset - bufferDataOffset);
+        auto vbSize = static_cast<size_t>(vh.SizeBytes);
+        vbStrides[j] = static_cast<uint32_t>(vh.StrideBytes);
+
+        std::vector<uint8_t> compacted;
+        if (compactVertices && vh.StrideBytes > 0 && vh.StrideBytes <= UINT32_MAX)
+        {
+            const auto nVerts = static_cast<size_t>(vh.SizeBytes / vh.StrideBytes);
+
+            ModelHelpers::PositionBounds bounds;
+            bounds.Add(*vbDecls[j], vbStrides[j], verts, nVerts);
+
+            // Normals written by the compaction are always biased, which the material sees through ilflags
+            unsigned int options = ModelHelpers::COMPACT_NORMALS | ModelHelpers::COMPACT_BIASED_NORMALS | ModelHelpers::COMPACT_TEXCOORDS;
+            if (bounds.GetScaleBias(positionScales[j], positionBiases[j]))
+            {
+                options |= ModelHelpers::COMPACT_POSITIONS;
+            }
+
+            auto decl = std::make_shared<ModelMeshPart::InputLayoutCollection>();
+            uint32_t compactStride = 0;
+            bool biasedNormals = false;
+            if (ModelHelpers::CompactVertices(*vbDecls[j], vbStrides[j], verts, nVerts, options,
+                positionScales[j], positionBiases[j], *decl, compactStride, compacted, biasedNormals))
+            {
+                fileDecls[j] = vbDecls[j];
+                vbDecls[j] = decl;
+                vbStrides[j] = compactStride;
+
+                if (biasedNormals)
+                {
+                    ilflags |= BIASED_VERTEX_NORMALS;
+                }
 
-        D3D11_BUFFER_DESC desc = {};
-        desc.Usage = D3D11_USAGE_DEFAULT;
-        desc.ByteWidth = static_cast<UINT>(vh.SizeBytes);
-        desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+                verts = compacted.data();
+                vbSize = compacted.size();
+            }
+            else
+            {
+                positionScales[j] = 1.f;
+                positionBiases[j] = XMFLOAT3(0.f, 0.f, 0.f);
+            }
+        }
+
+        materialFlags[j] = ilflags;
 
-        D3D11_SUBRESOURCE_DATA initData = { verts, 0, 0 };
+        if (consolidate)
+        {
+            if (!vh.StrideBytes || vh.StrideBytes > UINT32_MAX)
+                throw std::runtime_error("Invalid vertex stride");
 
-        ThrowIfFailed(
-            d3dDevice->CreateBuffer(&desc, &initData, &vbs[j])
-        );
+            vbEntries.push_back(consolidator.Add(verts, vbSize,
+                vbStrides[j], D3D11_BIND_VERTEX_BUFFER));
+            continue;
+        }
 
-        SetDebugObjectName(vbs[j].Get(), "ModelSDKMESH");
+        vbs[j] = compacted.empty()
+            ? data.AddBuffer(verts, vbSize, D3D11_BIND_VERTEX_BUFFER)
+            : data.AddBuffer(std::move(compacted), D3D11_BIND_VERTEX_BUFFER);
     }
 
     if (dec3nwarning)
@@ -565,9 +628,72 @@ std::unique_ptr<Model> Model::CreateFromSDKMESH(
             "         (treating as DXGI_FORMAT_R10G10B10A2_UNORM which is not a signed format)\n");
     }
 
-    // Create index buffers
-    std::vector<ComPtr<ID3D11Buffer>> ibs;
-    ibs.resize(header->NumIndexBuffers);
+    // Adjacent subsets of a mesh with the same material are merged by rewriting the index buffers
+    const bool mergeParts = (flags & ModelLoader_MergeParts) != 0;
+    ModelHelpers::PartMerger merger;
+
+    std::vector<std::vector<uint8_t>> mergedIndices;
+    if (mergeParts)
+    {
+        for (size_t meshIndex = 0; meshIndex < header->NumMeshes; ++meshIndex)
+        {
+            auto& mh = meshArray[meshIndex];
+
+            if (!mh.NumSubsets || mh.IndexBuffer >= header->NumIndexBuffers)
+                throw std::out_of_range("Invalid mesh found");
+
+            sizeBytes = uint64_t(mh.NumSubsets) * sizeof(uint32_t);
+            if (sizeBytes >= UINT32_MAX)
+                throw std::runtime_error("Too many subsets");
+
+            if (dataSize < mh.SubsetOffset
+                || (dataSize < mh.SubsetOffset + sizeBytes))
+                throw std::runtime_error("End of file");
+
+            auto subsets = reinterpret_cast<const uint32_t*>(meshData + mh.SubsetOffset);
+
+            auto& ih = ibArray[mh.IndexBuffer];
+            if (dataSize < ih.DataOffset
+                || (dataSize < ih.DataOffset + ih.SizeBytes))
+                throw std::runtime_error("End of file");
+
+            if (ih.IndexType != DXUT::IT_16BIT && ih.IndexType != DXUT::IT_32BIT)
+                throw std::runtime_error("Invalid index buffer type found");
+
+            auto indices = bufferData + (ih.DataOffset - bufferDataOffset);
+
+            for (size_t j = 0; j < mh.NumSubsets; ++j)
+            {
+                const auto sIndex = subsets[j];
+                if (sIndex >= header->NumTotalSubsets)
+                    throw std::out_of_range("Invalid mesh found");
+
+                auto& subset = subsetArray[sIndex];
+
+                // The subsets of a mesh share its buffers, so the material decides the effect and input layout
+                merger.AddPart(mh.IndexBuffer, indices, static_cast<size_t>(ih.SizeBytes), ih.IndexType == DXUT::IT_32BIT,
+                    static_cast<uint32_t>(subset.IndexStart), static_cast<uint32_t>(subset.IndexCount),
+                    static_cast<int32_t>(subset.VertexStart),
+                    (uint64_t(meshIndex) << 32) | subset.MaterialID,
+                    subset.PrimitiveType == DXUT::PT_TRIANGLE_LIST);
+            }
+        }
+
+        mergedIndices.resize(header->NumIndexBuffers);
+        for (size_t j = 0; j < header->NumIndexBuffers; ++j)
+        {
+            merger.MergeIndices(static_cast<uint32_t>(j), mergedIndices[j]);
+        }
+    }
+
+    // Index buffers. Retained geometry reads the indices from wherever the buffer data ends up.
+    std::vector<uint32_t> ibs;
+    ibs.resize(header->NumIndexBuffers, ModelData::c_None);
+
+    std::vector<const uint8_t*> ibData;
+    std::vector<size_t> ibSizes;
+    ibData.resize(header->NumIndexBuffers);
+    ibSizes.resize(header->NumIndexBuffers);
 
     for (size_t j = 0; j < header->NumIndexBuffers; ++j)
     {
@@ -590,28 +716,44 @@ std::unique_ptr<Model> Model::CreateFromSDKMESH(
             throw std::runtime_error("Invalid index buffer type found");
 
         auto indices = bufferData + (ih.DataOffset - bufferDataOffset);
+        auto ibSize = static_cast<size_t>(ih.SizeBytes);
 
-        D3D11_BUFFER_DESC desc = {};
-        desc.Usage = D3D11_USAGE_DEFAULT;
-        desc.ByteWidth = static_cast<UINT>(ih.SizeBytes);
-        desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+        const bool merged = mergeParts && !mergedIndices[j].empty();
+        if (merged)
+        {
+            indices = mergedIndices[j].data();
+            ibSize = mergedIndices[j].size();
+        }
 
-        D3D11_SUBRESOURCE_DATA initData = { indices, 0, 0 };
+        ibData[j] = indices;
+        ibSizes[j] = ibSize;
 
-        ThrowIfFailed(
-            d3dDevice->CreateBuffer(&desc, &initData, &ibs[j])
-        );
+        if (consolidate)
+        {
+            ibEntries.push_back(consolidator.Add(indices, ibSize,
+                (ih.IndexType == DXUT::IT_32BIT) ? 4u : 2u, D3D11_BIND_INDEX_BUFFER));
+            continue;
+        }
 
-        SetDebugObjectName(ibs[j].Get(), "ModelSDKMESH");
+        if (merged)
+        {
+            ibs[j] = data.AddBuffer(std::move(mergedIndices[j]), D3D11_BIND_INDEX_BUFFER);
+            ibData[j] = data.GetBuffers()[ibs[j]].data;
+        }
+        else
+        {
+            ibs[j] = data.AddBuffer(indices, ibSize, D3D11_BIND_INDEX_BUFFER);
+        }
     }
 
     // Create meshes
     std::vector<MaterialRecordSDKMESH> materials;
     materials.resize(header->NumMaterials);
 
-    auto model = std::make_unique<Model>();
+    auto model = &data.model;
     model->meshes.reserve(header->NumMeshes);
 
+    size_t subsetCount = 0;
     for (size_t meshIndex = 0; meshIndex < header->NumMeshes; ++meshIndex)
     {
         auto& mh = meshArray[meshIndex];
@@ -648,6 +790,13 @@ std::unique_ptr<Model> Model::CreateFromSDKMESH(
             if (flags & ModelLoader_IncludeBones)
             {
                 influences = reinterpret_cast<const uint32_t*>(meshData + mh.FrameInfluenceOffset);
+
+                // Influences index the model bones, which are created from the frames
+                for (size_t k = 0; k < mh.NumFrameInfluences; ++k)
+                {
+                    if (influences[k] >= header->NumFrames)
+                        throw std::out_of_range("Invalid frame influence index found");
+                }
             }
         }
 
@@ -663,12 +812,24 @@ std::unique_ptr<Model> Model::CreateFromSDKMESH(
         mesh->boundingBox.Extents = mh.BoundingBoxExtents;
         BoundingSphere::CreateFromBoundingBox(mesh->boundingSphere, mesh->boundingBox);
 
+        if (compactVertices)
+        {
+            mesh->positionScale = positionScales[mh.VertexBuffers[0]];
+            mesh->positionBias = positionBiases[mh.VertexBuffers[0]];
+        }
+
         if (influences)
         {
             mesh->boneInfluences.resize(mh.NumFrameInfluences);
             memcpy(mesh->boneInfluences.data(), influences, sizeof(uint32_t) * mh.NumFrameInfluences);
         }
 
+        std::shared_ptr<ModelMeshGeometry> geometry;
+        if (flags & ModelLoader_RetainGeometry)
+        {
+            geometry = std::make_shared<ModelMeshGeometry>();
+        }
+
         // Create subsets
         mesh->meshParts.reserve(mh.NumSubsets);
         for (size_t j = 0; j < mh.NumSubsets; ++j)
@@ -679,6 +840,13 @@ std::unique_ptr<Model> Model::CreateFromSDKMESH(
 
             auto& subset = subsetArray[sIndex];
 
+            const size_t mergeIndex = subsetCount++;
+            if (mergeParts && !merger.IsFirstInGroup(mergeIndex))
+            {
+                // Drawn by the part this subset was merged into
+                continue;
+            }
+
             D3D11_PRIMITIVE_TOPOLOGY primType;
             switch (subset.PrimitiveType)
             {
@@ -705,7 +873,7 @@ std::unique_ptr<Model> Model::CreateFromSDKMESH(
 
             auto& mat = materials[subset.MaterialID];
 
-            if (!mat.effect)
+            if (mat.material == ModelData::c_None)
             {
                 const size_t vi = mh.VertexBuffers[0];
 
@@ -714,49 +882,81 @@ std::unique_ptr<Model> Model::CreateFromSDKMESH(
                     LoadMaterial(
                         materialArray_v2[subset.MaterialID],
                         materialFlags[vi],
-                        fxFactory,
-                        mat);
+                        data,
+                        mat,
+                        model->textureNames);
                 }
                 else
                 {
                     LoadMaterial(
                         materialArray[subset.MaterialID],
                         materialFlags[vi],
-                        fxFactory,
+                        data,
                         mat,
-                        (flags & ModelLoader_MaterialColorsSRGB) != 0);
+                        (flags & ModelLoader_MaterialColorsSRGB) != 0,
+                        model->textureNames);
                 }
             }
 
-            ComPtr<ID3D11InputLayout> il;
-            ThrowIfFailed(
-                CreateInputLayoutFromEffect(d3dDevice, mat.effect.get(),
-                    vbDecls[mh.VertexBuffers[0]]->data(), vbDecls[mh.VertexBuffers[0]]->size(), il.GetAddressOf())
-            );
-
-            SetDebugObjectName(il.Get(), "ModelSDKMESH");
-
             auto part = std::make_unique<ModelMeshPart>();
             part->isAlpha = mat.alpha;
 
             part->indexCount = static_cast<uint32_t>(subset.IndexCount);
             part->startIndex = static_cast<uint32_t>(subset.IndexStart);
             part->vertexOffset = static_cast<int32_t>(subset.VertexStart);
-            part->vertexStride = static_cast<uint32_t>(vbArray[mh.VertexBuffers[0]].StrideBytes);
+            part->vertexCount = static_cast<uint32_t>(subset.VertexCount);
+
+            if (mergeParts)
+            {
+                const auto range = merger.GetRange(mergeIndex);
+                part->indexCount = range.indexCount;
+                part->startIndex = range.startIndex;
+                part->vertexOffset = range.vertexOffset;
+                part->vertexCount = range.vertexCount;
+            }
+
+            part->vertexStride = vbStrides[mh.VertexBuffers[0]];
             part->indexFormat = (ibArray[mh.IndexBuffer].IndexType == DXUT::IT_32BIT) ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
             part->primitiveType = primType;
-            part->inputLayout = il;
-            part->indexBuffer = ibs[mh.IndexBuffer];
-            part->vertexBuffer = vbs[mh.VertexBuffers[0]];
-            part->effect = mat.effect;
             part->vbDecl = vbDecls[mh.VertexBuffers[0]];
 
+            data.SetPart(part.get(), mat.material, vbs[mh.VertexBuffers[0]], ibs[mh.IndexBuffer]);
+
+            if (geometry)
+            {
+                auto& vh = vbArray[mh.VertexBuffers[0]];
+
+                const auto& fileDecl = (compactVertices && fileDecls[mh.VertexBuffers[0]])
+                    ? fileDecls[mh.VertexBuffers[0]] : vbDecls[mh.VertexBuffers[0]];
+
+                ModelHelpers::AddPartGeometry(*geometry, static_cast<uint32_t>(mesh->meshParts.size()), *mesh, *part,
+                    *fileDecl, static_cast<uint32_t>(vh.StrideBytes),
+                    bufferData + (vh.DataOffset - bufferDataOffset), static_cast<size_t>(vh.SizeBytes),
+                    ibData[mh.IndexBuffer], ibSizes[mh.IndexBuffer]);
+            }
+
+            if (consolidate)
+            {
+                consolidator.Assign(part.get(), vbEntries[mh.VertexBuffers[0]], ibEntries[mh.IndexBuffer]);
+            }
+
             mesh->meshParts.emplace_back(std::move(part));
         }
 
+        if (geometry)
+        {
+            geometry->Build();
+            mesh->geometry = std::move(geometry);
+        }
+
         model->meshes.emplace_back(mesh);
     }
 
+    if (consolidate)
+    {
+        consolidator.Build(data);
+    }
+
     // Load model bones (if present and requested)
     if (frameArray)
     {
@@ -797,6 +997,7 @@ std::unique_ptr<Model> Model::CreateFromSDKMESH(
         }
 
         std::swap(model->bones, bones);
+        model->Modified();
 
         // Compute inverse bind pose matrices for the model
         auto bindPose = ModelBone::MakeArray(header->NumFrames);
@@ -811,8 +1012,25 @@ std::unique_ptr<Model> Model::CreateFromSDKMESH(
         std::swap(model->boneMatrices, transforms);
         std::swap(model->invBindPoseMatrices, invBoneTransforms);
     }
+}
 
-    return model;
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+std::unique_ptr<Model> Model::CreateFromSDKMESH(
+    ID3D11Device* d3dDevice,
+    const uint8_t* meshData,
+    size_t dataSize,
+    IEffectFactory& fxFactory,
+    ModelLoaderFlags flags)
+{
+    if (!d3dDevice || !meshData)
+        throw std::invalid_argument("Device and meshData cannot be null");
+
+    ModelData data("ModelSDKMESH");
+    LoadSDKMESH(data, meshData, dataSize, flags);
+
+    return data.Create(d3dDevice, &fxFactory);
 }
 
 
@@ -824,9 +1042,13 @@ std::unique_ptr<Model> Model::CreateFromSDKMESH(
     IEffectFactory& fxFactory,
     ModelLoaderFlags flags)
 {
+    // A mapped file lets buffer creation read the vertex and index data in place
     size_t dataSize = 0;
     std::unique_ptr<uint8_t[]> data;
-    HRESULT hr = BinaryReader::ReadEntireFile(szFileName, data, &dataSize);
+    ScopedFileView view;
+    HRESULT hr = (flags & ModelLoader_MemoryMappedFile)
+        ? BinaryReader::MapEntireFile(szFileName, view, &dataSize)
+        : BinaryReader::ReadEntireFile(szFileName, data, &dataSize);
     if (FAILED(hr))
     {
         DebugTrace("ERROR: CreateFromSDKMESH failed (%08X) loading '%ls'\n",
@@ -834,7 +1056,9 @@ std::unique_ptr<Model> Model::CreateFromSDKMESH(
         throw std::runtime_error("CreateFromSDKMESH");
     }
 
-    auto model = CreateFromSDKMESH(device, data.get(), dataSize, fxFactory, flags);
+    auto meshData = view ? static_cast<const uint8_t*>(view.get()) : data.get();
+
+    auto model = CreateFromSDKMESH(device, meshData, dataSize, fxFactory, flags);
 
     model->name = szFileName;
 
@@ -13,12 +13,14 @@
 #include "Effects.h"
 #include "VertexTypes.h"
 #include "BinaryReader.h"
+#include "ModelData.h"
+#include "ModelPicking.h"
 #include "PlatformHelpers.h"
 
 #include "vbo.h"
 
 using namespace DirectX;
-using Microsoft::WRL::ComPtr;
+using namespace DirectX::ModelHelpers;
 
 static_assert(sizeof(VertexPositionNormalTexture) == sizeof(VBO::vertex_t), "VBO vertex size mismatch");
 
@@ -46,17 +48,16 @@ namespace
 
 //--------------------------------------------------------------------------------------
 _Use_decl_annotations_
-std::unique_ptr<Model> Model::CreateFromVBO(
-    ID3D11Device* device,
+void ModelHelpers::LoadVBO(
+    ModelData& data,
     const uint8_t* meshData, size_t dataSize,
-    std::shared_ptr<IEffect> ieffect,
     ModelLoaderFlags flags)
 {
     if (!InitOnceExecuteOnce(&g_InitOnce, InitializeDecl, nullptr, nullptr))
         throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "InitOnceExecuteOnce");
 
-    if (!device || !meshData)
-        throw std::invalid_argument("Device and meshData cannot be null");
+    if (!meshData)
+        throw std::invalid_argument("meshData cannot be null");
 
     // File Header
     if (dataSize < sizeof(VBO::header_t))
@@ -100,68 +101,19 @@ std::unique_ptr<Model> Model::CreateFromVBO(
         throw std::runtime_error("End of file");
     auto indices = reinterpret_cast<const uint16_t*>(meshData + sizeof(VBO::header_t) + vertSize);
 
-    // Create vertex buffer
-    ComPtr<ID3D11Buffer> vb;
-    {
-        D3D11_BUFFER_DESC desc = {};
-        desc.Usage = D3D11_USAGE_DEFAULT;
-        desc.ByteWidth = static_cast<UINT>(vertSize);
-        desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-
-        D3D11_SUBRESOURCE_DATA initData = { verts, 0, 0 };
-
-        ThrowIfFailed(
-            device->CreateBuffer(&desc, &initData, vb.GetAddressOf())
-        );
-
-        SetDebugObjectName(vb.Get(), "ModelVBO");
-    }
-
-    // Create index buffer
-    ComPtr<ID3D11Buffer> ib;
-    {
-        D3D11_BUFFER_DESC desc = {};
-        desc.Usage = D3D11_USAGE_DEFAULT;
-        desc.ByteWidth = static_cast<UINT>(indexSize);
-        desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-
-        D3D11_SUBRESOURCE_DATA initData = { indices, 0, 0 };
-
-        ThrowIfFailed(
-            device->CreateBuffer(&desc, &initData, ib.GetAddressOf())
-        );
-
-        SetDebugObjectName(ib.Get(), "ModelVBO");
-    }
-
-    // Create input layout and effect
-    if (!ieffect)
-    {
-        auto effect = std::make_shared<BasicEffect>(device);
-        effect->EnableDefaultLighting();
-        effect->SetLightingEnabled(true);
-
-        ieffect = effect;
-    }
-
-    ComPtr<ID3D11InputLayout> il;
-
-    ThrowIfFailed(
-        CreateInputLayoutFromEffect<VertexPositionNormalTexture>(device, ieffect.get(), il.GetAddressOf())
-    );
-
-    SetDebugObjectName(il.Get(), "ModelVBO");
+    // The file data is used as is; VBO files have no materials, so the part uses the default effect
+    const uint32_t vb = data.AddBuffer(verts, vertSize, D3D11_BIND_VERTEX_BUFFER);
+    const uint32_t ib = data.AddBuffer(indices, indexSize, D3D11_BIND_INDEX_BUFFER);
 
     auto part = std::make_unique<ModelMeshPart>();
     part->indexCount = header->numIndices;
     part->startIndex = 0;
     part->vertexStride = static_cast<UINT>(sizeof(VertexPositionNormalTexture));
-    part->inputLayout = il;
-    part->indexBuffer = ib;
-    part->vertexBuffer = vb;
-    part->effect = ieffect;
+    part->vertexCount = header->numVertices;
     part->vbDecl = g_vbdecl;
 
+    data.SetPart(part.get(), data.AddDefaultMaterial(), vb, ib);
+
     auto mesh = std::make_shared<ModelMesh>();
     mesh->ccw = (flags & ModelLoader_CounterClockwise) != 0;
     mesh->pmalpha = (flags & ModelLoader_PremultipledAlpha) != 0;
@@ -170,11 +122,36 @@ std::unique_ptr<Model> Model::CreateFromVBO(
     mesh->meshParts.reserve(1);
     mesh->meshParts.emplace_back(std::move(part));
 
-    auto model = std::make_unique<Model>();
-    model->meshes.reserve(1);
-    model->meshes.emplace_back(mesh);
+    if (flags & ModelLoader_RetainGeometry)
+    {
+        auto geometry = std::make_shared<ModelMeshGeometry>();
+        geometry->AddTriangles(0, indices, header->numIndices / 3,
+            &verts->position, sizeof(VertexPositionNormalTexture), header->numVertices);
+        geometry->Build();
+
+        mesh->geometry = std::move(geometry);
+    }
 
-    return model;
+    data.model.meshes.reserve(1);
+    data.model.meshes.emplace_back(mesh);
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+std::unique_ptr<Model> Model::CreateFromVBO(
+    ID3D11Device* device,
+    const uint8_t* meshData, size_t dataSize,
+    std::shared_ptr<IEffect> ieffect,
+    ModelLoaderFlags flags)
+{
+    if (!device || !meshData)
+        throw std::invalid_argument("Device and meshData cannot be null");
+
+    ModelData data("ModelVBO");
+    LoadVBO(data, meshData, dataSize, flags);
+
+    return data.Create(device, nullptr, ieffect);
 }
 
 
@@ -186,9 +163,13 @@ std::unique_ptr<Model> Model::CreateFromVBO(
     std::shared_ptr<IEffect> ieffect,
     ModelLoaderFlags flags)
 {
+    // A mapped file lets buffer creation read the vertex and index data in place
     size_t dataSize = 0;
     std::unique_ptr<uint8_t[]> data;
-    HRESULT hr = BinaryReader::ReadEntireFile(szFileName, data, &dataSize);
+    ScopedFileView view;
+    HRESULT hr = (flags & ModelLoader_MemoryMappedFile)
+        ? BinaryReader::MapEntireFile(szFileName, view, &dataSize)
+        : BinaryReader::ReadEntireFile(szFileName, data, &dataSize);
     if (FAILED(hr))
     {
         DebugTrace("ERROR: CreateFromVBO failed (%08X) loading '%ls'\n",
@@ -196,7 +177,9 @@ std::unique_ptr<Model> Model::CreateFromVBO(
         throw std::runtime_error("CreateFromVBO");
     }
 
-    auto model = CreateFromVBO(device, data.get(), dataSize, ieffect, flags);
+    auto meshData = view ? static_cast<const uint8_t*>(view.get()) : data.get();
+
+    auto model = CreateFromVBO(device, meshData, dataSize, ieffect, flags);
 
     model->name = szFileName;
 
@@ -0,0 +1,833 @@
+//--------------------------------------------------------------------------------------
+// File: ModelPicking.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "ModelPicking.h"
+
+#include "ModelHelpers.h"
+#include "PlatformHelpers.h"
+#include "WorkerThreads.h"
+
+#include <atomic>
+#include <exception>
+
+using namespace DirectX;
+using namespace DirectX::SimpleMath;
+
+namespace
+{
+    // Binned surface area heuristic
+    constexpr size_t c_SAHBins = 16;
+    constexpr float c_TraversalCost = 1.f;
+    constexpr float c_IntersectionCost = 1.f;
+    constexpr uint32_t c_MaxLeafTriangles = 8;
+
+    // Nodes at this depth become leaves, which bounds the traversal stack
+    constexpr uint32_t c_MaxTreeDepth = 48;
+
+    // Meshes per unit of work when picking across threads
+    constexpr size_t c_MeshesPerChunk = 64;
+
+    struct Node
+    {
+        XMFLOAT3    bmin;
+        uint32_t    first;      // First triangle of a leaf, or the left child (right is first + 1)
+        XMFLOAT3    bmax;
+        uint32_t    count;      // Triangles in a leaf, zero for an interior node
+    };
+
+    struct Bounds
+    {
+        XMVECTOR bmin;
+        XMVECTOR bmax;
+
+        void Reset() noexcept
+        {
+            bmin = XMVectorReplicate(FLT_MAX);
+            bmax = XMVectorReplicate(-FLT_MAX);
+        }
+
+        void Grow(FXMVECTOR p) noexcept
+        {
+            bmin = XMVectorMin(bmin, p);
+            bmax = XMVectorMax(bmax, p);
+        }
+
+        void Grow(const Bounds& b) noexcept
+        {
+            bmin = XMVectorMin(bmin, b.bmin);
+            bmax = XMVectorMax(bmax, b.bmax);
+        }
+
+        float HalfArea() const noexcept
+        {
+            const XMVECTOR e = XMVectorMax(XMVectorSubtract(bmax, bmin), XMVectorZero());
+            XMFLOAT3 d;
+            XMStoreFloat3(&d, e);
+            return d.x * d.y + d.y * d.z + d.z * d.x;
+        }
+    };
+
+    // Distance along the ray at which it enters the box, or FLT_MAX if it misses within maxDistance
+    inline float XM_CALLCONV IntersectBox(
+        const Node& node,
+        FXMVECTOR origin,
+        FXMVECTOR invDirection,
+        float maxDistance) noexcept
+    {
+        const XMVECTOR t0 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&node.bmin), origin), invDirection);
+        const XMVECTOR t1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&node.bmax), origin), invDirection);
+
+        // A ray parallel to an axis that starts on a slab plane gives 0 * inf = NaN. That axis
+        // does not limit the ray, and min/max would pass the NaN on or drop it depending on
+        // the operand order, so NaNs are replaced before the slabs are combined.
+        const XMVECTOR nan0 = XMVectorIsNaN(t0);
+        const XMVECTOR nan1 = XMVectorIsNaN(t1);
+
+        XMFLOAT3 tnear, tfar;
+        XMStoreFloat3(&tnear, XMVectorMin(XMVectorSelect(t0, g_XMNegInfinity, nan0), XMVectorSelect(t1, g_XMNegInfinity, nan1)));
+        XMStoreFloat3(&tfar, XMVectorMax(XMVectorSelect(t0, g_XMInfinity, nan0), XMVectorSelect(t1, g_XMInfinity, nan1)));
+
+        const float enter = std::max(std::max(tnear.x, tnear.y), std::max(tnear.z, 0.f));
+        const float exit = std::min(std::min(tfar.x, tfar.y), std::min(tfar.z, maxDistance));
+
+        return (enter <= exit) ? enter : FLT_MAX;
+    }
+
+    // Moller-Trumbore, accepting either winding
+    inline bool XM_CALLCONV IntersectTriangle(
+        FXMVECTOR origin,
+        FXMVECTOR direction,
+        const XMFLOAT3* v,
+        float maxDistance,
+        float& distance) noexcept
+    {
+        const XMVECTOR v0 = XMLoadFloat3(&v[0]);
+        const XMVECTOR e1 = XMVectorSubtract(XMLoadFloat3(&v[1]), v0);
+        const XMVECTOR e2 = XMVectorSubtract(XMLoadFloat3(&v[2]), v0);
+
+        const XMVECTOR p = XMVector3Cross(direction, e2);
+        const float det = XMVectorGetX(XMVector3Dot(e1, p));
+        if (det == 0.f)
+            return false;
+
+        const float invDet = 1.f / det;
+
+        const XMVECTOR s = XMVectorSubtract(origin, v0);
+        const float u = XMVectorGetX(XMVector3Dot(s, p)) * invDet;
+        if (u < 0.f || u > 1.f)
+            return false;
+
+        const XMVECTOR q = XMVector3Cross(s, e1);
+        const float w = XMVectorGetX(XMVector3Dot(direction, q)) * invDet;
+        if (w < 0.f || u + w > 1.f)
+            return false;
+
+        const float t = XMVectorGetX(XMVector3Dot(e2, q)) * invDet;
+        if (t < 0.f || t > maxDistance)
+            return false;
+
+        distance = t;
+        return true;
+    }
+
+    struct PickHit
+    {
+        bool            hit;
+        ModelPickResult result;
+    };
+}
+
+
+//--------------------------------------------------------------------------------------
+// ModelMeshGeometry::Impl
+//--------------------------------------------------------------------------------------
+
+class ModelMeshGeometry::Impl
+{
+public:
+    Impl() noexcept = default;
+
+    template<typename index_t>
+    void AddTriangles(
+        uint32_t partIndex,
+        const index_t* indices, size_t nFaces,
+        const void* positions, size_t vertexStride, size_t nVerts);
+
+    void Build();
+
+    bool XM_CALLCONV Intersects(
+        FXMVECTOR origin,
+        FXMVECTOR direction,
+        float maxDistance,
+        float& distance,
+        uint32_t& partIndex,
+        uint32_t& triangleIndex) const;
+
+    // Three positions per triangle, in hierarchy order once built
+    std::vector<XMFLOAT3>   vertices;
+    std::vector<uint32_t>   parts;
+    std::vector<uint32_t>   triangles;
+    std::vector<Node>       nodes;
+};
+
+
+template<typename index_t>
+void ModelMeshGeometry::Impl::AddTriangles(
+    uint32_t partIndex,
+    const index_t* indices, size_t nFaces,
+    const void* positions, size_t vertexStride, size_t nVerts)
+{
+    if (!nFaces)
+        return;
+
+    if (!indices || !positions || !nVerts)
+        throw std::invalid_argument("Requires both vertices and indices");
+
+    if (vertexStride < sizeof(XMFLOAT3))
+        throw std::invalid_argument("Invalid vertex stride");
+
+    if (nFaces > UINT32_MAX || parts.size() + nFaces > UINT32_MAX)
+        throw std::out_of_range("Too many triangles");
+
+    vertices.reserve(vertices.size() + nFaces * 3);
+    parts.reserve(parts.size() + nFaces);
+    triangles.reserve(triangles.size() + nFaces);
+
+    auto ptr = static_cast<const uint8_t*>(positions);
+    for (size_t face = 0; face < nFaces; ++face)
+    {
+        for (size_t k = 0; k < 3; ++k)
+        {
+            const index_t index = indices[face * 3 + k];
+            if (index >= nVerts)
+                throw std::out_of_range("Index not in vertices list");
+
+            XMFLOAT3 pos;
+            memcpy(&pos, ptr + size_t(index) * vertexStride, sizeof(XMFLOAT3));
+            vertices.push_back(pos);
+        }
+
+        parts.push_back(partIndex);
+        triangles.push_back(static_cast<uint32_t>(face));
+    }
+
+    nodes.clear();
+}
+
+
+void ModelMeshGeometry::Impl::Build()
+{
+    nodes.clear();
+
+    const size_t count = parts.size();
+    if (!count)
+        return;
+
+    std::vector<XMFLOAT3> centroids(count);
+    for (size_t j = 0; j < count; ++j)
+    {
+        const XMVECTOR sum = XMVectorAdd(XMVectorAdd(
+            XMLoadFloat3(&vertices[j * 3]),
+            XMLoadFloat3(&vertices[j * 3 + 1])),
+            XMLoadFloat3(&vertices[j * 3 + 2]));
+        XMStoreFloat3(&centroids[j], XMVectorScale(sum, 1.f / 3.f));
+    }
+
+    std::vector<uint32_t> order(count);
+    for (size_t j = 0; j < count; ++j)
+    {
+        order[j] = static_cast<uint32_t>(j);
+    }
+
+    auto triangleBounds = [this](uint32_t tri) noexcept
+        {
+            Bounds b;
+            b.bmin = b.bmax = XMLoadFloat3(&vertices[size_t(tri) * 3]);
+            b.Grow(XMLoadFloat3(&vertices[size_t(tri) * 3 + 1]));
+            b.Grow(XMLoadFloat3(&vertices[size_t(tri) * 3 + 2]));
+            return b;
+        };
+
+    nodes.reserve(count * 2);
+    nodes.push_back(Node{ {}, 0, {}, static_cast<uint32_t>(count) });
+
+    // Nodes waiting to be split hold their triangle range in 'first' and 'count'
+    std::vector<std::pair<uint32_t, uint32_t>> pending;
+    pending.emplace_back(0, 0);
+
+    while (!pending.empty())
+    {
+        const uint32_t nodeIndex = pending.back().first;
+        const uint32_t depth = pending.back().second;
+        pending.pop_back();
+
+        const uint32_t first = nodes[nodeIndex].first;
+        const uint32_t n = nodes[nodeIndex].count;
+
+        Bounds bounds;
+        Bounds centroidBounds;
+        bounds.Reset();
+        centroidBounds.Reset();
+        for (uint32_t j = first; j < first + n; ++j)
+        {
+            bounds.Grow(triangleBounds(order[j]));
+            centroidBounds.Grow(XMLoadFloat3(&centroids[order[j]]));
+        }
+
+        XMStoreFloat3(&nodes[nodeIndex].bmin, bounds.bmin);
+        XMStoreFloat3(&nodes[nodeIndex].bmax, bounds.bmax);
+
+        if (n <= 1 || depth + 1 >= c_MaxTreeDepth)
+            continue;
+
+        // Bin the centroids along the widest axis
+        XMFLOAT3 cmin, cmax;
+        XMStoreFloat3(&cmin, centroidBounds.bmin);
+        XMStoreFloat3(&cmax, centroidBounds.bmax);
+
+        const float extent[3] = { cmax.x - cmin.x, cmax.y - cmin.y, cmax.z - cmin.z };
+        const float start[3] = { cmin.x, cmin.y, cmin.z };
+
+        int axis = 0;
+        if (extent[1] > extent[axis])
+            axis = 1;
+        if (extent[2] > extent[axis])
+            axis = 2;
+
+        auto centroidAxis = [&centroids, axis](uint32_t tri) noexcept
+            {
+                const XMFLOAT3& c = centroids[tri];
+                return (axis == 0) ? c.x : ((axis == 1) ? c.y : c.z);
+            };
+
+        uint32_t mid = first;
+        bool split = false;
+
+        if (extent[axis] > 0.f)
+        {
+            const float scale = float(c_SAHBins) / extent[axis];
+
+            auto binIndex = [&](uint32_t tri) noexcept
+                {
+                    const auto bin = static_cast<size_t>((centroidAxis(tri) - start[axis]) * scale);
+                    return std::min(bin, c_SAHBins - 1);
+                };
+
+            Bounds binBounds[c_SAHBins];
+            uint32_t binCounts[c_SAHBins] = {};
+            for (auto& it : binBounds)
+            {
+                it.Reset();
+            }
+
+            for (uint32_t j = first; j < first + n; ++j)
+            {
+                const size_t bin = binIndex(order[j]);
+                binBounds[bin].Grow(triangleBounds(order[j]));
+                ++binCounts[bin];
+            }
+
+            // Sweep from the right to get the cost of each of the split planes between bins
+            float rightArea[c_SAHBins - 1];
+            uint32_t rightCount[c_SAHBins - 1];
+            {
+                Bounds b;
+                b.Reset();
+                uint32_t total = 0;
+                for (size_t j = c_SAHBins - 1; j > 0; --j)
+                {
+                    b.Grow(binBounds[j]);
+                    total += binCounts[j];
+                    rightArea[j - 1] = b.HalfArea();
+                    rightCount[j - 1] = total;
+                }
+            }
+
+            float bestCost = FLT_MAX;
+            size_t bestSplit = 0;
+            {
+                Bounds b;
+                b.Reset();
+                uint32_t total = 0;
+                for (size_t j = 0; j < c_SAHBins - 1; ++j)
+                {
+                    b.Grow(binBounds[j]);
+                    total += binCounts[j];
+
+                    if (!total || !rightCount[j])
+                        continue;
+
+                    const float cost = b.HalfArea() * float(total) + rightArea[j] * float(rightCount[j]);
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestSplit = j;
+                    }
+                }
+            }
+
+            const float area = bounds.HalfArea();
+            const float leafCost = c_IntersectionCost * float(n);
+            const float splitCost = (area > 0.f)
+                ? c_TraversalCost + c_IntersectionCost * bestCost / area
+                : leafCost;
+
+            if (bestCost < FLT_MAX && (splitCost < leafCost || n > c_MaxLeafTriangles))
+            {
+                auto it = std::partition(order.begin() + first, order.begin() + first + n,
+                    [&](uint32_t tri) noexcept { return binIndex(tri) <= bestSplit; });
+
+                mid = static_cast<uint32_t>(it - order.begin());
+                split = true;
+            }
+        }
+
+        if (!split)
+        {
+            if (n <= c_MaxLeafTriangles)
+                continue;
+
+            // All centroids coincide or no plane separates them, so split the range in half
+            mid = first + n / 2;
+            std::nth_element(order.begin() + first, order.begin() + mid, order.begin() + first + n,
+                [&](uint32_t a, uint32_t b) noexcept { return centroidAxis(a) < centroidAxis(b); });
+        }
+
+        const auto left = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(Node{ {}, first, {}, mid - first });
+        nodes.push_back(Node{ {}, mid, {}, first + n - mid });
+
+        nodes[nodeIndex].first = left;
+        nodes[nodeIndex].count = 0;
+
+        pending.emplace_back(left + 1, depth + 1);
+        pending.emplace_back(left, depth + 1);
+    }
+
+    // Store the triangles in leaf order
+    std::vector<XMFLOAT3> sortedVertices(count * 3);
+    std::vector<uint32_t> sortedParts(count);
+    std::vector<uint32_t> sortedTriangles(count);
+    for (size_t j = 0; j < count; ++j)
+    {
+        const size_t src = order[j];
+        sortedVertices[j * 3] = vertices[src * 3];
+        sortedVertices[j * 3 + 1] = vertices[src * 3 + 1];
+        sortedVertices[j * 3 + 2] = vertices[src * 3 + 2];
+        sortedParts[j] = parts[src];
+        sortedTriangles[j] = triangles[src];
+    }
+
+    std::swap(vertices, sortedVertices);
+    std::swap(parts, sortedParts);
+    std::swap(triangles, sortedTriangles);
+
+    nodes.shrink_to_fit();
+}
+
+
+_Use_decl_annotations_
+bool XM_CALLCONV ModelMeshGeometry::Impl::Intersects(
+    FXMVECTOR origin,
+    FXMVECTOR direction,
+    float maxDistance,
+    float& distance,
+    uint32_t& partIndex,
+    uint32_t& triangleIndex) const
+{
+    if (nodes.empty())
+    {
+        if (!parts.empty())
+            throw std::runtime_error("ModelMeshGeometry::Build must be called before queries");
+
+        return false;
+    }
+
+    const XMVECTOR invDirection = XMVectorReciprocal(direction);
+
+    float closest = maxDistance;
+    size_t hit = SIZE_MAX;
+
+    uint32_t stack[c_MaxTreeDepth + 1];
+    size_t depth = 0;
+
+    if (IntersectBox(nodes[0], origin, invDirection, closest) == FLT_MAX)
+        return false;
+
+    stack[depth++] = 0;
+
+    while (depth > 0)
+    {
+        const Node& node = nodes[stack[--depth]];
+
+        if (node.count > 0)
+        {
+            for (uint32_t j = node.first; j < node.first + node.count; ++j)
+            {
+                float t;
+                if (IntersectTriangle(origin, direction, &vertices[size_t(j) * 3], closest, t))
+                {
+                    closest = t;
+                    hit = j;
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first so the farther one can be rejected by the closer hit
+        uint32_t nearChild = node.first;
+        uint32_t farChild = node.first + 1;
+
+        float nearT = IntersectBox(nodes[nearChild], origin, invDirection, closest);
+        float farT = IntersectBox(nodes[farChild], origin, invDirection, closest);
+
+        if (farT < nearT)
+        {
+            std::swap(nearChild, farChild);
+            std::swap(nearT, farT);
+        }
+
+        // Each level leaves at most one far child behind, so the stack cannot overflow
+        if (farT != FLT_MAX)
+        {
+            assert(depth <= c_MaxTreeDepth);
+            stack[depth++] = farChild;
+        }
+
+        if (nearT != FLT_MAX)
+        {
+            assert(depth <= c_MaxTreeDepth);
+            stack[depth++] = nearChild;
+        }
+    }
+
+    if (hit == SIZE_MAX)
+        return false;
+
+    distance = closest;
+    partIndex = parts[hit];
+    triangleIndex = triangles[hit];
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// ModelMeshGeometry
+//--------------------------------------------------------------------------------------
+
+ModelMeshGeometry::ModelMeshGeometry() :
+    pImpl(std::make_unique<Impl>())
+{}
+
+ModelMeshGeometry::ModelMeshGeometry(ModelMeshGeometry&&) noexcept = default;
+ModelMeshGeometry& ModelMeshGeometry::operator= (ModelMeshGeometry&&) noexcept = default;
+ModelMeshGeometry::~ModelMeshGeometry() = default;
+
+
+_Use_decl_annotations_
+void ModelMeshGeometry::AddTriangles(
+    uint32_t partIndex,
+    const uint16_t* indices, size_t nFaces,
+    const void* positions, size_t vertexStride, size_t nVerts)
+{
+    pImpl->AddTriangles(partIndex, indices, nFaces, positions, vertexStride, nVerts);
+}
+
+_Use_decl_annotations_
+void ModelMeshGeometry::AddTriangles(
+    uint32_t partIndex,
+    const uint32_t* indices, size_t nFaces,
+    const void* positions, size_t vertexStride, size_t nVerts)
+{
+    pImpl->AddTriangles(partIndex, indices, nFaces, positions, vertexStride, nVerts);
+}
+
+
+void ModelMeshGeometry::Build()
+{
+    pImpl->Build();
+}
+
+
+size_t ModelMeshGeometry::GetTriangleCount() const noexcept
+{
+    return pImpl->parts.size();
+}
+
+
+_Use_decl_annotations_
+bool XM_CALLCONV ModelMeshGeometry::Intersects(
+    FXMVECTOR origin,
+    FXMVECTOR direction,
+    float maxDistance,
+    float& distance,
+    uint32_t& partIndex,
+    uint32_t& triangleIndex) const
+{
+    return pImpl->Intersects(origin, direction, maxDistance, distance, partIndex, triangleIndex);
+}
+
+
+_Use_decl_annotations_
+std::shared_ptr<ModelMeshGeometry> ModelMeshGeometry::CreateFromMesh(
+    ID3D11DeviceContext* deviceContext,
+    const ModelMesh& mesh)
+{
+    if (!deviceContext)
+        throw std::invalid_argument("Direct3D device context is null");
+
+    auto geometry = std::make_shared<ModelMeshGeometry>();
+
+    // Parts frequently share buffers, so each is read back once
+    std::map<ID3D11Buffer*, std::vector<uint8_t>> data;
+
+    auto readBack = [&](ID3D11Buffer* buffer) -> const std::vector<uint8_t>&
+        {
+            auto& it = data[buffer];
+            if (it.empty())
+            {
+                ModelHelpers::ReadBackBuffer(deviceContext, buffer, it);
+            }
+            return it;
+        };
+
+    for (size_t j = 0; j < mesh.meshParts.size(); ++j)
+    {
+        auto part = mesh.meshParts[j].get();
+        assert(part != nullptr);
+
+        if (!part->vertexBuffer || !part->indexBuffer || !part->vbDecl)
+            continue;
+
+        const auto& vb = readBack(part->vertexBuffer.Get());
+        const auto& ib = readBack(part->indexBuffer.Get());
+
+        ModelHelpers::AddPartGeometry(*geometry, static_cast<uint32_t>(j), mesh, *part, *part->vbDecl, part->vertexStride,
+            vb.data(), vb.size(), ib.data(), ib.size());
+    }
+
+    geometry->Build();
+
+    return geometry;
+}
+
+
+//--------------------------------------------------------------------------------------
+// ModelPicker
+//--------------------------------------------------------------------------------------
+
+namespace
+{
+    void PickRange(
+        FXMVECTOR origin,
+        FXMVECTOR direction,
+        float maxDistance,
+        size_t first,
+        size_t last,
+        const std::vector<size_t>& meshOffsets,
+        _In_ const Model* const* models,
+        _In_ const XMMATRIX* worlds,
+        _In_opt_ const XMMATRIX* const* boneTransforms,
+        PickHit& best)
+    {
+        best.hit = false;
+
+        float closest = maxDistance;
+
+        // Find the instance holding the first mesh of the range
+        size_t instance = static_cast<size_t>(
+            std::upper_bound(meshOffsets.cbegin(), meshOffsets.cend(), first) - meshOffsets.cbegin()) - 1;
+
+        for (size_t item = first; item < last; ++item)
+        {
+            while (item >= meshOffsets[instance + 1])
+                ++instance;
+
+            auto model = models[instance];
+            assert(model != nullptr);
+
+            const size_t meshIndex = item - meshOffsets[instance];
+            auto mesh = model->meshes[meshIndex].get();
+            assert(mesh != nullptr);
+
+            if (!mesh->geometry)
+                continue;
+
+            XMMATRIX local = worlds[instance];
+            if (boneTransforms && boneTransforms[instance]
+                && mesh->boneIndex != ModelBone::c_Invalid && mesh->boneIndex < model->bones.size())
+            {
+                local = XMMatrixMultiply(boneTransforms[instance][mesh->boneIndex], local);
+            }
+
+            XMVECTOR det;
+            const XMMATRIX invLocal = XMMatrixInverse(&det, local);
+            if (fabsf(XMVectorGetX(det)) < FLT_MIN)
+                continue;
+
+            // Intersecting in mesh space with an unnormalized direction keeps distances in world units
+            const XMVECTOR meshOrigin = XMVector3TransformCoord(origin, invLocal);
+            const XMVECTOR meshDirection = XMVector3TransformNormal(direction, invLocal);
+
+            float t;
+            uint32_t partIndex, triangleIndex;
+            if (mesh->geometry->Intersects(meshOrigin, meshDirection, closest, t, partIndex, triangleIndex))
+            {
+                // Equal distances keep the earlier mesh so the result does not depend on the thread count
+                if (!best.hit || t < closest)
+                {
+                    closest = t;
+                    best.hit = true;
+                    best.result = ModelPickResult{ t,
+                        static_cast<uint32_t>(instance), static_cast<uint32_t>(meshIndex), partIndex, triangleIndex };
+                }
+            }
+        }
+    }
+}
+
+
+_Use_decl_annotations_
+bool ModelPicker::Pick(
+    const Ray& ray,
+    float maxDistance,
+    size_t instanceCount,
+    const Model* const* models,
+    const XMMATRIX* worlds,
+    ModelPickResult& result,
+    unsigned int threadCount,
+    const XMMATRIX* const* boneTransforms)
+{
+    if (!instanceCount)
+        return false;
+
+    if (!models || !worlds)
+    {
+        throw std::invalid_argument("Models and world matrices arrays required");
+    }
+
+    if (instanceCount > UINT32_MAX)
+    {
+        throw std::out_of_range("Too many instances");
+    }
+
+    if (maxDistance < 0.f)
+        return false;
+
+    // Meshes of all instances are numbered consecutively so work can be split evenly
+    mMeshOffsets.resize(instanceCount + 1);
+    mMeshOffsets[0] = 0;
+    for (size_t i = 0; i < instanceCount; ++i)
+    {
+        mMeshOffsets[i + 1] = mMeshOffsets[i] + (models[i] ? models[i]->meshes.size() : 0);
+    }
+
+    const size_t meshCount = mMeshOffsets[instanceCount];
+    if (!meshCount)
+        return false;
+
+    const XMVECTOR origin = XMLoadFloat3(&ray.position);
+    const XMVECTOR direction = XMLoadFloat3(&ray.direction);
+
+    // Meshes are handed out in fixed size chunks, each with its own result, so the outcome
+    // does not depend on how many threads run or which thread picks up which chunk
+    const size_t chunkCount = (meshCount + c_MeshesPerChunk - 1) / c_MeshesPerChunk;
+
+    std::vector<PickHit> hits(chunkCount);
+    std::vector<std::exception_ptr> errors(chunkCount);
+
+    std::atomic<size_t> next(0);
+
+    const size_t nthreads = std::min<size_t>(std::max(1u, threadCount), chunkCount);
+
+    if (nthreads > 1 && !mWorkers)
+    {
+        mWorkers = WorkerThreads::Get();
+    }
+
+    auto worker = [&](size_t) noexcept
+        {
+            for (;;)
+            {
+                const size_t chunk = next++;
+                if (chunk >= chunkCount)
+                    break;
+
+                const size_t first = chunk * c_MeshesPerChunk;
+                const size_t last = std::min(meshCount, first + c_MeshesPerChunk);
+
+                try
+                {
+                    PickRange(origin, direction, maxDistance, first, last, mMeshOffsets,
+                        models, worlds, boneTransforms, hits[chunk]);
+                }
+                catch (...)
+                {
+                    errors[chunk] = std::current_exception();
+                }
+            }
+        };
+
+    if (nthreads > 1)
+    {
+        mWorkers->ParallelFor(nthreads, worker);
+    }
+    else
+    {
+        worker(0);
+    }
+
+    // Errors are rethrown in chunk order, so the exception does not depend on the thread count
+    for (const auto& it : errors)
+    {
+        if (it)
+        {
+            std::rethrow_exception(it);
+        }
+    }
+
+    // Chunks are in mesh order, so only a strictly closer hit replaces an earlier one
+    const PickHit* best = nullptr;
+    for (const auto& it : hits)
+    {
+        if (it.hit && (!best || it.result.distance < best->result.distance))
+        {
+            best = &it;
+        }
+    }
+
+    if (!best)
+        return false;
+
+    result = best->result;
+    return true;
+}
+
+
+_Use_decl_annotations_
+bool ModelPicker::PickSegment(
+    const Vector3& start,
+    const Vector3& end,
+    size_t instanceCount,
+    const Model* const* models,
+    const XMMATRIX* worlds,
+    ModelPickResult& result,
+    unsigned int threadCount,
+    const XMMATRIX* const* boneTransforms)
+{
+    Vector3 direction = end - start;
+    const float length = direction.Length();
+    if (length <= 0.f)
+        return false;
+
+    direction /= length;
+
+    return Pick(Ray(start, direction), length, instanceCount, models, worlds, result, threadCount, boneTransforms);
+}
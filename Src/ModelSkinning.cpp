@@ -0,0 +1,766 @@
+//--------------------------------------------------------------------------------------
+// File: ModelSkinning.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "Model.h"
+#include "CommonStates.h"
+#include "DirectXHelpers.h"
+#include "Effects.h"
+#include "ModelHelpers.h"
+#include "PlatformHelpers.h"
+#include "WorkerThreads.h"
+
+#include <atomic>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    constexpr uint32_t c_NoElement = uint32_t(-1);
+
+    // Below this many vertices per thread the cost of handing work to a thread outweighs the work
+    constexpr size_t c_MinVerticesPerThread = 4096;
+
+    struct Influence
+    {
+        uint32_t    bones[4];
+        XMFLOAT4    weights;
+    };
+
+    struct VertexElement
+    {
+        uint32_t    offset;
+        DXGI_FORMAT format;
+    };
+
+    VertexElement FindElement(
+        const ModelMeshPart::InputLayoutCollection& decl,
+        _In_z_ const char* semanticName)
+    {
+        VertexElement element = { c_NoElement, DXGI_FORMAT_UNKNOWN };
+        if (!ModelHelpers::FindVertexElement(decl, semanticName, 0, element.offset, element.format))
+        {
+            element.offset = c_NoElement;
+        }
+        return element;
+    }
+
+    bool IsSupportedVectorFormat(DXGI_FORMAT format) noexcept
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_R32G32B32_FLOAT:
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    XMVECTOR LoadVector(_In_ const uint8_t* ptr, DXGI_FORMAT format) noexcept
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_R32G32B32_FLOAT:
+            return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(ptr));
+
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(ptr));
+
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            return XMLoadHalf4(reinterpret_cast<const XMHALF4*>(ptr));
+
+        default:
+            return XMVectorZero();
+        }
+    }
+
+    void XM_CALLCONV StoreVector(_Out_ uint8_t* ptr, DXGI_FORMAT format, FXMVECTOR v) noexcept
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_R32G32B32_FLOAT:
+            XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(ptr), v);
+            break;
+
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(ptr), v);
+            break;
+
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            XMStoreHalf4(reinterpret_cast<XMHALF4*>(ptr), v);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    void LoadBlendIndices(_In_ const uint8_t* ptr, DXGI_FORMAT format, uint32_t(&bones)[4])
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UINT:
+            for (size_t j = 0; j < 4; ++j)
+                bones[j] = ptr[j];
+            break;
+
+        case DXGI_FORMAT_R16G16B16A16_UINT:
+            for (size_t j = 0; j < 4; ++j)
+            {
+                uint16_t index;
+                memcpy(&index, ptr + j * sizeof(uint16_t), sizeof(uint16_t));
+                bones[j] = index;
+            }
+            break;
+
+        case DXGI_FORMAT_R32G32B32A32_UINT:
+            memcpy(bones, ptr, sizeof(uint32_t) * 4);
+            break;
+
+        default:
+            throw std::runtime_error("Unsupported blend indices format for software skinning");
+        }
+    }
+
+    XMVECTOR LoadBlendWeights(_In_ const uint8_t* ptr, DXGI_FORMAT format)
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+            return XMLoadUByteN4(reinterpret_cast<const XMUBYTEN4*>(ptr));
+
+        case DXGI_FORMAT_R16G16B16A16_UNORM:
+            return XMLoadUShortN4(reinterpret_cast<const XMUSHORTN4*>(ptr));
+
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            return XMLoadHalf4(reinterpret_cast<const XMHALF4*>(ptr));
+
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(ptr));
+
+        default:
+            throw std::runtime_error("Unsupported blend weights format for software skinning");
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// ModelSkinner::Impl
+//--------------------------------------------------------------------------------------
+
+class ModelSkinner::Impl
+{
+public:
+    // The vertices one mesh draws from one vertex buffer, or a set of CPU-side vertices
+    struct Stream
+    {
+        std::shared_ptr<ModelMesh>                              mesh;
+        std::vector<const ModelMeshPart*>                       parts;
+        std::vector<std::shared_ptr<IEffect>>                   effects;
+        std::vector<IEffectMatrices*>                           effectMatrices;     // Cached when the effect is set
+        std::vector<ComPtr<ID3D11InputLayout>>                  inputLayouts;
+        std::shared_ptr<ModelMeshPart::InputLayoutCollection>   vbDecl;
+        uint32_t                                                stride = 0;
+        uint32_t                                                firstVertex = 0;
+        size_t                                                  vertexCount = 0;
+        uint32_t                                                maxBone = 0;
+
+        VertexElement                                           normal = {};
+        VertexElement                                           tangent = {};
+        uint32_t                                                positionOffset = 0;
+
+        std::vector<XMFLOAT3>                                   positions;
+        std::vector<XMFLOAT4>                                   normals;
+        std::vector<XMFLOAT4>                                   tangents;
+        std::vector<Influence>                                  influences;
+        std::vector<uint8_t>                                    skinned;
+
+        ComPtr<ID3D11Buffer>                                    vertexBuffer;
+    };
+
+    std::vector<Stream> streams;
+    std::shared_ptr<WorkerThreads> workers;
+
+    void Decode(
+        Stream& stream,
+        _In_reads_bytes_(stream.vertexCount * stream.stride) const uint8_t* vertices,
+        size_t nInfluences,
+        _In_reads_opt_(nInfluences) const uint32_t* boneInfluences);
+
+    static void XM_CALLCONV SkinStream(
+        Stream& stream,
+        _In_ const XMMATRIX* boneTransforms) noexcept;
+
+    static void CreateInputLayout(
+        _In_ ID3D11Device* device,
+        Stream& stream,
+        size_t part,
+        const std::shared_ptr<IEffect>& ieffect);
+};
+
+
+// Decodes the skinning inputs of a stream's vertices, and keeps a copy of the interleaved
+// data so the attributes that are not skinned are passed through.
+_Use_decl_annotations_
+void ModelSkinner::Impl::Decode(
+    Stream& stream,
+    const uint8_t* vertices,
+    size_t nInfluences,
+    const uint32_t* boneInfluences)
+{
+    auto& decl = *stream.vbDecl;
+
+    VertexElement position = FindElement(decl, "SV_Position");
+    if (position.offset == c_NoElement)
+        position = FindElement(decl, "POSITION");
+
+    if (position.offset == c_NoElement)
+        throw std::runtime_error("SV_Position is required");
+
+    if (position.format != DXGI_FORMAT_R32G32B32_FLOAT && position.format != DXGI_FORMAT_R32G32B32A32_FLOAT)
+        throw std::runtime_error("Unsupported vertex position format for software skinning");
+
+    const VertexElement indices = FindElement(decl, "BLENDINDICES");
+    const VertexElement weights = FindElement(decl, "BLENDWEIGHT");
+    if (indices.offset == c_NoElement || weights.offset == c_NoElement)
+        throw std::runtime_error("BLENDINDICES and BLENDWEIGHT are required");
+
+    stream.positionOffset = position.offset;
+    stream.normal = FindElement(decl, "NORMAL");
+    stream.tangent = FindElement(decl, "TANGENT");
+
+    if (stream.normal.offset != c_NoElement && !IsSupportedVectorFormat(stream.normal.format))
+        throw std::runtime_error("Unsupported vertex normal format for software skinning");
+
+    if (stream.tangent.offset != c_NoElement && !IsSupportedVectorFormat(stream.tangent.format))
+        throw std::runtime_error("Unsupported vertex tangent format for software skinning");
+
+    const size_t nverts = stream.vertexCount;
+    stream.positions.resize(nverts);
+    stream.influences.resize(nverts);
+
+    if (stream.normal.offset != c_NoElement)
+        stream.normals.resize(nverts);
+
+    if (stream.tangent.offset != c_NoElement)
+        stream.tangents.resize(nverts);
+
+    uint32_t maxBone = 0;
+    for (size_t j = 0; j < nverts; ++j)
+    {
+        const uint8_t* vertex = vertices + j * stream.stride;
+
+        memcpy(&stream.positions[j], vertex + position.offset, sizeof(XMFLOAT3));
+
+        if (!stream.normals.empty())
+            XMStoreFloat4(&stream.normals[j], LoadVector(vertex + stream.normal.offset, stream.normal.format));
+
+        if (!stream.tangents.empty())
+            XMStoreFloat4(&stream.tangents[j], LoadVector(vertex + stream.tangent.offset, stream.tangent.format));
+
+        auto& influence = stream.influences[j];
+        LoadBlendIndices(vertex + indices.offset, indices.format, influence.bones);
+        XMStoreFloat4(&influence.weights, LoadBlendWeights(vertex + weights.offset, weights.format));
+
+        for (auto& bone : influence.bones)
+        {
+            if (boneInfluences)
+            {
+                if (bone >= nInfluences)
+                    throw std::runtime_error("Invalid bone influence index");
+
+                bone = boneInfluences[bone];
+            }
+
+            maxBone = std::max(maxBone, bone);
+        }
+    }
+
+    stream.maxBone = maxBone;
+    stream.skinned.assign(vertices, vertices + nverts * stream.stride);
+}
+
+
+// Blends the four bone matrices of each vertex and transforms position, normal and tangent.
+_Use_decl_annotations_
+void XM_CALLCONV ModelSkinner::Impl::SkinStream(
+    Stream& stream,
+    const XMMATRIX* boneTransforms) noexcept
+{
+    const size_t nverts = stream.vertexCount;
+    const size_t stride = stream.stride;
+    uint8_t* dest = stream.skinned.data();
+
+    const bool hasNormals = !stream.normals.empty();
+    const bool hasTangents = !stream.tangents.empty();
+
+    for (size_t j = 0; j < nverts; ++j, dest += stride)
+    {
+        const auto& influence = stream.influences[j];
+        const XMVECTOR weights = XMLoadFloat4(&influence.weights);
+
+        const XMMATRIX& b0 = boneTransforms[influence.bones[0]];
+        const XMMATRIX& b1 = boneTransforms[influence.bones[1]];
+        const XMMATRIX& b2 = boneTransforms[influence.bones[2]];
+        const XMMATRIX& b3 = boneTransforms[influence.bones[3]];
+
+        const XMVECTOR w0 = XMVectorSplatX(weights);
+        const XMVECTOR w1 = XMVectorSplatY(weights);
+        const XMVECTOR w2 = XMVectorSplatZ(weights);
+        const XMVECTOR w3 = XMVectorSplatW(weights);
+
+        XMMATRIX skin;
+        for (size_t r = 0; r < 4; ++r)
+        {
+            XMVECTOR row = XMVectorMultiply(b0.r[r], w0);
+            row = XMVectorMultiplyAdd(b1.r[r], w1, row);
+            row = XMVectorMultiplyAdd(b2.r[r], w2, row);
+            skin.r[r] = XMVectorMultiplyAdd(b3.r[r], w3, row);
+        }
+
+        const XMVECTOR position = XMVector3Transform(XMLoadFloat3(&stream.positions[j]), skin);
+        XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(dest + stream.positionOffset), position);
+
+        if (hasNormals)
+        {
+            const XMVECTOR n = XMLoadFloat4(&stream.normals[j]);
+            const XMVECTOR normal = XMVector3Normalize(XMVector3TransformNormal(n, skin));
+            StoreVector(dest + stream.normal.offset, stream.normal.format, XMVectorSelect(n, normal, g_XMSelect1110));
+        }
+
+        if (hasTangents)
+        {
+            // Handedness in w is kept
+            const XMVECTOR t = XMLoadFloat4(&stream.tangents[j]);
+            const XMVECTOR tangent = XMVector3Normalize(XMVector3TransformNormal(t, skin));
+            StoreVector(dest + stream.tangent.offset, stream.tangent.format, XMVectorSelect(t, tangent, g_XMSelect1110));
+        }
+    }
+}
+
+
+_Use_decl_annotations_
+void ModelSkinner::Impl::CreateInputLayout(
+    ID3D11Device* device,
+    Stream& stream,
+    size_t part,
+    const std::shared_ptr<IEffect>& ieffect)
+{
+    assert(part < stream.parts.size());
+
+    auto& decl = *stream.vbDecl;
+
+    // Reuse the input layout of another part already set to the same effect
+    for (size_t j = 0; j < stream.parts.size(); ++j)
+    {
+        if (j != part && stream.effects[j] == ieffect && stream.inputLayouts[j])
+        {
+            stream.effects[part] = ieffect;
+            stream.effectMatrices[part] = stream.effectMatrices[j];
+            stream.inputLayouts[part] = stream.inputLayouts[j];
+            return;
+        }
+    }
+
+    ThrowIfFailed(
+        CreateInputLayoutFromEffect(device, ieffect.get(), decl.data(), decl.size(),
+            stream.inputLayouts[part].ReleaseAndGetAddressOf())
+    );
+
+    SetDebugObjectName(stream.inputLayouts[part].Get(), "DirectXTK:ModelSkinner");
+
+    stream.effects[part] = ieffect;
+    stream.effectMatrices[part] = dynamic_cast<IEffectMatrices*>(ieffect.get());
+}
+
+
+//--------------------------------------------------------------------------------------
+// ModelSkinner
+//--------------------------------------------------------------------------------------
+
+ModelSkinner::ModelSkinner() :
+    pImpl(std::make_unique<Impl>())
+{}
+
+ModelSkinner::ModelSkinner(ModelSkinner&&) noexcept = default;
+ModelSkinner& ModelSkinner::operator= (ModelSkinner&&) noexcept = default;
+ModelSkinner::~ModelSkinner() = default;
+
+
+_Use_decl_annotations_
+void ModelSkinner::AddModel(ID3D11DeviceContext* deviceContext, const Model& model)
+{
+    if (!deviceContext)
+        throw std::invalid_argument("Device context cannot be null");
+
+    // Each buffer is read back once, however many meshes and parts use it
+    std::map<ID3D11Buffer*, std::vector<uint8_t>> bufferData;
+    std::vector<uint32_t> indices;
+
+    auto readBack = [deviceContext, &bufferData](ID3D11Buffer* buffer) -> const std::vector<uint8_t>&
+        {
+            auto it = bufferData.find(buffer);
+            if (it == bufferData.end())
+            {
+                it = bufferData.emplace(buffer, std::vector<uint8_t>()).first;
+                ModelHelpers::ReadBackBuffer(deviceContext, buffer, it->second);
+            }
+            return it->second;
+        };
+
+    for (const auto& mesh : model.meshes)
+    {
+        assert(mesh != nullptr);
+
+        // Group the skinned parts of the mesh by vertex buffer
+        std::vector<Impl::Stream> meshStreams;
+
+        for (const auto& it : mesh->meshParts)
+        {
+            auto part = it.get();
+            assert(part != nullptr);
+
+            if (!part->vbDecl || !part->vertexBuffer || !part->indexBuffer || !part->vertexStride)
+                continue;
+
+            uint32_t offset;
+            DXGI_FORMAT format;
+            if (!ModelHelpers::FindVertexElement(*part->vbDecl, "BLENDINDICES", 0, offset, format)
+                || !ModelHelpers::FindVertexElement(*part->vbDecl, "BLENDWEIGHT", 0, offset, format))
+                continue;
+
+            if (part->primitiveType != D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST)
+                throw std::runtime_error("Software skinning requires triangle lists");
+
+            if (!part->indexCount)
+                continue;
+
+            // Find the range of vertices the part draws
+            const auto& ib = readBack(part->indexBuffer.Get());
+            ModelHelpers::GetPartIndices(*part, ib.data(), ib.size(), indices);
+
+            const auto range = std::minmax_element(indices.cbegin(), indices.cend());
+            const int64_t minVertex = *range.first;
+            const int64_t maxVertex = *range.second;
+
+            auto sit = std::find_if(meshStreams.begin(), meshStreams.end(),
+                [part](const Impl::Stream& stream) noexcept
+                {
+                    return stream.parts.front()->vertexBuffer == part->vertexBuffer
+                        && stream.vbDecl == part->vbDecl
+                        && stream.stride == part->vertexStride;
+                });
+
+            if (sit == meshStreams.end())
+            {
+                Impl::Stream stream;
+                stream.mesh = mesh;
+                stream.vbDecl = part->vbDecl;
+                stream.stride = part->vertexStride;
+                stream.firstVertex = static_cast<uint32_t>(minVertex);
+                stream.vertexCount = static_cast<size_t>(maxVertex - minVertex + 1);
+                meshStreams.emplace_back(std::move(stream));
+                sit = meshStreams.end() - 1;
+            }
+            else
+            {
+                const int64_t first = std::min<int64_t>(sit->firstVertex, minVertex);
+                const int64_t last = std::max<int64_t>(int64_t(sit->firstVertex) + int64_t(sit->vertexCount) - 1, maxVertex);
+                sit->firstVertex = static_cast<uint32_t>(first);
+                sit->vertexCount = static_cast<size_t>(last - first + 1);
+            }
+
+            sit->parts.push_back(part);
+        }
+
+        for (auto& stream : meshStreams)
+        {
+            const auto& vertices = readBack(stream.parts.front()->vertexBuffer.Get());
+
+            if ((uint64_t(stream.firstVertex) + stream.vertexCount) * stream.stride > vertices.size())
+                throw std::out_of_range("Mesh part vertices exceed vertex buffer");
+
+            stream.effects.resize(stream.parts.size());
+            stream.effectMatrices.resize(stream.parts.size());
+            stream.inputLayouts.resize(stream.parts.size());
+
+            pImpl->Decode(stream, vertices.data() + size_t(stream.firstVertex) * stream.stride,
+                mesh->boneInfluences.size(), mesh->boneInfluences.empty() ? nullptr : mesh->boneInfluences.data());
+
+            pImpl->streams.emplace_back(std::move(stream));
+        }
+    }
+}
+
+
+_Use_decl_annotations_
+size_t ModelSkinner::AddVertices(
+    const ModelMeshPart::InputLayoutCollection& vbDecl,
+    uint32_t vertexStride,
+    size_t vertexCount,
+    const void* vertices,
+    size_t nInfluences,
+    const uint32_t* boneInfluences)
+{
+    if (!vertexCount)
+        throw std::invalid_argument("Vertex count must be non-zero");
+
+    if (!vertices || !vertexStride)
+        throw std::invalid_argument("Vertices and vertex stride are required");
+
+    if (uint64_t(vertexCount) * vertexStride > UINT32_MAX)
+        throw std::out_of_range("Too many vertices");
+
+    Impl::Stream stream;
+    stream.vbDecl = std::make_shared<ModelMeshPart::InputLayoutCollection>(vbDecl);
+    stream.stride = vertexStride;
+    stream.vertexCount = vertexCount;
+
+    pImpl->Decode(stream, static_cast<const uint8_t*>(vertices), nInfluences, boneInfluences);
+
+    pImpl->streams.emplace_back(std::move(stream));
+    return pImpl->streams.size() - 1;
+}
+
+
+_Use_decl_annotations_
+void ModelSkinner::Skin(size_t nbones, const XMMATRIX* boneTransforms, unsigned int threadCount)
+{
+    auto& streams = pImpl->streams;
+    const size_t count = streams.size();
+    if (!count)
+        return;
+
+    if (!nbones || !boneTransforms)
+        throw std::invalid_argument("Bone transforms array required");
+
+    size_t totalVertices = 0;
+    for (const auto& it : streams)
+    {
+        if (it.maxBone >= nbones)
+            throw std::out_of_range("Bone transforms array is smaller than the skeleton");
+
+        totalVertices += it.vertexCount;
+    }
+
+    size_t nthreads = std::min<size_t>(std::max(1u, threadCount), count);
+    nthreads = std::min(nthreads, std::max<size_t>(1, totalVertices / c_MinVerticesPerThread));
+
+    if (nthreads == 1)
+    {
+        for (auto& it : streams)
+        {
+            Impl::SkinStream(it, boneTransforms);
+        }
+        return;
+    }
+
+    if (!pImpl->workers)
+    {
+        pImpl->workers = WorkerThreads::Get();
+    }
+
+    // Streams are handed out one at a time, so a large mesh does not hold up a whole range
+    std::atomic<size_t> next(0);
+
+    pImpl->workers->ParallelFor(nthreads, [&streams, &next, count, boneTransforms](size_t)
+        {
+            for (;;)
+            {
+                const size_t j = next++;
+                if (j >= count)
+                    break;
+
+                Impl::SkinStream(streams[j], boneTransforms);
+            }
+        });
+}
+
+
+_Use_decl_annotations_
+void ModelSkinner::Update(ID3D11DeviceContext* deviceContext)
+{
+    if (!deviceContext)
+        throw std::invalid_argument("Device context cannot be null");
+
+    ComPtr<ID3D11Device> device;
+
+    for (auto& stream : pImpl->streams)
+    {
+        if (!stream.mesh)
+            continue;
+
+        const size_t bytes = stream.skinned.size();
+
+        if (!stream.vertexBuffer)
+        {
+            if (!device)
+            {
+                deviceContext->GetDevice(&device);
+            }
+
+            D3D11_BUFFER_DESC desc = {};
+            desc.ByteWidth = static_cast<UINT>(bytes);
+            desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+            desc.Usage = D3D11_USAGE_DYNAMIC;
+            desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+            ThrowIfFailed(device->CreateBuffer(&desc, nullptr, stream.vertexBuffer.GetAddressOf()));
+
+            SetDebugObjectName(stream.vertexBuffer.Get(), "DirectXTK:ModelSkinner");
+        }
+
+        D3D11_MAPPED_SUBRESOURCE mapped = {};
+        ThrowIfFailed(deviceContext->Map(stream.vertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+
+        memcpy(mapped.pData, stream.skinned.data(), bytes);
+
+        deviceContext->Unmap(stream.vertexBuffer.Get(), 0);
+    }
+}
+
+
+_Use_decl_annotations_
+void ModelSkinner::SetEffect(ID3D11Device* device, const std::shared_ptr<IEffect>& ieffect)
+{
+    if (!device || !ieffect)
+        throw std::invalid_argument("Device and effect cannot be null");
+
+    for (auto& stream : pImpl->streams)
+    {
+        for (size_t j = 0; j < stream.parts.size(); ++j)
+        {
+            Impl::CreateInputLayout(device, stream, j, ieffect);
+        }
+    }
+}
+
+
+_Use_decl_annotations_
+void ModelSkinner::SetEffect(ID3D11Device* device, const ModelMeshPart& part, const std::shared_ptr<IEffect>& ieffect)
+{
+    if (!device || !ieffect)
+        throw std::invalid_argument("Device and effect cannot be null");
+
+    for (auto& stream : pImpl->streams)
+    {
+        auto it = std::find(stream.parts.cbegin(), stream.parts.cend(), &part);
+        if (it != stream.parts.cend())
+        {
+            Impl::CreateInputLayout(device, stream, static_cast<size_t>(it - stream.parts.cbegin()), ieffect);
+            return;
+        }
+    }
+
+    throw std::invalid_argument("Mesh part is not software skinned");
+}
+
+
+_Use_decl_annotations_
+void XM_CALLCONV ModelSkinner::Draw(
+    ID3D11DeviceContext* deviceContext,
+    const CommonStates& states,
+    FXMMATRIX world,
+    CXMMATRIX view,
+    CXMMATRIX projection,
+    bool wireframe,
+    std::function<void()> setCustomState) const
+{
+    assert(deviceContext != nullptr);
+
+    // Vertices are skinned into model space, so every part uses the same world matrix
+    for (const bool alpha : { false, true })
+    {
+        for (const auto& stream : pImpl->streams)
+        {
+            if (!stream.mesh)
+                continue;
+
+            if (!stream.vertexBuffer)
+                throw std::runtime_error("ModelSkinner::Update must be called before drawing");
+
+            bool prepared = false;
+
+            for (size_t j = 0; j < stream.parts.size(); ++j)
+            {
+                auto part = stream.parts[j];
+                if (part->isAlpha != alpha)
+                    continue;
+
+                auto effect = stream.effects[j].get();
+                if (!effect)
+                    throw std::runtime_error("ModelSkinner::SetEffect must be called before drawing");
+
+                if (!prepared)
+                {
+                    stream.mesh->PrepareForRendering(deviceContext, states, alpha, wireframe);
+                    prepared = true;
+                }
+
+                auto imatrices = stream.effectMatrices[j];
+                if (imatrices)
+                {
+                    imatrices->SetMatrices(world, view, projection);
+                }
+
+                deviceContext->IASetInputLayout(stream.inputLayouts[j].Get());
+
+                auto vb = stream.vertexBuffer.Get();
+                const UINT vbStride = stream.stride;
+                constexpr UINT vbOffset = 0;
+                deviceContext->IASetVertexBuffers(0, 1, &vb, &vbStride, &vbOffset);
+
+                deviceContext->IASetIndexBuffer(part->indexBuffer.Get(), part->indexFormat, 0);
+
+                effect->Apply(deviceContext);
+
+                if (setCustomState)
+                {
+                    setCustomState();
+                }
+
+                deviceContext->IASetPrimitiveTopology(part->primitiveType);
+
+                // The skinned vertex buffer starts at the first vertex the mesh draws
+                deviceContext->DrawIndexed(part->indexCount, part->startIndex,
+                    part->vertexOffset - static_cast<INT>(stream.firstVertex));
+            }
+        }
+    }
+}
+
+
+size_t ModelSkinner::GetStreamCount() const noexcept
+{
+    return pImpl->streams.size();
+}
+
+
+size_t ModelSkinner::GetVertexCount(size_t stream) const
+{
+    if (stream >= pImpl->streams.size())
+        throw std::out_of_range("Invalid stream index");
+
+    return pImpl->streams[stream].vertexCount;
+}
+
+
+const void* ModelSkinner::GetSkinnedVertices(size_t stream) const
+{
+    if (stream >= pImpl->streams.size())
+        throw std::out_of_range("Invalid stream index");
+
+    return pImpl->streams[stream].skinned.data();
+}
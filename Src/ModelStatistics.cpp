@@ -0,0 +1,330 @@
+//--------------------------------------------------------------------------------------
+// File: ModelStatistics.cpp
+//
+// Geometry counts and memory use of models, with shared buffers and textures counted once
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "Model.h"
+
+#include "Effects.h"
+#include "LoaderHelpers.h"
+#include "PlatformHelpers.h"
+
+#include <cwchar>
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    size_t GetIndexSize(DXGI_FORMAT format) noexcept
+    {
+        return (format == DXGI_FORMAT_R32_UINT) ? sizeof(uint32_t) : sizeof(uint16_t);
+    }
+
+    size_t GetTriangleCount(const ModelMeshPart& part) noexcept
+    {
+        switch (part.primitiveType)
+        {
+        case D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST:
+            return part.indexCount / 3;
+
+        case D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP:
+            return (part.indexCount > 2) ? part.indexCount - 2 : 0;
+
+        case D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST_ADJ:
+            return part.indexCount / 6;
+
+        default:
+            return 0;
+        }
+    }
+
+    // Vertices from the part's base vertex, falling back to the rest of the vertex buffer
+    // for loaders that do not record the range
+    size_t GetVertexCount(const ModelMeshPart& part)
+    {
+        if (part.vertexCount > 0)
+            return part.vertexCount;
+
+        if (!part.vertexBuffer || !part.vertexStride)
+            return 0;
+
+        D3D11_BUFFER_DESC desc = {};
+        part.vertexBuffer->GetDesc(&desc);
+
+        const int64_t count = int64_t(desc.ByteWidth / part.vertexStride) - part.vertexOffset;
+        return (count > 0) ? static_cast<size_t>(count) : 0;
+    }
+
+    size_t GetSurfaceBytes(size_t width, size_t height, DXGI_FORMAT format) noexcept
+    {
+        size_t numBytes = 0;
+        if (FAILED(LoaderHelpers::GetSurfaceInfo(width, height, format, &numBytes, nullptr, nullptr)))
+            return 0;
+
+        return numBytes;
+    }
+
+    // Size of all the mips and array slices of a texture resource
+    size_t GetTextureBytes(const ComPtr<ID3D11Resource>& res)
+    {
+        D3D11_RESOURCE_DIMENSION resType = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+        res->GetType(&resType);
+
+        size_t total = 0;
+
+        switch (resType)
+        {
+        case D3D11_RESOURCE_DIMENSION_TEXTURE1D:
+            {
+                ComPtr<ID3D11Texture1D> tex;
+                ThrowIfFailed(res.As(&tex));
+
+                D3D11_TEXTURE1D_DESC desc = {};
+                tex->GetDesc(&desc);
+
+                for (UINT level = 0; level < desc.MipLevels; ++level)
+                {
+                    total += GetSurfaceBytes(std::max<size_t>(desc.Width >> level, 1), 1, desc.Format);
+                }
+                total *= desc.ArraySize;
+                break;
+            }
+
+        case D3D11_RESOURCE_DIMENSION_TEXTURE2D:
+            {
+                ComPtr<ID3D11Texture2D> tex;
+                ThrowIfFailed(res.As(&tex));
+
+                D3D11_TEXTURE2D_DESC desc = {};
+                tex->GetDesc(&desc);
+
+                for (UINT level = 0; level < desc.MipLevels; ++level)
+                {
+                    total += GetSurfaceBytes(
+                        std::max<size_t>(desc.Width >> level, 1),
+                        std::max<size_t>(desc.Height >> level, 1),
+                        desc.Format);
+                }
+                total *= size_t(desc.ArraySize) * std::max<UINT>(desc.SampleDesc.Count, 1);
+                break;
+            }
+
+        case D3D11_RESOURCE_DIMENSION_TEXTURE3D:
+            {
+                ComPtr<ID3D11Texture3D> tex;
+                ThrowIfFailed(res.As(&tex));
+
+                D3D11_TEXTURE3D_DESC desc = {};
+                tex->GetDesc(&desc);
+
+                for (UINT level = 0; level < desc.MipLevels; ++level)
+                {
+                    total += GetSurfaceBytes(
+                        std::max<size_t>(desc.Width >> level, 1),
+                        std::max<size_t>(desc.Height >> level, 1),
+                        desc.Format) * std::max<size_t>(desc.Depth >> level, 1);
+                }
+                break;
+            }
+
+        default:
+            break;
+        }
+
+        return total;
+    }
+
+    template<size_t sizeOfBuffer, typename... Args>
+    void AppendLine(std::wstring& report, wchar_t(&buffer)[sizeOfBuffer], _In_z_ const wchar_t* format, Args... args)
+    {
+        if (swprintf(buffer, sizeOfBuffer, format, args...) > 0)
+        {
+            report += buffer;
+        }
+        report += L'\n';
+    }
+}
+
+
+ModelStatistics::ModelStatistics() noexcept :
+    mTotals{}
+{
+}
+
+
+_Use_decl_annotations_
+void ModelStatistics::Add(const Model& model, IEffectFactory* fxFactory)
+{
+    ++mTotals.modelCount;
+
+    // Counts a buffer the first time any part uses it
+    auto addBuffer = [&](ID3D11Buffer* buffer, bool vertices)
+        {
+            if (!buffer)
+                return;
+
+            ComPtr<ID3D11Resource> resource(buffer);
+            if (!mResources.insert(resource).second)
+                return;
+
+            D3D11_BUFFER_DESC desc = {};
+            buffer->GetDesc(&desc);
+
+            if (vertices)
+            {
+                ++mTotals.vertexBufferCount;
+                mTotals.vertexBufferBytes += desc.ByteWidth;
+            }
+            else
+            {
+                ++mTotals.indexBufferCount;
+                mTotals.indexBufferBytes += desc.ByteWidth;
+            }
+        };
+
+    std::map<std::pair<ID3D11Buffer*, int32_t>, size_t> meshVertices;
+
+    for (const auto& mesh : model.meshes)
+    {
+        if (!mesh || !mMeshRefs.insert(mesh).second)
+            continue;
+
+        MeshStatistics stats = {};
+        stats.modelName = model.name;
+        stats.meshName = mesh->name;
+        stats.partCount = mesh->meshParts.size();
+
+        // Parts drawing from the same base vertex of a buffer share their vertices
+        meshVertices.clear();
+
+        for (const auto& it : mesh->meshParts)
+        {
+            auto part = it.get();
+            assert(part != nullptr);
+
+            addBuffer(part->vertexBuffer.Get(), true);
+            addBuffer(part->indexBuffer.Get(), false);
+
+            stats.indexCount += part->indexCount;
+            stats.indexBytes += size_t(part->indexCount) * GetIndexSize(part->indexFormat);
+            stats.triangleCount += GetTriangleCount(*part);
+
+            const auto key = std::make_pair(part->vertexBuffer.Get(), part->vertexOffset);
+            const size_t vertexCount = GetVertexCount(*part);
+
+            auto& count = meshVertices[key];
+            if (vertexCount > count)
+            {
+                stats.vertexCount += vertexCount - count;
+                stats.vertexBytes += (vertexCount - count) * part->vertexStride;
+                count = vertexCount;
+            }
+        }
+
+        for (const auto& vit : meshVertices)
+        {
+            if (mVertexRanges.insert(vit.first).second)
+            {
+                mTotals.vertexCount += vit.second;
+            }
+        }
+
+        ++mTotals.meshCount;
+        mTotals.partCount += stats.partCount;
+        mTotals.indexCount += stats.indexCount;
+        mTotals.triangleCount += stats.triangleCount;
+
+        mMeshes.emplace_back(std::move(stats));
+    }
+
+    if (!fxFactory)
+        return;
+
+    // Only views the factory already holds are counted, so gathering statistics never loads a texture
+    for (const auto& name : model.textureNames)
+    {
+        ComPtr<ID3D11ShaderResourceView> srv;
+        if (!fxFactory->GetCachedTexture(name.c_str(), srv.GetAddressOf()) || !srv)
+        {
+            ++mTotals.textureMisses;
+            continue;
+        }
+
+        ComPtr<ID3D11Resource> resource;
+        srv->GetResource(resource.GetAddressOf());
+
+        if (!resource || !mResources.insert(resource).second)
+            continue;
+
+        ++mTotals.textureCount;
+        mTotals.textureBytes += GetTextureBytes(resource);
+    }
+}
+
+
+void ModelStatistics::Reset() noexcept
+{
+    mTotals = {};
+    mMeshes.clear();
+    mMeshRefs.clear();
+    mResources.clear();
+    mVertexRanges.clear();
+}
+
+
+std::wstring ModelStatistics::GetReport(size_t maxMeshes) const
+{
+    std::wstring report;
+    wchar_t line[512] = {};
+
+    constexpr double c_KB = 1024.0;
+
+    AppendLine(report, line, L"Models: %zu  Meshes: %zu  Parts: %zu",
+        mTotals.modelCount, mTotals.meshCount, mTotals.partCount);
+    AppendLine(report, line, L"Vertices: %zu  Indices: %zu  Triangles: %zu",
+        mTotals.vertexCount, mTotals.indexCount, mTotals.triangleCount);
+    AppendLine(report, line, L"Vertex buffers: %zu (%.1f KB)  Index buffers: %zu (%.1f KB)",
+        mTotals.vertexBufferCount, double(mTotals.vertexBufferBytes) / c_KB,
+        mTotals.indexBufferCount, double(mTotals.indexBufferBytes) / c_KB);
+    AppendLine(report, line, L"Textures: %zu (%.1f KB)  Not loaded: %zu",
+        mTotals.textureCount, double(mTotals.textureBytes) / c_KB, mTotals.textureMisses);
+    AppendLine(report, line, L"Total: %.1f KB",
+        double(mTotals.vertexBufferBytes + mTotals.indexBufferBytes + mTotals.textureBytes) / c_KB);
+
+    if (!maxMeshes || mMeshes.empty())
+        return report;
+
+    std::vector<const MeshStatistics*> heaviest;
+    heaviest.reserve(mMeshes.size());
+    for (const auto& it : mMeshes)
+    {
+        heaviest.push_back(&it);
+    }
+
+    const size_t count = std::min(maxMeshes, heaviest.size());
+    std::partial_sort(heaviest.begin(), heaviest.begin() + ptrdiff_t(count), heaviest.end(),
+        [](const MeshStatistics* a, const MeshStatistics* b) noexcept
+        {
+            return (a->vertexBytes + a->indexBytes) > (b->vertexBytes + b->indexBytes);
+        });
+
+    AppendLine(report, line, L"Heaviest meshes:");
+    for (size_t j = 0; j < count; ++j)
+    {
+        const auto& mesh = *heaviest[j];
+        AppendLine(report, line, L"  %.1f KB  %ls : %ls  parts %zu, vertices %zu, indices %zu, triangles %zu",
+            double(mesh.vertexBytes + mesh.indexBytes) / c_KB,
+            mesh.modelName.c_str(), mesh.meshName.c_str(),
+            mesh.partCount, mesh.vertexCount, mesh.indexCount, mesh.triangleCount);
+    }
+
+    return report;
+}
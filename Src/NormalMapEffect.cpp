@@ -710,24 +710,15 @@ void SkinnedNormalMapEffect::SetWeightsPerVertex(int value)
 
 void SkinnedNormalMapEffect::SetBoneTransforms(_In_reads_(count) XMMATRIX const* value, size_t count)
 {
-    if (count > MaxBones)
-        throw std::invalid_argument("count parameter exceeds MaxBones");
+    StoreBoneTransforms(pImpl->boneConstants.Bones, nullptr, count, value, count);
 
-    auto boneConstant = pImpl->boneConstants.Bones;
+    pImpl->dirtyFlags |= EffectDirtyFlags::ConstantBufferBones;
+}
 
-    for (size_t i = 0; i < count; i++)
-    {
-    #if DIRECTX_MATH_VERSION >= 313
-        XMStoreFloat3x4A(reinterpret_cast<XMFLOAT3X4A*>(&boneConstant[i]), value[i]);
-    #else
-            // Xbox One XDK has an older version of DirectXMath
-        XMMATRIX boneMatrix = XMMatrixTranspose(value[i]);
 
-        boneConstant[i][0] = boneMatrix.r[0];
-        boneConstant[i][1] = boneMatrix.r[1];
-        boneConstant[i][2] = boneMatrix.r[2];
-    #endif
-    }
+void SkinnedNormalMapEffect::GatherBoneTransforms(_In_reads_(count) const uint32_t* indices, size_t count, _In_reads_(nbones) XMMATRIX const* value, size_t nbones)
+{
+    StoreBoneTransforms(pImpl->boneConstants.Bones, indices, count, value, nbones);
 
     pImpl->dirtyFlags |= EffectDirtyFlags::ConstantBufferBones;
 }
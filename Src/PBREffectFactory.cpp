@@ -10,6 +10,7 @@
 #include "pch.h"
 #include "Effects.h"
 #include "DemandCreate.h"
+#include "EffectTextureCache.h"
 #include "SharedResourcePool.h"
 
 #include "DDSTextureLoader.h"
@@ -114,6 +115,10 @@ public:
     void CreateTexture(_In_z_ const wchar_t* texture,
         _In_opt_ ID3D11DeviceContext* deviceContext,
         _Outptr_ ID3D11ShaderResourceView** textureView);
+    bool GetCachedTexture(_In_z_ const wchar_t* texture, _Outptr_result_maybenull_ ID3D11ShaderResourceView** textureView)
+    {
+        return mTextureCache.Find(texture, textureView);
+    }
 
     void ReleaseCache();
 
@@ -128,11 +133,10 @@ public:
 
 private:
     using EffectCache = std::map< std::wstring, std::shared_ptr<IEffect> >;
-    using TextureCache = std::map< std::wstring, ComPtr<ID3D11ShaderResourceView> >;
 
     EffectCache  mEffectCache;
     EffectCache  mEffectCacheSkinning;
-    TextureCache mTextureCache;
+    EffectTextureCache mTextureCache;
 
     std::mutex mutex;
 };
@@ -215,86 +219,71 @@ void PBREffectFactory::Impl::CreateTexture(
     UNREFERENCED_PARAMETER(deviceContext);
 #endif
 
-    auto it = mTextureCache.find(name);
-
-    if (mSharing && it != mTextureCache.end())
-    {
-        ID3D11ShaderResourceView* srv = it->second.Get();
-        srv->AddRef();
-        *textureView = srv;
-    }
-    else
-    {
-        wchar_t fullName[MAX_PATH] = {};
-        wcscpy_s(fullName, mPath);
-        wcscat_s(fullName, name);
-
-        WIN32_FILE_ATTRIBUTE_DATA fileAttr = {};
-        if (!GetFileAttributesExW(fullName, GetFileExInfoStandard, &fileAttr))
+    mTextureCache.Get(name, mSharing, textureView, [&](ID3D11ShaderResourceView** view)
         {
-            // Try Current Working Directory (CWD)
-            wcscpy_s(fullName, name);
+            wchar_t fullName[MAX_PATH] = {};
+            wcscpy_s(fullName, mPath);
+            wcscat_s(fullName, name);
+
+            WIN32_FILE_ATTRIBUTE_DATA fileAttr = {};
             if (!GetFileAttributesExW(fullName, GetFileExInfoStandard, &fileAttr))
             {
-                DebugTrace("ERROR: PBREffectFactory could not find texture file '%ls'\n", name);
-                throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "PBREffectFactory::CreateTexture");
+                // Try Current Working Directory (CWD)
+                wcscpy_s(fullName, name);
+                if (!GetFileAttributesExW(fullName, GetFileExInfoStandard, &fileAttr))
+                {
+                    DebugTrace("ERROR: PBREffectFactory could not find texture file '%ls'\n", name);
+                    throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "PBREffectFactory::CreateTexture");
+                }
             }
-        }
 
-        wchar_t ext[_MAX_EXT] = {};
-        _wsplitpath_s(name, nullptr, 0, nullptr, 0, nullptr, 0, ext, _MAX_EXT);
-        const bool isdds = _wcsicmp(ext, L".dds") == 0;
+            wchar_t ext[_MAX_EXT] = {};
+            _wsplitpath_s(name, nullptr, 0, nullptr, 0, nullptr, 0, ext, _MAX_EXT);
+            const bool isdds = _wcsicmp(ext, L".dds") == 0;
 
-        if (isdds)
-        {
-            HRESULT hr = CreateDDSTextureFromFileEx(
-                mDevice.Get(), fullName, 0,
-                D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
-                mForceSRGB ? DDS_LOADER_FORCE_SRGB : DDS_LOADER_DEFAULT, nullptr, textureView);
-            if (FAILED(hr))
+            if (isdds)
             {
-                DebugTrace("ERROR: CreateDDSTextureFromFile failed (%08X) for '%ls'\n",
-                    static_cast<unsigned int>(hr), fullName);
-                throw std::runtime_error("PBREffectFactory::CreateDDSTextureFromFile");
+                HRESULT hr = CreateDDSTextureFromFileEx(
+                    mDevice.Get(), fullName, 0,
+                    D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
+                    mForceSRGB ? DDS_LOADER_FORCE_SRGB : DDS_LOADER_DEFAULT, nullptr, view);
+                if (FAILED(hr))
+                {
+                    DebugTrace("ERROR: CreateDDSTextureFromFile failed (%08X) for '%ls'\n",
+                        static_cast<unsigned int>(hr), fullName);
+                    throw std::runtime_error("PBREffectFactory::CreateDDSTextureFromFile");
+                }
             }
-        }
-    #if !defined(_XBOX_ONE) || !defined(_TITLE)
-        else if (deviceContext)
-        {
-            std::lock_guard<std::mutex> lock(mutex);
-            HRESULT hr = CreateWICTextureFromFileEx(
-                mDevice.Get(), deviceContext, fullName, 0,
-                D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
-                mForceSRGB ? WIC_LOADER_FORCE_SRGB : WIC_LOADER_DEFAULT, nullptr, textureView);
-            if (FAILED(hr))
+        #if !defined(_XBOX_ONE) || !defined(_TITLE)
+            else if (deviceContext)
             {
-                DebugTrace("ERROR: CreateWICTextureFromFile failed (%08X) for '%ls'\n",
-                    static_cast<unsigned int>(hr), fullName);
-                throw std::runtime_error("PBREffectFactory::CreateWICTextureFromFile");
+                std::lock_guard<std::mutex> lock(mutex);
+                HRESULT hr = CreateWICTextureFromFileEx(
+                    mDevice.Get(), deviceContext, fullName, 0,
+                    D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
+                    mForceSRGB ? WIC_LOADER_FORCE_SRGB : WIC_LOADER_DEFAULT, nullptr, view);
+                if (FAILED(hr))
+                {
+                    DebugTrace("ERROR: CreateWICTextureFromFile failed (%08X) for '%ls'\n",
+                        static_cast<unsigned int>(hr), fullName);
+                    throw std::runtime_error("PBREffectFactory::CreateWICTextureFromFile");
+                }
             }
-        }
-    #endif
-        else
-        {
-            HRESULT hr = CreateWICTextureFromFileEx(
-                mDevice.Get(), fullName, 0,
-                D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
-                mForceSRGB ? WIC_LOADER_FORCE_SRGB : WIC_LOADER_DEFAULT, nullptr, textureView);
-            if (FAILED(hr))
+        #endif
+            else
             {
-                DebugTrace("ERROR: CreateWICTextureFromFile failed (%08X) for '%ls'\n",
-                    static_cast<unsigned int>(hr), fullName);
-                throw std::runtime_error("PBREffectFactory::CreateWICTextureFromFile");
+                HRESULT hr = CreateWICTextureFromFileEx(
+                    mDevice.Get(), fullName, 0,
+                    D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
+                    mForceSRGB ? WIC_LOADER_FORCE_SRGB : WIC_LOADER_DEFAULT, nullptr, view);
+                if (FAILED(hr))
+                {
+                    DebugTrace("ERROR: CreateWICTextureFromFile failed (%08X) for '%ls'\n",
+                        static_cast<unsigned int>(hr), fullName);
+                    throw std::runtime_error("PBREffectFactory::CreateWICTextureFromFile");
+                }
             }
-        }
-
-        if (mSharing && *name && it == mTextureCache.end())
-        {
-            std::lock_guard<std::mutex> lock(mutex);
-            TextureCache::value_type v(name, *textureView);
-            mTextureCache.insert(v);
-        }
-    }
+        });
 }
 
 void PBREffectFactory::Impl::ReleaseCache()
@@ -302,7 +291,7 @@ void PBREffectFactory::Impl::ReleaseCache()
     std::lock_guard<std::mutex> lock(mutex);
     mEffectCache.clear();
     mEffectCacheSkinning.clear();
-    mTextureCache.clear();
+    mTextureCache.Clear();
 }
 
 
@@ -332,6 +321,15 @@ void PBREffectFactory::CreateTexture(const wchar_t* name, ID3D11DeviceContext* d
     return pImpl->CreateTexture(name, deviceContext, textureView);
 }
 
+_Use_decl_annotations_
+bool PBREffectFactory::GetCachedTexture(const wchar_t* name, ID3D11ShaderResourceView** textureView)
+{
+    if (!name || !textureView)
+        throw std::invalid_argument("name and textureView parameters can't be null");
+
+    return pImpl->GetCachedTexture(name, textureView);
+}
+
 void PBREffectFactory::ReleaseCache()
 {
     pImpl->ReleaseCache();
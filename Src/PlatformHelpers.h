@@ -96,5 +96,21 @@ namespace DirectX
 
     using ScopedHandle = std::unique_ptr<void, handle_closer>;
 
+    struct view_unmapper { void operator()(const void* p) noexcept { if (p) UnmapViewOfFile(p); } };
+
+    using ScopedFileView = std::unique_ptr<const void, view_unmapper>;
+
     inline HANDLE safe_handle(HANDLE h) noexcept { return (h == INVALID_HANDLE_VALUE) ? nullptr : h; }
+
+    // Helper for converting the UTF-8 names stored in binary files
+    template<size_t sizeOfBuffer>
+    inline void ASCIIToWChar(wchar_t(&buffer)[sizeOfBuffer], const char *ascii) noexcept
+    {
+    #ifdef _WIN32
+        MultiByteToWideChar(CP_UTF8, 0, ascii, -1, buffer, sizeOfBuffer);
+    #else
+        mbtowc(nullptr, nullptr, 0);
+        mbtowc(buffer, ascii, sizeOfBuffer);
+    #endif
+    }
 }
@@ -107,6 +107,39 @@ const D3D11_INPUT_ELEMENT_DESC VertexPositionNormalTexture::InputElements[] =
 static_assert(sizeof(VertexPositionNormalTexture) == 32, "Vertex struct/layout mismatch");
 
 
+//--------------------------------------------------------------------------------------
+// Vertex struct holding quantized position, normal vector, and texture mapping information.
+const D3D11_INPUT_ELEMENT_DESC VertexPositionNormalTexturePacked::InputElements[] =
+{
+    { "SV_Position", 0, DXGI_FORMAT_R16G16B16A16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    { "NORMAL",      0, DXGI_FORMAT_R10G10B10A2_UNORM,  0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    { "TEXCOORD",    0, DXGI_FORMAT_R16G16_UNORM,       0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+};
+
+static_assert(sizeof(VertexPositionNormalTexturePacked) == 16, "Vertex struct/layout mismatch");
+
+void XM_CALLCONV VertexPositionNormalTexturePacked::SetPosition(FXMVECTOR iposition) noexcept
+{
+    XMHALF4 packed;
+    XMStoreHalf4(&packed, XMVectorSelect(g_XMIdentityR3, iposition, g_XMSelect1110));
+    this->position = packed.v;
+}
+
+void XM_CALLCONV VertexPositionNormalTexturePacked::SetNormal(FXMVECTOR inormal) noexcept
+{
+    XMUDECN4 packed;
+    XMStoreUDecN4(&packed, XMVectorMultiplyAdd(inormal, g_XMOneHalf, g_XMOneHalf));
+    this->normal = packed.v;
+}
+
+void XM_CALLCONV VertexPositionNormalTexturePacked::SetTextureCoordinate(FXMVECTOR itextureCoordinate) noexcept
+{
+    XMUSHORTN2 packed;
+    XMStoreUShortN2(&packed, itextureCoordinate);
+    this->textureCoordinate = packed.v;
+}
+
+
 //--------------------------------------------------------------------------------------
 // Vertex struct holding position, normal vector, color, and texture mapping information.
 const D3D11_INPUT_ELEMENT_DESC VertexPositionNormalColorTexture::InputElements[] =
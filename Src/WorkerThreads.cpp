@@ -0,0 +1,170 @@
+//--------------------------------------------------------------------------------------
+// File: WorkerThreads.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "WorkerThreads.h"
+
+#include "PlatformHelpers.h"
+
+using namespace DirectX;
+
+namespace
+{
+    // Upper bound on the workers kept, however many tasks a caller splits its work into
+    constexpr size_t c_MaxThreads = 64;
+}
+
+
+WorkerThreads::WorkerThreads() noexcept :
+    mShutdown(false)
+{
+}
+
+
+WorkerThreads::~WorkerThreads()
+{
+    {
+        const std::lock_guard<std::mutex> lock(mMutex);
+        mShutdown = true;
+    }
+
+    mWorkAvailable.notify_all();
+
+    for (auto& it : mThreads)
+    {
+        it.join();
+    }
+}
+
+
+std::shared_ptr<WorkerThreads> WorkerThreads::Get()
+{
+    static std::mutex s_mutex;
+    static std::weak_ptr<WorkerThreads> s_instance;
+
+    const std::lock_guard<std::mutex> lock(s_mutex);
+
+    auto instance = s_instance.lock();
+    if (!instance)
+    {
+        instance = std::make_shared<WorkerThreads>();
+        s_instance = instance;
+    }
+
+    return instance;
+}
+
+
+void WorkerThreads::ParallelFor(size_t taskCount, const std::function<void(size_t)>& task)
+{
+    if (!taskCount)
+        return;
+
+    Job job = { &task, taskCount, 0, 0, nullptr };
+
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    if (taskCount > 1)
+    {
+        StartThreads(std::min(taskCount - 1, c_MaxThreads));
+
+        mJobs.push_back(&job);
+        mWorkAvailable.notify_all();
+    }
+
+    // The calling thread keeps taking tasks from its own job until all have been claimed
+    while (job.next < job.count)
+    {
+        RunTask(lock, job);
+    }
+
+    mJobCompleted.wait(lock, [&job]() noexcept { return job.completed == job.count; });
+
+    if (job.error)
+    {
+        lock.unlock();
+        std::rethrow_exception(job.error);
+    }
+}
+
+
+// Starts workers until there are 'count' of them; fewer is not an error as callers run tasks too.
+void WorkerThreads::StartThreads(size_t count) noexcept
+{
+    while (mThreads.size() < count)
+    {
+        try
+        {
+            mThreads.emplace_back(&WorkerThreads::WorkerLoop, this);
+        }
+        catch (...)
+        {
+            DebugTrace("WARNING: WorkerThreads could only start %zu of %zu threads\n", mThreads.size(), count);
+            break;
+        }
+    }
+}
+
+
+void WorkerThreads::WorkerLoop() noexcept
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    for (;;)
+    {
+        mWorkAvailable.wait(lock, [this]() noexcept { return mShutdown || !mJobs.empty(); });
+
+        if (mShutdown)
+            return;
+
+        RunTask(lock, *mJobs.front());
+    }
+}
+
+
+// Claims and runs the next task of a job. Called with the lock held, which is released while the task runs.
+void WorkerThreads::RunTask(std::unique_lock<std::mutex>& lock, Job& job) noexcept
+{
+    assert(job.next < job.count);
+
+    const size_t index = job.next++;
+    if (job.next == job.count)
+    {
+        // Nothing left to claim, so idle workers should not pick this job up again
+        auto it = std::find(mJobs.begin(), mJobs.end(), &job);
+        if (it != mJobs.end())
+        {
+            mJobs.erase(it);
+        }
+    }
+
+    lock.unlock();
+
+    std::exception_ptr error;
+    try
+    {
+        (*job.task)(index);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    lock.lock();
+
+    if (error && !job.error)
+    {
+        job.error = error;
+    }
+
+    if (++job.completed == job.count)
+    {
+        mJobCompleted.notify_all();
+    }
+}
@@ -0,0 +1,75 @@
+//--------------------------------------------------------------------------------------
+// File: WorkerThreads.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace DirectX
+{
+    inline namespace DX11
+    {
+        // Worker threads shared by the CPU-side model helpers (culling, picking, skinning,
+        // animation blending, and texture requests), so splitting work across threads does
+        // not start new threads on every call. Threads are started on demand and kept until
+        // the last owner releases the pool, which then joins them.
+        class WorkerThreads
+        {
+        public:
+            WorkerThreads() noexcept;
+
+            WorkerThreads(WorkerThreads&&) = delete;
+            WorkerThreads& operator= (WorkerThreads&&) = delete;
+
+            WorkerThreads(WorkerThreads const&) = delete;
+            WorkerThreads& operator= (WorkerThreads const&) = delete;
+
+            ~WorkerThreads();
+
+            // Returns the pool shared by every current owner, creating it if there are none.
+            static std::shared_ptr<WorkerThreads> __cdecl Get();
+
+            // Runs task(j) for each j in [0, taskCount) on up to taskCount - 1 workers and the
+            // calling thread, returning once every task has finished. If workers cannot be
+            // started the calling thread runs the remaining tasks itself. The first exception
+            // thrown by a task is rethrown once all of the tasks have finished.
+            void __cdecl ParallelFor(size_t taskCount, const std::function<void(size_t)>& task);
+
+        private:
+            struct Job
+            {
+                const std::function<void(size_t)>*  task;
+                size_t                              count;
+                size_t                              next;
+                size_t                              completed;
+                std::exception_ptr                  error;
+            };
+
+            std::mutex                  mMutex;
+            std::condition_variable     mWorkAvailable;
+            std::condition_variable     mJobCompleted;
+            std::deque<Job*>            mJobs;
+            std::vector<std::thread>    mThreads;
+            bool                        mShutdown;
+
+            void StartThreads(size_t count) noexcept;
+            void WorkerLoop() noexcept;
+            void RunTask(std::unique_lock<std::mutex>& lock, Job& job) noexcept;
+        };
+    }
+}
@@ -0,0 +1,163 @@
+//--------------------------------------------------------------------------------------
+// File: AnimationBlendBench.cpp
+//
+// Crossfading two clips on a 64 bone skeleton for 2000 instances with AnimationBlender,
+// on one thread and on the shared worker threads, for local and skinning transforms.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "ModelBench.h"
+
+#include "Animation.h"
+#include "Model.h"
+#include "SDKMesh.h"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr uint32_t c_BoneCount = 64;
+    constexpr uint32_t c_KeyCount = 30;
+    constexpr size_t c_InstanceCount = 2000;
+    constexpr size_t c_Iterations = 10;
+
+    // Four limbs of chained bones hanging off the root
+    void BuildModel(Model& model)
+    {
+        model.bones.resize(c_BoneCount);
+        model.boneMatrices = ModelBone::MakeArray(c_BoneCount);
+
+        for (uint32_t j = 0; j < c_BoneCount; ++j)
+        {
+            wchar_t name[32] = {};
+            swprintf_s(name, L"bone%u", j);
+            model.bones[j].name = name;
+            model.boneMatrices[j] = XMMatrixTranslation(0.f, (j > 0) ? 0.2f : 0.f, 0.f);
+        }
+
+        for (uint32_t j = c_BoneCount; j-- > 1;)
+        {
+            const uint32_t parent = ((j - 1) % 16 == 0) ? 0 : j - 1;
+            model.bones[j].parentIndex = parent;
+            model.bones[j].siblingIndex = model.bones[parent].childIndex;
+            model.bones[parent].childIndex = j;
+        }
+
+        model.Modified();
+    }
+
+    // An SDKMESH_ANIM file with a track for every bone, swinging at the given rate
+    std::vector<uint8_t> MakeClip(float rate)
+    {
+        using namespace DXUT;
+
+        const size_t frameBytes = c_BoneCount * sizeof(SDKANIMATION_FRAME_DATA);
+        const size_t keyBytes = size_t(c_BoneCount) * c_KeyCount * sizeof(SDKANIMATION_DATA);
+
+        std::vector<uint8_t> file(sizeof(SDKANIMATION_FILE_HEADER) + frameBytes + keyBytes);
+
+        auto header = reinterpret_cast<SDKANIMATION_FILE_HEADER*>(file.data());
+        header->Version = SDKMESH_FILE_VERSION;
+        header->NumFrames = c_BoneCount;
+        header->NumAnimationKeys = c_KeyCount;
+        header->AnimationFPS = 30;
+        header->AnimationDataSize = frameBytes + keyBytes;
+        header->AnimationDataOffset = sizeof(SDKANIMATION_FILE_HEADER);
+
+        auto frames = reinterpret_cast<SDKANIMATION_FRAME_DATA*>(file.data() + sizeof(SDKANIMATION_FILE_HEADER));
+        auto keys = reinterpret_cast<SDKANIMATION_DATA*>(file.data() + sizeof(SDKANIMATION_FILE_HEADER) + frameBytes);
+
+        for (uint32_t j = 0; j < c_BoneCount; ++j)
+        {
+            sprintf_s(frames[j].FrameName, "bone%u", j);
+
+            // Key offsets are relative to the end of the file header
+            frames[j].DataOffset = frameBytes + uint64_t(j) * c_KeyCount * sizeof(SDKANIMATION_DATA);
+
+            for (uint32_t k = 0; k < c_KeyCount; ++k)
+            {
+                const float angle = 0.3f * sinf(rate * float(k) / float(c_KeyCount) * XM_2PI + 0.1f * float(j));
+
+                auto& key = keys[j * c_KeyCount + k];
+                key.Translation = XMFLOAT3(0.f, (j > 0) ? 0.2f : 0.f, 0.f);
+                XMStoreFloat4(&key.Orientation, XMQuaternionRotationRollPitchYaw(angle, 0.5f * angle, 0.f));
+                key.Scaling = XMFLOAT3(1.f, 1.f, 1.f);
+            }
+        }
+
+        return file;
+    }
+}
+
+void ModelBench::BenchAnimationBlend()
+{
+    Model model;
+    BuildModel(model);
+
+    const auto walkFile = MakeClip(1.f);
+    const auto runFile = MakeClip(2.f);
+
+    auto walk = AnimationClip::CreateFromSDKMESH(walkFile.data(), walkFile.size());
+    auto run = AnimationClip::CreateFromSDKMESH(runFile.data(), runFile.size());
+
+    if (walk->Bind(model) != c_BoneCount || run->Bind(model) != c_BoneCount)
+        throw std::runtime_error("Animation clips do not bind to every bone");
+
+    // Each instance crossfades from walking to running at its own point in the clips
+    std::vector<AnimationLayer> layers(c_InstanceCount * 2);
+    for (size_t i = 0; i < c_InstanceCount; ++i)
+    {
+        const float fade = float(i % 101) / 100.f;
+        const float time = float(i) * 0.013f;
+
+        layers[i * 2] = AnimationLayer{ walk.get(), time, 1.f - fade, AnimationBlend_Override, nullptr };
+        layers[i * 2 + 1] = AnimationLayer{ run.get(), time, fade, AnimationBlend_Override, nullptr };
+    }
+
+    AnimationBlender blender(model);
+
+    auto single = ModelBone::MakeArray(c_InstanceCount * c_BoneCount);
+    auto threaded = ModelBone::MakeArray(c_InstanceCount * c_BoneCount);
+
+    const size_t bytes = sizeof(XMMATRIX) * c_InstanceCount * c_BoneCount;
+
+    const double blendOne = Measure(c_Iterations, [&]()
+        {
+            blender.Blend(c_InstanceCount, 2, layers.data(), c_BoneCount, single.get(), 1);
+        });
+
+    const double blendFour = Measure(c_Iterations, [&]()
+        {
+            blender.Blend(c_InstanceCount, 2, layers.data(), c_BoneCount, threaded.get(), 4);
+        });
+
+    if (memcmp(single.get(), threaded.get(), bytes) != 0)
+        throw std::runtime_error("Threaded AnimationBlender::Blend results differ from a single thread");
+
+    const double applyOne = Measure(c_Iterations, [&]()
+        {
+            blender.Apply(c_InstanceCount, 2, layers.data(), c_BoneCount, single.get(), 1);
+        });
+
+    const double applyFour = Measure(c_Iterations, [&]()
+        {
+            blender.Apply(c_InstanceCount, 2, layers.data(), c_BoneCount, threaded.get(), 4);
+        });
+
+    if (memcmp(single.get(), threaded.get(), bytes) != 0)
+        throw std::runtime_error("Threaded AnimationBlender::Apply results differ from a single thread");
+
+    Report("Blend, 1 thread", blendOne);
+    Report("Blend, 4 threads", blendFour, blendOne);
+    Report("Apply, 1 thread", applyOne);
+    Report("Apply, 4 threads", applyFour, applyOne);
+}
@@ -0,0 +1,109 @@
+//--------------------------------------------------------------------------------------
+// File: BoneTransformBench.cpp
+//
+// Absolute bone transforms for a 200 bone skeleton across 1000 instances: the recursive
+// hierarchy walk against the cached parent-before-child order, per instance and batched.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "ModelBench.h"
+
+#include "Model.h"
+
+#include <stdexcept>
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr size_t c_BoneCount = 200;
+    constexpr size_t c_InstanceCount = 1000;
+    constexpr size_t c_Iterations = 20;
+
+    // Ten limbs of chained bones hanging off the root, similar in depth to a character skeleton
+    void BuildSkeleton(ModelBone::Collection& bones)
+    {
+        bones.resize(c_BoneCount);
+
+        for (size_t j = c_BoneCount; j-- > 1;)
+        {
+            const auto parent = static_cast<uint32_t>(((j - 1) % 20 == 0) ? 0 : j - 1);
+            bones[j].parentIndex = parent;
+            bones[j].siblingIndex = bones[parent].childIndex;
+            bones[parent].childIndex = static_cast<uint32_t>(j);
+        }
+    }
+
+    // The depth-first walk used before the order was flattened
+    void ComputeRecursive(const ModelBone::Collection& bones, uint32_t index, CXMMATRIX parent,
+        const XMMATRIX* local, XMMATRIX* result)
+    {
+        while (index != ModelBone::c_Invalid)
+        {
+            const XMMATRIX m = XMMatrixMultiply(local[index], parent);
+            result[index] = m;
+
+            ComputeRecursive(bones, bones[index].childIndex, m, local, result);
+            index = bones[index].siblingIndex;
+        }
+    }
+}
+
+void ModelBench::BenchBoneTransforms()
+{
+    Model model;
+    BuildSkeleton(model.bones);
+    model.Modified();
+
+    auto local = ModelBone::MakeArray(c_BoneCount * c_InstanceCount);
+    auto result = ModelBone::MakeArray(c_BoneCount * c_InstanceCount);
+    auto check = ModelBone::MakeArray(c_BoneCount * c_InstanceCount);
+
+    for (size_t j = 0; j < c_BoneCount * c_InstanceCount; ++j)
+    {
+        local[j] = XMMatrixMultiply(
+            XMMatrixRotationRollPitchYaw(0.01f * float(j % 7), 0.02f * float(j % 5), 0.f),
+            XMMatrixTranslation(0.f, 0.1f, 0.f));
+    }
+
+    const double recursive = Measure(c_Iterations, [&]()
+        {
+            for (size_t i = 0; i < c_InstanceCount; ++i)
+            {
+                ComputeRecursive(model.bones, 0, XMMatrixIdentity(),
+                    local.get() + i * c_BoneCount, check.get() + i * c_BoneCount);
+            }
+        });
+
+    const double perInstance = Measure(c_Iterations, [&]()
+        {
+            for (size_t i = 0; i < c_InstanceCount; ++i)
+            {
+                model.CopyAbsoluteBoneTransforms(c_BoneCount,
+                    local.get() + i * c_BoneCount, result.get() + i * c_BoneCount);
+            }
+        });
+
+    const double batched = Measure(c_Iterations, [&]()
+        {
+            model.CopyAbsoluteBoneTransforms(c_InstanceCount, c_BoneCount, local.get(), result.get());
+        });
+
+    const XMVECTOR epsilon = XMVectorReplicate(1e-3f);
+    for (size_t j = 0; j < c_BoneCount * c_InstanceCount; ++j)
+    {
+        for (size_t r = 0; r < 4; ++r)
+        {
+            if (!XMVector4NearEqual(check[j].r[r], result[j].r[r], epsilon))
+                throw std::runtime_error("Flattened bone order does not match the recursive walk");
+        }
+    }
+
+    Report("Recursive walk per instance", recursive);
+    Report("Cached order per instance", perInstance, recursive);
+    Report("Cached order batched", batched, recursive);
+}
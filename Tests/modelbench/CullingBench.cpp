@@ -0,0 +1,110 @@
+//--------------------------------------------------------------------------------------
+// File: CullingBench.cpp
+//
+// Frustum culling of 100,000 meshes: one BoundingSphere transform and frustum test per
+// mesh against ModelCuller on one and on several threads.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "ModelBench.h"
+
+#include "Model.h"
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr size_t c_ModelCount = 16;
+    constexpr size_t c_MeshesPerModel = 4;
+    constexpr size_t c_InstanceCount = 25000;
+    constexpr size_t c_Iterations = 20;
+
+    static_assert(c_InstanceCount * c_MeshesPerModel == 100000, "Benchmark culls 100k meshes");
+}
+
+void ModelBench::BenchCulling()
+{
+    std::vector<std::unique_ptr<Model>> models;
+    for (size_t j = 0; j < c_ModelCount; ++j)
+    {
+        auto model = std::make_unique<Model>();
+        for (size_t m = 0; m < c_MeshesPerModel; ++m)
+        {
+            auto mesh = std::make_shared<ModelMesh>();
+            mesh->boundingSphere.Center = XMFLOAT3(float(m), float(j % 3), 0.f);
+            mesh->boundingSphere.Radius = 0.5f + 0.25f * float(m);
+            model->meshes.emplace_back(std::move(mesh));
+        }
+        models.emplace_back(std::move(model));
+    }
+
+    // Instances scattered on a grid around the camera, about half of them in view
+    std::vector<const Model*> instances(c_InstanceCount);
+    auto worlds = std::make_unique<XMMATRIX[]>(c_InstanceCount);
+    for (size_t i = 0; i < c_InstanceCount; ++i)
+    {
+        instances[i] = models[i % c_ModelCount].get();
+
+        const float x = float(i % 200) * 4.f - 400.f;
+        const float z = float(i / 200) * 4.f - 250.f;
+        worlds[i] = XMMatrixMultiply(
+            XMMatrixScaling(1.f + float(i % 4) * 0.5f, 1.f, 1.f),
+            XMMatrixMultiply(XMMatrixRotationY(float(i) * 0.1f), XMMatrixTranslation(x, 0.f, z)));
+    }
+
+    const XMMATRIX view = XMMatrixLookAtRH(XMVectorSet(0.f, 20.f, -300.f, 1.f), g_XMZero, g_XMIdentityR1);
+    const XMMATRIX proj = XMMatrixPerspectiveFovRH(XM_PIDIV4, 16.f / 9.f, 0.1f, 800.f);
+
+    BoundingFrustum frustum(proj, true);
+    frustum.Transform(frustum, XMMatrixInverse(nullptr, view));
+
+    size_t expected = 0;
+    const double scalar = Measure(c_Iterations, [&]()
+        {
+            expected = 0;
+            for (size_t i = 0; i < c_InstanceCount; ++i)
+            {
+                for (const auto& mesh : instances[i]->meshes)
+                {
+                    BoundingSphere sphere;
+                    mesh->boundingSphere.Transform(sphere, worlds[i]);
+                    if (frustum.Intersects(sphere))
+                        ++expected;
+                }
+            }
+        });
+
+    ModelCuller culler;
+    std::vector<ModelMeshVisibility> visible;
+
+    const double single = Measure(c_Iterations, [&]()
+        {
+            culler.Cull(frustum, c_InstanceCount, instances.data(), worlds.get(), visible, 1);
+        });
+
+    const size_t singleCount = visible.size();
+
+    const double threaded = Measure(c_Iterations, [&]()
+        {
+            culler.Cull(frustum, c_InstanceCount, instances.data(), worlds.get(), visible, 4);
+        });
+
+    if (visible.size() != singleCount)
+        throw std::runtime_error("Threaded ModelCuller results differ from a single thread");
+
+    // The sphere-plane test is conservative, so it can keep a few more meshes than the exact test
+    printf("  %zu of %zu meshes visible (%zu with the exact test)\n",
+        singleCount, c_InstanceCount * c_MeshesPerModel, expected);
+
+    Report("BoundingSphere per mesh", scalar);
+    Report("ModelCuller, 1 thread", single, scalar);
+    Report("ModelCuller, 4 threads", threaded, scalar);
+}
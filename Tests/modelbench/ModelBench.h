@@ -0,0 +1,52 @@
+//--------------------------------------------------------------------------------------
+// File: ModelBench.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+namespace ModelBench
+{
+    // Runs the function once to warm caches, then returns the average milliseconds of the timed runs
+    template<typename F>
+    double Measure(size_t iterations, F&& func)
+    {
+        func();
+
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t j = 0; j < iterations; ++j)
+        {
+            func();
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        return std::chrono::duration<double, std::milli>(end - start).count() / double(iterations);
+    }
+
+    inline void Report(const char* name, double ms, double baselineMs = 0.0)
+    {
+        if (baselineMs > 0.0)
+        {
+            printf("  %-40s %10.3f ms  (%.2fx)\n", name, ms, baselineMs / ms);
+        }
+        else
+        {
+            printf("  %-40s %10.3f ms\n", name, ms);
+        }
+    }
+
+    // Each benchmark prints its own timings and throws on failure
+    void BenchAnimationBlend();
+    void BenchBoneTransforms();
+    void BenchCulling();
+    void BenchSDKMESHLoad();
+    void BenchSkinning();
+}
@@ -0,0 +1,226 @@
+//--------------------------------------------------------------------------------------
+// File: SDKMESHLoadBench.cpp
+//
+// Cold-start load of a 64 mesh SDKMESH file into a model description, the part of the
+// load that runs before a device is involved, with and without the load-time options.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "ModelBench.h"
+
+#include "Model.h"
+#include "SDKMesh.h"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr uint32_t c_MeshCount = 64;
+    constexpr uint32_t c_SubsetsPerMesh = 4;
+    constexpr uint32_t c_MaterialCount = 8;
+    constexpr uint32_t c_GridSize = 64;     // Vertices per side of each mesh
+    constexpr size_t c_Iterations = 20;
+
+    struct Vertex
+    {
+        XMFLOAT3 position;
+        XMFLOAT3 normal;
+        XMFLOAT2 textureCoordinate;
+    };
+
+    template<typename T>
+    T* At(std::vector<uint8_t>& file, uint64_t offset)
+    {
+        return reinterpret_cast<T*>(file.data() + offset);
+    }
+
+    // Each mesh is a grid with its own vertex and index buffer, split into subsets that
+    // alternate between materials, and bound to a frame of a flat hierarchy.
+    std::vector<uint8_t> MakeSDKMESH()
+    {
+        using namespace DXUT;
+
+        constexpr uint32_t vertexCount = c_GridSize * c_GridSize;
+        constexpr uint32_t indexCount = (c_GridSize - 1) * (c_GridSize - 1) * 6;
+        static_assert(indexCount % (c_SubsetsPerMesh * 3) == 0, "Subsets split the grid on triangles");
+
+        constexpr uint64_t vbSize = uint64_t(vertexCount) * sizeof(Vertex);
+        constexpr uint64_t ibSize = uint64_t(indexCount) * sizeof(uint16_t);
+
+        const uint64_t headerSize = sizeof(SDKMESH_HEADER)
+            + c_MeshCount * sizeof(SDKMESH_VERTEX_BUFFER_HEADER)
+            + c_MeshCount * sizeof(SDKMESH_INDEX_BUFFER_HEADER);
+
+        const uint64_t meshOffset = headerSize;
+        const uint64_t subsetOffset = meshOffset + c_MeshCount * sizeof(SDKMESH_MESH);
+        const uint64_t frameOffset = subsetOffset + c_MeshCount * c_SubsetsPerMesh * sizeof(SDKMESH_SUBSET);
+        const uint64_t materialOffset = frameOffset + c_MeshCount * sizeof(SDKMESH_FRAME);
+        const uint64_t subsetIndexOffset = materialOffset + c_MaterialCount * sizeof(SDKMESH_MATERIAL);
+        const uint64_t bufferOffset = subsetIndexOffset + c_MeshCount * c_SubsetsPerMesh * sizeof(uint32_t);
+        const uint64_t bufferSize = c_MeshCount * (vbSize + ibSize);
+
+        std::vector<uint8_t> file(static_cast<size_t>(bufferOffset + bufferSize));
+
+        auto header = At<SDKMESH_HEADER>(file, 0);
+        header->Version = SDKMESH_FILE_VERSION;
+        header->HeaderSize = headerSize;
+        header->NonBufferDataSize = bufferOffset - headerSize;
+        header->BufferDataSize = bufferSize;
+        header->NumVertexBuffers = c_MeshCount;
+        header->NumIndexBuffers = c_MeshCount;
+        header->NumMeshes = c_MeshCount;
+        header->NumTotalSubsets = c_MeshCount * c_SubsetsPerMesh;
+        header->NumFrames = c_MeshCount;
+        header->NumMaterials = c_MaterialCount;
+        header->VertexStreamHeadersOffset = sizeof(SDKMESH_HEADER);
+        header->IndexStreamHeadersOffset = sizeof(SDKMESH_HEADER) + c_MeshCount * sizeof(SDKMESH_VERTEX_BUFFER_HEADER);
+        header->MeshDataOffset = meshOffset;
+        header->SubsetDataOffset = subsetOffset;
+        header->FrameDataOffset = frameOffset;
+        header->MaterialDataOffset = materialOffset;
+
+        const D3DVERTEXELEMENT9 decl[] =
+        {
+            { 0, 0, D3DDECLTYPE_FLOAT3, 0, D3DDECLUSAGE_POSITION, 0 },
+            { 0, 12, D3DDECLTYPE_FLOAT3, 0, D3DDECLUSAGE_NORMAL, 0 },
+            { 0, 24, D3DDECLTYPE_FLOAT2, 0, D3DDECLUSAGE_TEXCOORD, 0 },
+            { 0xFF, 0, D3DDECLTYPE_UNUSED, 0, 0, 0 },
+        };
+
+        for (uint32_t m = 0; m < c_MaterialCount; ++m)
+        {
+            auto& mat = At<SDKMESH_MATERIAL>(file, materialOffset)[m];
+            sprintf_s(mat.Name, "material%u", m);
+            sprintf_s(mat.DiffuseTexture, "diffuse%u.dds", m);
+            mat.Diffuse = XMFLOAT4(1.f, 1.f, 1.f, 1.f);
+            mat.Specular = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.f);
+            mat.Power = 16.f;
+        }
+
+        for (uint32_t j = 0; j < c_MeshCount; ++j)
+        {
+            const uint64_t vbOffset = bufferOffset + j * (vbSize + ibSize);
+            const uint64_t ibOffset = vbOffset + vbSize;
+
+            auto& vh = At<SDKMESH_VERTEX_BUFFER_HEADER>(file, header->VertexStreamHeadersOffset)[j];
+            vh.NumVertices = vertexCount;
+            vh.SizeBytes = vbSize;
+            vh.StrideBytes = sizeof(Vertex);
+            memcpy(vh.Decl, decl, sizeof(decl));
+            vh.DataOffset = vbOffset;
+
+            auto& ih = At<SDKMESH_INDEX_BUFFER_HEADER>(file, header->IndexStreamHeadersOffset)[j];
+            ih.NumIndices = indexCount;
+            ih.SizeBytes = ibSize;
+            ih.IndexType = IT_16BIT;
+            ih.DataOffset = ibOffset;
+
+            // A gently curved grid, offset per mesh
+            auto verts = At<Vertex>(file, vbOffset);
+            for (uint32_t y = 0; y < c_GridSize; ++y)
+            {
+                for (uint32_t x = 0; x < c_GridSize; ++x)
+                {
+                    auto& v = verts[y * c_GridSize + x];
+                    const float u = float(x) / float(c_GridSize - 1);
+                    const float w = float(y) / float(c_GridSize - 1);
+                    v.position = XMFLOAT3(float(j % 8) * 4.f + u * 3.f, 0.25f * sinf(u * XM_PI), float(j / 8) * 4.f + w * 3.f);
+                    v.normal = XMFLOAT3(0.f, 1.f, 0.f);
+                    v.textureCoordinate = XMFLOAT2(u, w);
+                }
+            }
+
+            auto indices = At<uint16_t>(file, ibOffset);
+            for (uint32_t y = 0; y + 1 < c_GridSize; ++y)
+            {
+                for (uint32_t x = 0; x + 1 < c_GridSize; ++x)
+                {
+                    const auto i = static_cast<uint16_t>(y * c_GridSize + x);
+                    *indices++ = i;
+                    *indices++ = static_cast<uint16_t>(i + c_GridSize);
+                    *indices++ = static_cast<uint16_t>(i + 1);
+                    *indices++ = static_cast<uint16_t>(i + 1);
+                    *indices++ = static_cast<uint16_t>(i + c_GridSize);
+                    *indices++ = static_cast<uint16_t>(i + c_GridSize + 1);
+                }
+            }
+
+            auto& mh = At<SDKMESH_MESH>(file, meshOffset)[j];
+            sprintf_s(mh.Name, "mesh%u", j);
+            mh.NumVertexBuffers = 1;
+            mh.VertexBuffers[0] = j;
+            mh.IndexBuffer = j;
+            mh.NumSubsets = c_SubsetsPerMesh;
+            mh.BoundingBoxCenter = XMFLOAT3(float(j % 8) * 4.f + 1.5f, 0.125f, float(j / 8) * 4.f + 1.5f);
+            mh.BoundingBoxExtents = XMFLOAT3(1.5f, 0.125f, 1.5f);
+            mh.SubsetOffset = subsetIndexOffset + uint64_t(j) * c_SubsetsPerMesh * sizeof(uint32_t);
+
+            for (uint32_t s = 0; s < c_SubsetsPerMesh; ++s)
+            {
+                const uint32_t index = j * c_SubsetsPerMesh + s;
+                At<uint32_t>(file, mh.SubsetOffset)[s] = index;
+
+                // Pairs of adjacent subsets share a material, so merging halves the part count
+                auto& subset = At<SDKMESH_SUBSET>(file, subsetOffset)[index];
+                sprintf_s(subset.Name, "subset%u", index);
+                subset.MaterialID = (j + s / 2) % c_MaterialCount;
+                subset.PrimitiveType = PT_TRIANGLE_LIST;
+                subset.IndexStart = uint64_t(s) * (indexCount / c_SubsetsPerMesh);
+                subset.IndexCount = indexCount / c_SubsetsPerMesh;
+                subset.VertexStart = 0;
+                subset.VertexCount = vertexCount;
+            }
+
+            auto& frame = At<SDKMESH_FRAME>(file, frameOffset)[j];
+            sprintf_s(frame.Name, "frame%u", j);
+            frame.Mesh = j;
+            frame.ParentFrame = (j > 0) ? 0 : INVALID_FRAME;
+            frame.ChildFrame = (j == 0 && c_MeshCount > 1) ? 1 : INVALID_FRAME;
+            frame.SiblingFrame = (j > 0 && j + 1 < c_MeshCount) ? j + 1 : INVALID_FRAME;
+            XMStoreFloat4x4(&frame.Matrix, XMMatrixIdentity());
+            frame.AnimationDataIndex = INVALID_ANIMATION_DATA;
+        }
+
+        return file;
+    }
+}
+
+void ModelBench::BenchSDKMESHLoad()
+{
+    const auto file = MakeSDKMESH();
+
+    printf("  %u meshes, %u subsets, %.1f MB\n",
+        c_MeshCount, c_MeshCount * c_SubsetsPerMesh, double(file.size()) / (1024.0 * 1024.0));
+
+    auto load = [&](ModelLoaderFlags flags)
+        {
+            auto desc = ModelDescription::CreateFromMemory(ModelFile_SDKMESH, file.data(), file.size(), flags);
+            if (desc->GetMeshCount() != c_MeshCount || desc->GetTextureNames().size() != c_MaterialCount)
+                throw std::runtime_error("SDKMESH description does not match the file");
+        };
+
+    const double plain = Measure(c_Iterations, [&]() { load(ModelLoader_Clockwise); });
+
+    const double bones = Measure(c_Iterations, [&]() { load(ModelLoader_Clockwise | ModelLoader_IncludeBones); });
+
+    const double geometry = Measure(c_Iterations, [&]() { load(ModelLoader_Clockwise | ModelLoader_RetainGeometry); });
+
+    const double optimized = Measure(c_Iterations, [&]()
+        {
+            load(ModelLoader_Clockwise | ModelLoader_CompactVertices | ModelLoader_MergeParts | ModelLoader_ConsolidateBuffers);
+        });
+
+    Report("Description", plain);
+    Report("Description with bones", bones, plain);
+    Report("Description with retained geometry", geometry, plain);
+    Report("Compacted, merged, consolidated", optimized, plain);
+}
@@ -0,0 +1,152 @@
+//--------------------------------------------------------------------------------------
+// File: SkinningBench.cpp
+//
+// Software skinning of 32 streams of 8192 vertices with a 64 bone skeleton: a per-vertex
+// reference loop against ModelSkinner on one thread and on the shared worker threads.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "ModelBench.h"
+
+#include "Model.h"
+
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr size_t c_StreamCount = 32;
+    constexpr size_t c_VertexCount = 8192;
+    constexpr size_t c_BoneCount = 64;
+    constexpr size_t c_Iterations = 20;
+
+    struct Vertex
+    {
+        XMFLOAT3    position;
+        XMFLOAT3    normal;
+        uint8_t     indices[4];
+        uint8_t     weights[4];
+    };
+
+    static_assert(sizeof(Vertex) == 32, "Vertex layout mismatch");
+
+    const D3D11_INPUT_ELEMENT_DESC c_InputElements[] =
+    {
+        { "SV_Position",  0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,  D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "NORMAL",       0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "BLENDINDICES", 0, DXGI_FORMAT_R8G8B8A8_UINT,   0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "BLENDWEIGHT",  0, DXGI_FORMAT_R8G8B8A8_UNORM,  0, 28, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    };
+
+    // Blends the positions one vertex and one bone at a time
+    void SkinReference(const std::vector<Vertex>& vertices, const XMMATRIX* bones, XMFLOAT3* result)
+    {
+        for (size_t j = 0; j < vertices.size(); ++j)
+        {
+            const auto& v = vertices[j];
+            const XMVECTOR p = XMLoadFloat3(&v.position);
+
+            XMVECTOR sum = XMVectorZero();
+            for (size_t k = 0; k < 4; ++k)
+            {
+                const float w = float(v.weights[k]) / 255.f;
+                sum = XMVectorMultiplyAdd(XMVector3Transform(p, bones[v.indices[k]]), XMVectorReplicate(w), sum);
+            }
+
+            XMStoreFloat3(&result[j], sum);
+        }
+    }
+}
+
+void ModelBench::BenchSkinning()
+{
+    const ModelMeshPart::InputLayoutCollection decl(std::begin(c_InputElements), std::end(c_InputElements));
+
+    std::vector<std::vector<Vertex>> streams(c_StreamCount);
+
+    ModelSkinner single;
+    ModelSkinner threaded;
+
+    for (size_t s = 0; s < c_StreamCount; ++s)
+    {
+        auto& vertices = streams[s];
+        vertices.resize(c_VertexCount);
+
+        for (size_t j = 0; j < c_VertexCount; ++j)
+        {
+            auto& v = vertices[j];
+            v.position = XMFLOAT3(float(j % 64) * 0.1f, float(j / 64) * 0.1f, float(s) * 0.5f);
+            v.normal = XMFLOAT3(0.f, 0.f, 1.f);
+
+            // Four influences per vertex with weights that sum to one
+            const auto bone = static_cast<uint8_t>((j + s) % (c_BoneCount - 3));
+            v.indices[0] = bone;
+            v.indices[1] = static_cast<uint8_t>(bone + 1);
+            v.indices[2] = static_cast<uint8_t>(bone + 2);
+            v.indices[3] = static_cast<uint8_t>(bone + 3);
+            v.weights[0] = 128;
+            v.weights[1] = 64;
+            v.weights[2] = 48;
+            v.weights[3] = 15;
+        }
+
+        single.AddVertices(decl, sizeof(Vertex), c_VertexCount, vertices.data());
+        threaded.AddVertices(decl, sizeof(Vertex), c_VertexCount, vertices.data());
+    }
+
+    auto bones = ModelBone::MakeArray(c_BoneCount);
+    for (size_t j = 0; j < c_BoneCount; ++j)
+    {
+        bones[j] = XMMatrixMultiply(
+            XMMatrixRotationRollPitchYaw(0.02f * float(j), 0.01f * float(j % 7), 0.f),
+            XMMatrixTranslation(0.f, 0.05f * float(j), 0.f));
+    }
+
+    std::vector<XMFLOAT3> expected(c_StreamCount * c_VertexCount);
+
+    const double reference = Measure(c_Iterations, [&]()
+        {
+            for (size_t s = 0; s < c_StreamCount; ++s)
+            {
+                SkinReference(streams[s], bones.get(), expected.data() + s * c_VertexCount);
+            }
+        });
+
+    const double one = Measure(c_Iterations, [&]()
+        {
+            single.Skin(c_BoneCount, bones.get(), 1);
+        });
+
+    const double four = Measure(c_Iterations, [&]()
+        {
+            threaded.Skin(c_BoneCount, bones.get(), 4);
+        });
+
+    const XMVECTOR epsilon = XMVectorReplicate(1e-3f);
+    for (size_t s = 0; s < c_StreamCount; ++s)
+    {
+        auto a = static_cast<const Vertex*>(single.GetSkinnedVertices(s));
+        auto b = static_cast<const Vertex*>(threaded.GetSkinnedVertices(s));
+
+        if (memcmp(a, b, c_VertexCount * sizeof(Vertex)) != 0)
+            throw std::runtime_error("Threaded ModelSkinner results differ from a single thread");
+
+        for (size_t j = 0; j < c_VertexCount; ++j)
+        {
+            if (!XMVector3NearEqual(XMLoadFloat3(&a[j].position), XMLoadFloat3(&expected[s * c_VertexCount + j]), epsilon))
+                throw std::runtime_error("ModelSkinner positions do not match the reference blend");
+        }
+    }
+
+    Report("Reference per vertex", reference);
+    Report("ModelSkinner, 1 thread", one, reference);
+    Report("ModelSkinner, 4 threads", four, reference);
+}
@@ -0,0 +1,55 @@
+//--------------------------------------------------------------------------------------
+// File: main.cpp
+//
+// Benchmarks for the CPU side of the model runtime
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "ModelBench.h"
+
+#include <cstdio>
+#include <exception>
+
+namespace
+{
+    struct BenchInfo
+    {
+        const char* name;
+        void (*func)();
+    };
+
+    const BenchInfo g_Benchmarks[] =
+    {
+        { "Animation blending (64 bones x 2000 instances)", ModelBench::BenchAnimationBlend },
+        { "Bone transforms (200 bones x 1000 instances)", ModelBench::BenchBoneTransforms },
+        { "Frustum culling (100k meshes)", ModelBench::BenchCulling },
+        { "SDKMESH cold-start load (64 meshes)", ModelBench::BenchSDKMESHLoad },
+        { "Software skinning (32 x 8192 vertices)", ModelBench::BenchSkinning },
+    };
+}
+
+int main()
+{
+    int result = 0;
+
+    for (const auto& bench : g_Benchmarks)
+    {
+        printf("%s\n", bench.name);
+
+        try
+        {
+            bench.func();
+        }
+        catch (const std::exception& e)
+        {
+            printf("ERROR: %s threw an exception: %s\n", bench.name, e.what());
+            result = 1;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,145 @@
+//--------------------------------------------------------------------------------------
+// File: BoneOrderTest.cpp
+//
+// Checks the cached parent-before-child bone order against a recursive evaluation,
+// including hierarchies edited without calling Model::Modified in debug builds.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "ModelTests.h"
+
+#include "Model.h"
+
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr size_t c_BoneCount = 64;
+
+    // Rebuilds the parent, child, and sibling links from a parent index per bone
+    void LinkBones(ModelBone::Collection& bones, const std::vector<uint32_t>& parents)
+    {
+        for (auto& bone : bones)
+        {
+            bone.parentIndex = bone.childIndex = bone.siblingIndex = ModelBone::c_Invalid;
+        }
+
+        // Walk backwards so children end up in increasing index order
+        for (size_t j = bones.size(); j-- > 1;)
+        {
+            const uint32_t parent = parents[j];
+            bones[j].parentIndex = parent;
+            bones[j].siblingIndex = bones[parent].childIndex;
+            bones[parent].childIndex = static_cast<uint32_t>(j);
+        }
+    }
+
+    XMMATRIX ComputeReference(const ModelBone::Collection& bones, const XMMATRIX* local, size_t index)
+    {
+        const uint32_t parent = bones[index].parentIndex;
+        if (parent == ModelBone::c_Invalid)
+            return local[index];
+
+        return XMMatrixMultiply(local[index], ComputeReference(bones, local, parent));
+    }
+
+    bool MatchesReference(const Model& model, const XMMATRIX* local, const XMMATRIX* result)
+    {
+        const XMVECTOR epsilon = XMVectorReplicate(1e-4f);
+
+        for (size_t j = 0; j < model.bones.size(); ++j)
+        {
+            const XMMATRIX expected = ComputeReference(model.bones, local, j);
+            for (size_t r = 0; r < 4; ++r)
+            {
+                if (!XMVector4NearEqual(expected.r[r], result[j].r[r], epsilon))
+                {
+                    printf("ERROR: bone %zu does not match the reference transform\n", j);
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+}
+
+bool ModelTests::TestBoneOrder()
+{
+    bool success = true;
+
+    Model model;
+    model.bones.resize(c_BoneCount);
+    model.boneMatrices = ModelBone::MakeArray(c_BoneCount);
+
+    for (size_t j = 0; j < c_BoneCount; ++j)
+    {
+        model.boneMatrices[j] = XMMatrixMultiply(
+            XMMatrixRotationY(0.1f * float(j)),
+            XMMatrixTranslation(1.f, float(j % 3), 0.f));
+    }
+
+    // Balanced binary tree
+    std::vector<uint32_t> parents(c_BoneCount, ModelBone::c_Invalid);
+    for (size_t j = 1; j < c_BoneCount; ++j)
+    {
+        parents[j] = static_cast<uint32_t>((j - 1) / 2);
+    }
+
+    LinkBones(model.bones, parents);
+    model.Modified();
+
+    auto result = ModelBone::MakeArray(c_BoneCount);
+
+    model.CopyAbsoluteBoneTransformsTo(c_BoneCount, result.get());
+    TEST_CHECK(MatchesReference(model, model.boneMatrices.get(), result.get()));
+
+    // Re-link into a single chain. Debug builds detect the stale order without Modified
+    for (size_t j = 1; j < c_BoneCount; ++j)
+    {
+        parents[j] = static_cast<uint32_t>(j - 1);
+    }
+
+    LinkBones(model.bones, parents);
+#ifndef _DEBUG
+    model.Modified();
+#endif
+
+    model.CopyAbsoluteBoneTransformsTo(c_BoneCount, result.get());
+    TEST_CHECK(MatchesReference(model, model.boneMatrices.get(), result.get()));
+
+    model.CopyAbsoluteBoneTransforms(c_BoneCount, model.boneMatrices.get(), result.get());
+    TEST_CHECK(MatchesReference(model, model.boneMatrices.get(), result.get()));
+
+    // Batched instances after refreshing the cache
+    model.Modified();
+
+    constexpr size_t c_Instances = 3;
+    auto local = ModelBone::MakeArray(c_BoneCount * c_Instances);
+    auto batch = ModelBone::MakeArray(c_BoneCount * c_Instances);
+
+    for (size_t i = 0; i < c_Instances; ++i)
+    {
+        for (size_t j = 0; j < c_BoneCount; ++j)
+        {
+            local[i * c_BoneCount + j] = XMMatrixMultiply(
+                model.boneMatrices[j],
+                XMMatrixRotationZ(0.05f * float(i)));
+        }
+    }
+
+    model.CopyAbsoluteBoneTransforms(c_Instances, c_BoneCount, local.get(), batch.get());
+
+    for (size_t i = 0; i < c_Instances; ++i)
+    {
+        TEST_CHECK(MatchesReference(model, local.get() + i * c_BoneCount, batch.get() + i * c_BoneCount));
+    }
+
+    return success;
+}
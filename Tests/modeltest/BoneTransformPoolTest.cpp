@@ -0,0 +1,146 @@
+//--------------------------------------------------------------------------------------
+// File: BoneTransformPoolTest.cpp
+//
+// Checks that pooled, plain and _aligned_malloc bone transform arrays share one stateless
+// deleter, that released arrays are recycled, and that ModelBoneTransformBatch keeps its
+// instances.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "ModelTests.h"
+
+#include "Model.h"
+
+#include <cstdint>
+#include <malloc.h>
+#include <vector>
+
+using namespace DirectX;
+
+static_assert(sizeof(ModelBone::TransformArray) == sizeof(XMMATRIX*), "Transform arrays must not carry deleter state");
+
+namespace
+{
+    bool Aligned(const XMMATRIX* p) noexcept
+    {
+        return (reinterpret_cast<uintptr_t>(p) % 16) == 0;
+    }
+}
+
+bool ModelTests::TestBoneTransformPool()
+{
+    bool success = true;
+
+    ModelBoneTransformPool pool(4096);
+
+    // Size classes, a count that is not a power of two, and one too large for any class
+    {
+        std::vector<ModelBone::TransformArray> arrays;
+        for (size_t count : { 1u, 2u, 3u, 64u, 100u, 10000u })
+        {
+            auto a = pool.Allocate(count);
+            TEST_CHECK(a != nullptr);
+            TEST_CHECK(Aligned(a.get()));
+
+            for (size_t j = 0; j < count; ++j)
+            {
+                a[j] = XMMatrixTranslation(float(j), 0.f, 0.f);
+            }
+            arrays.emplace_back(std::move(a));
+        }
+
+        TEST_CHECK(pool.GetArrayCount() == 6);
+    }
+
+    TEST_CHECK(pool.GetArrayCount() == 0);
+
+    // Released arrays go back on the free lists, so asking again reserves nothing new
+    const size_t reserved = pool.GetReservedBytes();
+    {
+        auto a = pool.Allocate(64);
+        auto b = pool.Allocate(100);
+        TEST_CHECK(pool.GetArrayCount() == 2);
+    }
+    TEST_CHECK(pool.GetReservedBytes() == reserved);
+
+    // Plain and pooled arrays can replace one another; each goes back where it came from
+    {
+        auto plain = ModelBone::MakeArray(16);
+        TEST_CHECK(Aligned(plain.get()));
+
+        auto pooled = pool.Allocate(16);
+        TEST_CHECK(pool.GetArrayCount() == 1);
+
+        plain = std::move(pooled);
+        TEST_CHECK(pool.GetArrayCount() == 1);
+
+        plain = ModelBone::MakeArray(8);
+        TEST_CHECK(pool.GetArrayCount() == 0);
+    }
+
+    // Arrays allocated directly with _aligned_malloc, as before the pool existed, are still
+    // freed with _aligned_free, and can be replaced by pooled ones
+    {
+        for (size_t alignment : { 16u, 64u })
+        {
+            auto raw = static_cast<XMMATRIX*>(_aligned_malloc(sizeof(XMMATRIX) * 4, alignment));
+            TEST_CHECK(raw != nullptr);
+            if (!raw)
+                continue;
+
+            ModelBone::TransformArray plain(raw);
+            plain[3] = XMMatrixIdentity();
+
+            plain = pool.Allocate(4);
+            TEST_CHECK(pool.GetArrayCount() == 1);
+
+            plain.reset(static_cast<XMMATRIX*>(_aligned_malloc(sizeof(XMMATRIX), alignment)));
+            TEST_CHECK(pool.GetArrayCount() == 0);
+        }
+    }
+
+    // Batches grow from the pool and keep their instances when they do
+    {
+        constexpr size_t c_BoneCount = 5;
+
+        ModelBoneTransformBatch batch(c_BoneCount, &pool);
+        for (size_t i = 0; i < 40; ++i)
+        {
+            XMMATRIX transforms[c_BoneCount];
+            for (size_t j = 0; j < c_BoneCount; ++j)
+            {
+                transforms[j] = XMMatrixTranslation(float(i), float(j), 0.f);
+            }
+            TEST_CHECK(batch.AddInstance(transforms) == i);
+        }
+
+        TEST_CHECK(batch.GetInstanceCount() == 40);
+        TEST_CHECK(batch.GetCapacity() >= 40);
+        TEST_CHECK(pool.GetArrayCount() == 1);
+
+        bool intact = true;
+        for (size_t i = 0; i < 40; ++i)
+        {
+            const XMMATRIX* instance = batch.GetInstance(i);
+            for (size_t j = 0; j < c_BoneCount; ++j)
+            {
+                if (XMVectorGetX(instance[j].r[3]) != float(i) || XMVectorGetY(instance[j].r[3]) != float(j))
+                    intact = false;
+            }
+        }
+        TEST_CHECK(intact);
+
+        // The last instance moves into the removed slot
+        batch.RemoveInstance(3);
+        TEST_CHECK(batch.GetInstanceCount() == 39);
+        TEST_CHECK(XMVectorGetX(batch.GetInstance(3)[0].r[3]) == 39.f);
+    }
+
+    TEST_CHECK(pool.GetArrayCount() == 0);
+
+    return success;
+}
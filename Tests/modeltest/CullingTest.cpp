@@ -0,0 +1,109 @@
+//--------------------------------------------------------------------------------------
+// File: CullingTest.cpp
+//
+// Checks ModelCuller against per-mesh BoundingSphere tests for models with varying mesh
+// counts, so runs of spheres straddle the four-wide groups and the batch boundaries.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "ModelTests.h"
+
+#include "Model.h"
+
+#include <memory>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr size_t c_InstanceCount = 1000;
+
+    bool SameResults(const std::vector<ModelMeshVisibility>& a, const std::vector<ModelMeshVisibility>& b)
+    {
+        if (a.size() != b.size())
+            return false;
+
+        for (size_t j = 0; j < a.size(); ++j)
+        {
+            if (a[j].instanceIndex != b[j].instanceIndex || a[j].meshIndex != b[j].meshIndex)
+                return false;
+        }
+
+        return true;
+    }
+}
+
+bool ModelTests::TestCulling()
+{
+    bool success = true;
+
+    // Mesh counts that are not multiples of four
+    std::vector<std::unique_ptr<Model>> models;
+    for (size_t meshCount : { 1u, 3u, 5u, 7u })
+    {
+        auto model = std::make_unique<Model>();
+        for (size_t m = 0; m < meshCount; ++m)
+        {
+            auto mesh = std::make_shared<ModelMesh>();
+            mesh->boundingSphere.Center = XMFLOAT3(float(m % 3) - 1.f, float(m % 2), -float(m % 4));
+            mesh->boundingSphere.Radius = 0.5f;
+            model->meshes.emplace_back(std::move(mesh));
+        }
+        models.emplace_back(std::move(model));
+    }
+
+    // Every third instance is behind the camera; the rest are well inside the frustum
+    std::vector<const Model*> instances(c_InstanceCount);
+    auto worlds = std::make_unique<XMMATRIX[]>(c_InstanceCount);
+    for (size_t i = 0; i < c_InstanceCount; ++i)
+    {
+        instances[i] = (i % 11 == 5) ? nullptr : models[i % models.size()].get();
+
+        const float z = (i % 3 == 0) ? 50.f : -30.f - float(i % 50);
+        worlds[i] = XMMatrixMultiply(
+            XMMatrixMultiply(XMMatrixScaling(1.f + float(i % 3) * 0.5f, 1.f, 1.f), XMMatrixRotationY(float(i) * 0.3f)),
+            XMMatrixTranslation(float(i % 5) - 2.f, 0.f, z));
+    }
+
+    const BoundingFrustum frustum(XMMatrixPerspectiveFovRH(XM_PIDIV4, 1.f, 0.1f, 1000.f), true);
+
+    std::vector<ModelMeshVisibility> expected;
+    for (size_t i = 0; i < c_InstanceCount; ++i)
+    {
+        if (!instances[i])
+            continue;
+
+        const auto& meshes = instances[i]->meshes;
+        for (size_t m = 0; m < meshes.size(); ++m)
+        {
+            BoundingSphere sphere;
+            meshes[m]->boundingSphere.Transform(sphere, worlds[i]);
+            if (frustum.Intersects(sphere))
+            {
+                expected.push_back(ModelMeshVisibility{ static_cast<uint32_t>(i), static_cast<uint32_t>(m) });
+            }
+        }
+    }
+
+    TEST_CHECK(!expected.empty());
+
+    ModelCuller culler;
+    std::vector<ModelMeshVisibility> visible;
+
+    culler.Cull(frustum, c_InstanceCount, instances.data(), worlds.get(), visible, 1);
+    TEST_CHECK(SameResults(expected, visible));
+
+    // Repeated threaded calls reuse the shared workers
+    for (size_t j = 0; j < 3; ++j)
+    {
+        culler.Cull(frustum, c_InstanceCount, instances.data(), worlds.get(), visible, 3);
+        TEST_CHECK(SameResults(expected, visible));
+    }
+
+    return success;
+}
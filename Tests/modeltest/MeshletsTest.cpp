@@ -0,0 +1,95 @@
+//--------------------------------------------------------------------------------------
+// File: MeshletsTest.cpp
+//
+// Checks that meshlets built from a closed sphere cover every triangle once, and that the
+// normal cones keep the clusters facing the eye and cull the ones on the far side.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "ModelTests.h"
+
+#include "GeometricPrimitive.h"
+#include "Meshlets.h"
+
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    using VertexCollection = GeometricPrimitive::VertexCollection;
+    using IndexCollection = GeometricPrimitive::IndexCollection;
+
+    // The sphere sits 10 units in front of an eye at the origin looking down -z
+    constexpr float c_Distance = 10.f;
+
+    bool TestSphere(bool rhcoords)
+    {
+        bool success = true;
+
+        VertexCollection vertices;
+        IndexCollection indices;
+        GeometricPrimitive::CreateSphere(vertices, indices, 2.f, 64, rhcoords);
+
+        std::vector<Meshlet> meshlets;
+        IndexCollection reordered;
+        ComputeMeshlets(indices.data(), indices.size() / 3,
+            &vertices[0].position, sizeof(VertexCollection::value_type), vertices.size(),
+            meshlets, reordered, rhcoords);
+
+        TEST_CHECK(meshlets.size() > 1);
+        TEST_CHECK(reordered.size() == indices.size());
+
+        size_t covered = 0;
+        for (const auto& it : meshlets)
+        {
+            TEST_CHECK(it.startIndex == covered);
+            covered += it.indexCount;
+        }
+        TEST_CHECK(covered == indices.size());
+
+        const BoundingFrustum frustum(XMMatrixPerspectiveFovRH(XM_PIDIV2, 1.f, 0.1f, 100.f), true);
+        const XMMATRIX world = XMMatrixTranslation(0.f, 0.f, -c_Distance);
+        const XMVECTOR toEye = XMVectorSet(0.f, 0.f, 1.f, 0.f);
+
+        size_t facing = 0;
+        size_t away = 0;
+        for (const auto& it : meshlets)
+        {
+            // The whole sphere is inside the frustum, so only the cone decides
+            std::vector<MeshletRange> visible;
+            CullMeshlets(&it, 1, frustum, world, g_XMZero, visible);
+
+            const float dp = XMVectorGetX(XMVector3Dot(XMVector3Normalize(XMLoadFloat3(&it.boundingSphere.Center)), toEye));
+            if (dp > 0.8f)
+            {
+                ++facing;
+                TEST_CHECK(!visible.empty());
+            }
+            else if (dp < -0.8f && it.coneCutoff < 1.f)
+            {
+                ++away;
+                TEST_CHECK(visible.empty());
+            }
+        }
+
+        TEST_CHECK(facing > 0);
+        TEST_CHECK(away > 0);
+
+        return success;
+    }
+}
+
+bool ModelTests::TestMeshlets()
+{
+    bool success = true;
+
+    TEST_CHECK(TestSphere(true));
+    TEST_CHECK(TestSphere(false));
+
+    return success;
+}
@@ -0,0 +1,412 @@
+//--------------------------------------------------------------------------------------
+// File: ModelDescriptionTest.cpp
+//
+// Checks that phase one of the two-phase load reads a model file into a description
+// without a device, and that the description round-trips through the baked format,
+// including the position decode and vertex counts of compacted vertices and the shared
+// buffers and part offsets of consolidated ones.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "ModelTests.h"
+
+#include "Model.h"
+#include "ModelBaked.h"
+#include "SDKMesh.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    // A VBO file holding a single quad
+    std::vector<uint8_t> MakeQuadVBO()
+    {
+        struct Vertex
+        {
+            XMFLOAT3 position;
+            XMFLOAT3 normal;
+            XMFLOAT2 textureCoordinate;
+        };
+
+        const Vertex vertices[] =
+        {
+            { XMFLOAT3(-1.f, -1.f, 0.f), XMFLOAT3(0.f, 0.f, 1.f), XMFLOAT2(0.f, 1.f) },
+            { XMFLOAT3(1.f, -1.f, 0.f), XMFLOAT3(0.f, 0.f, 1.f), XMFLOAT2(1.f, 1.f) },
+            { XMFLOAT3(1.f, 1.f, 0.f), XMFLOAT3(0.f, 0.f, 1.f), XMFLOAT2(1.f, 0.f) },
+            { XMFLOAT3(-1.f, 1.f, 0.f), XMFLOAT3(0.f, 0.f, 1.f), XMFLOAT2(0.f, 0.f) },
+        };
+
+        const uint16_t indices[] = { 0, 1, 2, 0, 2, 3 };
+
+        const uint32_t header[] = { uint32_t(std::size(vertices)), uint32_t(std::size(indices)) };
+
+        std::vector<uint8_t> file(sizeof(header) + sizeof(vertices) + sizeof(indices));
+        memcpy(file.data(), header, sizeof(header));
+        memcpy(file.data() + sizeof(header), vertices, sizeof(vertices));
+        memcpy(file.data() + sizeof(header) + sizeof(vertices), indices, sizeof(indices));
+        return file;
+    }
+
+    // An SDKMESH file holding flat 9 x 9 vertex grids from (0, 0, 0) to (8, 0, 8), each one a mesh
+    // with its own vertex and index buffer and a single subset, placed 10 apart along x
+    std::vector<uint8_t> MakeGridSDKMESH(uint32_t meshCount = 1)
+    {
+        using namespace DXUT;
+
+        struct Vertex
+        {
+            XMFLOAT3 position;
+            XMFLOAT3 normal;
+            XMFLOAT2 textureCoordinate;
+        };
+
+        constexpr uint32_t gridSize = 9;
+        constexpr uint32_t vertexCount = gridSize * gridSize;
+        constexpr uint32_t indexCount = (gridSize - 1) * (gridSize - 1) * 6;
+        constexpr uint64_t vbSize = vertexCount * sizeof(Vertex);
+        constexpr uint64_t ibSize = indexCount * sizeof(uint16_t);
+
+        const uint64_t headerSize = sizeof(SDKMESH_HEADER)
+            + meshCount * (sizeof(SDKMESH_VERTEX_BUFFER_HEADER) + sizeof(SDKMESH_INDEX_BUFFER_HEADER));
+        const uint64_t meshOffset = headerSize;
+        const uint64_t subsetOffset = meshOffset + meshCount * sizeof(SDKMESH_MESH);
+        const uint64_t frameOffset = subsetOffset + meshCount * sizeof(SDKMESH_SUBSET);
+        const uint64_t materialOffset = frameOffset + meshCount * sizeof(SDKMESH_FRAME);
+        const uint64_t subsetIndexOffset = materialOffset + sizeof(SDKMESH_MATERIAL);
+        const uint64_t vbOffset = subsetIndexOffset + meshCount * sizeof(uint32_t);
+        const uint64_t ibOffset = vbOffset + meshCount * vbSize;
+        const uint64_t fileSize = ibOffset + meshCount * ibSize;
+
+        std::vector<uint8_t> file(static_cast<size_t>(fileSize));
+        auto at = [&file](uint64_t offset) { return file.data() + offset; };
+
+        auto header = reinterpret_cast<SDKMESH_HEADER*>(at(0));
+        header->Version = SDKMESH_FILE_VERSION;
+        header->HeaderSize = headerSize;
+        header->NonBufferDataSize = vbOffset - headerSize;
+        header->BufferDataSize = fileSize - vbOffset;
+        header->NumVertexBuffers = meshCount;
+        header->NumIndexBuffers = meshCount;
+        header->NumMeshes = meshCount;
+        header->NumTotalSubsets = meshCount;
+        header->NumFrames = meshCount;
+        header->NumMaterials = 1;
+        header->VertexStreamHeadersOffset = sizeof(SDKMESH_HEADER);
+        header->IndexStreamHeadersOffset = sizeof(SDKMESH_HEADER) + meshCount * sizeof(SDKMESH_VERTEX_BUFFER_HEADER);
+        header->MeshDataOffset = meshOffset;
+        header->SubsetDataOffset = subsetOffset;
+        header->FrameDataOffset = frameOffset;
+        header->MaterialDataOffset = materialOffset;
+
+        const D3DVERTEXELEMENT9 decl[] =
+        {
+            { 0, 0, D3DDECLTYPE_FLOAT3, 0, D3DDECLUSAGE_POSITION, 0 },
+            { 0, 12, D3DDECLTYPE_FLOAT3, 0, D3DDECLUSAGE_NORMAL, 0 },
+            { 0, 24, D3DDECLTYPE_FLOAT2, 0, D3DDECLUSAGE_TEXCOORD, 0 },
+            { 0xFF, 0, D3DDECLTYPE_UNUSED, 0, 0, 0 },
+        };
+
+        auto mat = reinterpret_cast<SDKMESH_MATERIAL*>(at(materialOffset));
+        strcpy_s(mat->Name, "grid");
+        mat->Diffuse = XMFLOAT4(1.f, 1.f, 1.f, 1.f);
+        mat->Power = 16.f;
+
+        for (uint32_t m = 0; m < meshCount; ++m)
+        {
+            const float x0 = float(m) * 10.f;
+
+            auto vh = reinterpret_cast<SDKMESH_VERTEX_BUFFER_HEADER*>(at(header->VertexStreamHeadersOffset)) + m;
+            vh->NumVertices = vertexCount;
+            vh->SizeBytes = vbSize;
+            vh->StrideBytes = sizeof(Vertex);
+            memcpy(vh->Decl, decl, sizeof(decl));
+            vh->DataOffset = vbOffset + m * vbSize;
+
+            auto ih = reinterpret_cast<SDKMESH_INDEX_BUFFER_HEADER*>(at(header->IndexStreamHeadersOffset)) + m;
+            ih->NumIndices = indexCount;
+            ih->SizeBytes = ibSize;
+            ih->IndexType = IT_16BIT;
+            ih->DataOffset = ibOffset + m * ibSize;
+
+            auto verts = reinterpret_cast<Vertex*>(at(vh->DataOffset));
+            for (uint32_t y = 0; y < gridSize; ++y)
+            {
+                for (uint32_t x = 0; x < gridSize; ++x)
+                {
+                    auto& v = verts[y * gridSize + x];
+                    v.position = XMFLOAT3(x0 + float(x), 0.f, float(y));
+                    v.normal = XMFLOAT3(0.f, 1.f, 0.f);
+                    v.textureCoordinate = XMFLOAT2(float(x) / 8.f, float(y) / 8.f);
+                }
+            }
+
+            auto indices = reinterpret_cast<uint16_t*>(at(ih->DataOffset));
+            for (uint32_t y = 0; y + 1 < gridSize; ++y)
+            {
+                for (uint32_t x = 0; x + 1 < gridSize; ++x)
+                {
+                    const auto i = static_cast<uint16_t>(y * gridSize + x);
+                    *indices++ = i;
+                    *indices++ = static_cast<uint16_t>(i + gridSize);
+                    *indices++ = static_cast<uint16_t>(i + 1);
+                    *indices++ = static_cast<uint16_t>(i + 1);
+                    *indices++ = static_cast<uint16_t>(i + gridSize);
+                    *indices++ = static_cast<uint16_t>(i + gridSize + 1);
+                }
+            }
+
+            auto mh = reinterpret_cast<SDKMESH_MESH*>(at(meshOffset)) + m;
+            sprintf_s(mh->Name, "grid%u", m);
+            mh->VertexBuffers[0] = m;
+            mh->IndexBuffer = m;
+            mh->NumVertexBuffers = 1;
+            mh->NumSubsets = 1;
+            mh->BoundingBoxCenter = XMFLOAT3(x0 + 4.f, 0.f, 4.f);
+            mh->BoundingBoxExtents = XMFLOAT3(4.f, 0.f, 4.f);
+            mh->SubsetOffset = subsetIndexOffset + m * sizeof(uint32_t);
+            *reinterpret_cast<uint32_t*>(at(mh->SubsetOffset)) = m;
+
+            auto subset = reinterpret_cast<SDKMESH_SUBSET*>(at(subsetOffset)) + m;
+            subset->PrimitiveType = PT_TRIANGLE_LIST;
+            subset->IndexCount = indexCount;
+            subset->VertexCount = vertexCount;
+
+            auto frame = reinterpret_cast<SDKMESH_FRAME*>(at(frameOffset)) + m;
+            sprintf_s(frame->Name, "frame%u", m);
+            frame->Mesh = m;
+            frame->ParentFrame = INVALID_FRAME;
+            frame->ChildFrame = INVALID_FRAME;
+            frame->SiblingFrame = (m + 1 < meshCount) ? m + 1 : INVALID_FRAME;
+            XMStoreFloat4x4(&frame->Matrix, XMMatrixIdentity());
+            frame->AnimationDataIndex = INVALID_ANIMATION_DATA;
+        }
+
+        return file;
+    }
+
+    std::vector<uint8_t> ReadFile(const std::filesystem::path& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    // The parts of a baked file and the contents of its buffers
+    struct BakedFile
+    {
+        BakedModel::Header                  header = {};
+        std::vector<BakedModel::Part>       parts;
+        std::vector<std::vector<uint8_t>>   buffers;
+    };
+
+    // Returns false if a table, buffer or part buffer index is out of bounds
+    bool ReadBaked(const std::vector<uint8_t>& file, BakedFile& baked)
+    {
+        if (file.size() < sizeof(baked.header))
+            return false;
+
+        auto& header = baked.header;
+        memcpy(&header, file.data(), sizeof(header));
+        if (uint64_t(header.Parts.Offset) + uint64_t(header.Parts.Count) * sizeof(BakedModel::Part) > file.size()
+            || uint64_t(header.Buffers.Offset) + uint64_t(header.Buffers.Count) * sizeof(BakedModel::Buffer) > file.size())
+            return false;
+
+        baked.parts.resize(header.Parts.Count);
+        memcpy(baked.parts.data(), file.data() + header.Parts.Offset, baked.parts.size() * sizeof(BakedModel::Part));
+
+        for (uint32_t j = 0; j < header.Buffers.Count; ++j)
+        {
+            BakedModel::Buffer bh;
+            memcpy(&bh, file.data() + header.Buffers.Offset + j * sizeof(bh), sizeof(bh));
+            if (uint64_t(bh.DataOffset) + bh.SizeBytes > file.size())
+                return false;
+
+            baked.buffers.emplace_back(file.begin() + bh.DataOffset, file.begin() + bh.DataOffset + bh.SizeBytes);
+        }
+
+        for (const auto& it : baked.parts)
+        {
+            if (it.VertexBuffer >= header.Buffers.Count || it.IndexBuffer >= header.Buffers.Count)
+                return false;
+        }
+
+        return true;
+    }
+
+    std::vector<uint8_t> Concatenate(std::vector<uint8_t> a, const std::vector<uint8_t>& b)
+    {
+        a.insert(a.end(), b.begin(), b.end());
+        return a;
+    }
+
+    bool Throws(const std::vector<uint8_t>& file, ModelFileFormat format = ModelFile_VBO)
+    {
+        try
+        {
+            ModelDescription::CreateFromMemory(format, file.data(), file.size());
+        }
+        catch (const std::exception&)
+        {
+            return true;
+        }
+
+        return false;
+    }
+}
+
+bool ModelTests::TestModelDescription()
+{
+    bool success = true;
+
+    const auto file = MakeQuadVBO();
+
+    auto desc = ModelDescription::CreateFromMemory(ModelFile_VBO, file.data(), file.size());
+    TEST_CHECK(desc->GetFormat() == ModelFile_VBO);
+    TEST_CHECK(desc->GetMeshCount() == 1);
+    TEST_CHECK(desc->GetTextureNames().empty());
+    TEST_CHECK(desc->GetDataSize() == file.size());
+
+    // The description keeps its own copy of the file
+    TEST_CHECK(desc->GetData() != file.data());
+
+    // Truncated vertex and index data is rejected in phase one
+    TEST_CHECK(Throws(std::vector<uint8_t>(file.begin(), file.begin() + 4)));
+    TEST_CHECK(Throws(std::vector<uint8_t>(file.begin(), file.begin() + 40)));
+    TEST_CHECK(Throws(std::vector<uint8_t>(file.begin(), file.end() - 2)));
+
+    // Writing the baked format and reading it back needs no device either
+    const auto path = std::filesystem::temp_directory_path() / L"modeltest_description.dtkm";
+
+    desc->WriteBaked(path.c_str());
+
+    auto baked = ModelDescription::CreateFromFile(ModelFile_Baked, path.c_str());
+    TEST_CHECK(baked->GetFormat() == ModelFile_Baked);
+    TEST_CHECK(baked->GetMeshCount() == desc->GetMeshCount());
+    TEST_CHECK(baked->GetTextureNames().empty());
+    TEST_CHECK(baked->GetDataSize() > file.size());
+
+    // The same description can be baked again
+    desc->WriteBaked(path.c_str());
+
+    // Compacted positions only decode correctly if the baked file keeps the scale and bias
+    {
+        const auto grid = MakeGridSDKMESH();
+
+        auto compact = ModelDescription::CreateFromMemory(ModelFile_SDKMESH, grid.data(), grid.size(),
+            ModelLoader_Clockwise | ModelLoader_CompactVertices);
+        compact->WriteBaked(path.c_str());
+
+        const auto first = ReadFile(path);
+        TEST_CHECK(first.size() > sizeof(BakedModel::Header));
+        if (first.size() > sizeof(BakedModel::Header))
+        {
+            BakedModel::Header header;
+            memcpy(&header, first.data(), sizeof(header));
+            TEST_CHECK(header.Version == BakedModel::VERSION);
+            TEST_CHECK(header.Meshes.Count == 1 && header.Parts.Count == 1);
+
+            if (header.Meshes.Count == 1 && header.Parts.Count == 1
+                && uint64_t(header.Meshes.Offset) + sizeof(BakedModel::Mesh) <= first.size()
+                && uint64_t(header.Parts.Offset) + sizeof(BakedModel::Part) <= first.size())
+            {
+                BakedModel::Mesh mesh;
+                memcpy(&mesh, first.data() + header.Meshes.Offset, sizeof(mesh));
+                TEST_CHECK(mesh.PositionScale == 4.f);
+                TEST_CHECK(mesh.PositionBias.x == 4.f && mesh.PositionBias.y == 0.f && mesh.PositionBias.z == 4.f);
+
+                BakedModel::Part part;
+                memcpy(&part, first.data() + header.Parts.Offset, sizeof(part));
+                TEST_CHECK(part.VertexCount == 81);
+            }
+        }
+
+        // Reading the baked file restores everything, so baking it again gives the same bytes
+        auto reloaded = ModelDescription::CreateFromFile(ModelFile_Baked, path.c_str());
+        reloaded->WriteBaked(path.c_str());
+
+        TEST_CHECK(ReadFile(path) == first);
+    }
+
+    // Consolidated meshes share one vertex and one index buffer, holding the data of the
+    // separate buffers back to back, and each part is offset to where its data went
+    {
+        const auto grids = MakeGridSDKMESH(2);
+
+        auto separate = ModelDescription::CreateFromMemory(ModelFile_SDKMESH, grids.data(), grids.size(),
+            ModelLoader_Clockwise);
+        separate->WriteBaked(path.c_str());
+        const auto separateFile = ReadFile(path);
+
+        auto consolidated = ModelDescription::CreateFromMemory(ModelFile_SDKMESH, grids.data(), grids.size(),
+            ModelLoader_Clockwise | ModelLoader_ConsolidateBuffers);
+        TEST_CHECK(consolidated->GetMeshCount() == 2);
+        consolidated->WriteBaked(path.c_str());
+        const auto consolidatedFile = ReadFile(path);
+
+        BakedFile before;
+        BakedFile after;
+        const bool readable = ReadBaked(separateFile, before) && ReadBaked(consolidatedFile, after);
+        TEST_CHECK(readable);
+        TEST_CHECK(before.parts.size() == 2 && after.parts.size() == 2);
+
+        if (readable && before.parts.size() == 2 && after.parts.size() == 2)
+        {
+            TEST_CHECK(before.buffers.size() == 4);
+            TEST_CHECK(after.buffers.size() == 2);
+
+            const auto& first = after.parts[0];
+            const auto& second = after.parts[1];
+            TEST_CHECK(first.VertexBuffer == second.VertexBuffer && first.IndexBuffer == second.IndexBuffer);
+            TEST_CHECK(first.VertexOffset == 0 && first.StartIndex == 0);
+            TEST_CHECK(second.VertexOffset == 81 && second.StartIndex == 384);
+            TEST_CHECK(first.VertexCount == 81 && second.VertexCount == 81);
+
+            TEST_CHECK(after.buffers[first.VertexBuffer]
+                == Concatenate(before.buffers[before.parts[0].VertexBuffer], before.buffers[before.parts[1].VertexBuffer]));
+            TEST_CHECK(after.buffers[first.IndexBuffer]
+                == Concatenate(before.buffers[before.parts[0].IndexBuffer], before.buffers[before.parts[1].IndexBuffer]));
+        }
+
+        // The shared buffers survive a round trip through the baked format
+        auto reloaded = ModelDescription::CreateFromFile(ModelFile_Baked, path.c_str());
+        reloaded->WriteBaked(path.c_str());
+
+        TEST_CHECK(ReadFile(path) == consolidatedFile);
+
+        // Parts that reach outside their buffers are rejected when the file is read
+        if (readable && after.parts.size() == 2)
+        {
+            auto corrupt = [&](auto&& change)
+            {
+                auto file = consolidatedFile;
+                auto part = after.parts[1];
+                change(part);
+                memcpy(file.data() + after.header.Parts.Offset + sizeof(part), &part, sizeof(part));
+                return Throws(file, ModelFile_Baked);
+            };
+
+            TEST_CHECK(corrupt([](BakedModel::Part& part) { part.IndexCount += 3; }));
+            TEST_CHECK(corrupt([](BakedModel::Part& part) { part.VertexStride = 0; }));
+            TEST_CHECK(corrupt([](BakedModel::Part& part) { part.VertexOffset += part.VertexCount; }));
+            TEST_CHECK(corrupt([](BakedModel::Part& part) { part.PrimitiveType = 0; }));
+            TEST_CHECK(!corrupt([](BakedModel::Part&) {}));
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+
+    return success;
+}
@@ -0,0 +1,33 @@
+//--------------------------------------------------------------------------------------
+// File: ModelTests.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdio>
+
+// Reports a failed check with its location and makes the enclosing test fail
+#define TEST_CHECK(expr) \
+    if (!(expr)) \
+    { \
+        printf("ERROR: %s(%d): %s\n", __FILE__, __LINE__, #expr); \
+        success = false; \
+    }
+
+namespace ModelTests
+{
+    // Each test returns true on success and prints the reason for any failure
+    bool TestBoneOrder();
+    bool TestBoneTransformPool();
+    bool TestCulling();
+    bool TestMeshlets();
+    bool TestModelDescription();
+    bool TestPicking();
+    bool TestSimplifyMesh();
+    bool TestStatistics();
+}
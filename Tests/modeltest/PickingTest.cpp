@@ -0,0 +1,362 @@
+//--------------------------------------------------------------------------------------
+// File: PickingTest.cpp
+//
+// Checks the picking hierarchy against a test of every triangle, rays that run along the
+// faces of its bounding box, geometry built from compacted vertices against the float
+// originals, and ModelPicker on several threads against one.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "ModelTests.h"
+
+#include <cassert>
+#include <wrl/client.h>
+
+#include <DirectXPackedVector.h>
+
+#include "GeometricPrimitive.h"
+#include "ModelHelpers.h"
+#include "ModelPicking.h"
+#include "VertexTypes.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace DirectX;
+using namespace DirectX::SimpleMath;
+
+namespace
+{
+    using VertexCollection = GeometricPrimitive::VertexCollection;
+    using IndexCollection = GeometricPrimitive::IndexCollection;
+
+    constexpr size_t c_RayCount = 500;
+    constexpr size_t c_InstanceCount = 1000;
+
+    // Same arithmetic as the hierarchy leaves, so both agree on rays that graze an edge
+    bool XM_CALLCONV IntersectTriangle(FXMVECTOR origin, FXMVECTOR direction,
+        const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c, float& distance)
+    {
+        const XMVECTOR v0 = XMLoadFloat3(&a);
+        const XMVECTOR e1 = XMVectorSubtract(XMLoadFloat3(&b), v0);
+        const XMVECTOR e2 = XMVectorSubtract(XMLoadFloat3(&c), v0);
+
+        const XMVECTOR p = XMVector3Cross(direction, e2);
+        const float det = XMVectorGetX(XMVector3Dot(e1, p));
+        if (det == 0.f)
+            return false;
+
+        const float invDet = 1.f / det;
+
+        const XMVECTOR s = XMVectorSubtract(origin, v0);
+        const float u = XMVectorGetX(XMVector3Dot(s, p)) * invDet;
+        if (u < 0.f || u > 1.f)
+            return false;
+
+        const XMVECTOR q = XMVector3Cross(s, e1);
+        const float w = XMVectorGetX(XMVector3Dot(direction, q)) * invDet;
+        if (w < 0.f || u + w > 1.f)
+            return false;
+
+        const float t = XMVectorGetX(XMVector3Dot(e2, q)) * invDet;
+        if (t < 0.f)
+            return false;
+
+        distance = t;
+        return true;
+    }
+
+    bool XM_CALLCONV IntersectFace(FXMVECTOR origin, FXMVECTOR direction,
+        const VertexCollection& vertices, const IndexCollection& indices, size_t face, float& distance)
+    {
+        return IntersectTriangle(origin, direction,
+            vertices[indices[face * 3]].position,
+            vertices[indices[face * 3 + 1]].position,
+            vertices[indices[face * 3 + 2]].position,
+            distance);
+    }
+
+    // An 8 x 8 grid of unit squares in the x = 0 plane, spanning -4 to 4 in y and z
+    void MakeGrid(VertexCollection& vertices, IndexCollection& indices)
+    {
+        vertices.clear();
+        indices.clear();
+
+        for (int y = 0; y <= 8; ++y)
+        {
+            for (int z = 0; z <= 8; ++z)
+            {
+                vertices.push_back(VertexPositionNormalTexture(
+                    XMFLOAT3(0.f, float(y - 4), float(z - 4)), XMFLOAT3(1.f, 0.f, 0.f), XMFLOAT2(0.f, 0.f)));
+            }
+        }
+
+        for (uint16_t y = 0; y < 8; ++y)
+        {
+            for (uint16_t z = 0; z < 8; ++z)
+            {
+                const auto i = static_cast<uint16_t>(y * 9 + z);
+                indices.insert(indices.end(), { i, static_cast<uint16_t>(i + 9), static_cast<uint16_t>(i + 10) });
+                indices.insert(indices.end(), { i, static_cast<uint16_t>(i + 10), static_cast<uint16_t>(i + 1) });
+            }
+        }
+    }
+
+    // Small linear congruential generator, so runs are repeatable
+    class Random
+    {
+    public:
+        float Next(float lo, float hi) noexcept
+        {
+            mState = mState * 1664525u + 1013904223u;
+            return lo + (hi - lo) * float(mState >> 8) / float(1u << 24);
+        }
+
+    private:
+        uint32_t mState = 12345u;
+    };
+}
+
+bool ModelTests::TestPicking()
+{
+    bool success = true;
+
+    // Rays parallel to the grid plane that start on a face of its bounding box give 0 * inf
+    // in the slab test; they must still reach the edge of the grid they run along.
+    {
+        VertexCollection vertices;
+        IndexCollection indices;
+        MakeGrid(vertices, indices);
+
+        ModelMeshGeometry geometry;
+        geometry.AddTriangles(0, indices.data(), indices.size() / 3,
+            &vertices[0].position, sizeof(VertexCollection::value_type), vertices.size());
+        geometry.Build();
+
+        TEST_CHECK(geometry.GetTriangleCount() == indices.size() / 3);
+
+        const struct
+        {
+            XMFLOAT3 origin;
+            XMFLOAT3 direction;
+        } c_EdgeRays[] =
+        {
+            { XMFLOAT3(-5.f, 4.f, 0.5f), XMFLOAT3(1.f, 0.f, 0.f) },     // Along the top edge
+            { XMFLOAT3(5.f, -4.f, 0.5f), XMFLOAT3(-1.f, 0.f, 0.f) },    // Along the bottom edge, from behind
+            { XMFLOAT3(-5.f, 0.5f, 4.f), XMFLOAT3(1.f, 0.f, 0.f) },     // Along a side edge
+            { XMFLOAT3(-5.f, 4.f, -4.f), XMFLOAT3(1.f, 0.f, 0.f) },     // At a corner
+        };
+
+        for (const auto& ray : c_EdgeRays)
+        {
+            float distance = 0.f;
+            uint32_t partIndex, triangleIndex;
+            TEST_CHECK(geometry.Intersects(XMLoadFloat3(&ray.origin), XMLoadFloat3(&ray.direction), FLT_MAX,
+                distance, partIndex, triangleIndex));
+            TEST_CHECK(distance == 5.f);
+        }
+
+        // The same rays stopped short of the plane miss
+        for (const auto& ray : c_EdgeRays)
+        {
+            float distance;
+            uint32_t partIndex, triangleIndex;
+            TEST_CHECK(!geometry.Intersects(XMLoadFloat3(&ray.origin), XMLoadFloat3(&ray.direction), 4.5f,
+                distance, partIndex, triangleIndex));
+        }
+
+        // A ray inside the plane of the grid sees no area to hit
+        {
+            float distance;
+            uint32_t partIndex, triangleIndex;
+            TEST_CHECK(!geometry.Intersects(XMVectorSet(0.f, 0.5f, -5.f, 0.f), XMVectorSet(0.f, 0.f, 1.f, 0.f), FLT_MAX,
+                distance, partIndex, triangleIndex));
+        }
+    }
+
+    // Closest hits match a test of every triangle, and the part and triangle reported
+    // lead back to a triangle at that distance
+    VertexCollection vertices;
+    IndexCollection indices;
+    GeometricPrimitive::CreateTorus(vertices, indices, 2.f, 0.5f, 16);
+
+    const size_t nFaces = indices.size() / 3;
+    const size_t firstPartFaces = nFaces / 3;
+
+    auto geometry = std::make_shared<ModelMeshGeometry>();
+    geometry->AddTriangles(0, indices.data(), firstPartFaces,
+        &vertices[0].position, sizeof(VertexCollection::value_type), vertices.size());
+    geometry->AddTriangles(1, indices.data() + firstPartFaces * 3, nFaces - firstPartFaces,
+        &vertices[0].position, sizeof(VertexCollection::value_type), vertices.size());
+    geometry->Build();
+
+    TEST_CHECK(geometry->GetTriangleCount() == nFaces);
+
+    Random random;
+    size_t hits = 0;
+    for (size_t r = 0; r < c_RayCount; ++r)
+    {
+        const XMVECTOR origin = XMVectorSet(random.Next(-4.f, 4.f), random.Next(-2.f, 2.f), random.Next(-4.f, 4.f), 0.f);
+        const XMVECTOR target = XMVectorSet(random.Next(-2.5f, 2.5f), random.Next(-0.5f, 0.5f), random.Next(-2.5f, 2.5f), 0.f);
+        const XMVECTOR direction = XMVectorSubtract(target, origin);
+
+        float expected = FLT_MAX;
+        for (size_t face = 0; face < nFaces; ++face)
+        {
+            float t;
+            if (IntersectFace(origin, direction, vertices, indices, face, t) && t < expected)
+                expected = t;
+        }
+
+        float distance;
+        uint32_t partIndex, triangleIndex;
+        const bool hit = geometry->Intersects(origin, direction, FLT_MAX, distance, partIndex, triangleIndex);
+
+        TEST_CHECK(hit == (expected != FLT_MAX));
+        if (!hit || expected == FLT_MAX)
+            continue;
+
+        ++hits;
+        TEST_CHECK(distance == expected);
+
+        const size_t face = (partIndex == 0) ? triangleIndex : firstPartFaces + triangleIndex;
+        TEST_CHECK(partIndex <= 1 && face < nFaces);
+        if (face < nFaces)
+        {
+            float t;
+            TEST_CHECK(IntersectFace(origin, direction, vertices, indices, face, t) && t == distance);
+        }
+    }
+
+    // Enough rays reach the surface for the comparison to mean something
+    TEST_CHECK(hits > c_RayCount / 4);
+
+    // Parts whose positions were compacted to SNORM16, as baked models written from a
+    // ModelLoader_CompactVertices load and retained with ModelLoader_RetainGeometry have,
+    // are decoded with the mesh's scale and bias rather than skipped
+    {
+        const ModelMeshPart::InputLayoutCollection decl(VertexPositionNormalTexture::InputElements,
+            VertexPositionNormalTexture::InputElements + VertexPositionNormalTexture::InputElementCount);
+        constexpr auto stride = static_cast<uint32_t>(sizeof(VertexCollection::value_type));
+        const auto vbData = reinterpret_cast<const uint8_t*>(vertices.data());
+
+        ModelMesh mesh;
+        ModelHelpers::PositionBounds bounds;
+        bounds.Add(decl, stride, vbData, vertices.size());
+        TEST_CHECK(bounds.GetScaleBias(mesh.positionScale, mesh.positionBias));
+
+        ModelMeshPart::InputLayoutCollection compactDecl;
+        uint32_t compactStride = 0;
+        std::vector<uint8_t> compacted;
+        bool biasedNormals = false;
+        TEST_CHECK(ModelHelpers::CompactVertices(decl, stride, vbData, vertices.size(), ModelHelpers::COMPACT_POSITIONS,
+            mesh.positionScale, mesh.positionBias, compactDecl, compactStride, compacted, biasedNormals));
+
+        ModelMeshPart part;
+        part.indexCount = static_cast<uint32_t>(indices.size());
+        part.vertexStride = compactStride;
+        part.indexFormat = DXGI_FORMAT_R16_UINT;
+
+        ModelMeshGeometry compact;
+        TEST_CHECK(ModelHelpers::AddPartGeometry(compact, 0, mesh, part, compactDecl, compactStride,
+            compacted.data(), compacted.size(),
+            reinterpret_cast<const uint8_t*>(indices.data()), indices.size() * sizeof(uint16_t)));
+        compact.Build();
+
+        TEST_CHECK(compact.GetTriangleCount() == nFaces);
+
+        // Rays from outside the torus through triangle centroids hit both within the
+        // quantization error of the positions
+        size_t centroidRays = 0;
+        for (size_t face = 0; face < nFaces; face += 7)
+        {
+            const XMVECTOR centroid = XMVectorScale(XMVectorAdd(XMVectorAdd(
+                XMLoadFloat3(&vertices[indices[face * 3]].position),
+                XMLoadFloat3(&vertices[indices[face * 3 + 1]].position)),
+                XMLoadFloat3(&vertices[indices[face * 3 + 2]].position)), 1.f / 3.f);
+            const XMVECTOR origin = XMVectorAdd(XMVectorScale(centroid, 3.f), XMVectorSet(0.f, 4.f, 0.f, 0.f));
+            const XMVECTOR direction = XMVectorSubtract(centroid, origin);
+
+            float expected, distance;
+            uint32_t partIndex, triangleIndex;
+            const bool floatHit = geometry->Intersects(origin, direction, FLT_MAX, expected, partIndex, triangleIndex);
+            const bool compactHit = compact.Intersects(origin, direction, FLT_MAX, distance, partIndex, triangleIndex);
+
+            TEST_CHECK(floatHit && compactHit);
+            if (floatHit && compactHit)
+            {
+                ++centroidRays;
+                TEST_CHECK(fabsf(distance - expected) < 1e-3f);
+            }
+        }
+
+        TEST_CHECK(centroidRays > 0);
+    }
+
+    // The picker gives the same result on any number of threads, and the same result as
+    // picking each instance on its own
+    Model model;
+    {
+        auto mesh = std::make_shared<ModelMesh>();
+        mesh->geometry = geometry;
+        model.meshes.emplace_back(std::move(mesh));
+    }
+
+    std::vector<const Model*> models(c_InstanceCount, &model);
+    auto worlds = std::make_unique<XMMATRIX[]>(c_InstanceCount);
+    for (size_t i = 0; i < c_InstanceCount; ++i)
+    {
+        // Some instances share a position, so equal distances have to pick the earlier one
+        worlds[i] = XMMatrixMultiply(XMMatrixRotationY(float(i % 7) * 0.4f),
+            XMMatrixTranslation(float(i % 40) * 3.f - 60.f, 0.f, -float(i % 25) * 3.f));
+    }
+
+    ModelPicker single;
+    ModelPicker threaded;
+
+    for (size_t r = 0; r < 32; ++r)
+    {
+        const Ray ray(Vector3(random.Next(-60.f, 60.f), 10.f, random.Next(-72.f, 0.f)),
+            Vector3(random.Next(-0.5f, 0.5f), -1.f, random.Next(-0.5f, 0.5f)));
+
+        ModelPickResult expected = {};
+        bool expectedHit = false;
+        for (size_t i = 0; i < c_InstanceCount; ++i)
+        {
+            ModelPickResult result;
+            if (single.Pick(ray, FLT_MAX, model, worlds[i], result)
+                && (!expectedHit || result.distance < expected.distance))
+            {
+                expected = result;
+                expected.instanceIndex = static_cast<uint32_t>(i);
+                expectedHit = true;
+            }
+        }
+
+        ModelPickResult one = {};
+        ModelPickResult four = {};
+        const bool oneHit = single.Pick(ray, FLT_MAX, c_InstanceCount, models.data(), worlds.get(), one, 1);
+        const bool fourHit = threaded.Pick(ray, FLT_MAX, c_InstanceCount, models.data(), worlds.get(), four, 4);
+
+        TEST_CHECK(oneHit == expectedHit);
+        TEST_CHECK(fourHit == expectedHit);
+        if (!expectedHit || !oneHit || !fourHit)
+            continue;
+
+        TEST_CHECK(one.distance == expected.distance && one.instanceIndex == expected.instanceIndex);
+        TEST_CHECK(four.distance == one.distance);
+        TEST_CHECK(four.instanceIndex == one.instanceIndex);
+        TEST_CHECK(four.meshIndex == one.meshIndex);
+        TEST_CHECK(four.partIndex == one.partIndex);
+        TEST_CHECK(four.triangleIndex == one.triangleIndex);
+    }
+
+    return success;
+}
@@ -0,0 +1,131 @@
+//--------------------------------------------------------------------------------------
+// File: SimplifyMeshTest.cpp
+//
+// Checks SimplifyMesh on GeometricPrimitive shapes: the face count goes down, the error
+// reported stays within the bound asked for, and the indices still form valid triangles.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "ModelTests.h"
+
+#include "GeometricPrimitive.h"
+#include "ModelLOD.h"
+
+#include <cfloat>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    using VertexCollection = GeometricPrimitive::VertexCollection;
+    using IndexCollection = GeometricPrimitive::IndexCollection;
+
+    float Simplify(const VertexCollection& vertices, const IndexCollection& indices,
+        size_t targetFaces, float maxError, IndexCollection& result)
+    {
+        return SimplifyMesh(indices.data(), indices.size() / 3,
+            &vertices[0].position, sizeof(VertexCollection::value_type), vertices.size(),
+            targetFaces, maxError, result);
+    }
+
+    // Every index refers to a vertex and no triangle has collapsed to a line or a point
+    bool ValidTriangles(const IndexCollection& indices, size_t nVerts)
+    {
+        if (indices.size() % 3)
+            return false;
+
+        for (size_t j = 0; j < indices.size(); j += 3)
+        {
+            const uint16_t a = indices[j];
+            const uint16_t b = indices[j + 1];
+            const uint16_t c = indices[j + 2];
+
+            if (a >= nVerts || b >= nVerts || c >= nVerts || a == b || b == c || a == c)
+                return false;
+        }
+
+        return true;
+    }
+}
+
+bool ModelTests::TestSimplifyMesh()
+{
+    bool success = true;
+
+    // Torus: a closed surface, with attribute seams that must stay in place
+    {
+        VertexCollection vertices;
+        IndexCollection indices;
+        GeometricPrimitive::CreateTorus(vertices, indices, 2.f, 0.5f, 32);
+
+        const size_t nFaces = indices.size() / 3;
+        const size_t targetFaces = nFaces * 3 / 4;
+
+        // Each collapse removes the two triangles on its edge, so the target can be passed by one
+        IndexCollection result;
+        const float error = Simplify(vertices, indices, targetFaces, FLT_MAX, result);
+
+        TEST_CHECK(ValidTriangles(result, vertices.size()));
+        TEST_CHECK(result.size() / 3 <= targetFaces);
+        TEST_CHECK(result.size() / 3 + 1 >= targetFaces);
+        TEST_CHECK(error > 0.f);
+
+        // Collapses are applied in order of error, so a bound stops the same sequence sooner
+        constexpr float c_MaxError = 0.05f;
+
+        IndexCollection bounded;
+        const float boundedError = Simplify(vertices, indices, targetFaces, c_MaxError, bounded);
+
+        TEST_CHECK(ValidTriangles(bounded, vertices.size()));
+        TEST_CHECK(boundedError <= c_MaxError);
+        TEST_CHECK(boundedError <= error);
+        TEST_CHECK(bounded.size() >= result.size());
+        TEST_CHECK(bounded.size() < indices.size());
+    }
+
+    // Sphere: the triangles at the poles have no area, and the pole vertices are all locked
+    {
+        VertexCollection vertices;
+        IndexCollection indices;
+        GeometricPrimitive::CreateSphere(vertices, indices, 1.f, 32);
+
+        const size_t nFaces = indices.size() / 3;
+        const size_t targetFaces = nFaces * 3 / 4;
+
+        IndexCollection result;
+        const float error = Simplify(vertices, indices, targetFaces, FLT_MAX, result);
+
+        TEST_CHECK(ValidTriangles(result, vertices.size()));
+        TEST_CHECK(result.size() / 3 <= targetFaces);
+        TEST_CHECK(error > 0.f);
+
+        constexpr float c_MaxError = 1e-3f;
+
+        IndexCollection bounded;
+        const float boundedError = Simplify(vertices, indices, targetFaces, c_MaxError, bounded);
+
+        TEST_CHECK(ValidTriangles(bounded, vertices.size()));
+        TEST_CHECK(boundedError <= c_MaxError);
+        TEST_CHECK(bounded.size() >= result.size());
+    }
+
+    // A target at the face count leaves the mesh unchanged
+    {
+        VertexCollection vertices;
+        IndexCollection indices;
+        GeometricPrimitive::CreateTorus(vertices, indices, 1.f, 0.333f, 8);
+
+        IndexCollection result;
+        const float error = Simplify(vertices, indices, indices.size() / 3, FLT_MAX, result);
+
+        TEST_CHECK(error == 0.f);
+        TEST_CHECK(result == indices);
+    }
+
+    return success;
+}
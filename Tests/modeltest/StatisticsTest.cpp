@@ -0,0 +1,98 @@
+//--------------------------------------------------------------------------------------
+// File: StatisticsTest.cpp
+//
+// Checks that ModelStatistics only looks textures up in the factory cache and never asks
+// the factory to load one.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "ModelTests.h"
+
+#include "Effects.h"
+#include "Model.h"
+
+#include <memory>
+#include <stdexcept>
+
+using namespace DirectX;
+
+namespace
+{
+    // A factory with an empty cache that records what it was asked for
+    class CountingFactory : public IEffectFactory
+    {
+    public:
+        size_t effectRequests = 0;
+        size_t textureRequests = 0;
+        size_t cacheLookups = 0;
+
+        std::shared_ptr<IEffect> __cdecl CreateEffect(const EffectInfo&, ID3D11DeviceContext*) override
+        {
+            ++effectRequests;
+            throw std::runtime_error("CountingFactory does not create effects");
+        }
+
+        void __cdecl CreateTexture(const wchar_t*, ID3D11DeviceContext*, ID3D11ShaderResourceView** textureView) override
+        {
+            ++textureRequests;
+            *textureView = nullptr;
+            throw std::runtime_error("CountingFactory does not load textures");
+        }
+
+        bool __cdecl GetCachedTexture(const wchar_t*, ID3D11ShaderResourceView** textureView) override
+        {
+            ++cacheLookups;
+            *textureView = nullptr;
+            return false;
+        }
+    };
+}
+
+bool ModelTests::TestStatistics()
+{
+    bool success = true;
+
+    Model model;
+    model.name = L"textured";
+    model.textureNames = { L"diffuse.dds", L"normal.dds", L"specular.dds" };
+
+    {
+        auto mesh = std::make_shared<ModelMesh>();
+        mesh->name = L"empty";
+        model.meshes.emplace_back(std::move(mesh));
+    }
+
+    CountingFactory factory;
+
+    ModelStatistics stats;
+    stats.Add(model, &factory);
+
+    TEST_CHECK(factory.textureRequests == 0);
+    TEST_CHECK(factory.effectRequests == 0);
+    TEST_CHECK(factory.cacheLookups == model.textureNames.size());
+
+    const auto& totals = stats.GetTotals();
+    TEST_CHECK(totals.modelCount == 1);
+    TEST_CHECK(totals.meshCount == 1);
+    TEST_CHECK(totals.textureCount == 0);
+    TEST_CHECK(totals.textureBytes == 0);
+    TEST_CHECK(totals.textureMisses == model.textureNames.size());
+
+    // A model added again counts as another model, but its shared meshes only once
+    stats.Add(model, &factory);
+    TEST_CHECK(stats.GetTotals().modelCount == 2);
+    TEST_CHECK(stats.GetTotals().meshCount == 1);
+    TEST_CHECK(factory.textureRequests == 0);
+
+    // Without a factory no textures are looked at
+    stats.Reset();
+    stats.Add(model);
+    TEST_CHECK(stats.GetTotals().textureMisses == 0);
+    TEST_CHECK(factory.cacheLookups == model.textureNames.size() * 2);
+
+    return success;
+}
@@ -0,0 +1,69 @@
+//--------------------------------------------------------------------------------------
+// File: main.cpp
+//
+// Tests for the CPU side of the model runtime. None of them need a Direct3D device.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "ModelTests.h"
+
+#include <cstdio>
+#include <exception>
+#include <iterator>
+
+namespace
+{
+    struct TestInfo
+    {
+        const char* name;
+        bool (*func)();
+    };
+
+    const TestInfo g_Tests[] =
+    {
+        { "BoneOrder", ModelTests::TestBoneOrder },
+        { "BoneTransformPool", ModelTests::TestBoneTransformPool },
+        { "Culling", ModelTests::TestCulling },
+        { "Meshlets", ModelTests::TestMeshlets },
+        { "ModelDescription", ModelTests::TestModelDescription },
+        { "Picking", ModelTests::TestPicking },
+        { "SimplifyMesh", ModelTests::TestSimplifyMesh },
+        { "Statistics", ModelTests::TestStatistics },
+    };
+}
+
+int main()
+{
+    size_t failed = 0;
+
+    for (const auto& test : g_Tests)
+    {
+        bool passed = false;
+        try
+        {
+            passed = test.func();
+        }
+        catch (const std::exception& e)
+        {
+            printf("ERROR: %s threw an exception: %s\n", test.name, e.what());
+        }
+
+        printf("%s: %s\n", test.name, passed ? "PASSED" : "FAILED");
+
+        if (!passed)
+            ++failed;
+    }
+
+    if (failed > 0)
+    {
+        printf("%zu of %zu tests FAILED\n", failed, std::size(g_Tests));
+        return 1;
+    }
+
+    printf("All %zu tests PASSED\n", std::size(g_Tests));
+    return 0;
+}